@@ -25,6 +25,8 @@ INDEX_NODE          = 21    # Returned decoded node message
 INDEX_ROOT          = 22    # Returned decoded root message
 INDEX_ROOT_LINK     = 23    # Returned decoded link to next root (i.e. last root)
 INVALID_DATA        = 24    # Packet data is invalid for some reason
+INVALID_PARAMETER   = 25    # Passed parameter is invalid
+NO_MEMORY           = 26    # Memory allocation failed
 
 def Message (StatusNum):
     if   StatusNum == OK                : return "OK"
@@ -52,5 +54,7 @@ def Message (StatusNum):
     elif StatusNum == INDEX_ROOT        : return "Root Index Returned"
     elif StatusNum == INDEX_ROOT_LINK   : return "Root Index Link"
     elif StatusNum == INVALID_DATA      : return "Invalid Data"
+    elif StatusNum == INVALID_PARAMETER : return "Invalid Parameter"
+    elif StatusNum == NO_MEMORY         : return "Out of Memory"
     else                                : return "Undefined"
 
@@ -88,6 +88,12 @@ extern "C" {
 
 #define I106_CALL_DECL
 
+// Use SSE2 intrinsics for some of the low level scanning and checksum
+// routines if the compiler says they are available.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define I106_SSE2
+#endif
+
 // Turn on network support
 // #define IRIG_NETWORKING
 
@@ -115,6 +115,9 @@ namespace Irig106 {
 #endif
 
 #define RCV_BUFFER_START_SIZE   32768
+
+// The network stream data for a handle lives in the handle context
+#define NET_HANDLE(iHandle)     (psuI106Handle(iHandle)->psuNetHandle)
 #define MAX_UDP_WRITE_SIZE      32726   // From Chapter 10.3.9.1.3
 //#define MAX_UDP_WRITE_SIZE      104   // From Chapter 10.3.9.1.3
 
@@ -125,7 +128,7 @@ namespace Irig106 {
  */
 
 /// Data structure for IRIG 106 network handle
-typedef struct
+typedef struct SuI106Ch10NetHandle_S
     {
     EnI106Ch10Mode          enNetMode;
     SOCKET                  suIrigSocket;
@@ -161,8 +164,6 @@ typedef struct
  * -----------
  */
 
-static int                  m_bHandlesInited = bFALSE;
-static SuI106Ch10NetHandle  m_suNetHandle[MAX_HANDLES];
 const char*                 m_aucMcastInterface = MULTICAST_LISTEN_INTERFACE;
 const char*                 m_aucMcastBcastAddr = MULTICAST_BROADCAST_ADDRESS;
 
@@ -171,6 +172,8 @@ const char*                 m_aucMcastBcastAddr = MULTICAST_BROADCAST_ADDRESS;
  * --------------------
  */
 
+static SuI106Ch10NetHandle * psuGetNetHandle(int iHandle);
+
 
 /* ----------------------------------------------------------------------- */
 
@@ -181,7 +184,6 @@ const char*                 m_aucMcastBcastAddr = MULTICAST_BROADCAST_ADDRESS;
 EnI106Status I106_CALL_DECL
     enI106_OpenNetStreamRead(int iHandle, uint16_t uPort)
     {
-    int                     iIdx;
     int                     iResult;
     struct sockaddr_in      ServerAddr;
 #if defined(_WIN32)
@@ -189,15 +191,9 @@ EnI106Status I106_CALL_DECL
     WSADATA                 wsaData;
 #endif
 
-    // Initialize handle data if necessary
-    if (m_bHandlesInited == bFALSE)
-        {
-        for (iIdx=0; iIdx<MAX_HANDLES; iIdx++)
-            {
-            m_suNetHandle[iIdx].enNetMode  = I106_CLOSED;
-            }
-        m_bHandlesInited = bTRUE;
-        } // end if file handles not inited yet
+    // Make the network stream data for this handle
+    if (psuGetNetHandle(iHandle) == NULL)
+        return I106_OPEN_ERROR;
 
 #if defined(_WIN32)
     // Initialize WinSock, request version 2.2
@@ -212,8 +208,8 @@ EnI106Status I106_CALL_DECL
 #endif
 
     // Create a socket for listening to UDP
-    m_suNetHandle[iHandle].suIrigSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-    if (m_suNetHandle[iHandle].suIrigSocket == INVALID_SOCKET) 
+    NET_HANDLE(iHandle)->suIrigSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (NET_HANDLE(iHandle)->suIrigSocket == INVALID_SOCKET) 
         {
 //        printf("socket() failed with error: %ld\n", WSAGetLastError());
 #if defined(_WIN32)
@@ -227,15 +223,15 @@ EnI106Status I106_CALL_DECL
     ServerAddr.sin_addr.s_addr = htonl(INADDR_ANY);
     ServerAddr.sin_port        = htons(uPort);
 
-    iResult = bind(m_suNetHandle[iHandle].suIrigSocket, (SOCKADDR*) &ServerAddr, sizeof(ServerAddr));
+    iResult = bind(NET_HANDLE(iHandle)->suIrigSocket, (SOCKADDR*) &ServerAddr, sizeof(ServerAddr));
     if (iResult == SOCKET_ERROR) 
         {
 //        printf("bind() failed with error: %ld\n", WSAGetLastError());
 #if defined(_WIN32)
-        closesocket(m_suNetHandle[iHandle].suIrigSocket);
+        closesocket(NET_HANDLE(iHandle)->suIrigSocket);
         WSACleanup();
 #else
-        close(m_suNetHandle[iHandle].suIrigSocket);
+        close(NET_HANDLE(iHandle)->suIrigSocket);
 #endif
         return I106_OPEN_ERROR;
         }
@@ -245,20 +241,20 @@ EnI106Status I106_CALL_DECL
     struct ip_mreq mreq;
     mreq.imr_interface.s_addr = inet_addr(m_aucMcastInterface);
     mreq.imr_multiaddr.s_addr = inet_addr(m_aucMcastBcastAddr);
-    setsockopt(m_suNetHandle[iHandle].suIrigSocket, IPPROTO_IP, IP_ADD_MEMBERSHIP, (char*)&mreq, sizeof(mreq));
+    setsockopt(NET_HANDLE(iHandle)->suIrigSocket, IPPROTO_IP, IP_ADD_MEMBERSHIP, (char*)&mreq, sizeof(mreq));
 #endif
 
     // Make sure the receive buffer is big enough for at least one UDP packet
-    m_suNetHandle[iHandle].ulRcvBufferLen     = RCV_BUFFER_START_SIZE;
-    m_suNetHandle[iHandle].pchRcvBuffer       = (char *)malloc(RCV_BUFFER_START_SIZE);
+    NET_HANDLE(iHandle)->ulRcvBufferLen     = RCV_BUFFER_START_SIZE;
+    NET_HANDLE(iHandle)->pchRcvBuffer       = (char *)malloc(RCV_BUFFER_START_SIZE);
 
-    m_suNetHandle[iHandle].ulRcvBufferDataLen = 0L;
-    m_suNetHandle[iHandle].bBufferReady       = bFALSE;
-    m_suNetHandle[iHandle].ulBufferPosIdx     = 0L;
-    m_suNetHandle[iHandle].bGotFirstSegment   = bFALSE;
+    NET_HANDLE(iHandle)->ulRcvBufferDataLen = 0L;
+    NET_HANDLE(iHandle)->bBufferReady       = bFALSE;
+    NET_HANDLE(iHandle)->ulBufferPosIdx     = 0L;
+    NET_HANDLE(iHandle)->bGotFirstSegment   = bFALSE;
 
-    m_suNetHandle[iHandle].enNetMode          = I106_READ_NET_STREAM;
-    m_suNetHandle[iHandle].uDestPort          = uPort;
+    NET_HANDLE(iHandle)->enNetMode          = I106_READ_NET_STREAM;
+    NET_HANDLE(iHandle)->uDestPort          = uPort;
 
     return I106_OK;
     }
@@ -271,7 +267,6 @@ EnI106Status I106_CALL_DECL
 EnI106Status I106_CALL_DECL
     enI106_OpenNetStreamWrite(int iHandle, uint32_t uIpAddress, uint16_t uUdpPort)
     {
-    int                     iIdx;
     int                     iResult;
 #ifdef SO_MAX_MSG_SIZE
     int                     iMaxMsgSizeLen;
@@ -285,16 +280,9 @@ EnI106Status I106_CALL_DECL
 #endif
 
 
-    // Initialize handle data if necessary
-    if (m_bHandlesInited == bFALSE)
-        {
-        for (iIdx=0; iIdx<MAX_HANDLES; iIdx++)
-            {
-            m_suNetHandle[iIdx].enNetMode  = I106_CLOSED;
-            m_suNetHandle[iIdx].uUdpSeqNum = 0;
-            }
-        m_bHandlesInited = bTRUE;
-        } // end if file handles not inited yet
+    // Make the network stream data for this handle
+    if (psuGetNetHandle(iHandle) == NULL)
+        return I106_OPEN_ERROR;
 
 
 #if defined(_WIN32)
@@ -310,8 +298,8 @@ EnI106Status I106_CALL_DECL
 #endif
 
     // Create a socket for writing to UDP
-    m_suNetHandle[iHandle].suIrigSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-    if (m_suNetHandle[iHandle].suIrigSocket == INVALID_SOCKET) 
+    NET_HANDLE(iHandle)->suIrigSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (NET_HANDLE(iHandle)->suIrigSocket == INVALID_SOCKET) 
         {
 //        printf("socket() failed with error: %ld\n", WSAGetLastError());
 #if defined(_WIN32)
@@ -321,14 +309,14 @@ EnI106Status I106_CALL_DECL
         }
 
     // Fill in the remote host information
-    m_suNetHandle[iHandle].suSendIpAddress.sin_family      = AF_INET;
-    m_suNetHandle[iHandle].suSendIpAddress.sin_port        = htons(uUdpPort);
-    m_suNetHandle[iHandle].suSendIpAddress.sin_addr.s_addr = htonl(uIpAddress);
+    NET_HANDLE(iHandle)->suSendIpAddress.sin_family      = AF_INET;
+    NET_HANDLE(iHandle)->suSendIpAddress.sin_port        = htons(uUdpPort);
+    NET_HANDLE(iHandle)->suSendIpAddress.sin_addr.s_addr = htonl(uIpAddress);
 
 #ifdef SO_MAX_MSG_SIZE
     // getsockopt to retrieve the value of option SO_MAX_MSG_SIZE after a socket has been created.
     iMaxMsgSizeLen = sizeof(iMaxMsgSize);
-    iResult = getsockopt(m_suNetHandle[iHandle].suIrigSocket, SOL_SOCKET, SO_MAX_MSG_SIZE, (char *)&iMaxMsgSize, &iMaxMsgSizeLen);
+    iResult = getsockopt(NET_HANDLE(iHandle)->suIrigSocket, SOL_SOCKET, SO_MAX_MSG_SIZE, (char *)&iMaxMsgSize, &iMaxMsgSizeLen);
 #else
     iResult = 1;
 #endif
@@ -336,12 +324,12 @@ EnI106Status I106_CALL_DECL
     if (iResult == 0)
         {
         // Use smaller, taking into account Ch 10 UDP transfer header
-        m_suNetHandle[iHandle].uMaxUdpSize = MIN(iMaxMsgSize-6,MAX_UDP_WRITE_SIZE);
+        NET_HANDLE(iHandle)->uMaxUdpSize = MIN(iMaxMsgSize-6,MAX_UDP_WRITE_SIZE);
         }
     else
-        m_suNetHandle[iHandle].uMaxUdpSize = MAX_UDP_WRITE_SIZE;
+        NET_HANDLE(iHandle)->uMaxUdpSize = MAX_UDP_WRITE_SIZE;
 
-    m_suNetHandle[iHandle].enNetMode = I106_WRITE_NET_STREAM;
+    NET_HANDLE(iHandle)->enNetMode = I106_WRITE_NET_STREAM;
 
     return I106_OK;
     }
@@ -366,17 +354,10 @@ EnI106Status I106_CALL_DECL
     char            szSource[PCAP_BUF_SIZE];
     int             iStatus;
 #endif
-    int             iIdx;
 
-    // Initialize handle data if necessary
-    if (m_bHandlesInited == bFALSE)
-        {
-        for (iIdx=0; iIdx<MAX_HANDLES; iIdx++)
-            {
-            m_suNetHandle[iIdx].enNetMode  = I106_CLOSED;
-            }
-        m_bHandlesInited = bTRUE;
-        } // end if file handles not inited yet
+    // Make the network stream data for this handle
+    if (psuGetNetHandle(iHandle) == NULL)
+        return I106_OPEN_ERROR;
 
 
 #if defined(NPCAP)
@@ -412,7 +393,7 @@ EnI106Status I106_CALL_DECL
         return I106_OPEN_ERROR;
 
     // Open the pcap capture file
-    m_suNetHandle[iHandle].pPcapFile = pcap_open(
+    NET_HANDLE(iHandle)->pPcapFile = pcap_open(
             szSource,       // name of the device
             65536,          // portion of the packet to capture
                             // 65536 guarantees that the whole packet will be captured on all the link layers
@@ -421,14 +402,14 @@ EnI106Status I106_CALL_DECL
             NULL,           // authentication on the remote machine
             szErrBuf);      // error buffer
 
-    if (m_suNetHandle[iHandle].pPcapFile == NULL)
+    if (NET_HANDLE(iHandle)->pPcapFile == NULL)
         return I106_OPEN_ERROR;
 
 
 #elif defined(LPCAP)
-    m_suNetHandle[iHandle].pPcapFile = light_pcapng_open_read(szPcapFile, LIGHT_FALSE);
+    NET_HANDLE(iHandle)->pPcapFile = light_pcapng_open_read(szPcapFile, LIGHT_FALSE);
 
-    if (m_suNetHandle[iHandle].pPcapFile == NULL)
+    if (NET_HANDLE(iHandle)->pPcapFile == NULL)
         return I106_OPEN_ERROR;
 
 #else
@@ -438,16 +419,16 @@ EnI106Status I106_CALL_DECL
 #endif // NPCAP / LPCAP
 
     // Make sure the receive buffer is big enough for at least one UDP packet
-    m_suNetHandle[iHandle].ulRcvBufferLen     = RCV_BUFFER_START_SIZE;
-    m_suNetHandle[iHandle].pchRcvBuffer       = (char *)malloc(RCV_BUFFER_START_SIZE);
+    NET_HANDLE(iHandle)->ulRcvBufferLen     = RCV_BUFFER_START_SIZE;
+    NET_HANDLE(iHandle)->pchRcvBuffer       = (char *)malloc(RCV_BUFFER_START_SIZE);
 
-    m_suNetHandle[iHandle].ulRcvBufferDataLen = 0L;
-    m_suNetHandle[iHandle].bBufferReady       = bFALSE;
-    m_suNetHandle[iHandle].ulBufferPosIdx     = 0L;
-    m_suNetHandle[iHandle].bGotFirstSegment   = bFALSE;
+    NET_HANDLE(iHandle)->ulRcvBufferDataLen = 0L;
+    NET_HANDLE(iHandle)->bBufferReady       = bFALSE;
+    NET_HANDLE(iHandle)->ulBufferPosIdx     = 0L;
+    NET_HANDLE(iHandle)->bGotFirstSegment   = bFALSE;
 
-    m_suNetHandle[iHandle].enNetMode          = I106_READ_PCAP_STREAM;
-    m_suNetHandle[iHandle].uDestPort          = uDestUdpPort;
+    NET_HANDLE(iHandle)->enNetMode          = I106_READ_PCAP_STREAM;
+    NET_HANDLE(iHandle)->uDestPort          = uDestUdpPort;
     return I106_OK;
     }
 
@@ -458,67 +439,92 @@ EnI106Status I106_CALL_DECL
     enI106_CloseNetStream(int iHandle)
     {
 
+    // Nothing to do if the network stream was never opened
+    if (NET_HANDLE(iHandle) == NULL)
+        return I106_OK;
+
 #ifdef MULTICAST
     // Restore the appropriate interface out of multicast receive mode
     struct ip_mreq mreq;
     mreq.imr_interface.s_addr = inet_addr(m_aucMcastInterface);
     mreq.imr_multiaddr.s_addr = inet_addr(m_aucMcastBcastAddr);
-    setsockopt(m_suNetHandle[iHandle].suIrigSocket, IPPROTO_IP, IP_DROP_MEMBERSHIP, (char*)&mreq, sizeof(mreq));
+    setsockopt(NET_HANDLE(iHandle)->suIrigSocket, IPPROTO_IP, IP_DROP_MEMBERSHIP, (char*)&mreq, sizeof(mreq));
 #endif
 
-    switch (m_suNetHandle[iHandle].enNetMode)
+    switch (NET_HANDLE(iHandle)->enNetMode)
         {
         case I106_READ_NET_STREAM :
             // Close the receive socket
 #if defined(_WIN32)
-            closesocket(m_suNetHandle[iHandle].suIrigSocket);
+            closesocket(NET_HANDLE(iHandle)->suIrigSocket);
             WSACleanup();
 #else
-            close(m_suNetHandle[iHandle].suIrigSocket);
+            close(NET_HANDLE(iHandle)->suIrigSocket);
 #endif
             // Free up allocated memory
-            free(m_suNetHandle[iHandle].pchRcvBuffer);
-            m_suNetHandle[iHandle].pchRcvBuffer       = NULL;
-            m_suNetHandle[iHandle].ulRcvBufferLen     = 0L;
+            free(NET_HANDLE(iHandle)->pchRcvBuffer);
+            NET_HANDLE(iHandle)->pchRcvBuffer       = NULL;
+            NET_HANDLE(iHandle)->ulRcvBufferLen     = 0L;
             break;
 
         case I106_WRITE_NET_STREAM :
             // Close the transmit socket
 #if defined(_WIN32)
-            closesocket(m_suNetHandle[iHandle].suIrigSocket);
+            closesocket(NET_HANDLE(iHandle)->suIrigSocket);
             WSACleanup();
 #else
-            close(m_suNetHandle[iHandle].suIrigSocket);
+            close(NET_HANDLE(iHandle)->suIrigSocket);
 #endif
             break;
 
         case I106_READ_PCAP_STREAM :
 #if defined(NPCAP)
-            pcap_close(m_suNetHandle[iHandle].pPcapFile);
+            pcap_close(NET_HANDLE(iHandle)->pPcapFile);
 #endif
 
 #if defined(LPCAP)
-            light_pcapng_close(m_suNetHandle[iHandle].pPcapFile);
+            light_pcapng_close(NET_HANDLE(iHandle)->pPcapFile);
 #endif
 
             // Free up allocated memory
-            free(m_suNetHandle[iHandle].pchRcvBuffer);
-            m_suNetHandle[iHandle].pchRcvBuffer       = NULL;
-            m_suNetHandle[iHandle].ulRcvBufferLen     = 0L;
+            free(NET_HANDLE(iHandle)->pchRcvBuffer);
+            NET_HANDLE(iHandle)->pchRcvBuffer       = NULL;
+            NET_HANDLE(iHandle)->ulRcvBufferLen     = 0L;
             break;
 
         default :
             break;
         } // end switch on enNetMode
 
-    // Mark this case closed
-    m_suNetHandle[iHandle].enNetMode = I106_CLOSED;
+    // Mark this case closed and free the network stream data
+    NET_HANDLE(iHandle)->enNetMode = I106_CLOSED;
+    free(NET_HANDLE(iHandle));
+    NET_HANDLE(iHandle) = NULL;
 
     return I106_OK;
     }
 
 
 
+/* ----------------------------------------------------------------------- */
+
+// Get the network stream data for a handle, making a new one if necessary
+
+static SuI106Ch10NetHandle * psuGetNetHandle(int iHandle)
+    {
+
+    if (NET_HANDLE(iHandle) == NULL)
+        {
+        NET_HANDLE(iHandle) = (SuI106Ch10NetHandle *)calloc(1, sizeof(SuI106Ch10NetHandle));
+        if (NET_HANDLE(iHandle) != NULL)
+            NET_HANDLE(iHandle)->enNetMode = I106_CLOSED;
+        }
+
+    return NET_HANDLE(iHandle);
+    }
+
+
+
 // ----------------------------------------------------------------------------
 // UDP Read routines
 // ----------------------------------------------------------------------------
@@ -807,7 +813,7 @@ static void
 {
     char dummy;
     // We don't care about the return value, we're failing anyways.
-    (void)recvfrom(m_suNetHandle[iHandle].suIrigSocket, &dummy, sizeof(dummy), 0, 0, 0);
+    (void)recvfrom(NET_HANDLE(iHandle)->suIrigSocket, &dummy, sizeof(dummy), 0, 0, 0);
 }
 
 
@@ -837,15 +843,15 @@ int I106_CALL_DECL
     SuI106Ch10Header              * psuHeader;
 
     // If we don't have a buffer ready to read from then read network packets
-    if (m_suNetHandle[iHandle].bBufferReady == bFALSE)
+    if (NET_HANDLE(iHandle)->bBufferReady == bFALSE)
         {
         // Get ready for a new buffer of data
-        m_suNetHandle[iHandle].bBufferReady     = bFALSE;
-        m_suNetHandle[iHandle].bGotFirstSegment = bFALSE;
-        m_suNetHandle[iHandle].ulBufferPosIdx   = 0L;
+        NET_HANDLE(iHandle)->bBufferReady     = bFALSE;
+        NET_HANDLE(iHandle)->bGotFirstSegment = bFALSE;
+        NET_HANDLE(iHandle)->ulBufferPosIdx   = 0L;
 
         // Read until we've got a complete Ch 10 packet(s)
-        while (m_suNetHandle[iHandle].bBufferReady == bFALSE)
+        while (NET_HANDLE(iHandle)->bBufferReady == bFALSE)
             {
             // Read a network packet
             // ---------------------
@@ -853,7 +859,7 @@ int I106_CALL_DECL
             // If read from network stream
             // Peek at the message to determine the msg type (segmented or non-segmented)
 #if 0
-                iResult = recvfrom(m_suNetHandle[iHandle].suIrigSocket, (char *)&suUdpSeg, sizeof(suUdpSeg), MSG_PEEK, NULL, NULL);
+                iResult = recvfrom(NET_HANDLE(iHandle)->suIrigSocket, (char *)&suUdpSeg, sizeof(suUdpSeg), MSG_PEEK, NULL, NULL);
 #if defined(_WIN32)
                 // Make the WinSock return code more like POSIX to simplify the logic
                 // WinSock returns -1 when the message is larger than the buffer
@@ -867,7 +873,7 @@ int I106_CALL_DECL
 #endif
 
 #else
-            enStatus = RecvMsgPeek(&m_suNetHandle[iHandle], (char *)&suUdpSeg, sizeof(suUdpSeg), &ulBytesRcvd);
+            enStatus = RecvMsgPeek(NET_HANDLE(iHandle), (char *)&suUdpSeg, sizeof(suUdpSeg), &ulBytesRcvd);
 #endif
 
             // Handle read errors
@@ -897,7 +903,7 @@ int I106_CALL_DECL
             //! @todo Check the version field for a known version
 
             // Check and handle UDP sequence number
-            if (suUdpSeg.uUdpSeqNum != m_suNetHandle[iHandle].uUdpSeqNum+1)
+            if (suUdpSeg.uUdpSeqNum != NET_HANDLE(iHandle)->uUdpSeqNum+1)
                 {
                 enI106_DumpNetStream(iHandle);
                 }
@@ -905,7 +911,7 @@ int I106_CALL_DECL
             // UDP data OK so decode it
             // ------------------------
 
-            m_suNetHandle[iHandle].uUdpSeqNum = suUdpSeg.uUdpSeqNum;
+            NET_HANDLE(iHandle)->uUdpSeqNum = suUdpSeg.uUdpSeqNum;
 
             // Handle full and segmented packet types
             switch (suUdpSeg.uMsgType)
@@ -913,11 +919,11 @@ int I106_CALL_DECL
                 case 0 : // Full packet(s)
 //printf("Full - ");
 
-                    enStatus = RecvMsgSplit(&m_suNetHandle[iHandle],
+                    enStatus = RecvMsgSplit(NET_HANDLE(iHandle),
                                             &suUdpSeg,
                                             UDP_Transfer_Header_F1_NonSeg_Len,
-                                            m_suNetHandle[iHandle].pchRcvBuffer,
-                                            m_suNetHandle[iHandle].ulRcvBufferLen,
+                                            NET_HANDLE(iHandle)->pchRcvBuffer,
+                                            NET_HANDLE(iHandle)->ulRcvBufferLen,
                                             &ulBytesRcvd);
                     if (I106_OK != enStatus)
                         {
@@ -930,9 +936,9 @@ int I106_CALL_DECL
 
 //printf("Size = %lu\n", ulBytesRcvd - UDP_Transfer_Header_NonSeg_Len);
 
-                    m_suNetHandle[iHandle].ulRcvBufferDataLen = ulBytesRcvd - UDP_Transfer_Header_F1_NonSeg_Len;
-                    m_suNetHandle[iHandle].bBufferReady       = bTRUE;
-                    m_suNetHandle[iHandle].ulBufferPosIdx     = 0L;
+                    NET_HANDLE(iHandle)->ulRcvBufferDataLen = ulBytesRcvd - UDP_Transfer_Header_F1_NonSeg_Len;
+                    NET_HANDLE(iHandle)->bBufferReady       = bTRUE;
+                    NET_HANDLE(iHandle)->ulBufferPosIdx     = 0L;
                     break;
 
                 case 1 : // Segmented packet
@@ -948,22 +954,22 @@ int I106_CALL_DECL
 
                     // Always write to the beginning of the buffer while waiting for the first segment
                     // The first UDP packet is guaranteed to fit our default starting size
-                    if (m_suNetHandle[iHandle].bGotFirstSegment == bFALSE)
+                    if (NET_HANDLE(iHandle)->bGotFirstSegment == bFALSE)
                         {
-                        enStatus = RecvMsgSplit(&m_suNetHandle[iHandle],
+                        enStatus = RecvMsgSplit(NET_HANDLE(iHandle),
                                                 &suUdpSeg,
                                                 UDP_Transfer_Header_Seg_Len,
-                                                m_suNetHandle[iHandle].pchRcvBuffer,
-                                                m_suNetHandle[iHandle].ulRcvBufferLen,
+                                                NET_HANDLE(iHandle)->pchRcvBuffer,
+                                                NET_HANDLE(iHandle)->ulRcvBufferLen,
                                                 &ulBytesRcvd);
                         }
                     else
                         {
-                        enStatus = RecvMsgSplit(&m_suNetHandle[iHandle],
+                        enStatus = RecvMsgSplit(NET_HANDLE(iHandle),
                                                 &suUdpSeg,
                                                 UDP_Transfer_Header_Seg_Len,
-                                                &(m_suNetHandle[iHandle].pchRcvBuffer[suUdpSeg.uSegmentOffset]),
-                                                m_suNetHandle[iHandle].ulRcvBufferLen - suUdpSeg.uSegmentOffset,
+                                                &(NET_HANDLE(iHandle)->pchRcvBuffer[suUdpSeg.uSegmentOffset]),
+                                                NET_HANDLE(iHandle)->ulRcvBufferLen - suUdpSeg.uSegmentOffset,
                                                 &ulBytesRcvd);
                         }
 
@@ -986,30 +992,30 @@ int I106_CALL_DECL
                         continue;
                         }
 
-                    psuHeader = (SuI106Ch10Header *)m_suNetHandle[iHandle].pchRcvBuffer;
+                    psuHeader = (SuI106Ch10Header *)NET_HANDLE(iHandle)->pchRcvBuffer;
 
                     // If it's the first packet then figure out if our buffer is large enough for the whole Ch10 packet
                     if (suUdpSeg.uSegmentOffset == 0)
                         {
-                        if (psuHeader->ulPacketLen > m_suNetHandle[iHandle].ulRcvBufferLen)
+                        if (psuHeader->ulPacketLen > NET_HANDLE(iHandle)->ulRcvBufferLen)
                             {
-                            m_suNetHandle[iHandle].ulRcvBufferLen = psuHeader->ulPacketLen + 0x4000;
-                            m_suNetHandle[iHandle].pchRcvBuffer   = (char *)realloc(m_suNetHandle[iHandle].pchRcvBuffer,m_suNetHandle[iHandle].ulRcvBufferLen);
-                            psuHeader = (SuI106Ch10Header *)m_suNetHandle[iHandle].pchRcvBuffer;
+                            NET_HANDLE(iHandle)->ulRcvBufferLen = psuHeader->ulPacketLen + 0x4000;
+                            NET_HANDLE(iHandle)->pchRcvBuffer   = (char *)realloc(NET_HANDLE(iHandle)->pchRcvBuffer,NET_HANDLE(iHandle)->ulRcvBufferLen);
+                            psuHeader = (SuI106Ch10Header *)NET_HANDLE(iHandle)->pchRcvBuffer;
                             } // end if buffer too small for whole Ch 10 packet
-                        m_suNetHandle[iHandle].bGotFirstSegment   = bTRUE;
-                        m_suNetHandle[iHandle].ulRcvBufferDataLen = psuHeader->ulPacketLen;
+                        NET_HANDLE(iHandle)->bGotFirstSegment   = bTRUE;
+                        NET_HANDLE(iHandle)->ulRcvBufferDataLen = psuHeader->ulPacketLen;
                         } // end if first packet
 
                     // If we've gotten the first and last packets then mark the buffer as full and ready
-                    if ((m_suNetHandle[iHandle].bGotFirstSegment == bTRUE) &&                     // First UDP buffer
+                    if ((NET_HANDLE(iHandle)->bGotFirstSegment == bTRUE) &&                     // First UDP buffer
                         ((suUdpSeg.uSegmentOffset + ulBytesRcvd - UDP_Transfer_Header_Seg_Len) >= psuHeader->ulPacketLen)) // Last UDP buffer
                         {
 //if ((suUdpSeg.uSegmentOffset + ulBytesRcvd - UDP_Transfer_Header_Seg_Len) > psuHeader->ulPacketLen)
     //printf("Last packet too long");
-                        m_suNetHandle[iHandle].bBufferReady     = bTRUE;
-                        m_suNetHandle[iHandle].bGotFirstSegment = bFALSE;
-                        m_suNetHandle[iHandle].ulBufferPosIdx     = 0L;
+                        NET_HANDLE(iHandle)->bBufferReady     = bTRUE;
+                        NET_HANDLE(iHandle)->bGotFirstSegment = bFALSE;
+                        NET_HANDLE(iHandle)->ulBufferPosIdx     = 0L;
                         } // end if got first and last packet
 
                     break;
@@ -1025,14 +1031,14 @@ int I106_CALL_DECL
         } // end if called and buffer not ready
 
     // Copy data to the user buffer
-    iCopySize = MIN(m_suNetHandle[iHandle].ulRcvBufferDataLen - m_suNetHandle[iHandle].ulBufferPosIdx, iBuffSize);
-    memcpy(pvBuffer, &m_suNetHandle[iHandle].pchRcvBuffer[m_suNetHandle[iHandle].ulBufferPosIdx], iCopySize);
+    iCopySize = MIN(NET_HANDLE(iHandle)->ulRcvBufferDataLen - NET_HANDLE(iHandle)->ulBufferPosIdx, iBuffSize);
+    memcpy(pvBuffer, &NET_HANDLE(iHandle)->pchRcvBuffer[NET_HANDLE(iHandle)->ulBufferPosIdx], iCopySize);
 
     // Update buffer status
-    m_suNetHandle[iHandle].ulBufferPosIdx += iCopySize;
-    if (m_suNetHandle[iHandle].ulBufferPosIdx >= m_suNetHandle[iHandle].ulRcvBufferDataLen)
+    NET_HANDLE(iHandle)->ulBufferPosIdx += iCopySize;
+    if (NET_HANDLE(iHandle)->ulBufferPosIdx >= NET_HANDLE(iHandle)->ulRcvBufferDataLen)
         {
-        m_suNetHandle[iHandle].bBufferReady = bFALSE;
+        NET_HANDLE(iHandle)->bBufferReady = bFALSE;
         }
 
     return iCopySize;
@@ -1050,9 +1056,9 @@ int I106_CALL_DECL
 EnI106Status I106_CALL_DECL
     enI106_DumpNetStream(int iHandle)
     {
-    m_suNetHandle[iHandle].bBufferReady     = bFALSE;
-    m_suNetHandle[iHandle].bGotFirstSegment = bFALSE;
-    m_suNetHandle[iHandle].ulBufferPosIdx   = 0L;
+    NET_HANDLE(iHandle)->bBufferReady     = bFALSE;
+    NET_HANDLE(iHandle)->bGotFirstSegment = bFALSE;
+    NET_HANDLE(iHandle)->ulBufferPosIdx   = 0L;
 
     return I106_OK;
     }
@@ -1066,18 +1072,18 @@ EnI106Status I106_CALL_DECL
     {
     long    lNewPosition;
 
-    lNewPosition = m_suNetHandle[iHandle].ulBufferPosIdx + iRelOffset;
+    lNewPosition = NET_HANDLE(iHandle)->ulBufferPosIdx + iRelOffset;
     if (lNewPosition < 0)
-        m_suNetHandle[iHandle].ulBufferPosIdx = 0L;
+        NET_HANDLE(iHandle)->ulBufferPosIdx = 0L;
 
-    else if ((unsigned long)lNewPosition >= m_suNetHandle[iHandle].ulRcvBufferDataLen)
+    else if ((unsigned long)lNewPosition >= NET_HANDLE(iHandle)->ulRcvBufferDataLen)
         {
-        m_suNetHandle[iHandle].ulBufferPosIdx = 0L;
-        m_suNetHandle[iHandle].bBufferReady   = bFALSE;
+        NET_HANDLE(iHandle)->ulBufferPosIdx = 0L;
+        NET_HANDLE(iHandle)->bBufferReady   = bFALSE;
         }
 
     else
-        m_suNetHandle[iHandle].ulBufferPosIdx = (unsigned long)lNewPosition;
+        NET_HANDLE(iHandle)->ulBufferPosIdx = (unsigned long)lNewPosition;
 
     return I106_OK;
     }
@@ -1103,7 +1109,9 @@ EnI106Status I106_CALL_DECL
     enReturnStatus = I106_OK;
 
     // Check for initialized
-    if (m_suNetHandle[iHandle].enNetMode != I106_WRITE_NET_STREAM)
+    if ((bI106ValidHandle(iHandle)  == bFALSE) ||
+        (NET_HANDLE(iHandle)        == NULL)   ||
+        (NET_HANDLE(iHandle)->enNetMode != I106_WRITE_NET_STREAM))
         return I106_NOT_OPEN;
 
     // THIS WOULD BE A GOOD PLACE TO CHECK DATA PACKET INTEGRITY SOMEDAY
@@ -1124,7 +1132,7 @@ EnI106Status I106_CALL_DECL
     while (1==1)
         {
         // If current packet size > max then send segmented packet
-        if (psuCurrCh10Header->ulPacketLen > m_suNetHandle[iHandle].uMaxUdpSize)
+        if (psuCurrCh10Header->ulPacketLen > NET_HANDLE(iHandle)->uMaxUdpSize)
             {
             // This big packet had better be the first one in our current send buffer
 //          assert(pvCurrSendBuffPos == psuCurrCh10Header);
@@ -1155,7 +1163,7 @@ EnI106Status I106_CALL_DECL
             // If psuNextCh10Header > pvBuffer + uBuffSize then this is a malformed buffer.
 //          assert((char *)psuNextCh10Header <= ((char *)pvBuffer + uBuffSize));
 
-            assert(uCurrSendBuffLen <= m_suNetHandle[iHandle].uMaxUdpSize);
+            assert(uCurrSendBuffLen <= NET_HANDLE(iHandle)->uMaxUdpSize);
             // Send non-segmented packet
             enStatus = enI106_WriteNetNonSegmented(iHandle, pvCurrSendBuffPos, uCurrSendBuffLen);
             if (enStatus != I106_OK)
@@ -1171,7 +1179,7 @@ EnI106Status I106_CALL_DECL
         // Might want to validate sync word, packet header checksum, and packet checksum
         assert(psuNextCh10Header->uSync == 0xEB25);
 
-        if ((uCurrSendBuffLen + psuNextCh10Header->ulPacketLen) > m_suNetHandle[iHandle].uMaxUdpSize)
+        if ((uCurrSendBuffLen + psuNextCh10Header->ulPacketLen) > NET_HANDLE(iHandle)->uMaxUdpSize)
             {
             assert(psuCurrCh10Header->uSync == 0xEB25);
 
@@ -1235,7 +1243,7 @@ EnI106Status I106_CALL_DECL
     // Setup the non-segemented transfer header
     suUdpHeaderNonF1Seg.uFormat  = 1;
     suUdpHeaderNonF1Seg.uMsgType = 0;
-    suUdpHeaderNonF1Seg.uUdpSeqNum  = m_suNetHandle[iHandle].uUdpSeqNum;
+    suUdpHeaderNonF1Seg.uUdpSeqNum  = NET_HANDLE(iHandle)->uUdpSeqNum;
 
     // Send the IRIG UDP packet
 #if defined(_WIN32)
@@ -1251,15 +1259,15 @@ EnI106Status I106_CALL_DECL
     suMsBuffInfo[1].len       = uBuffSize;
 
     // Setup the send info for WSASendMsg()
-    suMsMsgInfo.name          = (SOCKADDR*)&(m_suNetHandle[iHandle].suSendIpAddress);  // THIS IS AMBIGUOUS IN MSDN
-    suMsMsgInfo.namelen       = sizeof(m_suNetHandle[iHandle].suSendIpAddress);
+    suMsMsgInfo.name          = (SOCKADDR*)&(NET_HANDLE(iHandle)->suSendIpAddress);  // THIS IS AMBIGUOUS IN MSDN
+    suMsMsgInfo.namelen       = sizeof(NET_HANDLE(iHandle)->suSendIpAddress);
     suMsMsgInfo.lpBuffers     = suMsBuffInfo;
     suMsMsgInfo.dwBufferCount = 2;
     suMsMsgInfo.Control       = suMsControl;
     suMsMsgInfo.dwFlags       = 0;
 
     // Send it. Done!
-    iSendStatus = WSASendMsg(m_suNetHandle[iHandle].suIrigSocket, &suMsMsgInfo, 0, &lBytesSent, NULL, NULL);
+    iSendStatus = WSASendMsg(NET_HANDLE(iHandle)->suIrigSocket, &suMsMsgInfo, 0, &lBytesSent, NULL, NULL);
     if (iSendStatus != 0)
         enReturnStatus = I106_WRITE_ERROR;
 #else
@@ -1268,7 +1276,7 @@ EnI106Status I106_CALL_DECL
 #endif
 
     // Increment the sequence number for next time
-    m_suNetHandle[iHandle].uUdpSeqNum++;
+    NET_HANDLE(iHandle)->uUdpSeqNum++;
 
     return enReturnStatus;
     }
@@ -1315,12 +1323,12 @@ EnI106Status I106_CALL_DECL
     uBuffIdx = 0;
     while (uBuffIdx < uBuffSize)
         {
-        suUdpHeaderF1Seg.uUdpSeqNum        = m_suNetHandle[iHandle].uUdpSeqNum;
+        suUdpHeaderF1Seg.uUdpSeqNum        = NET_HANDLE(iHandle)->uUdpSeqNum;
         suUdpHeaderF1Seg.uSegmentOffset = uBuffIdx;
 
         pchBuffer  = (char *)pvBuffer + uBuffIdx;
 
-        uSendSize = MIN(m_suNetHandle[iHandle].uMaxUdpSize, uBuffSize-uBuffIdx);
+        uSendSize = MIN(NET_HANDLE(iHandle)->uMaxUdpSize, uBuffSize-uBuffIdx);
 #if defined(_WIN32)
         // I don't really want or need control data. I hope this doesn't 
         // cause WSASendMsg() to fail.
@@ -1334,15 +1342,15 @@ EnI106Status I106_CALL_DECL
         suMsBuffInfo[1].len       = uSendSize;
 
         // Setup the send info for WSASendMsg()
-        suMsMsgInfo.name          = (SOCKADDR*)&(m_suNetHandle[iHandle].suSendIpAddress);  // THIS IS AMBIGUOUS IN MSDN
-        suMsMsgInfo.namelen       = sizeof(m_suNetHandle[iHandle].suSendIpAddress);
+        suMsMsgInfo.name          = (SOCKADDR*)&(NET_HANDLE(iHandle)->suSendIpAddress);  // THIS IS AMBIGUOUS IN MSDN
+        suMsMsgInfo.namelen       = sizeof(NET_HANDLE(iHandle)->suSendIpAddress);
         suMsMsgInfo.lpBuffers     = suMsBuffInfo;
         suMsMsgInfo.dwBufferCount = 2;
         suMsMsgInfo.Control       = suMsControl;
         suMsMsgInfo.dwFlags       = 0;
 
         // Send it. Done!
-        iSendStatus = WSASendMsg(m_suNetHandle[iHandle].suIrigSocket, &suMsMsgInfo, 0, &lBytesSent, NULL, NULL);
+        iSendStatus = WSASendMsg(NET_HANDLE(iHandle)->suIrigSocket, &suMsMsgInfo, 0, &lBytesSent, NULL, NULL);
         if (iSendStatus != 0)
             {
             enReturnStatus = I106_WRITE_ERROR;
@@ -1358,7 +1366,7 @@ EnI106Status I106_CALL_DECL
         uBuffIdx += uSendSize;
 
         // Increment the sequence number for next time
-        m_suNetHandle[iHandle].uUdpSeqNum++;
+        NET_HANDLE(iHandle)->uUdpSeqNum++;
 
         } // end while not at the end of the buffer
 
@@ -62,6 +62,18 @@ namespace Irig106 {
  */
 
 
+// Time F1 message word masks for the BCD fields in each byte
+#define F1_SEC_MASK         0x7f
+#define F1_MIN_MASK         0x7f
+#define F1_HOUR_MASK        0x3f
+#define F1_HDAY_MASK        0x03
+#define F1_MONTH_MASK       0x1f
+#define F1_HYEAR_MASK       0x3f
+
+// Marks a DMY format date key in the decode cache
+#define F1_DATEKEY_DMY      0x80000000UL
+
+
 /*
  * Data structures
  * ---------------
@@ -191,6 +203,40 @@ SuDOY2DM suDoy2DmLeap[] = {
 
 
 
+// Two BCD digits in a byte to binary.  Each time F1 field pair fits in one 
+// byte so the whole message decodes with a few lookups.
+static const uint8_t m_aubyBcd2Bin[256] = {
+      0,   1,   2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,  15,
+     10,  11,  12,  13,  14,  15,  16,  17,  18,  19,  20,  21,  22,  23,  24,  25,
+     20,  21,  22,  23,  24,  25,  26,  27,  28,  29,  30,  31,  32,  33,  34,  35,
+     30,  31,  32,  33,  34,  35,  36,  37,  38,  39,  40,  41,  42,  43,  44,  45,
+     40,  41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51,  52,  53,  54,  55,
+     50,  51,  52,  53,  54,  55,  56,  57,  58,  59,  60,  61,  62,  63,  64,  65,
+     60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,  72,  73,  74,  75,
+     70,  71,  72,  73,  74,  75,  76,  77,  78,  79,  80,  81,  82,  83,  84,  85,
+     80,  81,  82,  83,  84,  85,  86,  87,  88,  89,  90,  91,  92,  93,  94,  95,
+     90,  91,  92,  93,  94,  95,  96,  97,  98,  99, 100, 101, 102, 103, 104, 105,
+    100, 101, 102, 103, 104, 105, 106, 107, 108, 109, 110, 111, 112, 113, 114, 115,
+    110, 111, 112, 113, 114, 115, 116, 117, 118, 119, 120, 121, 122, 123, 124, 125,
+    120, 121, 122, 123, 124, 125, 126, 127, 128, 129, 130, 131, 132, 133, 134, 135,
+    130, 131, 132, 133, 134, 135, 136, 137, 138, 139, 140, 141, 142, 143, 144, 145,
+    140, 141, 142, 143, 144, 145, 146, 147, 148, 149, 150, 151, 152, 153, 154, 155,
+    150, 151, 152, 153, 154, 155, 156, 157, 158, 159, 160, 161, 162, 163, 164, 165 };
+
+// Binary 0 - 99 to two BCD digits in a byte
+static const uint8_t m_aubyBin2Bcd[100] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19,
+    0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29,
+    0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39,
+    0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+    0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79,
+    0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99 };
+
+
 /*
  * Function Declaration
  * --------------------
@@ -226,57 +272,100 @@ void I106_CALL_DECL
                               void              * pvTimeBuff,
                               SuIrig106Time     * psuTime)
     {
-    struct tm             suTmTime;
-    SuTime_MsgDmyFmt    * psuTimeDmy;
-    SuTime_MsgDayFmt    * psuTimeDay;
 
-    if (iDateFmt == 0)
+    vAbsInt2IrigTime(llI106_Decode_TimeF1_Buff(iDateFmt, bLeapYear, pvTimeBuff, NULL), 
+                     iDateFmt == 0 ? I106_DATEFMT_DAY : I106_DATEFMT_DMY, psuTime);
+
+    return;
+    }
+
+
+
+/* ---------------------------------------------------------------------- */
+
+// Decode the BCD time message a byte at a time with table lookups.  Day of 
+// year format has no year so like always it decodes as 1971, or 1972 for 
+// leap years.  The day number only gets worked out when the date changes.
+
+int64_t I106_CALL_DECL 
+    llI106_Decode_TimeF1_Buff(int                     iDateFmt,
+                              int                     bLeapYear,
+                              void                  * pvTimeBuff,
+                              SuTimeF1_DecodeCache  * psuCache)
+    {
+    SuTimeF1_DecodeCache    suCache;
+    uint8_t               * pubyTime;
+    uint32_t                ulDateKey;
+    int64_t                 llSecs;
+    int64_t                 llFrac;
+    int                     iYearDay;
+
+    if (psuCache == NULL)
         {
-        // Make time
-        psuTimeDay = (SuTime_MsgDayFmt *)pvTimeBuff;
-        suTmTime.tm_sec   = psuTimeDay->uTSn *  10 + psuTimeDay->uSn;
-        suTmTime.tm_min   = psuTimeDay->uTMn *  10 + psuTimeDay->uMn;
-        suTmTime.tm_hour  = psuTimeDay->uTHn *  10 + psuTimeDay->uHn;
+        suCache.bValid = bFALSE;
+        psuCache       = &suCache;
+        }
 
-        // Legal IRIG DoY numbers are from 1 to 365 (366 for leap year). Some vendors however
-        // will use 000 for DoY.  Not legal but there it is.
-        suTmTime.tm_yday  = psuTimeDay->uHDn * 100 + psuTimeDay->uTDn * 10 + psuTimeDay->uDn;
+    // Time message is little endian 16 bit words, so go byte by byte
+    pubyTime = (uint8_t *)pvTimeBuff;
 
-        // Make day
-        if (bLeapYear)
+    llFrac = (int64_t)m_aubyBcd2Bin[pubyTime[0]] * 100000L;
+    llSecs = (int64_t)m_aubyBcd2Bin[pubyTime[1] & F1_SEC_MASK]        +
+             (int64_t)m_aubyBcd2Bin[pubyTime[2] & F1_MIN_MASK]  *   60 +
+             (int64_t)m_aubyBcd2Bin[pubyTime[3] & F1_HOUR_MASK] * 3600;
+
+    if (iDateFmt == 0)
+        ulDateKey = (uint32_t)pubyTime[4]                 | 
+                    (uint32_t)(pubyTime[5] & F1_HDAY_MASK) <<  8 |
+                    (uint32_t)(bLeapYear ? 1 : 0)          << 16;
+    else
+        ulDateKey = (uint32_t)pubyTime[4]                  | 
+                    (uint32_t)(pubyTime[5] & F1_MONTH_MASK) <<  8 |
+                    (uint32_t)pubyTime[6]                   << 16 |
+                    (uint32_t)(pubyTime[7] & F1_HYEAR_MASK) << 24 |
+                    F1_DATEKEY_DMY;
+
+    // Work out the day if it changed
+    if ((psuCache->bValid == bFALSE) || (psuCache->ulDateKey != ulDateKey))
+        {
+        if (iDateFmt == 0)
             {
-            suTmTime.tm_mday  = suDoy2DmLeap[suTmTime.tm_yday].iDay;
-            suTmTime.tm_mon   = suDoy2DmLeap[suTmTime.tm_yday].iMonth;
-            suTmTime.tm_year  = 72;  // i.e. 1972, a leap year
+            // Legal IRIG DoY numbers are from 1 to 365 (366 for leap year). Some vendors however
+            // will use 000 for DoY.  Not legal but there it is, it ends up the day before.
+            iYearDay = m_aubyBcd2Bin[pubyTime[4]] + (pubyTime[5] & F1_HDAY_MASK) * 100;
+            psuCache->llDaySecs = (llI106_Date2Days(bLeapYear ? 1972 : 1971, 1, 1) + iYearDay - 1) * 86400;
             }
         else
-            {
-            suTmTime.tm_mday  = suDoy2DmNormal[suTmTime.tm_yday].iDay;
-            suTmTime.tm_mon   = suDoy2DmNormal[suTmTime.tm_yday].iMonth;
-            suTmTime.tm_year  = 71;  // i.e. 1971, not a leap year
-            }
-        suTmTime.tm_isdst = 0;
-        psuTime->ulSecs   = mkgmtime(&suTmTime);
-        psuTime->ulFrac   = psuTimeDay->uHmn * 1000000L + psuTimeDay->uTmn * 100000L;
-        psuTime->enFmt    = I106_DATEFMT_DAY;
+            psuCache->llDaySecs = llI106_Date2Days(
+                m_aubyBcd2Bin[pubyTime[6]] + m_aubyBcd2Bin[pubyTime[7] & F1_HYEAR_MASK] * 100,
+                m_aubyBcd2Bin[pubyTime[5] & F1_MONTH_MASK],
+                m_aubyBcd2Bin[pubyTime[4]]) * 86400;
+        psuCache->ulDateKey = ulDateKey;
+        psuCache->bValid    = bTRUE;
         }
 
-    // Time in DMY format
-    else
+    return (psuCache->llDaySecs + llSecs) * 10000000 + llFrac;
+    }
+
+
+
+/* ---------------------------------------------------------------------- */
+
+void I106_CALL_DECL 
+    vI106_Decode_TimeF1_Array(void                  * apvBuff[],
+                              int                     iCount,
+                              int64_t                 allAbsTime[])
+    {
+    SuTimeF1_DecodeCache    suCache;
+    SuTimeF1_ChanSpec     * psuChanSpecTime;
+    int                     iIdx;
+
+    suCache.bValid = bFALSE;
+    for (iIdx=0; iIdx<iCount; iIdx++)
         {
-        psuTimeDmy = (SuTime_MsgDmyFmt *)pvTimeBuff;
-        suTmTime.tm_sec   = psuTimeDmy->uTSn *   10 + psuTimeDmy->uSn;
-        suTmTime.tm_min   = psuTimeDmy->uTMn *   10 + psuTimeDmy->uMn;
-        suTmTime.tm_hour  = psuTimeDmy->uTHn *   10 + psuTimeDmy->uHn;
-        suTmTime.tm_yday  = 0;
-        suTmTime.tm_mday  = psuTimeDmy->uTDn *   10 + psuTimeDmy->uDn;
-        suTmTime.tm_mon   = psuTimeDmy->uTOn *   10 + psuTimeDmy->uOn - 1;
-        suTmTime.tm_year  = psuTimeDmy->uOYn * 1000 + psuTimeDmy->uHYn * 100 + 
-                            psuTimeDmy->uTYn *   10 + psuTimeDmy->uYn - 1900;
-        suTmTime.tm_isdst = 0;
-        psuTime->ulSecs   = mkgmtime(&suTmTime);
-        psuTime->ulFrac   = psuTimeDmy->uHmn * 1000000L + psuTimeDmy->uTmn * 100000L;
-        psuTime->enFmt    = I106_DATEFMT_DMY;
+        psuChanSpecTime  = (SuTimeF1_ChanSpec *)apvBuff[iIdx];
+        allAbsTime[iIdx] = llI106_Decode_TimeF1_Buff(psuChanSpecTime->uDateFmt, psuChanSpecTime->bLeapYear, 
+                                                     (char *)apvBuff[iIdx] + sizeof(SuTimeF1_ChanSpec), &suCache);
         }
 
     return;
@@ -381,69 +470,55 @@ EnI106Status I106_CALL_DECL
                          SuIrig106Time     * psuTime,
                          void              * pvBuffTimeF1)
     {
-    // A temporary integer to decimate to get BCD factors
-    uint32_t          uIntDec;
-    struct tm       * psuTmTime;
+    int64_t           llDays;
+    int               iSecOfDay;
+    int               iYear;
+    int               iMonth;
+    int               iDay;
+    int               iYearDay;
+    uint8_t         * pubyTime;
 
     SuMsgTimeF1 * psuTimeF1;
 
-    SuTime_MsgDayFmt   * psuDayFmt;
-    SuTime_MsgDmyFmt   * psuDmyFmt;
-
     // Now, after creating this ubertime-structure above, create a 
     // couple of pointers to make the code below simpler to read.
     psuTimeF1 = (SuMsgTimeF1 *)pvBuffTimeF1;
-    psuDayFmt = &(psuTimeF1->suMsg.suDayFmt);
-    psuDmyFmt = &(psuTimeF1->suMsg.suDmyFmt);
+    pubyTime  = (uint8_t *)&(psuTimeF1->suMsg);
 
     // Zero out all the time fields
     memset(psuTimeF1, 0, sizeof(SuTimeF1_ChanSpec));
 
     // Break time down to DMY HMS
-    psuTmTime = gmtime((time_t *)&(psuTime->ulSecs));
+    llDays    = (int64_t)psuTime->ulSecs / 86400;
+    iSecOfDay = (int)((int64_t)psuTime->ulSecs % 86400);
+    if (iSecOfDay < 0)
+        {
+        iSecOfDay += 86400;
+        llDays    -= 1;
+        }
+    vI106_Days2Date(llDays, &iYear, &iMonth, &iDay, &iYearDay);
 
     // Make channel specific data word
     psuTimeF1->suChanSpec.uTimeSrc    = uTimeSrc;
     psuTimeF1->suChanSpec.uTimeFmt    = uFmtTime;
     psuTimeF1->suChanSpec.uDateFmt    = uFmtDate;
-    if (psuTmTime->tm_year % 4 == 0)
+    if (iYear % 4 == 0)
         psuTimeF1->suChanSpec.bLeapYear = 1;
     else
         psuTimeF1->suChanSpec.bLeapYear = 0;
 
+    // The time fields are the same for both formats and each BCD field pair
+    // is one byte of the little endian time message words
+    pubyTime[0] = m_aubyBin2Bcd[psuTime->ulFrac / 100000L % 100];
+    pubyTime[1] = m_aubyBin2Bcd[iSecOfDay % 60];
+    pubyTime[2] = m_aubyBin2Bcd[iSecOfDay / 60 % 60];
+    pubyTime[3] = m_aubyBin2Bcd[iSecOfDay / 3600];
+
     // Fill in day of year format
     if (uFmtDate == 0)
         {
-        // Zero out all the time fields
-        memset(psuDayFmt, 0, sizeof(SuTime_MsgDayFmt));
-
-        // Set the various time fields
-        uIntDec = psuTime->ulFrac / 100000L;
-        psuDayFmt->uTmn = (uint16_t)(uIntDec  % 10);
-        uIntDec = (uIntDec - psuDayFmt->uHmn) / 10;
-        psuDayFmt->uHmn = (uint16_t)(uIntDec  % 10);
-
-        uIntDec = psuTmTime->tm_sec;
-        psuDayFmt->uSn  = (uint16_t)(uIntDec  % 10);
-        uIntDec = (uIntDec - psuDayFmt->uSn)  / 10;
-        psuDayFmt->uTSn = (uint16_t)(uIntDec  % 10);
-
-        uIntDec = psuTmTime->tm_min;
-        psuDayFmt->uMn  = (uint16_t)(uIntDec  % 10);
-        uIntDec = (uIntDec - psuDayFmt->uMn)  / 10;
-        psuDayFmt->uTMn = (uint16_t)(uIntDec  % 10);
-
-        uIntDec = psuTmTime->tm_hour;
-        psuDayFmt->uHn  = (uint16_t)(uIntDec  % 10);
-        uIntDec = (uIntDec - psuDayFmt->uHn)  / 10;
-        psuDayFmt->uTHn = (uint16_t)(uIntDec  % 10);
-
-        uIntDec = psuTmTime->tm_yday + 1;
-        psuDayFmt->uDn = (uint16_t)(uIntDec   % 10);
-        uIntDec = (uIntDec - psuDayFmt->uDn)  / 10;
-        psuDayFmt->uTDn = (uint16_t)(uIntDec  % 10);
-        uIntDec = (uIntDec - psuDayFmt->uTDn) / 10;
-        psuDayFmt->uHDn  = (uint16_t)(uIntDec  % 10);
+        pubyTime[4] = m_aubyBin2Bcd[iYearDay % 100];
+        pubyTime[5] = (uint8_t)(iYearDay / 100);
 
         // Set the data length in the header
         psuHeader->ulDataLen = 
@@ -453,48 +528,10 @@ EnI106Status I106_CALL_DECL
     // Fill in day, month, year format
     else
         {
-        // Zero out all the time fields
-        memset(psuDmyFmt, 0, sizeof(SuTime_MsgDmyFmt));
-
-        // Set the various time fields
-        uIntDec = psuTime->ulFrac / 100000L;
-        psuDmyFmt->uTmn = (uint16_t)(uIntDec  % 10);
-        uIntDec = (uIntDec - psuDmyFmt->uHmn) / 10;
-        psuDmyFmt->uHmn = (uint16_t)(uIntDec  % 10);
-
-        uIntDec = psuTmTime->tm_sec;
-        psuDmyFmt->uSn  = (uint16_t)(uIntDec  % 10);
-        uIntDec = (uIntDec - psuDmyFmt->uSn)  / 10;
-        psuDmyFmt->uTSn = (uint16_t)(uIntDec  % 10);
-
-        uIntDec = psuTmTime->tm_min;
-        psuDmyFmt->uMn  = (uint16_t)(uIntDec  % 10);
-        uIntDec = (uIntDec - psuDmyFmt->uMn)  / 10;
-        psuDmyFmt->uTMn = (uint16_t)(uIntDec  % 10);
-
-        uIntDec = psuTmTime->tm_hour;
-        psuDmyFmt->uHn  = (uint16_t)(uIntDec  % 10);
-        uIntDec = (uIntDec - psuDmyFmt->uHn)  / 10;
-        psuDmyFmt->uTHn = (uint16_t)(uIntDec  % 10);
-
-        uIntDec = psuTmTime->tm_mday;
-        psuDmyFmt->uDn  = (uint16_t)(uIntDec  % 10);
-        uIntDec = (uIntDec - psuDmyFmt->uDn)  / 10;
-        psuDmyFmt->uTDn = (uint16_t)(uIntDec  % 10);
-
-        uIntDec = psuTmTime->tm_mon + 1;
-        psuDmyFmt->uOn  = (uint16_t)(uIntDec  % 10);
-        uIntDec = (uIntDec - psuDmyFmt->uOn)  / 10;
-        psuDmyFmt->uTOn = (uint16_t)(uIntDec  % 10);
-
-        uIntDec = psuTmTime->tm_year + 1900;
-        psuDmyFmt->uYn  = (uint16_t)(uIntDec  % 10);
-        uIntDec = (uIntDec - psuDmyFmt->uYn)  / 10;
-        psuDmyFmt->uTYn = (uint16_t)(uIntDec  % 10);
-        uIntDec = (uIntDec - psuDmyFmt->uTYn) / 10;
-        psuDmyFmt->uHYn = (uint16_t)(uIntDec  % 10);
-        uIntDec = (uIntDec - psuDmyFmt->uHYn) / 10;
-        psuDmyFmt->uOYn = (uint16_t)(uIntDec  % 10);
+        pubyTime[4] = m_aubyBin2Bcd[iDay];
+        pubyTime[5] = m_aubyBin2Bcd[iMonth];
+        pubyTime[6] = m_aubyBin2Bcd[iYear % 100];
+        pubyTime[7] = m_aubyBin2Bcd[iYear / 100 % 100] & F1_HYEAR_MASK;
 
         // Set the data length in the header
         psuHeader->ulDataLen = 
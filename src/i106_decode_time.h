@@ -199,6 +199,16 @@ typedef struct
 #pragma pack(pop)
 #endif
 
+
+/// Day number of the last time F1 message decoded.  Time messages on the 
+/// same day reuse it.  Zero it out before first use.
+typedef struct
+    {
+    uint32_t    ulDateKey;              // BCD date fields of the cached day
+    int         bValid;                 // Cached day is valid
+    int64_t     llDaySecs;              // Seconds since 1970 at start of day
+    } SuTimeF1_DecodeCache;
+
 /*
  * Function Declaration
  * --------------------
@@ -215,6 +225,21 @@ void I106_CALL_DECL
                               void              * pvTimeBuff,
                               SuIrig106Time     * psuTime);
 
+// Decode the time F1 message straight to 64 bit absolute time (100 nsec 
+// since 1970, see enI106_RelInt2AbsTimeArray()).  psuCache may be NULL.
+int64_t I106_CALL_DECL 
+    llI106_Decode_TimeF1_Buff(int                     iDateFmt,
+                              int                     bLeapYear,
+                              void                  * pvTimeBuff,
+                              SuTimeF1_DecodeCache  * psuCache);
+
+// Decode a bunch of time F1 packets (channel specific word and time message,
+// as in enI106_Decode_TimeF1()) into 64 bit absolute times
+void I106_CALL_DECL 
+    vI106_Decode_TimeF1_Array(void                  * apvBuff[],
+                              int                     iCount,
+                              int64_t                 allAbsTime[]);
+
 EnI106Status I106_CALL_DECL 
     enI106_Encode_TimeF1(SuI106Ch10Header  * psuHeader,
                          unsigned int        uTimeSrc,
@@ -46,6 +46,18 @@
 
 #if defined(_WIN32)
 #include <io.h>
+#include <windows.h>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
 #endif
 
 #include <stdlib.h>
@@ -71,6 +83,27 @@ namespace Irig106 {
  * ----------------------
  */
 
+// The index for a handle lives in the handle context
+#define FILE_INDEX(iHandle)     (psuI106Handle(iHandle)->psuFileIndex)
+
+// Index table and index packet reading sizes
+#define INDEX_TABLE_MIN_NODES       1000        // Smallest index table to allocate
+#define INDEX_READ_BATCH_SIZE       0x1000000   // Node packet bytes to read before decoding
+#define INDEX_READ_BATCH_PACKETS    4096        // Node packets to read before decoding
+#define INDEX_PREFETCH_SIZE         0x10000     // Read ahead hint for each node packet
+#define INDEX_DECODE_MAX_THREADS    8
+#define INDEX_DECODE_MIN_NODES      0x8000      // Fewest node entries worth a thread
+
+// Channel index scan threads
+#define CHAN_INDEX_MAX_THREADS      16
+#define CHAN_INDEX_MIN_RANGE        0x1000000   // Smallest file range worth a thread
+
+// Index packet writing sizes
+#define INDEX_WRITE_NODE_ENTRIES    1000        // Default node entries per node packet
+#define INDEX_WRITE_ROOT_ENTRIES    1000        // Node packets per root packet
+
+// Index following
+#define INDEX_FOLLOW_POLL_MS        100         // How often to look for file growth without notification
 
 /*
  * Data structures
@@ -81,34 +114,154 @@ typedef struct SuFileIndex_S
     {
     uint32_t            uNodesUsed;         // Number of index nodes actually used
     uint32_t            uNodesAvailable;    // Number of index nodes available in the table
-    uint32_t            uNodeIncrement;     // Amount to increase the number of nodes
-    SuI106Ch10Header    suTimeF1Hdr;        // Header and buffer for an IRIG Format 1 time packet. 
-    void              * pvTimeF1Packet;     // This is necessary for date format and leap year flags
-    SuIrig106Time       suTimeF1;           // as well as relative time to absolute time mapping
-                                            // if absolute time isn't provided.
+    SuTimeSync          suTimeSync;         // An IRIG Format 1 time packet. This is necessary for
+                                            // date format and leap year flags as well as relative
+                                            // time to absolute time mapping if absolute time
+                                            // isn't provided.  All zero if none found.
     SuPacketIndexInfo * psuIndexTable;      // The main table of indexes
+    SuChanIndex       * asuChanIndex;       // Per channel tables sorted by channel ID
+    int                 iNumChanIndexes;
+    struct SuIndexWriter_S * psuWriter;     // Index packet writer, NULL if not writing
+    struct SuIndexFollow_S * psuFollow;     // File growth follower, NULL if not following
     } SuCh10Index;
 
+// Channel tables made by one channel index scan thread
+typedef struct
+    {
+    uint32_t          * aulChanSlot;        // Index + 1 into asuChan for each channel ID
+    SuChanIndex       * asuChan;
+    int                 iNumChans;
+    int                 iChansAvail;
+    } SuChanIndexScan;
+
+// State for writing index packets along with the data
+typedef struct SuIndexWriter_S
+    {
+    int64_t             llNextOffset;       // File offset of the next packet written
+    int64_t             llLastRelTime;      // RTC of the last packet written
+    int64_t             llLastRootOffset;   // Offset of the last root packet, -1 if none yet
+    int                 bAllChannels;       // Index all channels
+    uint8_t             abyChanMask[0x10000/8]; // Channels to index
+    uint8_t             ubySeqNum;          // Index packet sequence number
+    uint32_t            uNodeEntries;       // Node entries per node packet
+    SuIndex_NodeMsg   * asuNode;            // Node entries waiting to be written
+    uint32_t            uNodesUsed;
+    SuIndex_RootMsg   * asuRoot;            // Root entries for node packets already written
+    uint32_t            uRootsUsed;
+    } SuIndexWriter;
+
+// State for keeping the channel index tables current as the file grows
+typedef struct SuIndexFollow_S
+    {
+    int64_t             llNextOffset;       // File offset past the last packet indexed, -1 to find it
+    int                 bAbsTime;           // Keep absolute time up too
+    int                 bHaveTimeRef;       // Time reference found, absolute times are made with it
+    int                 bTimeModel;         // Time reference is the handle time model
+    SuTimeRef           suTimeRef;          // Time reference when there's no time model
+    int                 iNotify;            // File change notification, -1 to poll
+    } SuIndexFollow;
+
+// A node index packet read into the batch buffer, waiting to be decoded
+typedef struct
+    {
+    SuI106Ch10Header    suHdr;              // Node packet header
+    uint32_t            ulBuffOffset;       // Offset to packet data in the batch buffer
+    uint32_t            uFirstNode;         // Index table entry for the first node
+    uint32_t            uNumNodes;          // Number of node index entries
+    } SuNodePacket;
+
+// Buffers reused while reading root and node index packets
+typedef struct
+    {
+    uint8_t           * pchBuff;            // Index packet data
+    uint32_t            ulBuffSize;
+    uint8_t           * pchTimeBuff;        // Indexed time packet data
+    uint32_t            ulTimeBuffSize;
+    int64_t           * allNodeOffset;      // Node packet offsets from the root packets
+    uint32_t            uNodeOffsetsUsed;
+    uint32_t            uNodeOffsetsAvail;
+    SuNodePacket      * asuPacket;          // Node packets in the current batch
+    } SuIndexReader;
+
+// A range of node packets for a decode thread
+typedef struct
+    {
+    int                 iHandle;
+    uint8_t           * pchBuff;            // Batch buffer
+    SuNodePacket      * asuPacket;
+    int                 iNumPackets;
+    } SuNodeDecodeWorker;
+
 /*
  * Module data
  * -----------
  */
 
-static int                  m_bIndexesInited = bFALSE;      /// Flag to see if index data has been init'ed yet
-
-static SuCh10Index          m_asuCh10Index[MAX_HANDLES];
 
 /*
  * Function Declaration
  * --------------------
  */
 
-void            InitIndexes(void);
-
-EnI106Status    ProcessNodeIndexPacket(int iHandle, int64_t lNodeIndexOffset);
-EnI106Status    ProcessRootIndexPacket(int iHandle, int64_t lRootIndexOffset, int64_t * plNextIndexOffset);
+static SuCh10Index * psuGetIndex(int iHandle);
+
+static EnI106Status ProcessRootIndexPacket(int iHandle, int64_t lRootIndexOffset, int64_t * plNextIndexOffset,
+                                           SuIndexReader * psuReader);
+static EnI106Status enReadIndexPacket(int iHandle, int64_t llOffset, SuI106Ch10Header * psuHdr,
+                                      SuIndexReader * psuReader, uint32_t ulBuffOffset);
+static EnI106Status enReadNodeBatch(int iHandle, SuIndexReader * psuReader, uint32_t uFirstPacket,
+                                    int * piNumPackets, uint32_t * puNumNodes);
+static void vPrefetchNodePackets(int iHandle, SuIndexReader * psuReader, uint32_t uFirstPacket);
+static void vDecodeNodeBatch(int iHandle, SuIndexReader * psuReader, int iNumPackets, uint32_t uNumNodes);
+static void vDecodeNodePacket(int iHandle, SuNodePacket * psuPacket, void * pvBuff);
+static void vNodeDecodeWorker(SuNodeDecodeWorker * psuWorker);
+#if defined(_WIN32)
+static unsigned __stdcall uNodeDecodeThread(void * pvWorker);
+#else
+static void * pvNodeDecodeThread(void * pvWorker);
+#endif
+static void vReadIndexedTimePackets(int iHandle, SuIndexReader * psuReader, int iNumPackets);
+static int  bGrowIndexTable(int iHandle, uint32_t uNodesNeeded);
+static int  CompareOffsets(const void * pOffset1, const void * pOffset2);
+
+static EnI106Status enChanIndexScanSerial(int iHandle, SuChanIndexScan * psuScan);
+static EnI106Status I106_CALL_DECL enChanIndexScanHandler(int iThread, int64_t llFileOffset,
+                                   SuI106Ch10Header * psuHeader, void * pvData, void * pvUserData);
+static int  bChanIndexScanAdd(SuChanIndexScan * psuScan, int64_t llOffset, SuI106Ch10Header * psuHeader);
+static int  bGrowChanIndex(SuChanIndex * psuChan, uint32_t uNeeded);
+static int  bMergeChanIndexScans(SuChanIndexScan asuScan[], int iNumScans,
+                                 SuChanIndex ** pasuChan, int * piNumChans);
+static int  bSortChanIndex(SuChanIndex * psuChan);
+static EnI106Status enMakeChanAbsTimes(int iHandle);
+static EnI106Status enGetChanTimeRef(int iHandle, int * pbTimeModel, SuTimeRef * psuTimeRef);
+static EnI106Status enMakeChanAbsTime(int iHandle, int bTimeModel, SuTimeRef * psuTimeRef,
+                                      SuChanIndex * psuChan, uint32_t uFirst);
+static void vFreeChanIndexScan(SuChanIndexScan * psuScan);
+static void vFreeChanIndexes(SuChanIndex * asuChan, int iNumChans);
+static int  CompareChanIndexes(const void * pChan1, const void * pChan2);
+static int  CompareTimeOffsets(const void * pInfo1, const void * pInfo2);
+
+static int  bChanAbsTimesMissing(int iHandle, const uint16_t auChID[], int iNumChID);
+static uint32_t uFindTimeAfter(const int64_t allTime[], uint32_t uCount, int64_t llTime);
+static int  CompareQueryTimes(const void * pPacket1, const void * pPacket2);
+static int  CompareQueryOffsets(const void * pPacket1, const void * pPacket2);
+
+static EnI106Status enWriteNodeIndexPacket(int iHandle);
+static EnI106Status enWriteRootIndexPacket(int iHandle);
+static EnI106Status enWriteIndexPacket(int iHandle, int iIndexType, void * pvMsgs,
+                                       uint32_t uNumMsgs, uint32_t ulMsgLen);
+static void vFreeIndexWriter(SuIndexWriter * psuWriter);
+
+static EnI106Status enFollowScan(int iHandle, SuIndexFollow * psuFollow, int64_t llFileSize,
+                                 SuChanIndexScan * psuScan);
+static EnI106Status enAppendChanIndexScan(int iHandle, SuChanIndexScan * psuScan, uint32_t * puNewPackets);
+static EnI106Status enFindChanIndexEnd(int iHandle, int64_t * pllEndOffset);
+static EnI106Status enFollowTimeRef(int iHandle, SuIndexFollow * psuFollow);
+static void vFollowWait(SuIndexFollow * psuFollow, int iWaitMs);
+static int64_t llFollowFileSize(int iHandle);
+static int64_t llFollowMilliSecs(void);
+static void vFreeIndexFollow(SuIndexFollow * psuFollow);
 
-void AddIndexNodeToIndex(int iHandle, SuIndex_CurrMsg * psuNodeIndexMsg, uint16_t uChID, uint8_t ubyDataType);
 void AddNodeToIndex(int iHandle, SuPacketIndexInfo * psuIndexInfo);
 
 EnI106Status FindTimePacket(int iHandle);
@@ -151,7 +304,7 @@ EnI106Status I106_CALL_DECL
         *bFoundIndex = bFALSE;
 
         // If data file not open in read mode then return
-        if (g_suI106Handle[iHandle].enFileMode != I106_READ)
+        if (psuI106Handle(iHandle)->enFileMode != I106_READ)
             return I106_NOT_OPEN;
 
         // Save current position
@@ -243,7 +396,7 @@ EnI106Status I106_CALL_DECL enIndexPresent(const int iHandle, int * bFoundIndex)
     *bFoundIndex = bFALSE;
 
     // If data file not open in read mode then return
-    if (g_suI106Handle[iHandle].enFileMode != I106_READ)
+    if (psuI106Handle(iHandle)->enFileMode != I106_READ)
         return I106_NOT_OPEN;
 
     // Save current position
@@ -258,7 +411,7 @@ EnI106Status I106_CALL_DECL enIndexPresent(const int iHandle, int * bFoundIndex)
         if (enStatus != I106_OK)
             break;
 
-        enStatus = enI106Ch10ReadNextHeader(iHandle, &suI106Hdr);
+        enStatus = enI106Ch10ReadNextHeaderFile(iHandle, &suI106Hdr);
         if (enStatus != I106_OK)
             break;
 
@@ -277,17 +430,33 @@ EnI106Status I106_CALL_DECL enIndexPresent(const int iHandle, int * bFoundIndex)
 
 /* ----------------------------------------------------------------------- */
 
+// Reading a recorder index happens in two passes.  First the chain of root
+// index packets is walked back from the end of the file to collect the
+// offsets of all the node index packets.  Then the node packets are read in
+// file offset order, a batch at a time, into one reused buffer.  The number
+// of node entries in a batch is known once it is read, so the index table
+// gets sized for the whole file up front and each node packet decodes into
+// its own part of the table.  That lets big batches decode in parallel.
+
 EnI106Status I106_CALL_DECL enReadIndexes(const int iHandle)
     {
     EnI106Status        enStatus = I106_OK;
+    EnI106Status        enNodeStatus;
     int                 bFoundIndex;
     int64_t             llStartingFileOffset;
     int64_t             llCurrRootIndexOffset;
     int64_t             llNextRootIndexOffset;
-
-    // First, see if indexes have been init'ed
-    if (m_bIndexesInited == bFALSE)
-        InitIndexes();
+    SuIndexReader       suReader;
+    uint32_t            uNodePacket;
+    uint32_t            uOffsetIdx;
+    uint32_t            uNumNodes;
+    uint32_t            uNodesNeeded;
+    int64_t             llNodesNeeded;
+    int                 iNumPackets;
+
+    // Make sure there is an index for this handle
+    if (psuGetIndex(iHandle) == NULL)
+        return I106_INVALID_HANDLE;
 
 #if 0
     // enIndexPresent() can be computationally expensive for large files and/or
@@ -306,14 +475,14 @@ EnI106Status I106_CALL_DECL enReadIndexes(const int iHandle)
 
     // The reading mode must be I106_READ
 // TODO : get rid of this global
-    if (g_suI106Handle[iHandle].enFileMode != I106_READ )
+    if (psuI106Handle(iHandle)->enFileMode != I106_READ )
         {
         return I106_WRONG_FILE_MODE;
         }
 
     // The optional intrapacket data header provides absolute time in IRIG Time
     // Format 1 format.  Unfortunately there are two important pieces of information
-    // that are only in the CSDW, the date format flag and the leap year flag (need 
+    // that are only in the CSDW, the date format flag and the leap year flag (need
     // for DoY format).  The time CSDW isn't provided in the index.  So the plan
     // is to go read a time packet and hope that date format and leap year are
     // the same.
@@ -326,11 +495,14 @@ EnI106Status I106_CALL_DECL enReadIndexes(const int iHandle)
     // Save this file offset
     enStatus = enI106Ch10GetPos(iHandle, &llCurrRootIndexOffset);
 
+    memset(&suReader, 0, sizeof(suReader));
+
     // Root packet found so start processing root index packets
     while (1==1)
         {
         // Process the root packet at the given offset
-        enStatus = ProcessRootIndexPacket(iHandle, llCurrRootIndexOffset, &llNextRootIndexOffset);
+        llNextRootIndexOffset = llCurrRootIndexOffset;
+        enStatus = ProcessRootIndexPacket(iHandle, llCurrRootIndexOffset, &llNextRootIndexOffset, &suReader);
 
         // Check for no index
         if (enStatus == I106_INVALID_DATA)
@@ -343,7 +515,9 @@ EnI106Status I106_CALL_DECL enReadIndexes(const int iHandle)
         if (enStatus != I106_OK)
             break;
 
-        if (llCurrRootIndexOffset == llNextRootIndexOffset)
+        // Root packets link back toward the start of the file and the first
+        // one links to itself.  Anything else would loop forever.
+        if (llCurrRootIndexOffset <= llNextRootIndexOffset)
             break;
 
         // Not done so setup for the next root index packet
@@ -351,6 +525,66 @@ EnI106Status I106_CALL_DECL enReadIndexes(const int iHandle)
 
         } // end looping on root index packets
 
+    // Put the node packets in file order and drop any listed twice
+    if (suReader.uNodeOffsetsUsed > 1)
+        {
+        qsort(suReader.allNodeOffset, suReader.uNodeOffsetsUsed, sizeof(int64_t), &CompareOffsets);
+        uNodePacket = 1;
+        for (uOffsetIdx=1; uOffsetIdx<suReader.uNodeOffsetsUsed; uOffsetIdx++)
+            {
+            if (suReader.allNodeOffset[uOffsetIdx] != suReader.allNodeOffset[uNodePacket-1])
+                suReader.allNodeOffset[uNodePacket++] = suReader.allNodeOffset[uOffsetIdx];
+            }
+        suReader.uNodeOffsetsUsed = uNodePacket;
+        }
+
+    // Read and decode the node packets a batch at a time.  Node packets from
+    // root packets read before any root packet error still get added.
+    enNodeStatus = I106_OK;
+    uNodePacket  = 0;
+    if (suReader.uNodeOffsetsUsed > 0)
+        vPrefetchNodePackets(iHandle, &suReader, 0);
+    while (uNodePacket < suReader.uNodeOffsetsUsed)
+        {
+        // Node packets read before an error still get decoded
+        enNodeStatus = enReadNodeBatch(iHandle, &suReader, uNodePacket, &iNumPackets, &uNumNodes);
+        if (iNumPackets == 0)
+            break;
+
+        // Start the disk on the next batch while this one decodes
+        uNodePacket += iNumPackets;
+        if (uNodePacket < suReader.uNodeOffsetsUsed)
+            vPrefetchNodePackets(iHandle, &suReader, uNodePacket);
+
+        // Size the table for this batch plus the rest of the node packets
+        // at the same number of nodes per packet
+        llNodesNeeded = (int64_t)FILE_INDEX(iHandle)->uNodesUsed + uNumNodes +
+                        (int64_t)uNumNodes * (suReader.uNodeOffsetsUsed - uNodePacket) / iNumPackets;
+        uNodesNeeded  = FILE_INDEX(iHandle)->uNodesUsed + uNumNodes;
+        if ((llNodesNeeded > uNodesNeeded) && (llNodesNeeded < 0xffffffff))
+            uNodesNeeded = (uint32_t)llNodesNeeded;
+        if (bGrowIndexTable(iHandle, uNodesNeeded) == bFALSE)
+            {
+            enNodeStatus = I106_NO_MEMORY;
+            break;
+            }
+
+        vDecodeNodeBatch(iHandle, &suReader, iNumPackets, uNumNodes);
+        vReadIndexedTimePackets(iHandle, &suReader, iNumPackets);
+        FILE_INDEX(iHandle)->uNodesUsed += uNumNodes;
+
+        if (enNodeStatus != I106_OK)
+            break;
+        } // end while reading node packets
+
+    if (enStatus == I106_OK)
+        enStatus = enNodeStatus;
+
+    free(suReader.pchBuff);
+    free(suReader.pchTimeBuff);
+    free(suReader.allNodeOffset);
+    free(suReader.asuPacket);
+
     // Sort the resultant index
     SortIndexes(iHandle);
 
@@ -364,53 +598,46 @@ EnI106Status I106_CALL_DECL enReadIndexes(const int iHandle)
 
 /* ----------------------------------------------------------------------- */
 
-EnI106Status ProcessRootIndexPacket(int iHandle, int64_t lRootIndexOffset, int64_t * plNextIndexOffset)
+// Read the root index packet at the given offset and add the node index
+// packet offsets it holds to the list to read.
+
+static EnI106Status ProcessRootIndexPacket(int iHandle, int64_t lRootIndexOffset, int64_t * plNextIndexOffset,
+                                           SuIndexReader * psuReader)
     {
     EnI106Status        enStatus = I106_OK;
     SuI106Ch10Header    suHdr;
-    void              * pvRootBuff = NULL;
     SuIndex_CurrMsg     suCurrRootIndexMsg;
-
-    // Go to what should be a root index packet
-    enStatus = enI106Ch10SetPos(iHandle, lRootIndexOffset);
-    if (enStatus != I106_OK)
-        return enStatus;
+    int64_t           * allNewOffset;
+    uint32_t            uNewAvail;
 
     // Read what should be a root index packet
-    enStatus = enI106Ch10ReadNextHeader(iHandle, &suHdr);
-
+    enStatus = enReadIndexPacket(iHandle, lRootIndexOffset, &suHdr, psuReader, 0);
     if (enStatus != I106_OK)
         return enStatus;
 
-    if (suHdr.ubyDataType != I106CH10_DTYPE_RECORDING_INDEX)
-        return I106_INVALID_DATA;
-
-    // Read the index packet
-    pvRootBuff = malloc(suHdr.ulPacketLen);
-
-    // Read the data buffer
-    enStatus = enI106Ch10ReadData(iHandle, suHdr.ulPacketLen, pvRootBuff);
+    // Decode the first root index message
+    enStatus = enI106_Decode_FirstIndex(&suHdr, psuReader->pchBuff, &suCurrRootIndexMsg);
 
-    // Check for data read errors
-    if (enStatus != I106_OK)
+    // Make room for all the node offsets in this packet
+    if (psuReader->uNodeOffsetsAvail < psuReader->uNodeOffsetsUsed + suCurrRootIndexMsg.psuChanSpec->uIdxEntCount)
         {
-        free(pvRootBuff);
-        return enStatus;
+        uNewAvail = psuReader->uNodeOffsetsAvail * 2;
+        if (uNewAvail < psuReader->uNodeOffsetsUsed + suCurrRootIndexMsg.psuChanSpec->uIdxEntCount)
+            uNewAvail = psuReader->uNodeOffsetsUsed + suCurrRootIndexMsg.psuChanSpec->uIdxEntCount;
+        allNewOffset = (int64_t *)realloc(psuReader->allNodeOffset, uNewAvail * sizeof(int64_t));
+        if (allNewOffset == NULL)
+            return I106_NO_MEMORY;
+        psuReader->allNodeOffset     = allNewOffset;
+        psuReader->uNodeOffsetsAvail = uNewAvail;
         }
 
-    // Decode the first root index message
-    enStatus = enI106_Decode_FirstIndex(&suHdr, pvRootBuff, &suCurrRootIndexMsg);
-
     // Loop on all root index messages
     while (1==1)
         {
-        // Root message, go to node packet and decode
+        // Root message, save the node packet offset for later
         if      (enStatus == I106_INDEX_ROOT)
             {
-            // Go process the node packet
-            enStatus = ProcessNodeIndexPacket(iHandle, *(suCurrRootIndexMsg.plFileOffset));
-            if (enStatus != I106_OK)
-                break;                
+            psuReader->allNodeOffset[psuReader->uNodeOffsetsUsed++] = *(suCurrRootIndexMsg.plFileOffset);
             } // end if root index message
 
         // Last root message links to the next root packet
@@ -444,8 +671,6 @@ EnI106Status ProcessRootIndexPacket(int iHandle, int64_t lRootIndexOffset, int64
 
         } // end while walking root index packet
 
-    free(pvRootBuff);
-
     return enStatus;
     } // end ProcessRootIndexPacket()
 
@@ -453,141 +678,320 @@ EnI106Status ProcessRootIndexPacket(int iHandle, int64_t lRootIndexOffset, int64
 
 /* ----------------------------------------------------------------------- */
 
-// Go to the given offset, read what should be a node index packet, read
-// the index values, and add the info to the index memory array.
+// Go to the given offset, read what should be an index packet, and put its
+// data in the reader buffer at the given buffer offset.
 
-EnI106Status ProcessNodeIndexPacket(int iHandle, int64_t lNodeIndexOffset)
+static EnI106Status enReadIndexPacket(int iHandle, int64_t llOffset, SuI106Ch10Header * psuHdr,
+                                      SuIndexReader * psuReader, uint32_t ulBuffOffset)
     {
-    EnI106Status        enStatus = I106_OK;
-    SuI106Ch10Header    suHdr;
-    void              * pvNodeBuff = NULL;
-    SuIndex_CurrMsg     suCurrNodeIndexMsg;
+    EnI106Status        enStatus;
+    uint8_t           * pchNewBuff;
+    uint32_t            ulNewSize;
 
-    // Go to what should be a node index packet
-    enStatus = enI106Ch10SetPos(iHandle, lNodeIndexOffset);
+    // Go to what should be an index packet
+    enStatus = enI106Ch10SetPos(iHandle, llOffset);
     if (enStatus != I106_OK)
         return enStatus;
 
     // Read the packet header
-    enStatus = enI106Ch10ReadNextHeader(iHandle, &suHdr);
-
+    enStatus = enI106Ch10ReadNextHeaderFile(iHandle, psuHdr);
     if (enStatus != I106_OK)
         return enStatus;
 
-    if (suHdr.ubyDataType != I106CH10_DTYPE_RECORDING_INDEX)
+    if (psuHdr->ubyDataType != I106CH10_DTYPE_RECORDING_INDEX)
         return I106_INVALID_DATA;
 
     // Make sure our buffer is big enough, size *does* matter
-    pvNodeBuff = malloc(suHdr.ulPacketLen);
+    if (psuReader->ulBuffSize < ulBuffOffset + psuHdr->ulPacketLen)
+        {
+        ulNewSize = psuReader->ulBuffSize * 2;
+        if (ulNewSize < ulBuffOffset + psuHdr->ulPacketLen)
+            ulNewSize = ulBuffOffset + psuHdr->ulPacketLen;
+        pchNewBuff = (uint8_t *)realloc(psuReader->pchBuff, ulNewSize);
+        if (pchNewBuff == NULL)
+            return I106_NO_MEMORY;
+        psuReader->pchBuff    = pchNewBuff;
+        psuReader->ulBuffSize = ulNewSize;
+        }
 
     // Read the data buffer
-    enStatus = enI106Ch10ReadData(iHandle, suHdr.ulPacketLen, pvNodeBuff);
+    enStatus = enI106Ch10ReadData(iHandle, psuHdr->ulPacketLen, psuReader->pchBuff + ulBuffOffset);
 
-    // Check for data read errors
-    if (enStatus != I106_OK)
-        {
-        free(pvNodeBuff);
-        return enStatus;
-        }
+    return enStatus;
+    }
 
-    // Decode the first node index message
-    enStatus = enI106_Decode_FirstIndex(&suHdr, pvNodeBuff, &suCurrNodeIndexMsg);
 
-    // Loop on all node index messages
-    while (1==1)
+
+/* ----------------------------------------------------------------------- */
+
+// Read node index packets starting with the given one into the batch buffer
+// until the buffer is full.  Return how many packets were read and the total
+// number of node index entries in them.
+
+static EnI106Status enReadNodeBatch(int iHandle, SuIndexReader * psuReader, uint32_t uFirstPacket,
+                                    int * piNumPackets, uint32_t * puNumNodes)
+    {
+    EnI106Status        enStatus = I106_OK;
+    SuNodePacket      * psuPacket;
+    SuIndex_ChanSpec  * psuChanSpec;
+    uint32_t            ulBuffUsed = 0;
+    uint32_t            ulHdrLen;
+    uint32_t            ulMsgLen;
+    uint32_t            uMaxNodes;
+    int                 iNumPackets = 0;
+
+    *piNumPackets = 0;
+    *puNumNodes   = 0;
+
+    if (psuReader->asuPacket == NULL)
         {
-        // Node message, go to node packet and decode
-        if     (enStatus == I106_INDEX_NODE)
-            {
-            // Add this node to the index
-            AddIndexNodeToIndex(iHandle, &suCurrNodeIndexMsg, suHdr.uChID, suHdr.ubyDataType);
-            } // end if node index message
+        psuReader->asuPacket = (SuNodePacket *)malloc(INDEX_READ_BATCH_PACKETS * sizeof(SuNodePacket));
+        if (psuReader->asuPacket == NULL)
+            return I106_NO_MEMORY;
+        }
 
-        else if ((enStatus == I106_INDEX_ROOT) || (enStatus == I106_INDEX_ROOT_LINK))
-            {
-            enStatus = I106_INVALID_DATA;
+    while ((iNumPackets < INDEX_READ_BATCH_PACKETS)               &&
+           (uFirstPacket + iNumPackets < psuReader->uNodeOffsetsUsed) &&
+           (ulBuffUsed < INDEX_READ_BATCH_SIZE))
+        {
+        psuPacket = &psuReader->asuPacket[iNumPackets];
+        enStatus  = enReadIndexPacket(iHandle, psuReader->allNodeOffset[uFirstPacket + iNumPackets],
+                                      &psuPacket->suHdr, psuReader, ulBuffUsed);
+        if (enStatus != I106_OK)
             break;
-            }
 
-        // Done reading messages from the index buffer
-        else if (enStatus == I106_NO_MORE_DATA)
+        // Root messages in a node packet mean something is wrong
+        psuChanSpec = (SuIndex_ChanSpec *)(psuReader->pchBuff + ulBuffUsed);
+        if ((psuPacket->suHdr.ulDataLen < sizeof(SuIndex_ChanSpec)) ||
+            (psuChanSpec->uIndexType != 1))
             {
-            enStatus = I106_OK;
+            enStatus = I106_INVALID_DATA;
             break;
             }
 
-        // Any other return status is an error of some sort
-        else
-            break;
+        // Don't believe an entry count that runs past the end of the packet
+        ulHdrLen  = sizeof(SuIndex_ChanSpec) + (psuChanSpec->bFileSize ? sizeof(int64_t) : 0);
+        ulMsgLen  = psuChanSpec->bIntraPktHdr ? sizeof(SuIndex_NodeMsgOptTime) : sizeof(SuIndex_NodeMsg);
+        uMaxNodes = psuPacket->suHdr.ulDataLen > ulHdrLen ? (psuPacket->suHdr.ulDataLen - ulHdrLen) / ulMsgLen : 0;
 
-        // Get the next node index message
-        enStatus = enI106_Decode_NextIndex(&suCurrNodeIndexMsg);
+        psuPacket->ulBuffOffset = ulBuffUsed;
+        psuPacket->uFirstNode   = *puNumNodes;
+        psuPacket->uNumNodes    = psuChanSpec->uIdxEntCount < uMaxNodes ? psuChanSpec->uIdxEntCount : uMaxNodes;
 
-        } // end while walking node index packet
+        *puNumNodes += psuPacket->uNumNodes;
+        ulBuffUsed  += psuPacket->suHdr.ulPacketLen;
+        iNumPackets++;
+        } // end while reading node packets
 
-    free(pvNodeBuff);
+    *piNumPackets = iNumPackets;
 
     return enStatus;
-    } // end ProcessNodeIndexPacket()
+    }
 
 
 
 /* ----------------------------------------------------------------------- */
 
-/** Add an index packet node to the in memory index array
- */
+// Tell the OS which parts of the file the next batch of node packets will
+// be read from so it can get them from the disk all at once.
 
-void AddIndexNodeToIndex(int iHandle, SuIndex_CurrMsg * psuNodeIndexMsg, uint16_t uChID, uint8_t ubyDataType)
+static void vPrefetchNodePackets(int iHandle, SuIndexReader * psuReader, uint32_t uFirstPacket)
     {
-    SuPacketIndexInfo   suIndexInfo;
-    SuI106Ch10Header    suHdr;
-    void              * pvTimeBuff;
-    SuTimeF1_ChanSpec * psuTimeCSDW;
+#if !defined(_WIN32) && defined(POSIX_FADV_WILLNEED)
+    uint32_t            uPacket;
+
+    for (uPacket=uFirstPacket;
+         (uPacket < uFirstPacket + INDEX_READ_BATCH_PACKETS) && (uPacket < psuReader->uNodeOffsetsUsed);
+         uPacket++)
+        posix_fadvise(psuI106Handle(iHandle)->iFile, psuReader->allNodeOffset[uPacket],
+                      INDEX_PREFETCH_SIZE, POSIX_FADV_WILLNEED);
+#else
+    (void)iHandle;
+    (void)psuReader;
+    (void)uFirstPacket;
+#endif
+
+    return;
+    }
+
 
-    // Store the info
-    suIndexInfo.uChID       =   psuNodeIndexMsg->psuNodeData->uChannelID;
-    suIndexInfo.ubyDataType =   psuNodeIndexMsg->psuNodeData->uDataType;
-    suIndexInfo.lFileOffset = *(psuNodeIndexMsg->plFileOffset);
-    suIndexInfo.lRelTime    =   psuNodeIndexMsg->psuTime->llTime;
 
-    // If the optional intrapacket data header exists then get absolute time from it
-    if (psuNodeIndexMsg->psuChanSpec->bIntraPktHdr == 1)
+/* ----------------------------------------------------------------------- */
+
+// Decode a batch of node packets into the index table after the entries
+// already used.  The table must already be big enough.  Big batches are
+// split up by node count and decoded by several threads.
+
+static void vDecodeNodeBatch(int iHandle, SuIndexReader * psuReader, int iNumPackets, uint32_t uNumNodes)
+    {
+    SuNodeDecodeWorker  asuWorker[INDEX_DECODE_MAX_THREADS];
+#if defined(_WIN32)
+    HANDLE              ahThread[INDEX_DECODE_MAX_THREADS];
+#else
+    pthread_t           ahThread[INDEX_DECODE_MAX_THREADS];
+#endif
+    int                 abThreadOK[INDEX_DECODE_MAX_THREADS];
+    int                 iNumThreads;
+    int                 iThreadIdx;
+    int                 iPacket;
+    uint32_t            uNodesDone;
+
+    // Node table slots follow the ones already used
+    for (iPacket=0; iPacket<iNumPackets; iPacket++)
+        psuReader->asuPacket[iPacket].uFirstNode += FILE_INDEX(iHandle)->uNodesUsed;
+
+    // Pick the number of threads
+    iNumThreads = iI106Ch10GetNumCpus();
+    if (iNumThreads > INDEX_DECODE_MAX_THREADS)
+        iNumThreads = INDEX_DECODE_MAX_THREADS;
+    if ((uint32_t)iNumThreads > uNumNodes / INDEX_DECODE_MIN_NODES)
+        iNumThreads = (int)(uNumNodes / INDEX_DECODE_MIN_NODES);
+    if (iNumThreads > iNumPackets)
+        iNumThreads = iNumPackets;
+
+    // Not worth starting threads
+    if (iNumThreads <= 1)
+        {
+        for (iPacket=0; iPacket<iNumPackets; iPacket++)
+            vDecodeNodePacket(iHandle, &psuReader->asuPacket[iPacket],
+                              psuReader->pchBuff + psuReader->asuPacket[iPacket].ulBuffOffset);
+        return;
+        }
+
+    // Give each thread about the same number of nodes
+    iPacket    = 0;
+    uNodesDone = 0;
+    for (iThreadIdx=0; iThreadIdx<iNumThreads; iThreadIdx++)
+        {
+        asuWorker[iThreadIdx].iHandle     = iHandle;
+        asuWorker[iThreadIdx].pchBuff     = psuReader->pchBuff;
+        asuWorker[iThreadIdx].asuPacket   = &psuReader->asuPacket[iPacket];
+        asuWorker[iThreadIdx].iNumPackets = 0;
+        while ((iPacket < iNumPackets) &&
+               ((iThreadIdx == iNumThreads-1) ||
+                (uNodesDone < (uint64_t)uNumNodes * (iThreadIdx + 1) / iNumThreads)))
+            {
+            uNodesDone += psuReader->asuPacket[iPacket].uNumNodes;
+            asuWorker[iThreadIdx].iNumPackets++;
+            iPacket++;
+            }
+        }
+
+    // Start the threads.  If a thread can't be started just do its work here.
+    for (iThreadIdx=0; iThreadIdx<iNumThreads; iThreadIdx++)
         {
-        psuTimeCSDW = (SuTimeF1_ChanSpec *)m_asuCh10Index[iHandle].pvTimeF1Packet;
-        enI106_Decode_TimeF1_Buff(
-            psuTimeCSDW->uDateFmt, psuTimeCSDW->bLeapYear,
-            psuNodeIndexMsg->psuOptionalTime, &suIndexInfo.suIrigTime);
+#if defined(_WIN32)
+        ahThread[iThreadIdx] = (HANDLE)_beginthreadex(NULL, 0, uNodeDecodeThread,
+                                                      &asuWorker[iThreadIdx], 0, NULL);
+        abThreadOK[iThreadIdx] = ahThread[iThreadIdx] != 0;
+#else
+        abThreadOK[iThreadIdx] = pthread_create(&ahThread[iThreadIdx], NULL,
+                                                pvNodeDecodeThread, &asuWorker[iThreadIdx]) == 0;
+#endif
+        if (!abThreadOK[iThreadIdx])
+            vNodeDecodeWorker(&asuWorker[iThreadIdx]);
         }
 
-    // Else if the indexed packet is a time packet then get the time from it
-    else if (psuNodeIndexMsg->psuNodeData->uDataType == I106CH10_DTYPE_IRIG_TIME)
+    // Wait for everyone to finish
+    for (iThreadIdx=0; iThreadIdx<iNumThreads; iThreadIdx++)
         {
-        // Go to what should be a time packet
-        enI106Ch10SetPos(iHandle, *(psuNodeIndexMsg->plFileOffset));
+        if (!abThreadOK[iThreadIdx])
+            continue;
+#if defined(_WIN32)
+        WaitForSingleObject(ahThread[iThreadIdx], INFINITE);
+        CloseHandle(ahThread[iThreadIdx]);
+#else
+        pthread_join(ahThread[iThreadIdx], NULL);
+#endif
+        }
+
+    return;
+    }
 
-        // Read the packet header
-        enI106Ch10ReadNextHeader(iHandle, &suHdr);
 
-        // Make sure our buffer is big enough
-        pvTimeBuff = malloc(suHdr.ulPacketLen);
 
-        // Read the data buffer
-        enI106Ch10ReadData(iHandle, suHdr.ulPacketLen, pvTimeBuff);
+/* ----------------------------------------------------------------------- */
 
-        // Decode the time packet
-        enI106_Decode_TimeF1(&suHdr, pvTimeBuff, &suIndexInfo.suIrigTime);
+static void vNodeDecodeWorker(SuNodeDecodeWorker * psuWorker)
+    {
+    int                 iPacket;
 
-        free(pvTimeBuff);
+    for (iPacket=0; iPacket<psuWorker->iNumPackets; iPacket++)
+        vDecodeNodePacket(psuWorker->iHandle, &psuWorker->asuPacket[iPacket],
+                          psuWorker->pchBuff + psuWorker->asuPacket[iPacket].ulBuffOffset);
 
-        }
+    return;
+    }
 
-    // Else no absolute time available, so make it from relative time
-    else
+
+
+#if defined(_WIN32)
+static unsigned __stdcall uNodeDecodeThread(void * pvWorker)
+    {
+    vNodeDecodeWorker((SuNodeDecodeWorker *)pvWorker);
+    return 0;
+    }
+#else
+static void * pvNodeDecodeThread(void * pvWorker)
+    {
+    vNodeDecodeWorker((SuNodeDecodeWorker *)pvWorker);
+    return NULL;
+    }
+#endif
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Decode the node index entries in a node packet into the index table.  This
+// doesn't touch the file so it is safe to run in several threads at once.
+// Indexed time packets get their time from relative time for now and are
+// read later by vReadIndexedTimePackets().
+
+static void vDecodeNodePacket(int iHandle, SuNodePacket * psuPacket, void * pvBuff)
+    {
+    EnI106Status            enStatus;
+    SuIndex_CurrMsg         suNodeIndexMsg;
+    SuPacketIndexInfo     * psuIndexInfo;
+    SuTimeF1_ChanSpec     * psuTimeCSDW;
+    SuTimeF1_DecodeCache    suTimeCache;
+    uint32_t                uNode;
+
+    psuIndexInfo = &FILE_INDEX(iHandle)->psuIndexTable[psuPacket->uFirstNode];
+    psuTimeCSDW  = (SuTimeF1_ChanSpec *)&FILE_INDEX(iHandle)->suTimeSync.ulChanSpec;
+    memset(&suTimeCache, 0, sizeof(suTimeCache));
+
+    enStatus = enI106_Decode_FirstIndex(&psuPacket->suHdr, pvBuff, &suNodeIndexMsg);
+    for (uNode=0; uNode<psuPacket->uNumNodes; uNode++)
         {
-        RelInt2IrigTime(iHandle, psuNodeIndexMsg->psuTime->llTime, &suIndexInfo.suIrigTime);
-        }
+        // Keep the table entries consistent even if decoding stops early
+        if (enStatus != I106_INDEX_NODE)
+            {
+            memset(psuIndexInfo, 0, sizeof(SuPacketIndexInfo));
+            psuIndexInfo++;
+            continue;
+            }
+
+        // Store the info
+        psuIndexInfo->uChID       =   suNodeIndexMsg.psuNodeData->uChannelID;
+        psuIndexInfo->ubyDataType =   suNodeIndexMsg.psuNodeData->uDataType;
+        psuIndexInfo->lFileOffset = *(suNodeIndexMsg.plFileOffset);
+        psuIndexInfo->lRelTime    =   suNodeIndexMsg.psuTime->llTime;
+
+        // If the optional intrapacket data header exists then get absolute time from it
+        if (suNodeIndexMsg.psuChanSpec->bIntraPktHdr == 1)
+            vAbsInt2IrigTime(llI106_Decode_TimeF1_Buff(psuTimeCSDW->uDateFmt, psuTimeCSDW->bLeapYear,
+                                                       suNodeIndexMsg.psuOptionalTime, &suTimeCache),
+                             psuTimeCSDW->uDateFmt == 0 ? I106_DATEFMT_DAY : I106_DATEFMT_DMY,
+                             &psuIndexInfo->suIrigTime);
+
+        // Else make it from relative time
+        else
+            RelInt2IrigTime(iHandle, suNodeIndexMsg.psuTime->llTime, &psuIndexInfo->suIrigTime);
 
-    AddNodeToIndex(iHandle, &suIndexInfo);
+        psuIndexInfo++;
+        enStatus = enI106_Decode_NextIndex(&suNodeIndexMsg);
+        } // end for all node index messages
 
     return;
     }
@@ -596,30 +1000,113 @@ void AddIndexNodeToIndex(int iHandle, SuIndex_CurrMsg * psuNodeIndexMsg, uint16_
 
 /* ----------------------------------------------------------------------- */
 
-void AddNodeToIndex(int iHandle, SuPacketIndexInfo * psuIndexInfo)
+// Indexed time packets without the optional intrapacket data header get
+// their absolute time from the time packet itself.
+
+static void vReadIndexedTimePackets(int iHandle, SuIndexReader * psuReader, int iNumPackets)
     {
+    EnI106Status        enStatus;
+    SuI106Ch10Header    suHdr;
+    SuNodePacket      * psuPacket;
+    SuPacketIndexInfo * psuIndexInfo;
+    uint8_t           * pchNewBuff;
+    int                 iPacket;
+    uint32_t            uNode;
 
-    // See if we need to make the node table bigger
-    if (m_asuCh10Index[iHandle].uNodesAvailable <= m_asuCh10Index[iHandle].uNodesUsed)
+    for (iPacket=0; iPacket<iNumPackets; iPacket++)
         {
-        // Reallocate memory
-        m_asuCh10Index[iHandle].psuIndexTable = 
-            (SuPacketIndexInfo *)realloc(m_asuCh10Index[iHandle].psuIndexTable, 
-            (m_asuCh10Index[iHandle].uNodesAvailable + m_asuCh10Index[iHandle].uNodeIncrement) * sizeof(SuPacketIndexInfo));
+        psuPacket = &psuReader->asuPacket[iPacket];
+        if (((SuIndex_ChanSpec *)(psuReader->pchBuff + psuPacket->ulBuffOffset))->bIntraPktHdr == 1)
+            continue;
+
+        psuIndexInfo = &FILE_INDEX(iHandle)->psuIndexTable[psuPacket->uFirstNode];
+        for (uNode=0; uNode<psuPacket->uNumNodes; uNode++, psuIndexInfo++)
+            {
+            if (psuIndexInfo->ubyDataType != I106CH10_DTYPE_IRIG_TIME)
+                continue;
+
+            // Go to what should be a time packet and read the header
+            enStatus = enI106Ch10SetPos(iHandle, psuIndexInfo->lFileOffset);
+            if (enStatus == I106_OK)
+                enStatus = enI106Ch10ReadNextHeaderFile(iHandle, &suHdr);
+            if ((enStatus != I106_OK) || (suHdr.ubyDataType != I106CH10_DTYPE_IRIG_TIME))
+                continue;
+
+            // Make sure our buffer is big enough
+            if (psuReader->ulTimeBuffSize < suHdr.ulPacketLen)
+                {
+                pchNewBuff = (uint8_t *)realloc(psuReader->pchTimeBuff, suHdr.ulPacketLen);
+                if (pchNewBuff == NULL)
+                    continue;
+                psuReader->pchTimeBuff    = pchNewBuff;
+                psuReader->ulTimeBuffSize = suHdr.ulPacketLen;
+                }
 
-        m_asuCh10Index[iHandle].uNodesAvailable += m_asuCh10Index[iHandle].uNodeIncrement;
+            // Read and decode the time packet
+            enStatus = enI106Ch10ReadData(iHandle, suHdr.ulPacketLen, psuReader->pchTimeBuff);
+            if (enStatus == I106_OK)
+                enI106_Decode_TimeF1(&suHdr, psuReader->pchTimeBuff, &psuIndexInfo->suIrigTime);
+            } // end for all nodes in the packet
+        } // end for all node packets
 
-        // Make increment bigger next time
-        m_asuCh10Index[iHandle].uNodeIncrement = (uint32_t)(m_asuCh10Index[iHandle].uNodeIncrement * 1.5);
-        }
+    return;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
 
-    memcpy(&m_asuCh10Index[iHandle].psuIndexTable[m_asuCh10Index[iHandle].uNodesUsed], psuIndexInfo, sizeof(SuPacketIndexInfo));
-    m_asuCh10Index[iHandle].uNodesUsed++;
+void AddNodeToIndex(int iHandle, SuPacketIndexInfo * psuIndexInfo)
+    {
+
+    if (psuGetIndex(iHandle) == NULL)
+        return;
+
+    // See if we need to make the node table bigger
+    if (bGrowIndexTable(iHandle, FILE_INDEX(iHandle)->uNodesUsed + 1) == bFALSE)
+        return;
+
+    memcpy(&FILE_INDEX(iHandle)->psuIndexTable[FILE_INDEX(iHandle)->uNodesUsed], psuIndexInfo, sizeof(SuPacketIndexInfo));
+    FILE_INDEX(iHandle)->uNodesUsed++;
 
     return;
     }
 
 
+
+/* ----------------------------------------------------------------------- */
+
+// Make sure the index table has room for at least the given number of nodes.
+// The table grows by half again each time so adding nodes one at a time
+// doesn't spend all its time copying.
+
+static int bGrowIndexTable(int iHandle, uint32_t uNodesNeeded)
+    {
+    SuPacketIndexInfo * psuNewTable;
+    uint32_t            uNewAvailable;
+
+    if (FILE_INDEX(iHandle)->uNodesAvailable >= uNodesNeeded)
+        return bTRUE;
+
+    uNewAvailable = FILE_INDEX(iHandle)->uNodesAvailable + FILE_INDEX(iHandle)->uNodesAvailable / 2;
+    if (uNewAvailable < uNodesNeeded)
+        uNewAvailable = uNodesNeeded;
+    if (uNewAvailable < INDEX_TABLE_MIN_NODES)
+        uNewAvailable = INDEX_TABLE_MIN_NODES;
+
+    psuNewTable = (SuPacketIndexInfo *)realloc(FILE_INDEX(iHandle)->psuIndexTable,
+                                               (size_t)uNewAvailable * sizeof(SuPacketIndexInfo));
+    if (psuNewTable == NULL)
+        return bFALSE;
+
+    FILE_INDEX(iHandle)->psuIndexTable   = psuNewTable;
+    FILE_INDEX(iHandle)->uNodesAvailable = uNewAvailable;
+
+    return bTRUE;
+    }
+
+
+
 /* ----------------------------------------------------------------------- */
 
 /** Make an index of a channel by reading through the data file.
@@ -629,14 +1116,12 @@ EnI106Status I106_CALL_DECL enMakeIndex(const int iHandle, uint16_t uChID)
     {
     EnI106Status            enStatus;
     SuI106Ch10Header        suI106Hdr;
-    unsigned long           ulBuffSize = 0L;
-    unsigned char         * pvBuff = NULL;
     SuPacketIndexInfo       suIndexInfo;
     int64_t                 llOffset;
 
-    // First, see if indexes have been init'ed
-    if (m_bIndexesInited == bFALSE)
-        InitIndexes();
+    // Make sure there is an index for this handle
+    if (psuGetIndex(iHandle) == NULL)
+        return I106_INVALID_HANDLE;
 
     // Establish time
     FindTimePacket(iHandle);
@@ -645,7 +1130,7 @@ EnI106Status I106_CALL_DECL enMakeIndex(const int iHandle, uint16_t uChID)
     while (1==1) 
         {
         // Read the next header
-        enStatus = enI106Ch10ReadNextHeader(iHandle, &suI106Hdr);
+        enStatus = enI106Ch10ReadNextHeaderFile(iHandle, &suI106Hdr);
 
         // Get the file offset of the packet header we just read
         enI106Ch10GetPos(iHandle, &llOffset);
@@ -664,20 +1149,11 @@ EnI106Status I106_CALL_DECL enMakeIndex(const int iHandle, uint16_t uChID)
             if (enStatus != I106_OK)
                 break;
 
-            // If selected channel then put info into the index
+            // If selected channel then put info into the index.  Only the
+            // header is needed, the next header read skips over the data.
             if (suI106Hdr.uChID == uChID)
                 {
 
-                // Make sure our buffer is big enough, size *does* matter
-                if (ulBuffSize < suI106Hdr.ulPacketLen)
-                    {
-                    pvBuff = (unsigned char *)realloc(pvBuff, suI106Hdr.ulPacketLen);
-                    ulBuffSize = suI106Hdr.ulPacketLen;
-                    }
-
-                // Read the data buffer
-                enStatus = enI106Ch10ReadData(iHandle, ulBuffSize, pvBuff);
-
                 // Populate index info
                 suIndexInfo.lFileOffset = llOffset;
 // TODO:        suIndexInfo.suIrigTime  = ;
@@ -696,8 +1172,6 @@ EnI106Status I106_CALL_DECL enMakeIndex(const int iHandle, uint16_t uChID)
 
         } // End while looping forever
 
-    free(pvBuff);
-
     return I106_OK;
     }
 
@@ -706,9 +1180,8 @@ EnI106Status I106_CALL_DECL enMakeIndex(const int iHandle, uint16_t uChID)
 /* ----------------------------------------------------------------------- */
 
 /** Find a valid time packet for the index. 
- *  Read the data file from the middle of the file to try to determine a 
- *  valid relative time to clock time from a time packet. Store the result 
- *  the time field in the index.
+ *  Look for a time packet from the middle of the file to try to determine a
+ *  valid relative time to clock time. Store the result in the index.
  */
 
 EnI106Status FindTimePacket(int iHandle)
@@ -718,120 +1191,23 @@ EnI106Status FindTimePacket(int iHandle)
 
     int64_t             llCurrOffset;
     int64_t             llLastMsgOffset;
-    int64_t             llTimeLimit;
-    int64_t             llCurrTime;
     EnI106Status        enStatus;
-    EnI106Status        enRetStatus;
-    SuI106Ch10Header    suHdr;
-    unsigned long       ulBuffSize = 0;
-    void              * pvBuff = NULL;
-    SuTimeF1_ChanSpec * psuChanSpecTime = NULL;
 
-    // Get and save the current file position
+    // Get the middle of the file
     enStatus = enI106Ch10GetPos(iHandle, &llCurrOffset);
     if (enStatus != I106_OK)
         return enStatus;
+    enI106Ch10LastMsg(iHandle);
+    enI106Ch10GetPos(iHandle, &llLastMsgOffset);
+    enI106Ch10SetPos(iHandle, llCurrOffset);
 
-#if 0
-    // Get time from the beginning of the file
-    enStatus = enI106Ch10FirstMsg(iHandle);;
-    if (enStatus != I106_OK)
-        return enStatus;
-#else
-    // Get time from the middle of the file
-    enStatus = enI106Ch10LastMsg(iHandle);
-    enStatus = enI106Ch10GetPos(iHandle, &llLastMsgOffset);
-    enStatus = enI106Ch10SetPos(iHandle,  llLastMsgOffset/2);
-#endif
-
-    // Read the next header
-    enStatus = enI106Ch10ReadNextHeaderFile(iHandle, &suHdr);
-    if (enStatus == I106_EOF)
-        return I106_TIME_NOT_FOUND;
-
-    if (enStatus != I106_OK)
-        return enStatus;
-
-    // Calculate the time limit if there is one
-    if (iTimeLimit > 0)
-        {
-        vTimeArray2LLInt(suHdr.aubyRefTime, &llTimeLimit);
-        llTimeLimit = llTimeLimit + (int64_t)iTimeLimit * (int64_t)10000000;
-        }
-    else
-        llTimeLimit = 0;
-
-    // Loop, looking for appropriate time message
-    while (bTRUE)
-        {
-
-        // See if we've passed our time limit
-        if (llTimeLimit > 0)
-            {
-            vTimeArray2LLInt(suHdr.aubyRefTime, &llCurrTime);
-            if (llTimeLimit < llCurrTime)
-                {
-                enRetStatus = I106_TIME_NOT_FOUND;
-                break;
-                }
-            } // end if there is a time limit
-
-        // If IRIG time type then process it
-        if (suHdr.ubyDataType == I106CH10_DTYPE_IRIG_TIME)
-            {
-
-            // Read header OK, make buffer for time message
-            if (ulBuffSize < suHdr.ulPacketLen)
-                {
-                pvBuff          = realloc(pvBuff, suHdr.ulPacketLen);
-                psuChanSpecTime = (SuTimeF1_ChanSpec *)pvBuff;
-                ulBuffSize      = suHdr.ulPacketLen;
-                }
-
-            // Read the data buffer
-            enStatus = enI106Ch10ReadData(iHandle, ulBuffSize, pvBuff);
-            if (enStatus != I106_OK)
-                {
-                enRetStatus = I106_TIME_NOT_FOUND;
-                break;
-                }
-
-            // If external sync OK then decode it and set relative time
-            if ((bRequireSync == bFALSE) || (psuChanSpecTime->uTimeSrc == 1))
-                {
-                memcpy(&m_asuCh10Index[iHandle].suTimeF1Hdr, &suHdr, sizeof(SuI106Ch10Header));
-                m_asuCh10Index[iHandle].pvTimeF1Packet = pvBuff;
-                enI106_Decode_TimeF1(&suHdr, pvBuff, &m_asuCh10Index[iHandle].suTimeF1);
-                enRetStatus = I106_OK;
-                break;
-                }
-            } // end if IRIG time message
-
-        // Read the next header and try again
-        enStatus = enI106Ch10ReadNextHeaderFile(iHandle, &suHdr);
-        if (enStatus == I106_EOF)
-            {
-            enRetStatus = I106_TIME_NOT_FOUND;
-            break;
-            }
-
-        if (enStatus != I106_OK)
-            {
-            enRetStatus = enStatus;
-            break;
-            }
-
-        } // end while looping looking for time message
-
-    // Restore file position
-    enStatus = enI106Ch10SetPos(iHandle, llCurrOffset);
+    enStatus = enI106_FindTimePacket(iHandle, llLastMsgOffset/2, bRequireSync, iTimeLimit, 
+                                     &FILE_INDEX(iHandle)->suTimeSync);
     if (enStatus != I106_OK)
-        {
-        enRetStatus = enStatus;
-        }
+        memset(&FILE_INDEX(iHandle)->suTimeSync, 0, sizeof(SuTimeSync));
 
-    return enRetStatus;
-    } // end FindDateFmtLeapYear()
+    return enStatus;
+    } // end FindTimePacket()
 
 
 
@@ -856,13 +1232,13 @@ void RelInt2IrigTime(int            iHandle,
     int64_t         lFrac;
 
     // Figure out the relative time difference
-    vTimeArray2LLInt(m_asuCh10Index[iHandle].suTimeF1Hdr.aubyRefTime, &uRefRelTime);
+    uRefRelTime = FILE_INDEX(iHandle)->suTimeSync.llRelTime;
     uTimeDiff = llRelTime - uRefRelTime;
     lSecDiff  = uTimeDiff / 10000000;
     lFracDiff = uTimeDiff % 10000000;
 
-    lSec      = m_asuCh10Index[iHandle].suTimeF1.ulSecs + lSecDiff;
-    lFrac     = m_asuCh10Index[iHandle].suTimeF1.ulFrac + lFracDiff;
+    lSec      = FILE_INDEX(iHandle)->suTimeSync.suIrigTime.ulSecs + lSecDiff;
+    lFrac     = FILE_INDEX(iHandle)->suTimeSync.suIrigTime.ulFrac + lFracDiff;
 
     // This seems a bit extreme but it's defensive programming
     while (lFrac < 0)
@@ -880,7 +1256,7 @@ void RelInt2IrigTime(int            iHandle,
     // Now add the time difference to the last IRIG time reference
     psuTime->ulFrac = (unsigned long)lFrac;
     psuTime->ulSecs = (unsigned long)lSec;
-    psuTime->enFmt  = m_asuCh10Index[iHandle].suTimeF1.enFmt;
+    psuTime->enFmt  = FILE_INDEX(iHandle)->suTimeSync.suIrigTime.enFmt;
 
     return;
     }
@@ -928,17 +1304,25 @@ int ReadTimeDataPacketBody(SuI106Ch10Header suTimeDataHeader)
 
 void InitIndex(int iHandle)
     {
-    m_asuCh10Index[iHandle].uNodesAvailable = 0;
-    m_asuCh10Index[iHandle].uNodesUsed      = 0;
-    m_asuCh10Index[iHandle].uNodeIncrement  = 1000;
 
-    if ((m_bIndexesInited) && (m_asuCh10Index[iHandle].pvTimeF1Packet != NULL))
-        free(m_asuCh10Index[iHandle].pvTimeF1Packet);
-    m_asuCh10Index[iHandle].pvTimeF1Packet = NULL;
+    if (FILE_INDEX(iHandle) == NULL)
+        return;
+
+    FILE_INDEX(iHandle)->uNodesAvailable = 0;
+    FILE_INDEX(iHandle)->uNodesUsed      = 0;
 
-    if ((m_bIndexesInited) && (m_asuCh10Index[iHandle].psuIndexTable != NULL))
-        free(m_asuCh10Index[iHandle].psuIndexTable);
-    m_asuCh10Index[iHandle].psuIndexTable = NULL;
+    memset(&FILE_INDEX(iHandle)->suTimeSync, 0, sizeof(SuTimeSync));
+
+    free(FILE_INDEX(iHandle)->psuIndexTable);
+    FILE_INDEX(iHandle)->psuIndexTable = NULL;
+
+    vFreeChanIndexes(FILE_INDEX(iHandle)->asuChanIndex, FILE_INDEX(iHandle)->iNumChanIndexes);
+    FILE_INDEX(iHandle)->asuChanIndex    = NULL;
+    FILE_INDEX(iHandle)->iNumChanIndexes = 0;
+
+    // Anything followed from here on has to start over
+    if (FILE_INDEX(iHandle)->psuFollow != NULL)
+        FILE_INDEX(iHandle)->psuFollow->llNextOffset = -1;
   
     return;
     }
@@ -948,18 +1332,21 @@ void InitIndex(int iHandle)
 /* ----------------------------------------------------------------------- */
 
 /**
-* Initialize all index tables for the first time
+* Free the index table for a handle.  Called when the handle is closed.
 */
 
-void InitIndexes(void)
+void FreeIndex(int iHandle)
     {
-    int     iHandleIdx;
 
-    for (iHandleIdx=0; iHandleIdx<MAX_HANDLES; iHandleIdx++)
-        InitIndex(iHandleIdx);
+    if (FILE_INDEX(iHandle) == NULL)
+        return;
+
+    InitIndex(iHandle);
+    vFreeIndexWriter(FILE_INDEX(iHandle)->psuWriter);
+    vFreeIndexFollow(FILE_INDEX(iHandle)->psuFollow);
+    free(FILE_INDEX(iHandle));
+    FILE_INDEX(iHandle) = NULL;
 
-    m_bIndexesInited = bTRUE;
-  
     return;
     }
 
@@ -968,12 +1355,32 @@ void InitIndexes(void)
 /* ----------------------------------------------------------------------- */
 
 /**
-* Sort an existing index table in memory by relative time
+* Get the index table for a handle, making a new one if necessary.
 */
 
-int CompareIndexes(const void * pIndex1, const void * pIndex2)
+static SuCh10Index * psuGetIndex(int iHandle)
     {
-    if (((SuPacketIndexInfo *)pIndex1)->lRelTime > ((SuPacketIndexInfo *)pIndex2)->lRelTime)
+
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        return NULL;
+
+    if (FILE_INDEX(iHandle) == NULL)
+        FILE_INDEX(iHandle) = (SuCh10Index *)calloc(1, sizeof(SuCh10Index));
+
+    return FILE_INDEX(iHandle);
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+/**
+* Sort an existing index table in memory by relative time
+*/
+
+int CompareIndexes(const void * pIndex1, const void * pIndex2)
+    {
+    if (((SuPacketIndexInfo *)pIndex1)->lRelTime > ((SuPacketIndexInfo *)pIndex2)->lRelTime)
         return 1;
 
     if (((SuPacketIndexInfo *)pIndex1)->lRelTime < ((SuPacketIndexInfo *)pIndex2)->lRelTime)
@@ -983,13 +1390,31 @@ int CompareIndexes(const void * pIndex1, const void * pIndex2)
     }
 
 
+/* ----------------------------------------------------------------------- */
+
+static int CompareOffsets(const void * pOffset1, const void * pOffset2)
+    {
+    if (*(int64_t *)pOffset1 > *(int64_t *)pOffset2)
+        return 1;
+
+    if (*(int64_t *)pOffset1 < *(int64_t *)pOffset2)
+        return -1;
+
+    return 0;
+    }
+
+
 /* ----------------------------------------------------------------------- */
 
 void SortIndexes(int iHandle)
     {
+
+    if (FILE_INDEX(iHandle) == NULL)
+        return;
+
     qsort(
-        m_asuCh10Index[iHandle].psuIndexTable, 
-        m_asuCh10Index[iHandle].uNodesUsed, 
+        FILE_INDEX(iHandle)->psuIndexTable, 
+        FILE_INDEX(iHandle)->uNodesUsed, 
         sizeof(SuPacketIndexInfo), 
         &CompareIndexes);
     return;
@@ -1003,23 +1428,1713 @@ void SortIndexes(int iHandle)
 EnI106Status enGetIndexArray(const int iHandle, SuPacketIndexInfo * asuPacketIndexInfo[], uint32_t * piArrayLength)
     {
 
-    if (m_bIndexesInited == bFALSE)
-        return I106_NO_INDEX;
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        return I106_INVALID_HANDLE;
 
-    if (m_asuCh10Index[iHandle].psuIndexTable == NULL)
+    if ((FILE_INDEX(iHandle) == NULL) || (FILE_INDEX(iHandle)->psuIndexTable == NULL))
         return I106_NO_INDEX;
 
-    *asuPacketIndexInfo = m_asuCh10Index[iHandle].psuIndexTable;
-    *piArrayLength      = m_asuCh10Index[iHandle].uNodesUsed;
+    *asuPacketIndexInfo = FILE_INDEX(iHandle)->psuIndexTable;
+    *piArrayLength      = FILE_INDEX(iHandle)->uNodesUsed;
 
     return I106_OK;
     }
 
 
 // ----------------------------------------------------------------------------
-// Index writing functions
+// Channel index functions
 // ----------------------------------------------------------------------------
 
+/** Make time and offset tables for every channel in one pass over the file.
+ *  Only packet headers are read.  With more than one thread the file is
+ *  opened again by name and split into byte ranges, one per thread.  If that
+ *  can't be done the scan is done with this handle.
+ */
+
+EnI106Status I106_CALL_DECL enMakeChanIndexes(const int iHandle, int iNumThreads, int bAbsTime)
+    {
+    EnI106Status        enStatus;
+    SuChanIndexScan   * asuScan;
+    SuChanIndex       * asuChan;
+    int                 iNumChans;
+    int                 iScanIdx;
+    int64_t             llStartingFileOffset;
+    int64_t             llFileSize;
+#if !defined(_WIN32)
+    struct stat         suStatBuff;
+#endif
+
+    // Make sure there is an index for this handle
+    if (psuGetIndex(iHandle) == NULL)
+        return I106_INVALID_HANDLE;
+
+    // Only files can be scanned this way
+    switch (psuI106Handle(iHandle)->enFileMode)
+        {
+        case I106_READ          :
+        case I106_READ_IN_ORDER :
+        case I106_READ_MMAP     :
+            break;
+        default :
+            return I106_WRONG_FILE_MODE;
+        }
+
+    enStatus = enI106Ch10GetPos(iHandle, &llStartingFileOffset);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    // Pick the number of threads
+    if (iNumThreads <= 0)
+        {
+#if defined(_WIN32)
+        llFileSize = _filelengthi64(psuI106Handle(iHandle)->iFile);
+#else
+        if (fstat(psuI106Handle(iHandle)->iFile, &suStatBuff) != 0)
+            return I106_READ_ERROR;
+        llFileSize = suStatBuff.st_size;
+#endif
+        iNumThreads = iI106Ch10GetNumCpus();
+        if (iNumThreads > CHAN_INDEX_MAX_THREADS)
+            iNumThreads = CHAN_INDEX_MAX_THREADS;
+        if (iNumThreads > llFileSize / CHAN_INDEX_MIN_RANGE)
+            iNumThreads = (int)(llFileSize / CHAN_INDEX_MIN_RANGE);
+        if (iNumThreads < 1)
+            iNumThreads = 1;
+        }
+
+    asuScan = (SuChanIndexScan *)calloc(iNumThreads, sizeof(SuChanIndexScan));
+    if (asuScan == NULL)
+        return I106_NO_MEMORY;
+
+    // Scan in parallel if we can, otherwise read through with this handle
+    enStatus = I106_UNSUPPORTED;
+    if (iNumThreads > 1)
+        enStatus = enI106Ch10ScanHeadersParallel(psuI106Handle(iHandle)->szFileName, iNumThreads,
+                                                 enChanIndexScanHandler, asuScan);
+    if (enStatus != I106_OK)
+        {
+        for (iScanIdx=0; iScanIdx<iNumThreads; iScanIdx++)
+            vFreeChanIndexScan(&asuScan[iScanIdx]);
+        iNumThreads = 1;
+        enStatus = enChanIndexScanSerial(iHandle, &asuScan[0]);
+        }
+
+    // Put the thread tables together
+    asuChan   = NULL;
+    iNumChans = 0;
+    if ((enStatus == I106_OK) && (bMergeChanIndexScans(asuScan, iNumThreads, &asuChan, &iNumChans) == bFALSE))
+        enStatus = I106_NO_MEMORY;
+
+    for (iScanIdx=0; iScanIdx<iNumThreads; iScanIdx++)
+        vFreeChanIndexScan(&asuScan[iScanIdx]);
+    free(asuScan);
+
+    enI106Ch10SetPos(iHandle, llStartingFileOffset);
+
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    // Out with the old, in with the new
+    vFreeChanIndexes(FILE_INDEX(iHandle)->asuChanIndex, FILE_INDEX(iHandle)->iNumChanIndexes);
+    FILE_INDEX(iHandle)->asuChanIndex    = asuChan;
+    FILE_INDEX(iHandle)->iNumChanIndexes = iNumChans;
+    if (FILE_INDEX(iHandle)->psuFollow != NULL)
+        FILE_INDEX(iHandle)->psuFollow->llNextOffset = -1;
+
+    if (bAbsTime)
+        enStatus = enMakeChanAbsTimes(iHandle);
+
+    return enStatus;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+/** Get the array of channel index tables, sorted by channel ID
+ */
+
+EnI106Status I106_CALL_DECL enGetChanIndexes(const int iHandle, SuChanIndex ** pasuChanIndex, int * piNumChans)
+    {
+
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        return I106_INVALID_HANDLE;
+
+    if ((FILE_INDEX(iHandle) == NULL) || (FILE_INDEX(iHandle)->asuChanIndex == NULL))
+        return I106_NO_INDEX;
+
+    *pasuChanIndex = FILE_INDEX(iHandle)->asuChanIndex;
+    *piNumChans    = FILE_INDEX(iHandle)->iNumChanIndexes;
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+/** Get the index table for one channel
+ */
+
+EnI106Status I106_CALL_DECL enGetChanIndex(const int iHandle, uint16_t uChID, SuChanIndex ** ppsuChanIndex)
+    {
+    SuChanIndex         suKey;
+
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        return I106_INVALID_HANDLE;
+
+    if ((FILE_INDEX(iHandle) == NULL) || (FILE_INDEX(iHandle)->asuChanIndex == NULL))
+        return I106_NO_INDEX;
+
+    suKey.uChID    = uChID;
+    *ppsuChanIndex = (SuChanIndex *)bsearch(&suKey, FILE_INDEX(iHandle)->asuChanIndex,
+                                            FILE_INDEX(iHandle)->iNumChanIndexes, sizeof(SuChanIndex),
+                                            &CompareChanIndexes);
+    if (*ppsuChanIndex == NULL)
+        return I106_INVALID_PARAMETER;
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+/** Find the first entry in a channel index at or after a relative time.
+ *  Returns the number of entries if they are all before the time.
+ */
+
+uint32_t I106_CALL_DECL uChanIndexFindTime(const SuChanIndex * psuChanIndex, int64_t llRelTime)
+    {
+    uint32_t            uLow  = 0;
+    uint32_t            uHigh = psuChanIndex->uCount;
+    uint32_t            uMid;
+
+    while (uLow < uHigh)
+        {
+        uMid = uLow + (uHigh - uLow) / 2;
+        if (psuChanIndex->allRelTime[uMid] < llRelTime)
+            uLow = uMid + 1;
+        else
+            uHigh = uMid;
+        }
+
+    return uLow;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Read through the whole file with this handle, headers only, and add every
+// packet to the channel tables.
+
+static EnI106Status enChanIndexScanSerial(int iHandle, SuChanIndexScan * psuScan)
+    {
+    EnI106Status        enStatus;
+    SuI106Ch10Header    suHdr;
+    int64_t             llOffset;
+
+    enStatus = enI106Ch10SetPos(iHandle, 0L);
+
+    while (enStatus == I106_OK)
+        {
+        enStatus = enI106Ch10ReadNextHeaderFile(iHandle, &suHdr);
+        if (enStatus == I106_HEADER_CHKSUM_BAD)
+            {
+            enStatus = I106_OK;
+            continue;
+            }
+        if (enStatus == I106_EOF)
+            {
+            enStatus = I106_OK;
+            break;
+            }
+        if (enStatus != I106_OK)
+            break;
+
+        enI106Ch10GetPos(iHandle, &llOffset);
+        llOffset -= iGetHeaderLen(&suHdr);
+
+        if (bChanIndexScanAdd(psuScan, llOffset, &suHdr) == bFALSE)
+            enStatus = I106_NO_MEMORY;
+        }
+
+    return enStatus;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Header handler for the parallel channel index scan
+
+static EnI106Status I106_CALL_DECL enChanIndexScanHandler(
+            int                 iThread,
+            int64_t             llFileOffset,
+            SuI106Ch10Header  * psuHeader,
+            void              * pvData,
+            void              * pvUserData)
+    {
+    (void)pvData;
+
+    if (bChanIndexScanAdd(&((SuChanIndexScan *)pvUserData)[iThread], llFileOffset, psuHeader) == bFALSE)
+        return I106_NO_MEMORY;
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Add a packet to the table for its channel, making the table if needed
+
+static int bChanIndexScanAdd(SuChanIndexScan * psuScan, int64_t llOffset, SuI106Ch10Header * psuHeader)
+    {
+    SuChanIndex       * asuNewChan;
+    SuChanIndex       * psuChan;
+    int                 iNewAvail;
+
+    // Find or make the channel table
+    if (psuScan->aulChanSlot == NULL)
+        {
+        psuScan->aulChanSlot = (uint32_t *)calloc(0x10000, sizeof(uint32_t));
+        if (psuScan->aulChanSlot == NULL)
+            return bFALSE;
+        }
+    if (psuScan->aulChanSlot[psuHeader->uChID] == 0)
+        {
+        if (psuScan->iNumChans >= psuScan->iChansAvail)
+            {
+            iNewAvail  = psuScan->iChansAvail + psuScan->iChansAvail / 2 + 16;
+            asuNewChan = (SuChanIndex *)realloc(psuScan->asuChan, sizeof(SuChanIndex) * iNewAvail);
+            if (asuNewChan == NULL)
+                return bFALSE;
+            psuScan->asuChan     = asuNewChan;
+            psuScan->iChansAvail = iNewAvail;
+            }
+        psuChan = &psuScan->asuChan[psuScan->iNumChans++];
+        memset(psuChan, 0, sizeof(SuChanIndex));
+        psuChan->uChID       = psuHeader->uChID;
+        psuChan->ubyDataType = psuHeader->ubyDataType;
+        psuScan->aulChanSlot[psuHeader->uChID] = psuScan->iNumChans;
+        }
+    psuChan = &psuScan->asuChan[psuScan->aulChanSlot[psuHeader->uChID] - 1];
+
+    if ((psuChan->uCount >= psuChan->uAvailable) &&
+        (bGrowChanIndex(psuChan, psuChan->uCount + 1) == bFALSE))
+        return bFALSE;
+
+    vTimeArray2LLInt(psuHeader->aubyRefTime, &psuChan->allRelTime[psuChan->uCount]);
+    psuChan->allOffset[psuChan->uCount] = llOffset;
+    psuChan->uCount++;
+
+    return bTRUE;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Make sure a channel table has room for at least the given number of
+// entries.  Tables grow by half again each time.
+
+static int bGrowChanIndex(SuChanIndex * psuChan, uint32_t uNeeded)
+    {
+    int64_t           * allNewRelTime;
+    int64_t           * allNewOffset;
+    int64_t           * allNewAbsTime;
+    uint32_t            uNewAvail;
+
+    if (psuChan->uAvailable >= uNeeded)
+        return bTRUE;
+
+    uNewAvail = psuChan->uAvailable + psuChan->uAvailable / 2 + 1024;
+    if (uNewAvail < uNeeded)
+        uNewAvail = uNeeded;
+
+    allNewRelTime = (int64_t *)realloc(psuChan->allRelTime, uNewAvail * sizeof(int64_t));
+    if (allNewRelTime == NULL)
+        return bFALSE;
+    psuChan->allRelTime = allNewRelTime;
+
+    allNewOffset = (int64_t *)realloc(psuChan->allOffset, uNewAvail * sizeof(int64_t));
+    if (allNewOffset == NULL)
+        return bFALSE;
+    psuChan->allOffset = allNewOffset;
+
+    if (psuChan->allAbsTime != NULL)
+        {
+        allNewAbsTime = (int64_t *)realloc(psuChan->allAbsTime, uNewAvail * sizeof(int64_t));
+        if (allNewAbsTime == NULL)
+            return bFALSE;
+        psuChan->allAbsTime = allNewAbsTime;
+        }
+
+    psuChan->uAvailable = uNewAvail;
+
+    return bTRUE;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Put the channel tables from the scan threads together.  Threads scan the
+// file in order so appending their tables in thread order keeps each channel
+// in file order.  The result is sorted by channel ID and each table is sorted
+// by time.
+
+static int bMergeChanIndexScans(SuChanIndexScan asuScan[], int iNumScans,
+                                SuChanIndex ** pasuChan, int * piNumChans)
+    {
+    SuChanIndex       * asuChan;
+    SuChanIndex       * psuChan;
+    SuChanIndex       * psuScanChan;
+    uint32_t          * aulSlot;
+    int                 iNumChans = 0;
+    int                 iScanIdx;
+    int                 iChanIdx;
+
+    *pasuChan   = NULL;
+    *piNumChans = 0;
+
+    aulSlot = (uint32_t *)calloc(0x10000, sizeof(uint32_t));
+    asuChan = (SuChanIndex *)calloc(0x10000, sizeof(SuChanIndex));
+    if ((aulSlot == NULL) || (asuChan == NULL))
+        {
+        free(aulSlot);
+        free(asuChan);
+        return bFALSE;
+        }
+
+    // Count up the entries for each channel
+    for (iScanIdx=0; iScanIdx<iNumScans; iScanIdx++)
+        for (iChanIdx=0; iChanIdx<asuScan[iScanIdx].iNumChans; iChanIdx++)
+            {
+            psuScanChan = &asuScan[iScanIdx].asuChan[iChanIdx];
+            if (aulSlot[psuScanChan->uChID] == 0)
+                {
+                psuChan = &asuChan[iNumChans++];
+                psuChan->uChID       = psuScanChan->uChID;
+                psuChan->ubyDataType = psuScanChan->ubyDataType;
+                aulSlot[psuScanChan->uChID] = iNumChans;
+                }
+            asuChan[aulSlot[psuScanChan->uChID] - 1].uAvailable += psuScanChan->uCount;
+            }
+
+    // Copy the thread tables in
+    for (iChanIdx=0; iChanIdx<iNumChans; iChanIdx++)
+        {
+        psuChan = &asuChan[iChanIdx];
+        psuChan->allRelTime = (int64_t *)malloc(psuChan->uAvailable * sizeof(int64_t));
+        psuChan->allOffset  = (int64_t *)malloc(psuChan->uAvailable * sizeof(int64_t));
+        if ((psuChan->allRelTime == NULL) || (psuChan->allOffset == NULL))
+            {
+            vFreeChanIndexes(asuChan, iNumChans);
+            free(aulSlot);
+            return bFALSE;
+            }
+        }
+
+    for (iScanIdx=0; iScanIdx<iNumScans; iScanIdx++)
+        for (iChanIdx=0; iChanIdx<asuScan[iScanIdx].iNumChans; iChanIdx++)
+            {
+            psuScanChan = &asuScan[iScanIdx].asuChan[iChanIdx];
+            psuChan     = &asuChan[aulSlot[psuScanChan->uChID] - 1];
+            memcpy(&psuChan->allRelTime[psuChan->uCount], psuScanChan->allRelTime, psuScanChan->uCount * sizeof(int64_t));
+            memcpy(&psuChan->allOffset[psuChan->uCount],  psuScanChan->allOffset,  psuScanChan->uCount * sizeof(int64_t));
+            psuChan->uCount += psuScanChan->uCount;
+            }
+
+    free(aulSlot);
+
+    for (iChanIdx=0; iChanIdx<iNumChans; iChanIdx++)
+        if (bSortChanIndex(&asuChan[iChanIdx]) == bFALSE)
+            {
+            vFreeChanIndexes(asuChan, iNumChans);
+            return bFALSE;
+            }
+
+    qsort(asuChan, iNumChans, sizeof(SuChanIndex), &CompareChanIndexes);
+
+    // Give back the unused channel slots
+    psuChan = (SuChanIndex *)realloc(asuChan, (iNumChans > 0 ? iNumChans : 1) * sizeof(SuChanIndex));
+    if (psuChan != NULL)
+        asuChan = psuChan;
+
+    *pasuChan   = asuChan;
+    *piNumChans = iNumChans;
+
+    return bTRUE;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Sort a channel table by time, then file offset.  Channels are almost
+// always already in time order so check before doing any work.
+
+static int bSortChanIndex(SuChanIndex * psuChan)
+    {
+    SuInOrderPacketInfo   * asuSort;
+    uint32_t                uIdx;
+
+    for (uIdx=1; uIdx<psuChan->uCount; uIdx++)
+        if (psuChan->allRelTime[uIdx] < psuChan->allRelTime[uIdx-1])
+            break;
+    if (uIdx >= psuChan->uCount)
+        return bTRUE;
+
+    asuSort = (SuInOrderPacketInfo *)malloc(psuChan->uCount * sizeof(SuInOrderPacketInfo));
+    if (asuSort == NULL)
+        return bFALSE;
+
+    for (uIdx=0; uIdx<psuChan->uCount; uIdx++)
+        {
+        asuSort[uIdx].llTime   = psuChan->allRelTime[uIdx];
+        asuSort[uIdx].llOffset = psuChan->allOffset[uIdx];
+        }
+
+    qsort(asuSort, psuChan->uCount, sizeof(SuInOrderPacketInfo), &CompareTimeOffsets);
+
+    for (uIdx=0; uIdx<psuChan->uCount; uIdx++)
+        {
+        psuChan->allRelTime[uIdx] = asuSort[uIdx].llTime;
+        psuChan->allOffset[uIdx]  = asuSort[uIdx].llOffset;
+        }
+
+    free(asuSort);
+
+    return bTRUE;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Fill in absolute time for all the channel tables.
+
+static EnI106Status enMakeChanAbsTimes(int iHandle)
+    {
+    EnI106Status        enStatus;
+    SuTimeRef           suTimeRef;
+    int                 bTimeModel;
+    int                 iChanIdx;
+
+    enStatus = enGetChanTimeRef(iHandle, &bTimeModel, &suTimeRef);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    for (iChanIdx=0; iChanIdx<FILE_INDEX(iHandle)->iNumChanIndexes; iChanIdx++)
+        {
+        enStatus = enMakeChanAbsTime(iHandle, bTimeModel, &suTimeRef,
+                                     &FILE_INDEX(iHandle)->asuChanIndex[iChanIdx], 0);
+        if (enStatus != I106_OK)
+            break;
+        }
+
+    return enStatus;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Get what relative time is converted to absolute time with.  Use the time
+// model if the handle has one, otherwise use the index time reference.
+
+static EnI106Status enGetChanTimeRef(int iHandle, int * pbTimeModel, SuTimeRef * psuTimeRef)
+    {
+    SuIndexFollow     * psuFollow = FILE_INDEX(iHandle)->psuFollow;
+
+    // Following the file keeps using the reference it started with so the
+    // tables don't end up with a mix of references
+    if ((psuFollow != NULL) && psuFollow->bHaveTimeRef)
+        {
+        *pbTimeModel = psuFollow->bTimeModel;
+        *psuTimeRef  = psuFollow->suTimeRef;
+        return I106_OK;
+        }
+
+    *pbTimeModel = (psuI106Handle(iHandle)->psuTimeModel != NULL) &&
+                   (psuI106Handle(iHandle)->psuTimeModel->iNumSegments > 0);
+    if (*pbTimeModel)
+        return I106_OK;
+
+    if (FindTimePacket(iHandle) != I106_OK)
+        return I106_TIME_NOT_FOUND;
+    memset(psuTimeRef, 0, sizeof(SuTimeRef));
+    psuTimeRef->uRelTime   = FILE_INDEX(iHandle)->suTimeSync.llRelTime;
+    psuTimeRef->suIrigTime = FILE_INDEX(iHandle)->suTimeSync.suIrigTime;
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Fill in absolute time for one channel table from entry uFirst on
+
+static EnI106Status enMakeChanAbsTime(int iHandle, int bTimeModel, SuTimeRef * psuTimeRef,
+                                      SuChanIndex * psuChan, uint32_t uFirst)
+    {
+    EnI106Status        enStatus;
+    SuTimeModel       * psuModel;
+    uint32_t            uEntry;
+
+    // Start over if there's nothing to add on to
+    if ((uFirst == 0) || (psuChan->allAbsTime == NULL))
+        {
+        uFirst = 0;
+        free(psuChan->allAbsTime);
+        psuChan->allAbsTime = (int64_t *)malloc(psuChan->uAvailable * sizeof(int64_t));
+        if (psuChan->allAbsTime == NULL)
+            return I106_NO_MEMORY;
+        psuChan->bAbsTimeSorted = bTRUE;
+        }
+
+    // Each packet uses the time model epoch for where it is in the file
+    if (bTimeModel)
+        {
+        psuModel = psuI106Handle(iHandle)->psuTimeModel;
+        for (uEntry=uFirst; uEntry<psuChan->uCount; uEntry++)
+            {
+            vI106_TimeModelSetOffset(psuModel, psuChan->allOffset[uEntry]);
+            psuChan->allAbsTime[uEntry] = llI106_TimeModelRel2Abs(psuModel, psuChan->allRelTime[uEntry]);
+            }
+        enStatus = I106_OK;
+        }
+    else
+        enStatus = enI106_RelInt2AbsTimeArray2(psuTimeRef, &psuChan->allRelTime[uFirst],
+                                               &psuChan->allAbsTime[uFirst], psuChan->uCount - uFirst);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    // A time jump can put absolute time out of order even though relative time is
+    for (uEntry=(uFirst > 0 ? uFirst : 1); uEntry<psuChan->uCount; uEntry++)
+        if (psuChan->allAbsTime[uEntry] < psuChan->allAbsTime[uEntry-1])
+            {
+            psuChan->bAbsTimeSorted = bFALSE;
+            break;
+            }
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+static void vFreeChanIndexScan(SuChanIndexScan * psuScan)
+    {
+
+    vFreeChanIndexes(psuScan->asuChan, psuScan->iNumChans);
+    free(psuScan->aulChanSlot);
+    memset(psuScan, 0, sizeof(SuChanIndexScan));
+
+    return;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+static void vFreeChanIndexes(SuChanIndex * asuChan, int iNumChans)
+    {
+    int                 iChanIdx;
+
+    if (asuChan == NULL)
+        return;
+
+    for (iChanIdx=0; iChanIdx<iNumChans; iChanIdx++)
+        {
+        free(asuChan[iChanIdx].allRelTime);
+        free(asuChan[iChanIdx].allOffset);
+        free(asuChan[iChanIdx].allAbsTime);
+        }
+    free(asuChan);
+
+    return;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+static int CompareChanIndexes(const void * pChan1, const void * pChan2)
+    {
+    return (int)((SuChanIndex *)pChan1)->uChID - (int)((SuChanIndex *)pChan2)->uChID;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+static int CompareTimeOffsets(const void * pInfo1, const void * pInfo2)
+    {
+    if (((SuInOrderPacketInfo *)pInfo1)->llTime > ((SuInOrderPacketInfo *)pInfo2)->llTime)
+        return 1;
+
+    if (((SuInOrderPacketInfo *)pInfo1)->llTime < ((SuInOrderPacketInfo *)pInfo2)->llTime)
+        return -1;
+
+    if (((SuInOrderPacketInfo *)pInfo1)->llOffset > ((SuInOrderPacketInfo *)pInfo2)->llOffset)
+        return 1;
+
+    if (((SuInOrderPacketInfo *)pInfo1)->llOffset < ((SuInOrderPacketInfo *)pInfo2)->llOffset)
+        return -1;
+
+    return 0;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+// Index query functions
+// ----------------------------------------------------------------------------
+
+/** Find the packets from a set of channels with times from llStartTime to
+ *  llStopTime inclusive.  Only the channel index tables are used, they are
+ *  made first if need be.  Each channel range is found by binary search.
+ */
+
+EnI106Status I106_CALL_DECL enIndexQuery(const int           iHandle,
+                                         const uint16_t      auChID[],
+                                         int                 iNumChID,
+                                         int64_t             llStartTime,
+                                         int64_t             llStopTime,
+                                         int                 bAbsTime,
+                                         EnI106QueryOrder    enOrder,
+                                         SuIndexQuery      * psuQuery)
+    {
+    EnI106Status            enStatus;
+    SuChanIndex           * asuChan;
+    SuChanIndex           * psuChan;
+    SuIndexQueryPacket    * psuPacket;
+    uint32_t              * auFirst;
+    uint32_t              * auLast;
+    uint32_t                uEntry;
+    uint32_t                uCount;
+    int                     iNumChans;
+    int                     iChanIdx;
+    int                     iChIdx;
+
+    if (psuQuery == NULL)
+        return I106_INVALID_PARAMETER;
+    memset(psuQuery, 0, sizeof(SuIndexQuery));
+    psuQuery->iHandle = iHandle;
+
+    if ((iNumChID < 0) || ((iNumChID > 0) && (auChID == NULL)))
+        return I106_INVALID_PARAMETER;
+
+    // Make the channel tables if they aren't there yet
+    enStatus = enGetChanIndexes(iHandle, &asuChan, &iNumChans);
+    if (enStatus == I106_NO_INDEX)
+        {
+        enStatus = enMakeChanIndexes(iHandle, 0, bAbsTime);
+        if (enStatus == I106_OK)
+            enStatus = enGetChanIndexes(iHandle, &asuChan, &iNumChans);
+        }
+    else if ((enStatus == I106_OK) && bAbsTime && bChanAbsTimesMissing(iHandle, auChID, iNumChID))
+        enStatus = enMakeChanAbsTimes(iHandle);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    auFirst = (uint32_t *)calloc(iNumChans + 1, sizeof(uint32_t));
+    auLast  = (uint32_t *)calloc(iNumChans + 1, sizeof(uint32_t));
+    if ((auFirst == NULL) || (auLast == NULL))
+        {
+        free(auFirst);
+        free(auLast);
+        return I106_NO_MEMORY;
+        }
+
+    // Find the range of entries in each selected channel
+    uCount = 0;
+    for (iChanIdx=0; iChanIdx<iNumChans; iChanIdx++)
+        {
+        psuChan = &asuChan[iChanIdx];
+        if (iNumChID > 0)
+            {
+            for (iChIdx=0; iChIdx<iNumChID; iChIdx++)
+                if (auChID[iChIdx] == psuChan->uChID)
+                    break;
+            if (iChIdx >= iNumChID)
+                continue;
+            }
+
+        if (bAbsTime && !psuChan->bAbsTimeSorted)
+            {
+            // Time jumps leave absolute time out of order so look at them all
+            auFirst[iChanIdx] = 0;
+            auLast[iChanIdx]  = psuChan->uCount;
+            }
+        else if (bAbsTime)
+            {
+            auFirst[iChanIdx] = uChanIndexFindAbsTime(psuChan, llStartTime);
+            auLast[iChanIdx]  = uFindTimeAfter(psuChan->allAbsTime, psuChan->uCount, llStopTime);
+            }
+        else
+            {
+            auFirst[iChanIdx] = uChanIndexFindTime(psuChan, llStartTime);
+            auLast[iChanIdx]  = uFindTimeAfter(psuChan->allRelTime, psuChan->uCount, llStopTime);
+            }
+        if (auLast[iChanIdx] > auFirst[iChanIdx])
+            uCount += auLast[iChanIdx] - auFirst[iChanIdx];
+        }
+
+    // Copy out the packets
+    psuQuery->asuPacket = (SuIndexQueryPacket *)malloc((uCount + 1) * sizeof(SuIndexQueryPacket));
+    if (psuQuery->asuPacket == NULL)
+        {
+        free(auFirst);
+        free(auLast);
+        return I106_NO_MEMORY;
+        }
+
+    psuPacket = psuQuery->asuPacket;
+    for (iChanIdx=0; iChanIdx<iNumChans; iChanIdx++)
+        {
+        psuChan = &asuChan[iChanIdx];
+        for (uEntry=auFirst[iChanIdx]; uEntry<auLast[iChanIdx]; uEntry++)
+            {
+            if (bAbsTime && !psuChan->bAbsTimeSorted &&
+                ((psuChan->allAbsTime[uEntry] < llStartTime) || (psuChan->allAbsTime[uEntry] > llStopTime)))
+                continue;
+            psuPacket->llOffset    = psuChan->allOffset[uEntry];
+            psuPacket->llRelTime   = psuChan->allRelTime[uEntry];
+            psuPacket->uChID       = psuChan->uChID;
+            psuPacket->ubyDataType = psuChan->ubyDataType;
+            psuPacket++;
+            }
+        }
+    psuQuery->uCount = (uint32_t)(psuPacket - psuQuery->asuPacket);
+
+    free(auFirst);
+    free(auLast);
+
+    // Put them in the order asked for
+    qsort(psuQuery->asuPacket, psuQuery->uCount, sizeof(SuIndexQueryPacket),
+          enOrder == I106_QUERY_FILE_ORDER ? &CompareQueryOffsets : &CompareQueryTimes);
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+/** Read the next packet found by a query.  The packet is read with the normal
+ *  file read routines so the data can be decoded as usual.  Returns I106_EOF
+ *  after the last packet.
+ */
+
+EnI106Status I106_CALL_DECL enIndexQueryReadNext(SuIndexQuery       * psuQuery,
+                                                 SuI106Ch10Header   * psuHeader,
+                                                 unsigned long        ulBuffSize,
+                                                 void               * pvBuff)
+    {
+    EnI106Status            enStatus;
+    SuIndexQueryPacket    * psuPacket;
+    int64_t                 llCurrOffset;
+    int64_t                 llRelTime;
+
+    if (psuQuery->uNext >= psuQuery->uCount)
+        return I106_EOF;
+
+    psuPacket = &psuQuery->asuPacket[psuQuery->uNext];
+
+    // Packets next to each other in the file don't need a seek
+    enStatus = enI106Ch10GetPos(psuQuery->iHandle, &llCurrOffset);
+    if ((enStatus != I106_OK) || (llCurrOffset != psuPacket->llOffset))
+        {
+        enStatus = enI106Ch10SetPos(psuQuery->iHandle, psuPacket->llOffset);
+        if (enStatus != I106_OK)
+            return enStatus;
+        }
+
+    enStatus = enI106Ch10ReadNextHeaderFile(psuQuery->iHandle, psuHeader);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    // Make sure the index and the file still agree.  A bad entry is skipped
+    // so the next call goes on to the packet after it.
+    psuQuery->uNext++;
+    vTimeArray2LLInt(psuHeader->aubyRefTime, &llRelTime);
+    if ((psuHeader->uChID != psuPacket->uChID) || (llRelTime != psuPacket->llRelTime))
+        return I106_INVALID_DATA;
+
+    if (pvBuff == NULL)
+        return I106_OK;
+
+    return enI106Ch10ReadData(psuQuery->iHandle, ulBuffSize, pvBuff);
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+/** Free the packet list of a query
+ */
+
+void I106_CALL_DECL vFreeIndexQuery(SuIndexQuery * psuQuery)
+    {
+
+    if (psuQuery == NULL)
+        return;
+
+    free(psuQuery->asuPacket);
+    psuQuery->asuPacket = NULL;
+    psuQuery->uCount    = 0;
+    psuQuery->uNext     = 0;
+
+    return;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+/** Find the first entry in a channel index at or after an absolute time.  The
+ *  absolute times must be in order, see bAbsTimeSorted.
+ */
+
+uint32_t I106_CALL_DECL uChanIndexFindAbsTime(const SuChanIndex * psuChanIndex, int64_t llAbsTime)
+    {
+    uint32_t            uLow  = 0;
+    uint32_t            uHigh = psuChanIndex->uCount;
+    uint32_t            uMid;
+
+    if (psuChanIndex->allAbsTime == NULL)
+        return psuChanIndex->uCount;
+
+    while (uLow < uHigh)
+        {
+        uMid = uLow + (uHigh - uLow) / 2;
+        if (psuChanIndex->allAbsTime[uMid] < llAbsTime)
+            uLow = uMid + 1;
+        else
+            uHigh = uMid;
+        }
+
+    return uLow;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// See if any of a set of channel tables, or all of them, don't have absolute
+// time yet.  Channels added by following the file start out without it.
+
+static int bChanAbsTimesMissing(int iHandle, const uint16_t auChID[], int iNumChID)
+    {
+    SuChanIndex       * psuChan;
+    int                 iChanIdx;
+    int                 iChIdx;
+
+    for (iChanIdx=0; iChanIdx<FILE_INDEX(iHandle)->iNumChanIndexes; iChanIdx++)
+        {
+        psuChan = &FILE_INDEX(iHandle)->asuChanIndex[iChanIdx];
+        if (psuChan->allAbsTime != NULL)
+            continue;
+        if (iNumChID == 0)
+            return bTRUE;
+        for (iChIdx=0; iChIdx<iNumChID; iChIdx++)
+            if (auChID[iChIdx] == psuChan->uChID)
+                return bTRUE;
+        }
+
+    return bFALSE;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Find the first entry in a sorted time column that is after a time
+
+static uint32_t uFindTimeAfter(const int64_t allTime[], uint32_t uCount, int64_t llTime)
+    {
+    uint32_t            uLow  = 0;
+    uint32_t            uHigh = uCount;
+    uint32_t            uMid;
+
+    while (uLow < uHigh)
+        {
+        uMid = uLow + (uHigh - uLow) / 2;
+        if (allTime[uMid] <= llTime)
+            uLow = uMid + 1;
+        else
+            uHigh = uMid;
+        }
+
+    return uLow;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+static int CompareQueryTimes(const void * pPacket1, const void * pPacket2)
+    {
+    if (((SuIndexQueryPacket *)pPacket1)->llRelTime > ((SuIndexQueryPacket *)pPacket2)->llRelTime)
+        return 1;
+
+    if (((SuIndexQueryPacket *)pPacket1)->llRelTime < ((SuIndexQueryPacket *)pPacket2)->llRelTime)
+        return -1;
+
+    return CompareQueryOffsets(pPacket1, pPacket2);
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+static int CompareQueryOffsets(const void * pPacket1, const void * pPacket2)
+    {
+    if (((SuIndexQueryPacket *)pPacket1)->llOffset > ((SuIndexQueryPacket *)pPacket2)->llOffset)
+        return 1;
+
+    if (((SuIndexQueryPacket *)pPacket1)->llOffset < ((SuIndexQueryPacket *)pPacket2)->llOffset)
+        return -1;
+
+    return 0;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+// Index following functions
+// ----------------------------------------------------------------------------
+
+/** Start keeping the channel index tables current while the file grows.
+ *  The tables are made first if they haven't been.  After this each call to
+ *  enFollowIndex() adds the packets written since the last call.  Absolute
+ *  times are made with one time reference, found now or as soon as a time
+ *  packet has been written.
+ */
+
+EnI106Status I106_CALL_DECL enStartIndexFollow(const int iHandle, int iNumThreads, int bAbsTime)
+    {
+    EnI106Status        enStatus = I106_OK;
+    SuIndexFollow     * psuFollow;
+
+    // Make sure there is an index for this handle
+    if (psuGetIndex(iHandle) == NULL)
+        return I106_INVALID_HANDLE;
+
+    // Memory mapped and in order reads don't see the file grow
+    if (psuI106Handle(iHandle)->enFileMode != I106_READ)
+        return I106_WRONG_FILE_MODE;
+
+    if (FILE_INDEX(iHandle)->psuFollow != NULL)
+        return I106_INVALID_PARAMETER;
+
+    // Make the tables, absolute time comes later
+    if (FILE_INDEX(iHandle)->asuChanIndex == NULL)
+        enStatus = enMakeChanIndexes(iHandle, iNumThreads, bFALSE);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    psuFollow = (SuIndexFollow *)calloc(1, sizeof(SuIndexFollow));
+    if (psuFollow == NULL)
+        return I106_NO_MEMORY;
+
+    psuFollow->llNextOffset = -1;
+    psuFollow->bAbsTime     = bAbsTime;
+    psuFollow->iNotify      = -1;
+
+#if defined(__linux__)
+    // Get told about writes instead of polling if we can
+    psuFollow->iNotify = inotify_init();
+    if ((psuFollow->iNotify >= 0) &&
+        (inotify_add_watch(psuFollow->iNotify, psuI106Handle(iHandle)->szFileName, IN_MODIFY) < 0))
+        {
+        close(psuFollow->iNotify);
+        psuFollow->iNotify = -1;
+        }
+#endif
+
+    FILE_INDEX(iHandle)->psuFollow = psuFollow;
+
+    // There may not be a time packet yet when recording has just started
+    if (bAbsTime)
+        {
+        enStatus = enFollowTimeRef(iHandle, psuFollow);
+        if (enStatus != I106_OK)
+            {
+            FILE_INDEX(iHandle)->psuFollow = NULL;
+            vFreeIndexFollow(psuFollow);
+            return enStatus;
+            }
+        }
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+/** Add packets written since the last call to the channel index tables.
+ *  Only whole packets are added, a packet still being written is picked up
+ *  next time.  If nothing new has been written wait up to iTimeoutMs for
+ *  more data.
+ */
+
+EnI106Status I106_CALL_DECL enFollowIndex(const int iHandle, int iTimeoutMs, uint32_t * puNewPackets)
+    {
+    EnI106Status        enStatus;
+    SuIndexFollow     * psuFollow;
+    SuChanIndexScan     suScan;
+    int64_t             llStartingFileOffset;
+    int64_t             llFileSize;
+    int64_t             llStopTime;
+    int64_t             llWaitMs;
+
+    if (puNewPackets != NULL)
+        *puNewPackets = 0;
+
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        return I106_INVALID_HANDLE;
+
+    if ((FILE_INDEX(iHandle) == NULL) || (FILE_INDEX(iHandle)->psuFollow == NULL))
+        return I106_NO_INDEX;
+
+    psuFollow = FILE_INDEX(iHandle)->psuFollow;
+
+    enStatus = enI106Ch10GetPos(iHandle, &llStartingFileOffset);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    // Find where the tables leave off if they were just made
+    if (psuFollow->llNextOffset < 0)
+        {
+        enStatus = enFindChanIndexEnd(iHandle, &psuFollow->llNextOffset);
+        if (enStatus != I106_OK)
+            return enStatus;
+        }
+
+    // Look for new whole packets until there are some or time runs out
+    memset(&suScan, 0, sizeof(suScan));
+    llStopTime = llFollowMilliSecs() + iTimeoutMs;
+    while (bTRUE)
+        {
+        llFileSize = llFollowFileSize(iHandle);
+        if (llFileSize < 0)
+            {
+            enStatus = I106_READ_ERROR;
+            break;
+            }
+        if (llFileSize >= psuFollow->llNextOffset + HEADER_SIZE)
+            {
+            enStatus = enFollowScan(iHandle, psuFollow, llFileSize, &suScan);
+            if ((enStatus != I106_OK) || (suScan.iNumChans > 0))
+                break;
+            }
+
+        llWaitMs = llStopTime - llFollowMilliSecs();
+        if (llWaitMs <= 0)
+            break;
+        vFollowWait(psuFollow, llWaitMs < INDEX_FOLLOW_POLL_MS ? (int)llWaitMs : INDEX_FOLLOW_POLL_MS);
+        }
+
+    enI106Ch10SetPos(iHandle, llStartingFileOffset);
+
+    if (enStatus == I106_OK)
+        enStatus = enAppendChanIndexScan(iHandle, &suScan, puNewPackets);
+
+    vFreeChanIndexScan(&suScan);
+
+    return enStatus;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+/** Stop following the file.  The channel index tables are kept.
+ */
+
+EnI106Status I106_CALL_DECL enStopIndexFollow(const int iHandle)
+    {
+
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        return I106_INVALID_HANDLE;
+
+    if (FILE_INDEX(iHandle) == NULL)
+        return I106_OK;
+
+    vFreeIndexFollow(FILE_INDEX(iHandle)->psuFollow);
+    FILE_INDEX(iHandle)->psuFollow = NULL;
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Read the headers of the whole packets past the last one indexed into a scan
+// table.  A packet that isn't all there yet is left for next time.
+
+static EnI106Status enFollowScan(int iHandle, SuIndexFollow * psuFollow, int64_t llFileSize,
+                                 SuChanIndexScan * psuScan)
+    {
+    EnI106Status        enStatus;
+    SuI106Ch10Header    suHdr;
+    int64_t             llOffset;
+
+    enStatus = enI106Ch10SetPos(iHandle, psuFollow->llNextOffset);
+    while (enStatus == I106_OK)
+        {
+        enStatus = enI106Ch10ReadNextHeaderFile(iHandle, &suHdr);
+        if (enStatus == I106_HEADER_CHKSUM_BAD)
+            {
+            enStatus = I106_OK;
+            continue;
+            }
+        if (enStatus == I106_EOF)
+            {
+            enStatus = I106_OK;
+            break;
+            }
+        if (enStatus != I106_OK)
+            break;
+
+        enI106Ch10GetPos(iHandle, &llOffset);
+        llOffset -= iGetHeaderLen(&suHdr);
+
+        if (llOffset + suHdr.ulPacketLen > llFileSize)
+            break;
+
+        if (bChanIndexScanAdd(psuScan, llOffset, &suHdr) == bFALSE)
+            {
+            enStatus = I106_NO_MEMORY;
+            break;
+            }
+        psuFollow->llNextOffset = llOffset + suHdr.ulPacketLen;
+        }
+
+    return enStatus;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Add the tables from a scan of new packets to the end of the channel index
+// tables.  New channels are put in channel ID order.  A channel only gets
+// sorted again if the new packets go back in time.
+
+static EnI106Status enAppendChanIndexScan(int iHandle, SuChanIndexScan * psuScan, uint32_t * puNewPackets)
+    {
+    EnI106Status        enStatus = I106_OK;
+    SuCh10Index       * psuIndex = FILE_INDEX(iHandle);
+    SuChanIndex       * psuNew;
+    SuChanIndex       * psuChan;
+    SuChanIndex       * asuNewChan;
+    SuIndexFollow     * psuFollow = psuIndex->psuFollow;
+    uint32_t            uFirst;
+    uint32_t            uEntry;
+    int                 bNewTimePackets = bFALSE;
+    int                 iScanIdx;
+    int                 iChanIdx;
+
+    for (iScanIdx=0; iScanIdx<psuScan->iNumChans; iScanIdx++)
+        {
+        psuNew = &psuScan->asuChan[iScanIdx];
+
+        // Find the channel table, or put a new one where it goes
+        for (iChanIdx=0; iChanIdx<psuIndex->iNumChanIndexes; iChanIdx++)
+            if (psuIndex->asuChanIndex[iChanIdx].uChID >= psuNew->uChID)
+                break;
+        if ((iChanIdx >= psuIndex->iNumChanIndexes) ||
+            (psuIndex->asuChanIndex[iChanIdx].uChID != psuNew->uChID))
+            {
+            asuNewChan = (SuChanIndex *)realloc(psuIndex->asuChanIndex,
+                                                (psuIndex->iNumChanIndexes + 1) * sizeof(SuChanIndex));
+            if (asuNewChan == NULL)
+                return I106_NO_MEMORY;
+            memmove(&asuNewChan[iChanIdx+1], &asuNewChan[iChanIdx],
+                    (psuIndex->iNumChanIndexes - iChanIdx) * sizeof(SuChanIndex));
+            memset(&asuNewChan[iChanIdx], 0, sizeof(SuChanIndex));
+            asuNewChan[iChanIdx].uChID       = psuNew->uChID;
+            asuNewChan[iChanIdx].ubyDataType = psuNew->ubyDataType;
+            psuIndex->asuChanIndex = asuNewChan;
+            psuIndex->iNumChanIndexes++;
+            }
+        psuChan = &psuIndex->asuChanIndex[iChanIdx];
+
+        // Tack the new entries on the end
+        uFirst = psuChan->uCount;
+        if (bGrowChanIndex(psuChan, psuChan->uCount + psuNew->uCount) == bFALSE)
+            return I106_NO_MEMORY;
+        memcpy(&psuChan->allRelTime[uFirst], psuNew->allRelTime, psuNew->uCount * sizeof(int64_t));
+        memcpy(&psuChan->allOffset[uFirst],  psuNew->allOffset,  psuNew->uCount * sizeof(int64_t));
+        psuChan->uCount += psuNew->uCount;
+
+        // Packets out of time order mean sorting and redoing absolute time
+        for (uEntry=(uFirst > 0 ? uFirst : 1); uEntry<psuChan->uCount; uEntry++)
+            if (psuChan->allRelTime[uEntry] < psuChan->allRelTime[uEntry-1])
+                break;
+        if (uEntry < psuChan->uCount)
+            {
+            if (bSortChanIndex(psuChan) == bFALSE)
+                return I106_NO_MEMORY;
+            uFirst = 0;
+            }
+
+        if (psuFollow->bAbsTime && psuFollow->bHaveTimeRef)
+            {
+            enStatus = enMakeChanAbsTime(iHandle, psuFollow->bTimeModel, &psuFollow->suTimeRef,
+                                         psuChan, uFirst);
+            if (enStatus != I106_OK)
+                return enStatus;
+            }
+
+        if (psuNew->ubyDataType == I106CH10_DTYPE_IRIG_TIME)
+            bNewTimePackets = bTRUE;
+
+        if (puNewPackets != NULL)
+            *puNewPackets += psuNew->uCount;
+        }
+
+    // Only look for a time reference again once there's a new time packet
+    if (psuFollow->bAbsTime && !psuFollow->bHaveTimeRef && bNewTimePackets)
+        enStatus = enFollowTimeRef(iHandle, psuFollow);
+
+    return enStatus;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Get the time reference for following the file and make absolute time for
+// everything indexed so far with it.  Not finding one yet isn't an error.
+
+static EnI106Status enFollowTimeRef(int iHandle, SuIndexFollow * psuFollow)
+    {
+
+    if (enGetChanTimeRef(iHandle, &psuFollow->bTimeModel, &psuFollow->suTimeRef) != I106_OK)
+        return I106_OK;
+
+    psuFollow->bHaveTimeRef = bTRUE;
+
+    return enMakeChanAbsTimes(iHandle);
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Find the file offset just past the last packet in the channel index tables
+
+static EnI106Status enFindChanIndexEnd(int iHandle, int64_t * pllEndOffset)
+    {
+    EnI106Status        enStatus;
+    SuChanIndex       * psuChan;
+    SuI106Ch10Header    suHdr;
+    int64_t             llLastOffset = -1;
+    uint32_t            uEntry;
+    int                 iChanIdx;
+
+    // Tables are in time order so look at every offset
+    for (iChanIdx=0; iChanIdx<FILE_INDEX(iHandle)->iNumChanIndexes; iChanIdx++)
+        {
+        psuChan = &FILE_INDEX(iHandle)->asuChanIndex[iChanIdx];
+        for (uEntry=0; uEntry<psuChan->uCount; uEntry++)
+            if (psuChan->allOffset[uEntry] > llLastOffset)
+                llLastOffset = psuChan->allOffset[uEntry];
+        }
+
+    if (llLastOffset < 0)
+        {
+        *pllEndOffset = 0;
+        return I106_OK;
+        }
+
+    enStatus = enI106Ch10SetPos(iHandle, llLastOffset);
+    if (enStatus == I106_OK)
+        enStatus = enI106Ch10ReadNextHeaderFile(iHandle, &suHdr);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    *pllEndOffset = llLastOffset + suHdr.ulPacketLen;
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Wait a while for the file to be written to
+
+static void vFollowWait(SuIndexFollow * psuFollow, int iWaitMs)
+    {
+#if defined(_WIN32)
+    (void)psuFollow;
+    Sleep(iWaitMs);
+#else
+    struct timespec     suSleep;
+#if defined(__linux__)
+    struct pollfd       suPoll;
+    char                achEvents[1024];
+
+    if (psuFollow->iNotify >= 0)
+        {
+        suPoll.fd      = psuFollow->iNotify;
+        suPoll.events  = POLLIN;
+        suPoll.revents = 0;
+        if (poll(&suPoll, 1, iWaitMs) > 0)
+            read(psuFollow->iNotify, achEvents, sizeof(achEvents));
+        return;
+        }
+#endif
+
+    suSleep.tv_sec  = iWaitMs / 1000;
+    suSleep.tv_nsec = (iWaitMs % 1000) * 1000000L;
+    nanosleep(&suSleep, NULL);
+#endif
+
+    return;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+static int64_t llFollowFileSize(int iHandle)
+    {
+#if defined(_WIN32)
+    return _filelengthi64(psuI106Handle(iHandle)->iFile);
+#else
+    struct stat         suStatBuff;
+
+    if (fstat(psuI106Handle(iHandle)->iFile, &suStatBuff) != 0)
+        return -1;
+    return suStatBuff.st_size;
+#endif
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+static int64_t llFollowMilliSecs(void)
+    {
+#if defined(_WIN32)
+    return (int64_t)GetTickCount64();
+#else
+    struct timespec     suNow;
+
+    clock_gettime(CLOCK_MONOTONIC, &suNow);
+    return (int64_t)suNow.tv_sec * 1000 + suNow.tv_nsec / 1000000;
+#endif
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+static void vFreeIndexFollow(SuIndexFollow * psuFollow)
+    {
+
+    if (psuFollow == NULL)
+        return;
+
+#if defined(__linux__)
+    if (psuFollow->iNotify >= 0)
+        close(psuFollow->iNotify);
+#endif
+    free(psuFollow);
+
+    return;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+// Index writing functions
+// ----------------------------------------------------------------------------
+
+/** Start writing root and node index packets.
+ *  Every packet written to a selected channel gets a node index entry. A
+ *  node index packet is written each time uNodeEntries entries build up, and
+ *  a root index packet each time INDEX_WRITE_ROOT_ENTRIES node packets are
+ *  written.  enStopIndexWrite() writes what is left and the final root index
+ *  packet, which is always the last packet in the file.
+ */
+
+EnI106Status I106_CALL_DECL enStartIndexWrite(const int        iHandle,
+                                              const uint16_t   auChID[],
+                                              int              iNumChID,
+                                              uint32_t         uNodeEntries)
+    {
+    EnI106Status        enStatus;
+    SuIndexWriter     * psuWriter;
+    int                 iChIdx;
+
+    // Make sure there is an index for this handle
+    if (psuGetIndex(iHandle) == NULL)
+        return I106_INVALID_HANDLE;
+
+    // Offsets only mean something in a file
+    if ((psuI106Handle(iHandle)->enFileMode != I106_OVERWRITE) &&
+        (psuI106Handle(iHandle)->enFileMode != I106_APPEND))
+        return I106_WRONG_FILE_MODE;
+
+    if (FILE_INDEX(iHandle)->psuWriter != NULL)
+        return I106_INVALID_PARAMETER;
+
+    if ((iNumChID < 0) || ((iNumChID > 0) && (auChID == NULL)))
+        return I106_INVALID_PARAMETER;
+
+    // The node entry count is only 16 bits
+    if (uNodeEntries == 0)
+        uNodeEntries = INDEX_WRITE_NODE_ENTRIES;
+    if (uNodeEntries > 0xffff)
+        uNodeEntries = 0xffff;
+
+    psuWriter = (SuIndexWriter *)calloc(1, sizeof(SuIndexWriter));
+    if (psuWriter == NULL)
+        return I106_NO_MEMORY;
+
+    psuWriter->asuNode = (SuIndex_NodeMsg *)malloc(uNodeEntries * sizeof(SuIndex_NodeMsg));
+    psuWriter->asuRoot = (SuIndex_RootMsg *)malloc((INDEX_WRITE_ROOT_ENTRIES + 1) * sizeof(SuIndex_RootMsg));
+    if ((psuWriter->asuNode == NULL) || (psuWriter->asuRoot == NULL))
+        {
+        vFreeIndexWriter(psuWriter);
+        return I106_NO_MEMORY;
+        }
+
+    // Index packets are placed by file offset so start from where writing is now
+    enStatus = enI106Ch10GetPos(iHandle, &psuWriter->llNextOffset);
+    if (enStatus != I106_OK)
+        {
+        vFreeIndexWriter(psuWriter);
+        return enStatus;
+        }
+
+    // No channel list means index everything
+    psuWriter->bAllChannels     = iNumChID == 0;
+    for (iChIdx=0; iChIdx<iNumChID; iChIdx++)
+        psuWriter->abyChanMask[auChID[iChIdx] >> 3] |= (uint8_t)(1 << (auChID[iChIdx] & 0x07));
+
+    psuWriter->uNodeEntries     = uNodeEntries;
+    psuWriter->llLastRootOffset = -1;
+
+    FILE_INDEX(iHandle)->psuWriter = psuWriter;
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+/** Write the remaining node index entries and the final root index packet
+ *  and stop writing index packets.  This is done automatically on close.
+ */
+
+EnI106Status I106_CALL_DECL enStopIndexWrite(const int iHandle)
+    {
+    EnI106Status        enStatus = I106_OK;
+    SuIndexWriter     * psuWriter;
+
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        return I106_INVALID_HANDLE;
+
+    if ((FILE_INDEX(iHandle) == NULL) || (FILE_INDEX(iHandle)->psuWriter == NULL))
+        return I106_OK;
+
+    psuWriter = FILE_INDEX(iHandle)->psuWriter;
+
+    // Write what's left then the root that ties it all together
+    if (psuWriter->uNodesUsed > 0)
+        enStatus = enWriteNodeIndexPacket(iHandle);
+
+    if ((enStatus == I106_OK) && (psuWriter->uRootsUsed > 0))
+        enStatus = enWriteRootIndexPacket(iHandle);
+
+    FILE_INDEX(iHandle)->psuWriter = NULL;
+    vFreeIndexWriter(psuWriter);
+
+    return enStatus;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Called after each packet is written to keep track of file offsets and to
+// add node index entries for packets from the selected channels.
+
+EnI106Status enIndexPacketWritten(int iHandle, SuI106Ch10Header * psuHeader)
+    {
+    EnI106Status        enStatus;
+    SuIndexWriter     * psuWriter;
+    SuIndex_NodeMsg   * psuNode;
+    int64_t             llOffset;
+    int64_t             llRelTime;
+
+    if ((FILE_INDEX(iHandle) == NULL) || (FILE_INDEX(iHandle)->psuWriter == NULL))
+        return I106_OK;
+
+    psuWriter = FILE_INDEX(iHandle)->psuWriter;
+    llOffset  = psuWriter->llNextOffset;
+    psuWriter->llNextOffset += psuHeader->ulPacketLen;
+
+    vTimeArray2LLInt(psuHeader->aubyRefTime, &llRelTime);
+    psuWriter->llLastRelTime = llRelTime;
+
+    // Don't index the index
+    if (psuHeader->ubyDataType == I106CH10_DTYPE_RECORDING_INDEX)
+        return I106_OK;
+
+    if ((psuWriter->bAllChannels == bFALSE) &&
+        ((psuWriter->abyChanMask[psuHeader->uChID >> 3] & (1 << (psuHeader->uChID & 0x07))) == 0))
+        return I106_OK;
+
+    psuNode = &psuWriter->asuNode[psuWriter->uNodesUsed++];
+    memset(psuNode, 0, sizeof(SuIndex_NodeMsg));
+    psuNode->suTime.llTime     = llRelTime;
+    psuNode->suData.uChannelID = psuHeader->uChID;
+    psuNode->suData.uDataType  = psuHeader->ubyDataType;
+    psuNode->lOffset           = llOffset;
+
+    if (psuWriter->uNodesUsed < psuWriter->uNodeEntries)
+        return I106_OK;
+
+    // A failed index packet write leaves the node or root list full, and the
+    // offsets in the index can't be trusted anymore anyway, so stop indexing
+    enStatus = enWriteNodeIndexPacket(iHandle);
+    if (enStatus != I106_OK)
+        {
+        FILE_INDEX(iHandle)->psuWriter = NULL;
+        vFreeIndexWriter(psuWriter);
+        }
+
+    return enStatus;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Write the waiting node index entries as a node index packet and add a root
+// index entry for it.  Write a root index packet if that fills the root list.
+
+static EnI106Status enWriteNodeIndexPacket(int iHandle)
+    {
+    EnI106Status        enStatus;
+    SuIndexWriter     * psuWriter = FILE_INDEX(iHandle)->psuWriter;
+    SuIndex_RootMsg   * psuRoot;
+    int64_t             llNodeOffset;
+
+    llNodeOffset = psuWriter->llNextOffset;
+    enStatus = enWriteIndexPacket(iHandle, 1, psuWriter->asuNode,
+                                  psuWriter->uNodesUsed, sizeof(SuIndex_NodeMsg));
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    // The root entry points at the node packet with the time of its first node
+    psuRoot = &psuWriter->asuRoot[psuWriter->uRootsUsed++];
+    psuRoot->suTime.llTime = psuWriter->asuNode[0].suTime.llTime;
+    psuRoot->lOffset       = llNodeOffset;
+    psuWriter->uNodesUsed  = 0;
+
+    if (psuWriter->uRootsUsed >= INDEX_WRITE_ROOT_ENTRIES)
+        enStatus = enWriteRootIndexPacket(iHandle);
+
+    return enStatus;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Write a root index packet.  The last entry links back to the previous root
+// index packet, or to itself for the first one.
+
+static EnI106Status enWriteRootIndexPacket(int iHandle)
+    {
+    EnI106Status        enStatus;
+    SuIndexWriter     * psuWriter = FILE_INDEX(iHandle)->psuWriter;
+    SuIndex_RootMsg   * psuLink;
+    int64_t             llRootOffset;
+
+    llRootOffset = psuWriter->llNextOffset;
+
+    psuLink = &psuWriter->asuRoot[psuWriter->uRootsUsed];
+    psuLink->suTime.llTime = psuWriter->llLastRelTime;
+    psuLink->lOffset       = psuWriter->llLastRootOffset < 0 ? llRootOffset : psuWriter->llLastRootOffset;
+
+    enStatus = enWriteIndexPacket(iHandle, 0, psuWriter->asuRoot,
+                                  psuWriter->uRootsUsed + 1, sizeof(SuIndex_RootMsg));
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    psuWriter->llLastRootOffset = llRootOffset;
+    psuWriter->uRootsUsed       = 0;
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Put a header and channel specific data word on an array of index messages
+// and write it out.  Index messages are a multiple of 4 bytes long so there
+// is never any filler.
+
+static EnI106Status enWriteIndexPacket(int iHandle, int iIndexType, void * pvMsgs,
+                                       uint32_t uNumMsgs, uint32_t ulMsgLen)
+    {
+    SuI106Ch10Header    suHdr;
+    SuIndex_ChanSpec    suChanSpec;
+    SuIndexWriter     * psuWriter = FILE_INDEX(iHandle)->psuWriter;
+
+    memset(&suChanSpec, 0, sizeof(suChanSpec));
+    suChanSpec.uIdxEntCount = uNumMsgs;
+    suChanSpec.uIndexType   = iIndexType;
+
+    iHeaderInit(&suHdr, 0, I106CH10_DTYPE_RECORDING_INDEX, I106CH10_PFLAGS_CHKSUM_NONE, psuWriter->ubySeqNum++);
+    suHdr.ulDataLen   = sizeof(SuIndex_ChanSpec) + uNumMsgs * ulMsgLen;
+    suHdr.ulPacketLen = HEADER_SIZE + suHdr.ulDataLen;
+    vLLInt2TimeArray(&psuWriter->llLastRelTime, suHdr.aubyRefTime);
+    suHdr.uChecksum   = uCalcHeaderChecksum(&suHdr);
+
+    return enI106Ch10WriteMsg2(iHandle, &suHdr, &suChanSpec, sizeof(SuIndex_ChanSpec),
+                               pvMsgs, uNumMsgs * ulMsgLen, NULL, 0);
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+static void vFreeIndexWriter(SuIndexWriter * psuWriter)
+    {
+
+    if (psuWriter == NULL)
+        return;
+
+    free(psuWriter->asuNode);
+    free(psuWriter->asuRoot);
+    free(psuWriter);
+
+    return;
+    }
+
+
 
 #ifdef __cplusplus
 }
@@ -69,6 +69,46 @@ typedef struct
     int64_t         lFileOffset;        ///< File offset to packet
     } SuPacketIndexInfo;
 
+/// Time and offset table for one channel.  Each column is a separate array
+/// so a binary search on time only touches time values.  Entries are sorted
+/// by relative time, and by file offset for equal times.
+typedef struct
+    {
+    uint16_t        uChID;              ///< Channel ID
+    uint8_t         ubyDataType;        ///< Data type of first packet
+    uint32_t        uCount;             ///< Number of packets
+    uint32_t        uAvailable;         ///< Number of entries allocated
+    int64_t       * allRelTime;         ///< 48 bit relative time of each packet
+    int64_t       * allOffset;          ///< File offset of each packet
+    int64_t       * allAbsTime;         ///< Absolute time of each packet, NULL if not made
+    int             bAbsTimeSorted;     ///< Absolute times are in order too
+    } SuChanIndex;
+
+/// Order of index query results
+typedef enum
+    {
+    I106_QUERY_TIME_ORDER   = 0,        ///< By relative time, then file offset
+    I106_QUERY_FILE_ORDER   = 1,        ///< By file offset
+    } EnI106QueryOrder;
+
+/// One packet found by an index query
+typedef struct
+    {
+    int64_t         llOffset;           ///< File offset to packet
+    int64_t         llRelTime;          ///< 48 bit relative time
+    uint16_t        uChID;              ///< Channel ID
+    uint8_t         ubyDataType;        ///< Data type
+    } SuIndexQueryPacket;
+
+/// Packets found by an index query and where reading them is up to
+typedef struct
+    {
+    int                     iHandle;    ///< Handle the query was made on
+    uint32_t                uCount;     ///< Number of packets found
+    uint32_t                uNext;      ///< Next packet for enIndexQueryReadNext()
+    SuIndexQueryPacket    * asuPacket;  ///< Packets found
+    } SuIndexQuery;
+
 
 /*
  * Global data
@@ -86,6 +126,11 @@ typedef struct
 */
 void InitIndex(int iHandle);
 
+/** Free index data structures
+    @param iHandle      Handle to an open IRIG 106 data stream
+*/
+void FreeIndex(int iHandle);
+
 /** Sort the in-memory index by RTC value
     @param iHandle      Handle to an open IRIG 106 data stream
 */
@@ -128,6 +173,141 @@ void AddNodeToIndex(int iHandle, SuPacketIndexInfo * psuIndexInfo);
 */
 EnI106Status I106_CALL_DECL enGetIndexArray(const int iHandle, SuPacketIndexInfo * asuPacketIndexInfo[], uint32_t * piArrayLength);
 
+/** Make time and offset tables for all channels in one pass through the file.
+    Only packet headers are read.
+    @param iHandle      Handle of an IRIG file already opened for reading
+    @param iNumThreads  Number of threads to scan with, 0 to pick automatically
+    @param bAbsTime     Also make absolute time (100 nsec since 1970) for each packet
+    @return             I106_OK if tables made, I106_TIME_NOT_FOUND if absolute time couldn't be made
+*/
+EnI106Status I106_CALL_DECL enMakeChanIndexes(const int iHandle, int iNumThreads, int bAbsTime);
+
+/** Get the channel index tables, sorted by channel ID
+    @param iHandle      Handle of an IRIG file
+    @param pasuChanIndex Array of channel index tables
+    @param piNumChans   Number of channel index tables
+    @return             I106_OK if return values valid
+*/
+EnI106Status I106_CALL_DECL enGetChanIndexes(const int iHandle, SuChanIndex ** pasuChanIndex, int * piNumChans);
+
+/** Get the index table for one channel
+    @param iHandle      Handle of an IRIG file
+    @param uChID        Channel ID
+    @param ppsuChanIndex Channel index table
+    @return             I106_OK if return value valid
+*/
+EnI106Status I106_CALL_DECL enGetChanIndex(const int iHandle, uint16_t uChID, SuChanIndex ** ppsuChanIndex);
+
+/** Binary search a channel index for the first entry at or after a relative time
+    @param psuChanIndex Channel index table
+    @param llRelTime    Relative time to look for
+    @return             Entry number, uCount if all entries are earlier
+*/
+uint32_t I106_CALL_DECL uChanIndexFindTime(const SuChanIndex * psuChanIndex, int64_t llRelTime);
+
+/** Binary search a channel index for the first entry at or after an absolute time
+    @param psuChanIndex Channel index table with absolute times in order
+    @param llAbsTime    Absolute time (100 nsec since 1970) to look for
+    @return             Entry number, uCount if all entries are earlier
+*/
+uint32_t I106_CALL_DECL uChanIndexFindAbsTime(const SuChanIndex * psuChanIndex, int64_t llAbsTime);
+
+/** Find the packets from a set of channels within a time range using the
+    channel index tables.  The tables are made if they haven't been already.
+    No packet data is read.
+    @param iHandle      Handle of an IRIG file already opened for reading
+    @param auChID       Channel IDs to look for
+    @param iNumChID     Number of channel IDs, 0 for all channels
+    @param llStartTime  Start time, relative or absolute
+    @param llStopTime   Stop time, inclusive
+    @param bAbsTime     Times are absolute (100 nsec since 1970) instead of relative
+    @param enOrder      Order of the packets found
+    @param psuQuery     Packets found, free with vFreeIndexQuery()
+    @return             I106_OK if query made
+*/
+EnI106Status I106_CALL_DECL enIndexQuery(const int           iHandle,
+                                         const uint16_t      auChID[],
+                                         int                 iNumChID,
+                                         int64_t             llStartTime,
+                                         int64_t             llStopTime,
+                                         int                 bAbsTime,
+                                         EnI106QueryOrder    enOrder,
+                                         SuIndexQuery      * psuQuery);
+
+/** Read the header and data of the next packet found by a query
+    @param psuQuery     Query made with enIndexQuery()
+    @param psuHeader    Packet header
+    @param ulBuffSize   Size of the data buffer
+    @param pvBuff       Packet data buffer, NULL to only read the header
+    @return             I106_OK if packet read, I106_EOF after the last packet,
+                        I106_INVALID_DATA if the packet no longer matches the index.
+                        The bad packet is skipped and the query can go on.
+*/
+EnI106Status I106_CALL_DECL enIndexQueryReadNext(SuIndexQuery       * psuQuery,
+                                                 SuI106Ch10Header   * psuHeader,
+                                                 unsigned long        ulBuffSize,
+                                                 void               * pvBuff);
+
+/** Free the packets found by a query
+    @param psuQuery     Query made with enIndexQuery()
+*/
+void I106_CALL_DECL vFreeIndexQuery(SuIndexQuery * psuQuery);
+
+/** Start writing root and node index packets along with the data.  Every 
+    packet written after this to one of the selected channels gets a node index
+    entry.  Node index packets are written as entries build up and the final
+    root index packet is written by enStopIndexWrite() or on close.
+    @param iHandle      Handle of an IRIG file opened with I106_OVERWRITE or I106_APPEND
+    @param auChID       Channel IDs to index
+    @param iNumChID     Number of channel IDs, 0 to index all channels
+    @param uNodeEntries Node index entries per node index packet, 0 for the default
+    @return             I106_OK if index writing started
+*/
+EnI106Status I106_CALL_DECL enStartIndexWrite(const int        iHandle,
+                                              const uint16_t   auChID[],
+                                              int              iNumChID,
+                                              uint32_t         uNodeEntries);
+
+/** Write the remaining node index entries and the final root index packet.
+    @param iHandle      Handle of an IRIG file being written
+    @return             I106_OK if index packets written
+*/
+EnI106Status I106_CALL_DECL enStopIndexWrite(const int iHandle);
+
+/** Note a packet that was just written for the index packet writer.  If an
+    index packet write fails index writing stops as if enStopIndexWrite() had
+    been called.
+    @param iHandle      Handle of an IRIG file being written
+    @param psuHeader    Header of the packet written
+    @return             I106_OK if any index packet write went OK
+*/
+EnI106Status enIndexPacketWritten(int iHandle, SuI106Ch10Header * psuHeader);
+
+/** Start keeping the channel index tables current while the file is still
+    being recorded.  The tables are made first if they haven't been already.
+    @param iHandle      Handle of an IRIG file opened with I106_READ
+    @param iNumThreads  Number of threads to make the tables with, 0 to pick automatically
+    @param bAbsTime     Also keep absolute time for each packet.  If there is no
+                        time packet yet absolute times are filled in once there is.
+    @return             I106_OK if following started
+*/
+EnI106Status I106_CALL_DECL enStartIndexFollow(const int iHandle, int iNumThreads, int bAbsTime);
+
+/** Add packets written since the last call to the channel index tables.
+    Channel table pointers from enGetChanIndexes() must be gotten again after.
+    @param iHandle      Handle of an IRIG file being followed
+    @param iTimeoutMs   Time to wait for new data if there isn't any, 0 to not wait
+    @param puNewPackets Number of packets added, can be NULL
+    @return             I106_OK if tables are current
+*/
+EnI106Status I106_CALL_DECL enFollowIndex(const int iHandle, int iTimeoutMs, uint32_t * puNewPackets);
+
+/** Stop following the file.  The channel index tables are kept.
+    @param iHandle      Handle of an IRIG file being followed
+    @return             I106_OK if stopped
+*/
+EnI106Status I106_CALL_DECL enStopIndexFollow(const int iHandle);
+
 
 #ifdef __cplusplus
 } // end extern "C"
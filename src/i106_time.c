@@ -38,12 +38,21 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 //#include <time.h>
 
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
 #include "i106_stdint.h"
 #include "irig106ch10.h"
 #include "i106_time.h"
 #include "i106_decode_time.h"
+#include "i106_index.h"
 
 #ifdef __cplusplus
 namespace Irig106 {
@@ -54,25 +63,120 @@ namespace Irig106 {
  * ----------------------
  */
 
+// Time model fitting.  A time packet that is off from the current segment
+// line by more than the tolerance starts a new segment at the previous time
+// packet.  One that is off by more than the jump limit is a time source 
+// jump and starts a new segment at itself.
+#define TIME_MODEL_TOLERANCE    10000L          // 1 msec
+#define TIME_MODEL_JUMP         1000000L        // 100 msec
+
+#define TIME_MODEL_MAGIC        "I106TIM"
+#define TIME_MODEL_VERSION      2
+
+// Number of time packet searches remembered
+#define TIME_SYNC_CACHE_SIZE    16
+
+// Index entries a channel seek reads headers for before it goes to the 
+// channel time tables
+#define SEEK_CHAN_WALK          256
+
 
 /*
  * Data structures
  * ---------------
  */
 
+// Time model file header.  It is followed by the segments and then the 
+// epochs in native byte order.
+typedef struct
+    {
+    char            achMagic[8];
+    uint32_t        ulVersion;
+    uint32_t        ulHeaderSize;
+    int64_t         llSourceSize;       // Data file size
+    int64_t         llSourceTime;       // Data file modify time
+    uint64_t        ullSourceHash;      // Hash of data at each end of the file
+    uint32_t        ulNumSegments;
+    uint32_t        ulDateFmt;
+    uint32_t        ulTimeChanID;
+    uint32_t        ulNumEpochs;
+    } SuTimeModelFileHdr;
+
+// Range of rates that fit all the time points in the current time model
+// segment so far
+typedef struct
+    {
+    double          dRateMin;
+    double          dRateMax;
+    } SuTimeModelFit;
+
+// Remembered time packet search
+typedef struct
+    {
+    int             bValid;
+    uint64_t        ullNameHash;        // Hash of the data file name
+    int64_t         llFileSize;         // Data file size
+    int64_t         llFileTime;         // Data file modify time
+    int             bRequireSync;
+    int64_t         llSearchStart;      // Search started here
+    SuTimeSync      suTimeSync;         // and found this, llOffset = -1 if nothing
+    } SuTimeSyncCacheEntry;
+
 
 /*
  * Module data
  * -----------
  */
 
-static SuTimeRef    m_asuTimeRef[MAX_HANDLES]; // Relative / absolute time reference
+static SuTimeSyncCacheEntry m_asuTimeSyncCache[TIME_SYNC_CACHE_SIZE];
+static int                  m_iTimeSyncCacheNext = 0;
+
+// Lock for the time sync cache.  The critical section is set up on first use.
+#if defined(_WIN32)
+static CRITICAL_SECTION m_suTimeSyncLock;
+static volatile LONG    m_lTimeSyncLockInit  = 0;
+static volatile LONG    m_lTimeSyncLockReady = 0;
+static void vLockTimeSync(void);
+#define LOCK_TIME_SYNC()    vLockTimeSync()
+#define UNLOCK_TIME_SYNC()  LeaveCriticalSection(&m_suTimeSyncLock)
+#else
+static pthread_mutex_t  m_suTimeSyncLock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK_TIME_SYNC()    pthread_mutex_lock(&m_suTimeSyncLock)
+#define UNLOCK_TIME_SYNC()  pthread_mutex_unlock(&m_suTimeSyncLock)
+#endif
+
 
 /*
  * Function Declaration
  * --------------------
  */
 
+static SuTimeRef * psuGetTimeRef(int iI106Ch10Handle);
+static EnI106Status enTimeModelAddPoint(SuTimeModel * psuModel, SuTimeModelFit * psuFit, 
+                                        int64_t llOffset, int64_t llRelTime, int64_t llAbsTime);
+static void vTimeEpochRange(SuTimeModel * psuModel, int * piFirst, int * piEnd);
+static void vTimeModelSetHandleEpoch(int iI106Ch10Handle);
+static int  bTimeSegmentHasAbs(SuTimeModel * psuModel, int iSeg, int iEnd, int64_t llAbsTime);
+static EnI106Status enOpenTimeScan(int iI106Ch10Handle, int * piScanHandle);
+static EnI106Status enReadNextTimePacket(int iScanHandle, int iChanID, SuI106Ch10Header * psuI106Hdr,
+                                         void ** ppvBuff, unsigned long * pulBuffSize);
+static int  bDecodeTimePacket(SuI106Ch10Header * psuI106Hdr, void * pvBuff, 
+                              SuTimeF1_DecodeCache * psuCache, SuTimePacket * psuTimePacket);
+static EnI106Status enFindTimePacketIndex(int iI106Ch10Handle, int64_t llStartOffset, int bRequireSync, 
+                                          int64_t llTimeLimit, SuTimeSync * psuTimeSync, int * pbCacheable);
+static EnI106Status enFindTimePacketScan(int iI106Ch10Handle, int64_t llStartOffset, int bRequireSync, 
+                                         int64_t llTimeLimit, SuTimeSync * psuTimeSync, int * pbCacheable);
+static EnI106Status enReadTimeSync(int iI106Ch10Handle, int64_t llOffset, int bRequireSync,
+                                   int64_t llTimeLimit, SuTimeSync * psuTimeSync);
+static int  bTimeSyncCacheKey(int iI106Ch10Handle, int bRequireSync, SuTimeSyncCacheEntry * psuEntry);
+static int  bTimeSyncCacheFind(SuTimeSyncCacheEntry * psuEntry, int64_t llStartOffset);
+static void vTimeSyncCacheAdd(SuTimeSyncCacheEntry * psuEntry);
+static int  CompareOffsets(const void * pOffset1, const void * pOffset2);
+static int  iSeekChanWalk(int iHandle, int iChanID, int64_t llSeekTime, int iFrom, int iTo);
+static int  iSeekChanIndex(int iHandle, int iChanID, int64_t llSeekTime, int iFrom);
+static int  bReadTimeModel(int iI106Ch10Handle, const char * szModelFileName);
+static int  bWriteTimeModel(int iI106Ch10Handle, const char * szModelFileName);
+
 
 /* ----------------------------------------------------------------------- */
 
@@ -82,15 +186,20 @@ EnI106Status I106_CALL_DECL
                        SuIrig106Time  * psuTime,
                        uint8_t          abyRelTime[])
     {
+    SuTimeRef     * psuTimeRef;
+
+    psuTimeRef = psuGetTimeRef(iI106Ch10Handle);
+    if (psuTimeRef == NULL)
+        return I106_INVALID_HANDLE;
 
     // Save the absolute time value
-    m_asuTimeRef[iI106Ch10Handle].suIrigTime.ulSecs = psuTime->ulSecs;
-    m_asuTimeRef[iI106Ch10Handle].suIrigTime.ulFrac = psuTime->ulFrac;
-    m_asuTimeRef[iI106Ch10Handle].suIrigTime.enFmt  = psuTime->enFmt;
+    psuTimeRef->suIrigTime.ulSecs = psuTime->ulSecs;
+    psuTimeRef->suIrigTime.ulFrac = psuTime->ulFrac;
+    psuTimeRef->suIrigTime.enFmt  = psuTime->enFmt;
 
     // Save the relative (i.e. the 10MHz counter) value
-    m_asuTimeRef[iI106Ch10Handle].uRelTime          = 0;
-    memcpy((char *)&(m_asuTimeRef[iI106Ch10Handle].uRelTime), 
+    psuTimeRef->uRelTime          = 0;
+    memcpy((char *)&(psuTimeRef->uRelTime), 
            (char *)&abyRelTime[0], 6);
 
     return I106_OK;
@@ -163,15 +272,29 @@ EnI106Status I106_CALL_DECL
 
     int64_t         lSec;
     int64_t         lFrac;
+    SuTimeRef     * psuTimeRef;
+
+    psuTimeRef = psuGetTimeRef(iI106Ch10Handle);
+    if (psuTimeRef == NULL)
+        return I106_INVALID_HANDLE;
 
+    // Use the time model if there is one
+    if ((psuI106Handle(iI106Ch10Handle)->psuTimeModel               != NULL) &&
+        (psuI106Handle(iI106Ch10Handle)->psuTimeModel->iNumSegments >  0))
+        {
+        vTimeModelSetHandleEpoch(iI106Ch10Handle);
+        vAbsInt2IrigTime(llI106_TimeModelRel2Abs(psuI106Handle(iI106Ch10Handle)->psuTimeModel, llRelTime),
+                         psuI106Handle(iI106Ch10Handle)->psuTimeModel->enFmt, psuTime);
+        return I106_OK;
+        }
 
     // Figure out the relative time difference
-    uTimeDiff = llRelTime - m_asuTimeRef[iI106Ch10Handle].uRelTime;
+    uTimeDiff = llRelTime - psuTimeRef->uRelTime;
     lSecDiff  = uTimeDiff / 10000000;
     lFracDiff = uTimeDiff % 10000000;
 
-    lSec      = m_asuTimeRef[iI106Ch10Handle].suIrigTime.ulSecs + lSecDiff;
-    lFrac     = m_asuTimeRef[iI106Ch10Handle].suIrigTime.ulFrac + lFracDiff;
+    lSec      = psuTimeRef->suIrigTime.ulSecs + lSecDiff;
+    lFrac     = psuTimeRef->suIrigTime.ulFrac + lFracDiff;
 
     // This seems a bit extreme but it's defensive programming
     while (lFrac < 0)
@@ -189,7 +312,7 @@ EnI106Status I106_CALL_DECL
     // Now add the time difference to the last IRIG time reference
     psuTime->ulFrac = (unsigned long)lFrac;
     psuTime->ulSecs = (unsigned long)lSec;
-    psuTime->enFmt  = m_asuTimeRef[iI106Ch10Handle].suIrigTime.enFmt;
+    psuTime->enFmt  = psuTimeRef->suIrigTime.enFmt;
 
     return I106_OK;
     }
@@ -245,6 +368,125 @@ EnI106Status I106_CALL_DECL
 
 
 
+/* ----------------------------------------------------------------------- */
+
+// Convert a whole array of relative times at once.  Relative time and the 
+// 64 bit absolute time are both 100 nsec counts so the conversion is just
+// adding a constant, which compilers turn into SIMD code.
+
+EnI106Status I106_CALL_DECL 
+    enI106_RelInt2AbsTimeArray(int               iI106Ch10Handle,
+                               const int64_t     allRelTime[],
+                               int64_t           allAbsTime[],
+                               int               iCount)
+    {
+    SuTimeRef     * psuTimeRef;
+    SuTimeModel   * psuModel;
+    int             iIdx;
+
+    psuTimeRef = psuGetTimeRef(iI106Ch10Handle);
+    if (psuTimeRef == NULL)
+        return I106_INVALID_HANDLE;
+
+    // Use the time model if there is one
+    psuModel = psuI106Handle(iI106Ch10Handle)->psuTimeModel;
+    if ((psuModel != NULL) && (psuModel->iNumSegments > 0))
+        {
+        vTimeModelSetHandleEpoch(iI106Ch10Handle);
+        for (iIdx=0; iIdx<iCount; iIdx++)
+            allAbsTime[iIdx] = llI106_TimeModelRel2Abs(psuModel, allRelTime[iIdx]);
+        return I106_OK;
+        }
+
+    return enI106_RelInt2AbsTimeArray2(psuTimeRef, allRelTime, allAbsTime, iCount);
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+EnI106Status I106_CALL_DECL 
+    enI106_RelInt2AbsTimeArray2(SuTimeRef       * psuRelTimeRef,
+                                const int64_t     allRelTime[],
+                                int64_t           allAbsTime[],
+                                int               iCount)
+    {
+    int64_t         llOffset;
+    int             iIdx;
+
+    llOffset = (int64_t)psuRelTimeRef->suIrigTime.ulSecs * 10000000 + 
+               (int64_t)psuRelTimeRef->suIrigTime.ulFrac -
+               psuRelTimeRef->uRelTime;
+
+    for (iIdx=0; iIdx<iCount; iIdx++)
+        allAbsTime[iIdx] = allRelTime[iIdx] + llOffset;
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+EnI106Status I106_CALL_DECL 
+    enI106_Rel2AbsTimeArray2(SuTimeRef       * psuRelTimeRef,
+                             const uint8_t   * pabyRelTime,
+                             int               iStride,
+                             int64_t           allAbsTime[],
+                             int               iCount)
+    {
+    int64_t         llOffset;
+    int             iIdx;
+    const uint8_t * pabyTime;
+
+    llOffset = (int64_t)psuRelTimeRef->suIrigTime.ulSecs * 10000000 + 
+               (int64_t)psuRelTimeRef->suIrigTime.ulFrac -
+               psuRelTimeRef->uRelTime;
+
+    // Put the 6 bytes together by hand rather than memcpy() so that the 
+    // last value doesn't need to be followed by 2 more readable bytes
+    pabyTime = pabyRelTime;
+    for (iIdx=0; iIdx<iCount; iIdx++)
+        {
+        allAbsTime[iIdx] = ((int64_t)pabyTime[0]      ) | ((int64_t)pabyTime[1] <<  8) |
+                           ((int64_t)pabyTime[2] << 16) | ((int64_t)pabyTime[3] << 24) |
+                           ((int64_t)pabyTime[4] << 32) | ((int64_t)pabyTime[5] << 40);
+        allAbsTime[iIdx] += llOffset;
+        pabyTime += iStride;
+        }
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+void I106_CALL_DECL 
+    vAbsInt2IrigTime(int64_t           llAbsTime,
+                     EnI106DateFmt     enFmt,
+                     SuIrig106Time   * psuTime)
+    {
+    int64_t         llSecs;
+    int64_t         llFrac;
+
+    llSecs = llAbsTime / 10000000;
+    llFrac = llAbsTime % 10000000;
+    if (llFrac < 0)
+        {
+        llFrac += 10000000;
+        llSecs -= 1;
+        }
+
+    psuTime->ulSecs = (time_t)llSecs;
+    psuTime->ulFrac = (uint32_t)llFrac;
+    psuTime->enFmt  = enFmt;
+
+    return;
+    }
+
+
+
 /* ----------------------------------------------------------------------- */
 
 // Take a real clock time and turn it into a 6 byte relative time.
@@ -256,15 +498,32 @@ EnI106Status I106_CALL_DECL
     {
     int64_t         llDiff;
     int64_t         llNewRel;
+    SuTimeRef     * psuTimeRef;
 
-    // Calculate time difference (LSB = 100 nSec) between the passed time 
-    // and the time reference
-    llDiff = 
-         (int64_t)(+ psuTime->ulSecs - m_asuTimeRef[iI106Ch10Handle].suIrigTime.ulSecs) * 10000000 +
-         (int64_t)(+ psuTime->ulFrac - m_asuTimeRef[iI106Ch10Handle].suIrigTime.ulFrac);
+    psuTimeRef = psuGetTimeRef(iI106Ch10Handle);
+    if (psuTimeRef == NULL)
+        return I106_INVALID_HANDLE;
+
+    // Use the time model if there is one
+    if ((psuI106Handle(iI106Ch10Handle)->psuTimeModel               != NULL) &&
+        (psuI106Handle(iI106Ch10Handle)->psuTimeModel->iNumSegments >  0))
+        {
+        vTimeModelSetHandleEpoch(iI106Ch10Handle);
+        llNewRel = llI106_TimeModelAbs2Rel(psuI106Handle(iI106Ch10Handle)->psuTimeModel,
+                                           (int64_t)psuTime->ulSecs * 10000000 + psuTime->ulFrac);
+        }
 
-    // Add this amount to the reference 
-    llNewRel = m_asuTimeRef[iI106Ch10Handle].uRelTime + llDiff;
+    else
+        {
+        // Calculate time difference (LSB = 100 nSec) between the passed time 
+        // and the time reference
+        llDiff = 
+             (int64_t)(+ psuTime->ulSecs - psuTimeRef->suIrigTime.ulSecs) * 10000000 +
+             (int64_t)(+ psuTime->ulFrac - psuTimeRef->suIrigTime.ulFrac);
+
+        // Add this amount to the reference 
+        llNewRel = psuTimeRef->uRelTime + llDiff;
+        }
 
     // Now convert this to a 6 byte relative time
     memcpy((char *)&abyRelTime[0],
@@ -306,6 +565,226 @@ EnI106Status I106_CALL_DECL
 }
 
 
+
+/* ------------------------------------------------------------------------ */
+
+// Nanosecond time conversions
+
+int64_t I106_CALL_DECL 
+    llI106_IEEE15882NanoTime(const SuIEEE1588_Time * psuIEEE1588Time)
+    {
+    return (int64_t)psuIEEE1588Time->uSeconds * 1000000000 + (int64_t)psuIEEE1588Time->uNanoSeconds;
+    }
+
+
+
+int64_t I106_CALL_DECL 
+    llI106_ERTC2NanoTime(const SuERTC_Time * psuERTCTime)
+    {
+    return (int64_t)(((uint64_t)psuERTCTime->uMSLW << 32) | (uint64_t)psuERTCTime->uLSLW);
+    }
+
+
+
+// Ch 4 binary time is the time of year in 10 msec counts plus microseconds so
+// this is nanoseconds since the start of the year
+
+int64_t I106_CALL_DECL 
+    llI106_Ch4Binary2NanoTime(const SuI106Ch4_Binary_Time * psuCh4BinaryTime)
+    {
+    return (((int64_t)psuCh4BinaryTime->uHighBinTime << 16) | (int64_t)psuCh4BinaryTime->uLowBinTime) * 10000000 +
+           (int64_t)psuCh4BinaryTime->uUSecs * 1000;
+    }
+
+
+
+int64_t I106_CALL_DECL 
+    llI106_IrigTime2NanoTime(const SuIrig106Time * psuTime)
+    {
+    return (int64_t)psuTime->ulSecs * 1000000000 + (int64_t)psuTime->ulFrac * 100;
+    }
+
+
+
+void I106_CALL_DECL 
+    vI106_NanoTime2IrigTime(int64_t           llNanoTime,
+                            EnI106DateFmt     enFmt,
+                            SuIrig106Time   * psuTime)
+    {
+    int64_t         llSecs;
+    int64_t         llNanos;
+
+    llSecs  = llNanoTime / 1000000000;
+    llNanos = llNanoTime % 1000000000;
+    if (llNanos < 0)
+        {
+        llNanos += 1000000000;
+        llSecs  -= 1;
+        }
+
+    psuTime->ulSecs = (time_t)llSecs;
+    psuTime->ulFrac = (uint32_t)(llNanos / 100);
+    psuTime->enFmt  = enFmt;
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// ERTC counts nanoseconds and the 10 MHz relative time counter is the low 
+// 48 bits of ERTC / 100, so ERTC goes through the time reference the same 
+// way relative time does.  ERTC stamps are spaced iStride bytes apart.
+
+static EnI106NanoTimeType enERTC2NanoTimeArray(int               iI106Ch10Handle,
+                                               const uint8_t   * pabyERTC,
+                                               int               iStride,
+                                               int64_t           allNanoTime[],
+                                               int               iCount)
+    {
+    uint64_t            ullERTC;
+    int                 iIdx;
+
+    for (iIdx=0; iIdx<iCount; iIdx++)
+        {
+        ullERTC = (uint64_t)llI106_ERTC2NanoTime((const SuERTC_Time *)&pabyERTC[(size_t)iIdx * iStride]);
+        allNanoTime[iIdx] = (int64_t)((ullERTC / 100) & 0xFFFFFFFFFFFFULL);
+        }
+
+    if (enI106_RelInt2AbsTimeArray(iI106Ch10Handle, allNanoTime, allNanoTime, iCount) != I106_OK)
+        {
+        for (iIdx=0; iIdx<iCount; iIdx++)
+            allNanoTime[iIdx] = llI106_ERTC2NanoTime((const SuERTC_Time *)&pabyERTC[(size_t)iIdx * iStride]);
+        return I106_NANOTIME_ERTC;
+        }
+
+    // Put back the nanoseconds the relative time counter doesn't have
+    for (iIdx=0; iIdx<iCount; iIdx++)
+        {
+        ullERTC = (uint64_t)llI106_ERTC2NanoTime((const SuERTC_Time *)&pabyERTC[(size_t)iIdx * iStride]);
+        allNanoTime[iIdx] = allNanoTime[iIdx] * 100 + (int64_t)(ullERTC % 100);
+        }
+
+    return I106_NANOTIME_ABS;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Turn one absolute time stamp into nanoseconds based on the secondary 
+// header time format.
+
+static EnI106NanoTimeType enAbsTime2NanoTime(int iI106Ch10Handle, int iSecHdrTimeFmt, 
+                                             const void * pvTime, int64_t * pllNanoTime)
+    {
+
+    switch (iSecHdrTimeFmt)
+        {
+        case I106CH10_PFLAGS_TIMEFMT_IRIG106 :
+            *pllNanoTime = llI106_Ch4Binary2NanoTime((const SuI106Ch4_Binary_Time *)pvTime);
+            return I106_NANOTIME_TOY;
+        case I106CH10_PFLAGS_TIMEFMT_IEEE1588 :
+            *pllNanoTime = llI106_IEEE15882NanoTime((const SuIEEE1588_Time *)pvTime);
+            return I106_NANOTIME_ABS;
+        case I106CH10_PFLAGS_TIMEFMT_ERTC :
+            return enERTC2NanoTimeArray(iI106Ch10Handle, (const uint8_t *)pvTime, 0, pllNanoTime, 1);
+        default :
+            return I106_NANOTIME_NONE;
+        }
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+EnI106NanoTimeType I106_CALL_DECL 
+    enI106_PacketNanoTime(int                 iI106Ch10Handle,
+                          SuI106Ch10Header  * psuHeader,
+                          SuIntraPacketTS   * psuIntraPacketTS,
+                          int64_t           * pllNanoTime)
+    {
+    int                 iSecHdrTimeFmt;
+    int64_t             llRelTime;
+
+    iSecHdrTimeFmt = psuHeader->ubyPacketFlags & I106CH10_PFLAGS_TIMEFMT_MASK;
+
+    // Intra-packet time, absolute or relative
+    if (psuIntraPacketTS != NULL)
+        {
+        if ((psuHeader->ubyPacketFlags & I106CH10_PFLAGS_IPTIMESRC) != 0)
+            return enAbsTime2NanoTime(iI106Ch10Handle, iSecHdrTimeFmt, psuIntraPacketTS, pllNanoTime);
+        vTimeArray2LLInt(psuIntraPacketTS->aubyIntPktTime, &llRelTime);
+        }
+
+    // Packet time, secondary header if there is one
+    else
+        {
+        if ((psuHeader->ubyPacketFlags & I106CH10_PFLAGS_SEC_HEADER) != 0)
+            return enAbsTime2NanoTime(iI106Ch10Handle, iSecHdrTimeFmt, psuHeader->abyTime, pllNanoTime);
+        vTimeArray2LLInt(psuHeader->aubyRefTime, &llRelTime);
+        }
+
+    // Relative time counts are 100 nsec
+    if (enI106_RelInt2AbsTimeArray(iI106Ch10Handle, &llRelTime, pllNanoTime, 1) != I106_OK)
+        return I106_NANOTIME_NONE;
+    *pllNanoTime *= 100;
+
+    return I106_NANOTIME_ABS;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+EnI106NanoTimeType I106_CALL_DECL 
+    enI106_IntraPktNanoTimeArray(int                 iI106Ch10Handle,
+                                 SuI106Ch10Header  * psuHeader,
+                                 const uint8_t     * pabyIntPktTime,
+                                 int                 iStride,
+                                 int64_t             allNanoTime[],
+                                 int                 iCount)
+    {
+    int                 iIdx;
+
+    // Absolute time stamps
+    if ((psuHeader->ubyPacketFlags & I106CH10_PFLAGS_IPTIMESRC) != 0)
+        {
+        switch (psuHeader->ubyPacketFlags & I106CH10_PFLAGS_TIMEFMT_MASK)
+            {
+            case I106CH10_PFLAGS_TIMEFMT_IRIG106 :
+                for (iIdx=0; iIdx<iCount; iIdx++)
+                    allNanoTime[iIdx] = llI106_Ch4Binary2NanoTime(
+                        (const SuI106Ch4_Binary_Time *)&pabyIntPktTime[(size_t)iIdx * iStride]);
+                return I106_NANOTIME_TOY;
+            case I106CH10_PFLAGS_TIMEFMT_IEEE1588 :
+                for (iIdx=0; iIdx<iCount; iIdx++)
+                    allNanoTime[iIdx] = llI106_IEEE15882NanoTime(
+                        (const SuIEEE1588_Time *)&pabyIntPktTime[(size_t)iIdx * iStride]);
+                return I106_NANOTIME_ABS;
+            case I106CH10_PFLAGS_TIMEFMT_ERTC :
+                return enERTC2NanoTimeArray(iI106Ch10Handle, pabyIntPktTime, iStride, allNanoTime, iCount);
+            default :
+                return I106_NANOTIME_NONE;
+            }
+        }
+
+    // Relative time stamps, convert them all in one go
+    for (iIdx=0; iIdx<iCount; iIdx++)
+        {
+        allNanoTime[iIdx] = 0L;
+        memcpy(&allNanoTime[iIdx], &pabyIntPktTime[(size_t)iIdx * iStride], 6);
+        }
+    if (enI106_RelInt2AbsTimeArray(iI106Ch10Handle, allNanoTime, allNanoTime, iCount) != I106_OK)
+        return I106_NANOTIME_NONE;
+    for (iIdx=0; iIdx<iCount; iIdx++)
+        allNanoTime[iIdx] *= 100;
+
+    return I106_NANOTIME_ABS;
+    }
+
+
 /* ------------------------------------------------------------------------ */
 
 // Warning - array to int / int to array functions are little endian only!
@@ -347,181 +826,1595 @@ EnI106Status I106_CALL_DECL
                     int     iTimeLimit)     // Max time to look in seconds
     {
     int64_t             llCurrOffset;
-    int64_t             llTimeLimit;
-    int64_t             llCurrTime;
     EnI106Status        enStatus;
-    EnI106Status        enRetStatus;
-    SuI106Ch10Header    suI106Hdr;
-    SuIrig106Time       suTime;
-    unsigned long       ulBuffSize = 0;
-    void              * pvBuff = NULL;
-    SuTimeF1_ChanSpec * psuChanSpecTime = NULL;
+    SuTimeSync          suTimeSync;
+    uint8_t             abyRelTime[6];
 
-    // Get and save the current file position
+    // Get the current file position
     enStatus = enI106Ch10GetPos(iI106Ch10Handle, &llCurrOffset);
     if (enStatus != I106_OK)
         return enStatus;
 
-    // Set the file to the start
-    //enStatus = enI106Ch10SetPos(iI106Ch10Handle, 0);
-    //if (enStatus != I106_OK)
-    //    return enStatus;
+    enStatus = enI106_FindTimePacket(iI106Ch10Handle, llCurrOffset, bRequireSync, iTimeLimit, &suTimeSync);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    vLLInt2TimeArray(&suTimeSync.llRelTime, abyRelTime);
+    enI106_SetRelTime(iI106Ch10Handle, &suTimeSync.suIrigTime, abyRelTime);
 
-    // Read the next header
-    enStatus = enI106Ch10ReadNextHeaderFile(iI106Ch10Handle, &suI106Hdr);
-    if (enStatus == I106_EOF)
-        return I106_TIME_NOT_FOUND;
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+EnI106Status I106_CALL_DECL 
+    enI106_FindTimePacket(int            iI106Ch10Handle,
+                          int64_t        llStartOffset,
+                          int            bRequireSync,
+                          int            iTimeLimit,
+                          SuTimeSync   * psuTimeSync)
+    {
+    int64_t             llCurrOffset;
+    int64_t             llTimeLimit = 0;
+    int                 bCacheable  = bFALSE;
+    int                 bHaveKey;
+    EnI106Status        enStatus;
+    EnI106Status        enRetStatus;
+    SuI106Ch10Header    suI106Hdr;
+    SuTimeSyncCacheEntry suCacheEntry;
 
+    // Get and save the current file position
+    enStatus = enI106Ch10GetPos(iI106Ch10Handle, &llCurrOffset);
     if (enStatus != I106_OK)
         return enStatus;
 
-    // Calculate the time limit if there is one
+    // Calculate the time limit from the first header if there is one
     if (iTimeLimit > 0)
         {
+        enStatus = enI106Ch10SetPos(iI106Ch10Handle, llStartOffset);
+        if (enStatus == I106_OK)
+            enStatus = enI106Ch10ReadNextHeaderFile(iI106Ch10Handle, &suI106Hdr);
+        if (enStatus != I106_OK)
+            {
+            enI106Ch10SetPos(iI106Ch10Handle, llCurrOffset);
+            return enStatus == I106_EOF ? I106_TIME_NOT_FOUND : enStatus;
+            }
         vTimeArray2LLInt(suI106Hdr.aubyRefTime, &llTimeLimit);
         llTimeLimit = llTimeLimit + (int64_t)iTimeLimit * (int64_t)10000000;
         }
-    else
-        llTimeLimit = 0;
 
-    // Loop, looking for appropriate time message
-    while (bTRUE)
+    // See if this has been looked for before
+    bHaveKey = bTimeSyncCacheKey(iI106Ch10Handle, bRequireSync, &suCacheEntry);
+    if (bHaveKey && bTimeSyncCacheFind(&suCacheEntry, llStartOffset))
         {
-
-        // See if we've passed our time limit
-        if (llTimeLimit > 0)
-            {
-            vTimeArray2LLInt(suI106Hdr.aubyRefTime, &llCurrTime);
-            if (llTimeLimit < llCurrTime)
-                {
-                enRetStatus = I106_TIME_NOT_FOUND;
-                break;
-                }
-            } // end if there is a time limit
-
-        // If IRIG time type then process it
-        if (suI106Hdr.ubyDataType == I106CH10_DTYPE_IRIG_TIME)
-            {
-
-            // Read header OK, make buffer for time message
-            if (ulBuffSize < suI106Hdr.ulPacketLen)
-                {
-                pvBuff          = realloc(pvBuff, suI106Hdr.ulPacketLen);
-                psuChanSpecTime = (SuTimeF1_ChanSpec *)pvBuff;
-                ulBuffSize      = suI106Hdr.ulPacketLen;
-                }
-
-            // Read the data buffer
-            enStatus = enI106Ch10ReadData(iI106Ch10Handle, ulBuffSize, pvBuff);
-            if (enStatus != I106_OK)
-                {
-                enRetStatus = I106_TIME_NOT_FOUND;
-                break;
-                }
-
-            // If external sync OK then decode it and set relative time
-            if ((bRequireSync == bFALSE) || (psuChanSpecTime->uTimeSrc == 1))
-                {
-                enI106_Decode_TimeF1(&suI106Hdr, pvBuff, &suTime);
-                enI106_SetRelTime(iI106Ch10Handle, &suTime, suI106Hdr.aubyRefTime);
-                enRetStatus = I106_OK;
-                break;
-                }
-            } // end if IRIG time message
-
-        // Read the next header and try again
-        enStatus = enI106Ch10ReadNextHeaderFile(iI106Ch10Handle, &suI106Hdr);
-        if (enStatus == I106_EOF)
-            {
+        if ((suCacheEntry.suTimeSync.llOffset == -1) ||
+            ((llTimeLimit > 0) && (llTimeLimit < suCacheEntry.suTimeSync.llRelTime)))
             enRetStatus = I106_TIME_NOT_FOUND;
-            break;
+        else
+            {
+            *psuTimeSync = suCacheEntry.suTimeSync;
+            enRetStatus  = I106_OK;
             }
+        }
 
-        if (enStatus != I106_OK)
+    // Use the file index if it has time packets, otherwise read through the
+    // file.  Whatever is found is good for any later search starting 
+    // between here and there, unless the search stopped at the time limit.
+    else
+        {
+        enRetStatus = enFindTimePacketIndex(iI106Ch10Handle, llStartOffset, bRequireSync, llTimeLimit, 
+                                            psuTimeSync, &bCacheable);
+        if (enRetStatus == I106_NO_INDEX)
+            enRetStatus = enFindTimePacketScan(iI106Ch10Handle, llStartOffset, bRequireSync, llTimeLimit, 
+                                               psuTimeSync, &bCacheable);
+
+        if (bHaveKey && bCacheable)
             {
-            enRetStatus = enStatus;
-            break;
+            suCacheEntry.llSearchStart = llStartOffset;
+            if (enRetStatus == I106_OK)
+                suCacheEntry.suTimeSync = *psuTimeSync;
+            else
+                suCacheEntry.suTimeSync.llOffset = -1;
+            vTimeSyncCacheAdd(&suCacheEntry);
             }
-
-        } // end while looping looking for time message
+        }
 
     // Restore file position
     enStatus = enI106Ch10SetPos(iI106Ch10Handle, llCurrOffset);
     if (enStatus != I106_OK)
-        {
         enRetStatus = enStatus;
-        }
-
-    // Return the malloc'ed memory
-    free(pvBuff);
 
     return enRetStatus;
     }
 
 
-/* ----------------------------------------------------------------------- */
 
-EnI106Status I106_CALL_DECL 
-    enI106Ch10SetPosToIrigTime(int iHandle, SuIrig106Time * psuSeekTime)
-    {
+/* ------------------------------------------------------------------------ */
+
+// Find the first time packet after the start offset in the file index.  
+// The index is in time order so look for the smallest time packet offset
+// past the start, read it, and try the next one if it isn't synced.  
+// Returns I106_NO_INDEX if the index doesn't have time packets.
+
+static EnI106Status enFindTimePacketIndex(int iI106Ch10Handle, int64_t llStartOffset, int bRequireSync, 
+                                          int64_t llTimeLimit, SuTimeSync * psuTimeSync, int * pbCacheable)
+    {
+    int                 bFoundTime = bFALSE;
+    int                 bTimeChan  = bFALSE;
+    int64_t           * allOffset;
+    uint32_t            uNumOffsets;
+    uint32_t            uIdx;
+    uint32_t            uIndexLen;
+    int                 iChanIdx;
+    SuPacketIndexInfo * asuIndex;
+    SuInOrderIndex    * psuInOrderIndex;
+    EnI106Status        enStatus;
+
+    *pbCacheable = bFALSE;
+
+    // A channel summary with no time channels means no time packets, no 
+    // need to go looking
+    psuInOrderIndex = &psuI106Handle(iI106Ch10Handle)->suInOrderIndex;
+    if (psuInOrderIndex->iNumChans > 0)
+        {
+        for (iChanIdx=0; iChanIdx<psuInOrderIndex->iNumChans; iChanIdx++)
+            if (psuInOrderIndex->asuChanInfo[iChanIdx].ubyDataType == I106CH10_DTYPE_IRIG_TIME)
+                bTimeChan = bTRUE;
+        if (bTimeChan == bFALSE)
+            {
+            *pbCacheable = bTRUE;
+            return I106_TIME_NOT_FOUND;
+            }
+        }
+
+    if (enGetIndexArray(iI106Ch10Handle, &asuIndex, &uIndexLen) != I106_OK)
+        return I106_NO_INDEX;
+
+    // Pull out the time packets from the start offset on, in file order
+    allOffset = (int64_t *)malloc((uIndexLen + 1) * sizeof(int64_t));
+    if (allOffset == NULL)
+        return I106_NO_MEMORY;
+
+    uNumOffsets = 0;
+    for (uIdx=0; uIdx<uIndexLen; uIdx++)
+        {
+        if (asuIndex[uIdx].ubyDataType != I106CH10_DTYPE_IRIG_TIME)
+            continue;
+        bFoundTime = bTRUE;
+        if (asuIndex[uIdx].lFileOffset >= llStartOffset)
+            allOffset[uNumOffsets++] = asuIndex[uIdx].lFileOffset;
+        }
+
+    if (bFoundTime == bFALSE)
+        {
+        free(allOffset);
+        return I106_NO_INDEX;
+        }
+
+    qsort(allOffset, uNumOffsets, sizeof(int64_t), &CompareOffsets);
+
+    // Try each one until one has a good time
+    enStatus = I106_TIME_NOT_FOUND;
+    for (uIdx=0; uIdx<uNumOffsets; uIdx++)
+        {
+        enStatus = enReadTimeSync(iI106Ch10Handle, allOffset[uIdx], bRequireSync, llTimeLimit, psuTimeSync);
+        if (enStatus != I106_TIME_NOT_FOUND)
+            break;
+        if ((llTimeLimit > 0) && (llTimeLimit < psuTimeSync->llRelTime))
+            {
+            free(allOffset);
+            return I106_TIME_NOT_FOUND;
+            }
+        }
+
+    free(allOffset);
+
+    if ((enStatus == I106_OK) || (enStatus == I106_TIME_NOT_FOUND))
+        *pbCacheable = bTRUE;
+
+    return enStatus;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+static int CompareOffsets(const void * pOffset1, const void * pOffset2)
+    {
+    if (*(int64_t *)pOffset1 > *(int64_t *)pOffset2)
+        return 1;
+
+    if (*(int64_t *)pOffset1 < *(int64_t *)pOffset2)
+        return -1;
+
+    return 0;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Read headers from the start offset until a time packet turns up.
+
+static EnI106Status enFindTimePacketScan(int iI106Ch10Handle, int64_t llStartOffset, int bRequireSync, 
+                                         int64_t llTimeLimit, SuTimeSync * psuTimeSync, int * pbCacheable)
+    {
+    int64_t             llCurrTime;
+    int64_t             llOffset;
+    EnI106Status        enStatus;
+    SuI106Ch10Header    suI106Hdr;
+
+    *pbCacheable = bFALSE;
+
+    enStatus = enI106Ch10SetPos(iI106Ch10Handle, llStartOffset);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    // Loop, looking for appropriate time message
+    while (bTRUE)
+        {
+        enStatus = enI106Ch10ReadNextHeaderFile(iI106Ch10Handle, &suI106Hdr);
+        if (enStatus == I106_EOF)
+            {
+            *pbCacheable = bTRUE;
+            return I106_TIME_NOT_FOUND;
+            }
+        if (enStatus == I106_HEADER_CHKSUM_BAD)
+            continue;
+        if (enStatus != I106_OK)
+            return enStatus;
+
+        // See if we've passed our time limit
+        if (llTimeLimit > 0)
+            {
+            vTimeArray2LLInt(suI106Hdr.aubyRefTime, &llCurrTime);
+            if (llTimeLimit < llCurrTime)
+                return I106_TIME_NOT_FOUND;
+            } // end if there is a time limit
+
+        if (suI106Hdr.ubyDataType != I106CH10_DTYPE_IRIG_TIME)
+            continue;
+
+        // Go back to the start of the header and read the whole time packet
+        enI106Ch10GetPos(iI106Ch10Handle, &llOffset);
+        llOffset -= (suI106Hdr.ubyPacketFlags & I106CH10_PFLAGS_SEC_HEADER) ? HEADER_SIZE + SEC_HEADER_SIZE : HEADER_SIZE;
+        enStatus = enReadTimeSync(iI106Ch10Handle, llOffset, bRequireSync, 0, psuTimeSync);
+        if (enStatus == I106_OK)
+            {
+            *pbCacheable = bTRUE;
+            return I106_OK;
+            }
+        if (enStatus != I106_TIME_NOT_FOUND)
+            return enStatus;
+        } // end while looping looking for time message
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Read and decode the time packet at an offset.  Returns I106_TIME_NOT_FOUND
+// if it isn't a synced time packet inside the time limit.  The read 
+// position is left after the packet.
+
+static EnI106Status enReadTimeSync(int iI106Ch10Handle, int64_t llOffset, int bRequireSync,
+                                   int64_t llTimeLimit, SuTimeSync * psuTimeSync)
+    {
+    EnI106Status        enStatus;
+    SuI106Ch10Header    suI106Hdr;
+    unsigned long       ulBuffSize;
+    void              * pvBuff;
+    SuTimeF1_ChanSpec * psuChanSpecTime;
+
+    enStatus = enI106Ch10SetPos(iI106Ch10Handle, llOffset);
+    if (enStatus == I106_OK)
+        enStatus = enI106Ch10ReadNextHeaderFile(iI106Ch10Handle, &suI106Hdr);
+    if (enStatus == I106_EOF)
+        return I106_TIME_NOT_FOUND;
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    vTimeArray2LLInt(suI106Hdr.aubyRefTime, &psuTimeSync->llRelTime);
+    if ((suI106Hdr.ubyDataType != I106CH10_DTYPE_IRIG_TIME) ||
+        ((llTimeLimit > 0) && (llTimeLimit < psuTimeSync->llRelTime)))
+        return I106_TIME_NOT_FOUND;
+
+    // Time packets are small, get the whole thing
+    ulBuffSize = suI106Hdr.ulPacketLen;
+    pvBuff     = malloc(ulBuffSize);
+    if (pvBuff == NULL)
+        return I106_NO_MEMORY;
+    enStatus = enI106Ch10ReadData(iI106Ch10Handle, ulBuffSize, pvBuff);
+    psuChanSpecTime = (SuTimeF1_ChanSpec *)pvBuff;
+
+    // If external sync OK then decode it
+    if ((enStatus == I106_OK) && 
+        ((bRequireSync == bFALSE) || (psuChanSpecTime->uTimeSrc == 1)))
+        {
+        enI106_Decode_TimeF1(&suI106Hdr, pvBuff, &psuTimeSync->suIrigTime);
+        psuTimeSync->llOffset = llOffset;
+        psuTimeSync->uChID    = suI106Hdr.uChID;
+        memcpy(&psuTimeSync->ulChanSpec, pvBuff, sizeof(psuTimeSync->ulChanSpec));
+        }
+    else if ((enStatus == I106_OK) || (enStatus == I106_EOF))
+        enStatus = I106_TIME_NOT_FOUND;
+
+    free(pvBuff);
+
+    return enStatus;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Time sync cache.  Entries are for a file (name, size, and modify time) and
+// sync requirement, and say the first time packet after llSearchStart is 
+// the one in suTimeSync, or there is none if its offset is -1.
+
+static int bTimeSyncCacheKey(int iI106Ch10Handle, int bRequireSync, SuTimeSyncCacheEntry * psuEntry)
+    {
+    const unsigned char   * pchName;
+#if defined(_WIN32)
+    struct _stati64         suStatBuff;
+#else
+    struct stat             suStatBuff;
+#endif
+
+#if defined(_WIN32)
+    if (_stati64(psuI106Handle(iI106Ch10Handle)->szFileName, &suStatBuff) != 0)
+        return bFALSE;
+#else
+    if (stat(psuI106Handle(iI106Ch10Handle)->szFileName, &suStatBuff) != 0)
+        return bFALSE;
+#endif
+
+    // FNV-1a hash of the file name
+    psuEntry->ullNameHash = 0xcbf29ce484222325ULL;
+    for (pchName = (const unsigned char *)psuI106Handle(iI106Ch10Handle)->szFileName; *pchName != '\0'; pchName++)
+        psuEntry->ullNameHash = (psuEntry->ullNameHash ^ *pchName) * 0x100000001b3ULL;
+
+    psuEntry->llFileSize   = suStatBuff.st_size;
+    psuEntry->llFileTime   = suStatBuff.st_mtime;
+    psuEntry->bRequireSync = bRequireSync ? bTRUE : bFALSE;
+    psuEntry->bValid       = bTRUE;
+
+    return bTRUE;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+#if defined(_WIN32)
+static void vLockTimeSync(void)
+    {
+    if (m_lTimeSyncLockReady == 0)
+        {
+        if (InterlockedIncrement((LONG *)&m_lTimeSyncLockInit) == 1)
+            {
+            InitializeCriticalSection(&m_suTimeSyncLock);
+            InterlockedExchange((LONG *)&m_lTimeSyncLockReady, 1);
+            }
+        else
+            {
+            while (m_lTimeSyncLockReady == 0)
+                Sleep(0);
+            }
+        }
+
+    EnterCriticalSection(&m_suTimeSyncLock);
+    }
+#endif
+
+
+
+/* ------------------------------------------------------------------------ */
+
+static int bTimeSyncCacheFind(SuTimeSyncCacheEntry * psuEntry, int64_t llStartOffset)
+    {
+    int                     iIdx;
+    int                     bFound = bFALSE;
+    SuTimeSyncCacheEntry  * psuCached;
+
+    LOCK_TIME_SYNC();
+    for (iIdx=0; iIdx<TIME_SYNC_CACHE_SIZE; iIdx++)
+        {
+        psuCached = &m_asuTimeSyncCache[iIdx];
+        if ((psuCached->bValid       == bTRUE)                  &&
+            (psuCached->ullNameHash  == psuEntry->ullNameHash)  &&
+            (psuCached->llFileSize   == psuEntry->llFileSize)   &&
+            (psuCached->llFileTime   == psuEntry->llFileTime)   &&
+            (psuCached->bRequireSync == psuEntry->bRequireSync) &&
+            (psuCached->llSearchStart <= llStartOffset)         &&
+            ((psuCached->suTimeSync.llOffset == -1) || 
+             (psuCached->suTimeSync.llOffset >= llStartOffset)))
+            {
+            *psuEntry = *psuCached;
+            bFound    = bTRUE;
+            break;
+            }
+        }
+    UNLOCK_TIME_SYNC();
+
+    return bFound;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+static void vTimeSyncCacheAdd(SuTimeSyncCacheEntry * psuEntry)
+    {
+
+    LOCK_TIME_SYNC();
+    m_asuTimeSyncCache[m_iTimeSyncCacheNext] = *psuEntry;
+    m_iTimeSyncCacheNext = (m_iTimeSyncCacheNext + 1) % TIME_SYNC_CACHE_SIZE;
+    UNLOCK_TIME_SYNC();
+
+    return;
+    }
+
+
+/* ----------------------------------------------------------------------- */
+
+EnI106Status I106_CALL_DECL 
+    enI106Ch10SetPosToIrigTime(int iHandle, SuIrig106Time * psuSeekTime)
+    {
+    return enI106Ch10SetPosToIrigTimeChan(iHandle, psuSeekTime, -1);
+    }
+
+
+/* ----------------------------------------------------------------------- */
+
+EnI106Status I106_CALL_DECL 
+    enI106Ch10SetPosToIrigTimeChan(int              iHandle, 
+                                   SuIrig106Time  * psuSeekTime,
+                                   int              iChanID)
+    {
     uint8_t             abySeekTime[6];
     int64_t             llSeekTime;
-    SuInOrderIndex    * psuIndex = &g_suI106Handle[iHandle].suInOrderIndex;
-    int                 iUpperLimit;
-    int                 iLowerLimit;
-    int                 iSearchLoopIdx;
+    EnI106Status        enStatus;
+
+    // Convert clock time to 10 MHz count
+    enStatus = enI106_Irig2RelTime(iHandle, psuSeekTime, abySeekTime);
+    if (enStatus != I106_OK)
+        return enStatus;
+    vTimeArray2LLInt(abySeekTime, &llSeekTime);
+
+    return enI106Ch10SetPosToRelTime(iHandle, llSeekTime, iChanID);
+    }
+
+
+/* ----------------------------------------------------------------------- */
+
+// The index is sorted by time except for the TMATS and time packets at the 
+// start.  Time in a recording goes up nearly linearly so an interpolation
+// search usually finds the spot in a few steps.  If a step doesn't at least
+// halve the search range the next step is a plain binary search step, so it
+// never takes more than about twice as many steps as a binary search.
+
+EnI106Status I106_CALL_DECL 
+    enI106Ch10SetPosToRelTime(int       iHandle, 
+                              int64_t   llSeekTime,
+                              int       iChanID)
+    {
+    SuInOrderIndex    * psuIndex;
+    SuInOrderPacketInfo * asuIndex;
+    EnI106Status        enStatus;
+    int                 iFirst;         // First sorted entry
+    int                 iLower;
+    int                 iUpper;
+    int                 iProbe;
+    int                 iFound;
+    int                 iOldRange;
+    int                 bInterpolate;
+    int                 iWalkEnd;
+    int                 iChanIdx;
+    int                 bChanFound;
+
+    // Check for a valid handle
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        return I106_INVALID_HANDLE;
+
+    // Channel IDs are 16 bits, -1 is any channel
+    if ((iChanID < -1) || (iChanID > 0xFFFF))
+        return I106_INVALID_PARAMETER;
+
+    psuIndex = &psuI106Handle(iHandle)->suInOrderIndex;
+
+    // If there is no index in memory then barf
+    if ((psuIndex->enSortStatus != enSorted) || (psuIndex->iArrayUsed == 0))
+        return I106_NO_INDEX;
+
+    asuIndex = psuIndex->asuIndex;
+    iFirst   = psuIndex->iArrayUsed > 2 ? 2 : 0;
+    iUpper   = psuIndex->iArrayUsed - 1;
+
+    // Check time bounds
+    if (asuIndex[iUpper].llTime < llSeekTime)
+        iFound = psuIndex->iArrayUsed;
+
+    // Before the start means start at the beginning of the file
+    else if (llSeekTime <= asuIndex[iFirst].llTime)
+        iFound = 0;
+
+    // Find the first entry at or after the seek time.  The search keeps
+    // time[iLower] < seek time <= time[iUpper].
+    else
+        {
+        iLower       = iFirst;
+        bInterpolate = bTRUE;
+        while (iUpper - iLower > 1)
+            {
+            if (bInterpolate)
+                iProbe = iLower + (int)((double)(llSeekTime - asuIndex[iLower].llTime) * 
+                                        (double)(iUpper - iLower) / 
+                                        (double)(asuIndex[iUpper].llTime - asuIndex[iLower].llTime));
+            else
+                iProbe = iLower + (iUpper - iLower) / 2;
+            if (iProbe <= iLower)
+                iProbe = iLower + 1;
+            if (iProbe >= iUpper)
+                iProbe = iUpper - 1;
+
+            iOldRange = iUpper - iLower;
+            if (asuIndex[iProbe].llTime < llSeekTime)
+                iLower = iProbe;
+            else
+                iUpper = iProbe;
+            bInterpolate = (iUpper - iLower) <= iOldRange / 2;
+            } // end while searching
+        iFound = iUpper;
+        }
+
+    // Look for the channel.  The channel summary says whether it's worth 
+    // looking.  Then read headers a short way along the index since most 
+    // channels have a packet close by.  If that doesn't find one, or the 
+    // channel is too sparse to bother, use the channel time tables.
+    if ((iChanID >= 0) && (iFound < psuIndex->iArrayUsed))
+        {
+        iWalkEnd = iFound + SEEK_CHAN_WALK;
+        if (psuIndex->asuChanInfo != NULL)
+            {
+            bChanFound = bFALSE;
+            for (iChanIdx=0; iChanIdx<psuIndex->iNumChans; iChanIdx++)
+                {
+                if ((psuIndex->asuChanInfo[iChanIdx].uChID      == iChanID) &&
+                    (psuIndex->asuChanInfo[iChanIdx].llLastTime >= llSeekTime))
+                    {
+                    bChanFound = bTRUE;
+                    if ((uint32_t)psuIndex->iArrayUsed / SEEK_CHAN_WALK >= psuIndex->asuChanInfo[iChanIdx].ulPacketCount)
+                        iWalkEnd = iFound;
+                    }
+                }
+            if (bChanFound == bFALSE)
+                iFound = psuIndex->iArrayUsed;
+            }
+
+        if (iFound < psuIndex->iArrayUsed)
+            {
+            if (iWalkEnd > psuIndex->iArrayUsed)
+                iWalkEnd = psuIndex->iArrayUsed;
+            iFound = iSeekChanWalk(iHandle, iChanID, llSeekTime, iFound, iWalkEnd);
+            if (iFound == iWalkEnd)
+                iFound = iSeekChanIndex(iHandle, iChanID, llSeekTime, iFound);
+            }
+        } // end if looking for a channel
+
+    // Not found so leave things at the last packet
+    if (iFound >= psuIndex->iArrayUsed)
+        {
+        enI106Ch10LastMsg(iHandle);
+        return I106_TIME_NOT_FOUND;
+        }
+
+    // Position to the packet found
+    psuIndex->iArrayCurr = iFound;
+    enStatus = enI106Ch10SetPos(iHandle, asuIndex[iFound].llOffset);
+
+    return enStatus;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Step through the index from iFrom reading headers until a packet from the
+// channel turns up.  Returns iTo if there isn't one before it.  The packets
+// ahead of the sorted part of the index also have to be late enough.
+
+static int iSeekChanWalk(int iHandle, int iChanID, int64_t llSeekTime, int iFrom, int iTo)
+    {
+    SuInOrderIndex    * psuIndex = &psuI106Handle(iHandle)->suInOrderIndex;
+    SuI106Ch10Header    suHeader;
+    EnI106Status        enStatus;
+    int                 iFirst;
+
+    iFirst = psuIndex->iArrayUsed > 2 ? 2 : 0;
+
+    while (iFrom < iTo)
+        {
+        enI106Ch10SetPos(iHandle, psuIndex->asuIndex[iFrom].llOffset);
+        enStatus = enI106Ch10ReadNextHeaderFile(iHandle, &suHeader);
+        if ((enStatus == I106_OK) && (suHeader.uChID == iChanID) &&
+            ((iFrom >= iFirst) || (psuIndex->asuIndex[iFrom].llTime >= llSeekTime)))
+            break;
+        iFrom++;
+        }
+
+    return iFrom;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Find the first packet from a channel at or after the seek time with the 
+// channel time tables.  Then find that packet in the index by its time and
+// offset.  If the tables haven't been made or don't match the index, go on
+// reading headers from iFrom.
+
+static int iSeekChanIndex(int iHandle, int iChanID, int64_t llSeekTime, int iFrom)
+    {
+    SuInOrderIndex    * psuIndex = &psuI106Handle(iHandle)->suInOrderIndex;
+    SuInOrderPacketInfo * asuIndex = psuIndex->asuIndex;
+    SuChanIndex       * psuChan;
+    EnI106Status        enStatus;
+    uint32_t            uEntry;
+    int64_t             llTime;
+    int64_t             llOffset;
+    int                 iFirst;
+    int                 iLower;
+    int                 iUpper;
+    int                 iProbe;
+
+    iFirst = psuIndex->iArrayUsed > 2 ? 2 : 0;
+
+    enStatus = enGetChanIndex(iHandle, (uint16_t)iChanID, &psuChan);
+    if (enStatus == I106_OK)
+        {
+        uEntry = uChanIndexFindTime(psuChan, llSeekTime);
+        if (uEntry >= psuChan->uCount)
+            return psuIndex->iArrayUsed;
+        llTime   = psuChan->allRelTime[uEntry];
+        llOffset = psuChan->allOffset[uEntry];
+
+        // The packets ahead of the sorted part
+        for (iProbe=0; iProbe<iFirst; iProbe++)
+            if (asuIndex[iProbe].llOffset == llOffset)
+                return iProbe;
+
+        // First entry at the packet time, then the one at its offset
+        iLower = iFirst;
+        iUpper = psuIndex->iArrayUsed;
+        while (iLower < iUpper)
+            {
+            iProbe = iLower + (iUpper - iLower) / 2;
+            if (asuIndex[iProbe].llTime < llTime)
+                iLower = iProbe + 1;
+            else
+                iUpper = iProbe;
+            }
+        for (iProbe=iLower; (iProbe < psuIndex->iArrayUsed) && (asuIndex[iProbe].llTime == llTime); iProbe++)
+            if (asuIndex[iProbe].llOffset == llOffset)
+                return iProbe;
+        } // end if there is a channel table
+
+    return iSeekChanWalk(iHandle, iChanID, llSeekTime, iFrom, psuIndex->iArrayUsed);
+    }
+
+
+/* ----------------------------------------------------------------------- */
+
+// Make a time model in one pass through the file.  This uses its own handle
+// so the read position of the caller's handle isn't disturbed.  Only time 
+// packets from the first time channel found are used, otherwise two time
+// sources that don't quite agree would look like a string of time jumps.
+
+EnI106Status I106_CALL_DECL 
+    enI106_MakeTimeModel(int     iI106Ch10Handle,
+                         int     bRequireSync)
+    {
+    int                     iScanHandle;
+    int                     iTimeChanID = -1;
+    EnI106Status            enStatus;
+    EnI106Status            enRetStatus = I106_OK;
+    SuI106Ch10Header        suI106Hdr;
+    SuTimePacket            suTimePacket;
+    SuTimeF1_DecodeCache    suCache;
+    SuTimeModel           * psuModel;
+    SuTimeModelFit          suFit;
+    int64_t                 llOffset;
+    unsigned long           ulBuffSize = 0;
+    void                  * pvBuff = NULL;
+
+    enStatus = enOpenTimeScan(iI106Ch10Handle, &iScanHandle);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    psuModel = (SuTimeModel *)calloc(1, sizeof(SuTimeModel));
+    if (psuModel == NULL)
+        {
+        enI106Ch10Close(iScanHandle);
+        return I106_NO_MEMORY;
+        }
+
+    // Read and decode every time packet
+    suCache.bValid = bFALSE;
+    suFit.dRateMin = 0.0;
+    suFit.dRateMax = 2.0;
+    while (bTRUE)
+        {
+        enStatus = enReadNextTimePacket(iScanHandle, iTimeChanID, &suI106Hdr, &pvBuff, &ulBuffSize);
+        if (enStatus == I106_EOF)
+            break;
+        if (enStatus != I106_OK)
+            {
+            enRetStatus = enStatus;
+            break;
+            }
+
+        if (bDecodeTimePacket(&suI106Hdr, pvBuff, &suCache, &suTimePacket) == bFALSE)
+            continue;
+        if (bRequireSync && (suTimePacket.ubyDataType == I106CH10_DTYPE_IRIG_TIME) && 
+                            (suTimePacket.ubyTimeSrc  != 1))
+            continue;
+
+        // The first time packet picks the channel and date format
+        if (iTimeChanID == -1)
+            {
+            psuModel->uTimeChanID = suTimePacket.uChID;
+            psuModel->enFmt       = suTimePacket.enFmt;
+            iTimeChanID           = suTimePacket.uChID;
+            }
+        else if (suTimePacket.enFmt != psuModel->enFmt)
+            continue;
+
+        // The time packet was just read so it starts a packet length back
+        enStatus = enI106Ch10GetPos(iScanHandle, &llOffset);
+        if (enStatus == I106_OK)
+            enStatus = enTimeModelAddPoint(psuModel, &suFit, llOffset - suI106Hdr.ulPacketLen,
+                                           suTimePacket.llRelTime, suTimePacket.llAbsTime);
+        if (enStatus != I106_OK)
+            {
+            enRetStatus = enStatus;
+            break;
+            }
+        } // end while reading time packets
+
+    free(pvBuff);
+    enI106Ch10Close(iScanHandle);
+
+    if ((enRetStatus == I106_OK) && (psuModel->iNumSegments == 0))
+        enRetStatus = I106_TIME_NOT_FOUND;
+
+    if (enRetStatus != I106_OK)
+        {
+        vI106_FreeTimeModel(psuModel);
+        return enRetStatus;
+        }
+
+    // Replace any old time model
+    vI106_FreeTimeModel(psuI106Handle(iI106Ch10Handle)->psuTimeModel);
+    psuI106Handle(iI106Ch10Handle)->psuTimeModel = psuModel;
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+EnI106Status I106_CALL_DECL 
+    enI106_ReadTimePackets(int              iI106Ch10Handle,
+                           int              iChanID,
+                           SuTimePacket  ** pasuTimePacket,
+                           int            * piNumPackets)
+    {
+    int                     iScanHandle;
+    int                     iArraySize = 0;
+    EnI106Status            enStatus;
+    EnI106Status            enRetStatus = I106_OK;
+    SuI106Ch10Header        suI106Hdr;
+    SuTimeF1_DecodeCache    suCache;
+    SuTimePacket          * asuNewTimePacket;
+    unsigned long           ulBuffSize = 0;
+    void                  * pvBuff = NULL;
+
+    *pasuTimePacket = NULL;
+    *piNumPackets   = 0;
+
+    enStatus = enOpenTimeScan(iI106Ch10Handle, &iScanHandle);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    suCache.bValid = bFALSE;
+    while (bTRUE)
+        {
+        enStatus = enReadNextTimePacket(iScanHandle, iChanID, &suI106Hdr, &pvBuff, &ulBuffSize);
+        if (enStatus == I106_EOF)
+            break;
+        if (enStatus != I106_OK)
+            {
+            enRetStatus = enStatus;
+            break;
+            }
+
+        if (*piNumPackets >= iArraySize)
+            {
+            asuNewTimePacket = (SuTimePacket *)realloc(*pasuTimePacket, 
+                                   sizeof(SuTimePacket) * (iArraySize + iArraySize / 2 + 1024));
+            if (asuNewTimePacket == NULL)
+                {
+                enRetStatus = I106_NO_MEMORY;
+                break;
+                }
+            *pasuTimePacket = asuNewTimePacket;
+            iArraySize      = iArraySize + iArraySize / 2 + 1024;
+            }
+
+        if (bDecodeTimePacket(&suI106Hdr, pvBuff, &suCache, &(*pasuTimePacket)[*piNumPackets]))
+            (*piNumPackets)++;
+        } // end while reading time packets
+
+    free(pvBuff);
+    enI106Ch10Close(iScanHandle);
+
+    if (enRetStatus != I106_OK)
+        {
+        free(*pasuTimePacket);
+        *pasuTimePacket = NULL;
+        *piNumPackets   = 0;
+        }
+
+    return enRetStatus;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Open a second handle on the data file for reading time packets so the 
+// caller's read position isn't disturbed.  Skipping over data is free with 
+// a memory mapped file so try that first.
+
+static EnI106Status enOpenTimeScan(int iI106Ch10Handle, int * piScanHandle)
+    {
+    EnI106Status        enStatus;
+
+    if (bI106ValidHandle(iI106Ch10Handle) == bFALSE)
+        return I106_INVALID_HANDLE;
+
+    switch (psuI106Handle(iI106Ch10Handle)->enFileMode)
+        {
+        case I106_READ          :
+        case I106_READ_IN_ORDER :
+        case I106_READ_MMAP     :
+            break;
+        default :
+            return I106_WRONG_FILE_MODE;
+        }
+
+    enStatus = enI106Ch10Open(piScanHandle, psuI106Handle(iI106Ch10Handle)->szFileName, I106_READ_MMAP);
+    if ((enStatus != I106_OK) && (enStatus != I106_OPEN_WARNING))
+        enStatus = enI106Ch10Open(piScanHandle, psuI106Handle(iI106Ch10Handle)->szFileName, I106_READ);
+    if ((enStatus != I106_OK) && (enStatus != I106_OPEN_WARNING))
+        return enStatus;
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Read headers until the next time packet, from channel iChanID if it 
+// isn't -1, and read in its data.  The buffer grows as needed.
+
+static EnI106Status enReadNextTimePacket(int iScanHandle, int iChanID, SuI106Ch10Header * psuI106Hdr,
+                                         void ** ppvBuff, unsigned long * pulBuffSize)
+    {
+    EnI106Status        enStatus;
+    void              * pvNewBuff;
+
+    while (bTRUE)
+        {
+        enStatus = enI106Ch10ReadNextHeaderFile(iScanHandle, psuI106Hdr);
+        if (enStatus == I106_HEADER_CHKSUM_BAD)
+            continue;
+        if (enStatus != I106_OK)
+            return enStatus;
+
+        if ((psuI106Hdr->ubyDataType != I106CH10_DTYPE_IRIG_TIME) &&
+            (psuI106Hdr->ubyDataType != I106CH10_DTYPE_NETWORK_TIME))
+            continue;
+        if ((iChanID != -1) && (psuI106Hdr->uChID != iChanID))
+            continue;
+
+        if (*pulBuffSize < psuI106Hdr->ulPacketLen)
+            {
+            pvNewBuff = realloc(*ppvBuff, psuI106Hdr->ulPacketLen);
+            if (pvNewBuff == NULL)
+                return I106_NO_MEMORY;
+            *ppvBuff     = pvNewBuff;
+            *pulBuffSize = psuI106Hdr->ulPacketLen;
+            }
+        enStatus = enI106Ch10ReadData(iScanHandle, *pulBuffSize, *ppvBuff);
+        if (enStatus == I106_OK)
+            return I106_OK;
+        } // end while looking for a time packet
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Decode a time F1 or F2 packet.  Returns bFALSE for time formats that 
+// aren't supported.
+
+static int bDecodeTimePacket(SuI106Ch10Header * psuI106Hdr, void * pvBuff, 
+                             SuTimeF1_DecodeCache * psuCache, SuTimePacket * psuTimePacket)
+    {
+    SuTimeF1_ChanSpec   * psuChanSpecF1;
+    SuTimeF2_ChanSpec   * psuChanSpecF2;
+    SuIrig106Time         suTime;
+
+    vTimeArray2LLInt(psuI106Hdr->aubyRefTime, &(psuTimePacket->llRelTime));
+    psuTimePacket->uChID       = psuI106Hdr->uChID;
+    psuTimePacket->ubyDataType = psuI106Hdr->ubyDataType;
+
+    if (psuI106Hdr->ubyDataType == I106CH10_DTYPE_IRIG_TIME)
+        {
+        psuChanSpecF1 = (SuTimeF1_ChanSpec *)pvBuff;
+        psuTimePacket->llAbsTime  = llI106_Decode_TimeF1_Buff(psuChanSpecF1->uDateFmt, psuChanSpecF1->bLeapYear,
+                                        (char *)pvBuff + sizeof(SuTimeF1_ChanSpec), psuCache);
+        psuTimePacket->ubyTimeSrc = (uint8_t)psuChanSpecF1->uTimeSrc;
+        psuTimePacket->enFmt      = psuChanSpecF1->uDateFmt == 0 ? I106_DATEFMT_DAY : I106_DATEFMT_DMY;
+        }
+    else
+        {
+        psuChanSpecF2 = (SuTimeF2_ChanSpec *)pvBuff;
+        if (enI106_Decode_TimeF2(psuI106Hdr, pvBuff, &suTime) != I106_OK)
+            return bFALSE;
+        psuTimePacket->llAbsTime  = (int64_t)suTime.ulSecs * 10000000 + (int64_t)suTime.ulFrac;
+        psuTimePacket->ubyTimeSrc = (uint8_t)psuChanSpecF2->uTimeStatus;
+        psuTimePacket->enFmt      = suTime.enFmt;
+        }
+
+    return bTRUE;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Fit the next time point into the time model.  Every time point in a 
+// segment has to be within the tolerance of the segment line.  Each point 
+// narrows down the range of rates that keep all the points so far in 
+// tolerance.  As long as that range isn't empty the point goes in the 
+// current segment.  When it runs out the clock has drifted and a new segment
+// starts at the end of the current one, so the model stays continuous.  A 
+// point way off the line is a time jump and starts a new segment at itself.
+// Relative time going backwards (the RTC was reset) starts a new epoch at 
+// the time packet's file offset, with a new segment at the point.
+
+static EnI106Status enTimeModelAddPoint(SuTimeModel * psuModel, SuTimeModelFit * psuFit, 
+                                        int64_t llOffset, int64_t llRelTime, int64_t llAbsTime)
+    {
+    SuTimeSegment     * psuSeg;
+    SuTimeSegment     * asuNewSegment;
+    SuTimeEpoch       * asuNewEpoch;
+    int64_t             llRelDiff;
+    int64_t             llError;
+    int64_t             llStartRelTime;
+    int64_t             llStartAbsTime;
+    double              dRateMin;
+    double              dRateMax;
+    int                 bJump = bTRUE;
+    int                 bNewEpoch;
+
+    bNewEpoch = psuModel->iNumSegments == 0;
+    if (!bNewEpoch)
+        {
+        // Ignore duplicates
+        psuSeg = &psuModel->asuSegment[psuModel->iNumSegments-1];
+        if (llRelTime == psuSeg->llRelTimeEnd)
+            return I106_OK;
+        bNewEpoch = llRelTime < psuSeg->llRelTimeEnd;
+        }
+
+    if (!bNewEpoch)
+        {
+        // How far off the current line is it
+        llError = llAbsTime - (psuSeg->llAbsTime + 
+                  (int64_t)((double)(llRelTime - psuSeg->llRelTime) * psuSeg->dRate));
+        if (llError < 0)
+            llError = -llError;
+        bJump = llError > TIME_MODEL_JUMP;
+
+        if (!bJump)
+            {
+            // Rates that would put this point in tolerance
+            llRelDiff = llRelTime - psuSeg->llRelTime;
+            dRateMin  = (double)(llAbsTime - TIME_MODEL_TOLERANCE - psuSeg->llAbsTime) / (double)llRelDiff;
+            dRateMax  = (double)(llAbsTime + TIME_MODEL_TOLERANCE - psuSeg->llAbsTime) / (double)llRelDiff;
+            if (dRateMin < psuFit->dRateMin)
+                dRateMin = psuFit->dRateMin;
+            if (dRateMax > psuFit->dRateMax)
+                dRateMax = psuFit->dRateMax;
+
+            // Still fits so aim the line at this point, as far as allowed
+            if (dRateMin <= dRateMax)
+                {
+                psuFit->dRateMin     = dRateMin;
+                psuFit->dRateMax     = dRateMax;
+                psuSeg->dRate        = (double)(llAbsTime - psuSeg->llAbsTime) / (double)llRelDiff;
+                if (psuSeg->dRate < dRateMin)
+                    psuSeg->dRate = dRateMin;
+                if (psuSeg->dRate > dRateMax)
+                    psuSeg->dRate = dRateMax;
+                psuSeg->llRelTimeEnd = llRelTime;
+                return I106_OK;
+                }
+            }
+        } // end if in the current epoch
+
+    // Make room for a new segment
+    if (psuModel->iNumSegments >= psuModel->iArraySize)
+        {
+        asuNewSegment = (SuTimeSegment *)realloc(psuModel->asuSegment, 
+                            sizeof(SuTimeSegment) * (psuModel->iArraySize * 2 + 64));
+        if (asuNewSegment == NULL)
+            return I106_NO_MEMORY;
+        psuModel->asuSegment  = asuNewSegment;
+        psuModel->iArraySize  = psuModel->iArraySize * 2 + 64;
+        }
+
+    // A new epoch starts with the new segment.  The first one covers the file
+    // from the start.
+    if (bNewEpoch)
+        {
+        if (psuModel->iNumEpochs >= psuModel->iEpochArraySize)
+            {
+            asuNewEpoch = (SuTimeEpoch *)realloc(psuModel->asuEpoch, 
+                              sizeof(SuTimeEpoch) * (psuModel->iEpochArraySize * 2 + 8));
+            if (asuNewEpoch == NULL)
+                return I106_NO_MEMORY;
+            psuModel->asuEpoch        = asuNewEpoch;
+            psuModel->iEpochArraySize = psuModel->iEpochArraySize * 2 + 8;
+            }
+        psuModel->asuEpoch[psuModel->iNumEpochs].llOffset      = psuModel->iNumEpochs == 0 ? 0 : llOffset;
+        psuModel->asuEpoch[psuModel->iNumEpochs].iFirstSegment = psuModel->iNumSegments;
+        psuModel->iNumEpochs++;
+        }
+
+    // Drift starts the new segment at the end of the last one and this point
+    // narrows down its rate.  A jump starts fresh at this point.
+    if (!bJump)
+        {
+        psuSeg         = &psuModel->asuSegment[psuModel->iNumSegments-1];
+        llStartRelTime = psuSeg->llRelTimeEnd;
+        llStartAbsTime = psuSeg->llAbsTime + 
+                         (int64_t)((double)(psuSeg->llRelTimeEnd - psuSeg->llRelTime) * psuSeg->dRate);
+        llRelDiff      = llRelTime - llStartRelTime;
+        psuFit->dRateMin = (double)(llAbsTime - TIME_MODEL_TOLERANCE - llStartAbsTime) / (double)llRelDiff;
+        psuFit->dRateMax = (double)(llAbsTime + TIME_MODEL_TOLERANCE - llStartAbsTime) / (double)llRelDiff;
+
+        psuSeg = &psuModel->asuSegment[psuModel->iNumSegments];
+        psuSeg->llRelTime    = llStartRelTime;
+        psuSeg->llAbsTime    = llStartAbsTime;
+        psuSeg->llRelTimeEnd = llRelTime;
+        psuSeg->dRate        = (double)(llAbsTime - llStartAbsTime) / (double)llRelDiff;
+        }
+    else
+        {
+        psuFit->dRateMin = 0.0;
+        psuFit->dRateMax = 2.0;
+
+        psuSeg = &psuModel->asuSegment[psuModel->iNumSegments];
+        psuSeg->llRelTime    = llRelTime;
+        psuSeg->llAbsTime    = llAbsTime;
+        psuSeg->llRelTimeEnd = llRelTime;
+        psuSeg->dRate        = 1.0;
+        }
+    psuModel->iNumSegments++;
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Pick the epoch for a file offset.  It's the last one starting at or before
+// the offset.
+
+void I106_CALL_DECL 
+    vI106_TimeModelSetOffset(SuTimeModel   * psuModel,
+                             int64_t         llOffset)
+    {
+    int                 iLower;
+    int                 iUpper;
+    int                 iProbe;
+
+    if (psuModel->iNumEpochs <= 1)
+        {
+        psuModel->iCurrEpoch = 0;
+        return;
+        }
 
-    // If there is no index in memory then barf
-    if (psuIndex->enSortStatus != enSorted)
-        return I106_NO_INDEX;
+    iLower = 0;
+    iUpper = psuModel->iNumEpochs - 1;
+    while (iLower < iUpper)
+        {
+        iProbe = iLower + (iUpper - iLower + 1) / 2;
+        if (psuModel->asuEpoch[iProbe].llOffset <= llOffset)
+            iLower = iProbe;
+        else
+            iUpper = iProbe - 1;
+        }
+    psuModel->iCurrEpoch = iLower;
+
+    return;
+    }
 
-    // We have an index so do a binary search for time
 
-    // Convert clock time to 10 MHz count
-    enI106_Irig2RelTime(iHandle, psuSeekTime, abySeekTime);
-    vTimeArray2LLInt(abySeekTime, &llSeekTime);
 
-    // Check time bounds
-    if (llSeekTime < psuIndex->asuIndex[0].llTime)
+/* ----------------------------------------------------------------------- */
+
+// Look up the segment for a relative time in the current epoch and convert.
+// Lookups usually land in the segment used last or the one after it so check
+// those before doing a binary search.  Times before the first segment use the
+// first segment and times after a segment ends use that segment until the 
+// next one starts.
+
+int64_t I106_CALL_DECL 
+    llI106_TimeModelRel2Abs(SuTimeModel   * psuModel,
+                            int64_t         llRelTime)
+    {
+    SuTimeSegment     * asuSeg = psuModel->asuSegment;
+    int                 iSeg   = psuModel->iCurrSegment;
+    int                 iFirst;
+    int                 iEnd;
+    int                 iLower;
+    int                 iUpper;
+    int                 iProbe;
+
+    if (psuModel->iNumSegments <= 0)
+        return 0;
+
+    vTimeEpochRange(psuModel, &iFirst, &iEnd);
+    if ((iSeg < iFirst) || (iSeg >= iEnd))
+        iSeg = iFirst;
+
+    // Segment iSeg covers relative times from its start to the start of the
+    // next segment
+    if ((llRelTime >= asuSeg[iSeg].llRelTime) &&
+        ((iSeg+1 == iEnd) || (llRelTime < asuSeg[iSeg+1].llRelTime)))
+        ;
+
+    else if ((iSeg+1 < iEnd) && (llRelTime >= asuSeg[iSeg+1].llRelTime) &&
+             ((iSeg+2 == iEnd) || (llRelTime < asuSeg[iSeg+2].llRelTime)))
+        iSeg++;
+
+    else if (llRelTime < asuSeg[iFirst].llRelTime)
+        iSeg = iFirst;
+
+    // Find the last segment starting at or before the relative time
+    else
         {
-        enI106Ch10FirstMsg(iHandle);
-        return I106_TIME_NOT_FOUND;
-        };
+        iLower = iFirst;
+        iUpper = iEnd - 1;
+        while (iLower < iUpper)
+            {
+            iProbe = iLower + (iUpper - iLower + 1) / 2;
+            if (asuSeg[iProbe].llRelTime <= llRelTime)
+                iLower = iProbe;
+            else
+                iUpper = iProbe - 1;
+            }
+        iSeg = iLower;
+        }
+
+    psuModel->iCurrSegment = iSeg;
+
+    return asuSeg[iSeg].llAbsTime + 
+           (int64_t)((double)(llRelTime - asuSeg[iSeg].llRelTime) * asuSeg[iSeg].dRate);
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Look up the segment for an absolute time in the current epoch and convert
+// back to relative time.  Time jumps can make absolute time go backwards so
+// more than one segment may cover an absolute time.  The segment used last is
+// tried first, then the first covering segment in relative time order.  Times
+// no segment covers use the segment starting closest before them, or the 
+// first segment.
+
+int64_t I106_CALL_DECL 
+    llI106_TimeModelAbs2Rel(SuTimeModel   * psuModel,
+                            int64_t         llAbsTime)
+    {
+    SuTimeSegment     * asuSeg = psuModel->asuSegment;
+    int                 iSeg   = psuModel->iCurrSegment;
+    int                 iFirst;
+    int                 iEnd;
+    int                 iBefore;
 
-    if (llSeekTime > psuIndex->asuIndex[psuIndex->iArrayUsed].llTime)
+    if (psuModel->iNumSegments <= 0)
+        return 0;
+
+    vTimeEpochRange(psuModel, &iFirst, &iEnd);
+    if ((iSeg < iFirst) || (iSeg >= iEnd))
+        iSeg = iFirst;
+
+    if (!bTimeSegmentHasAbs(psuModel, iSeg, iEnd, llAbsTime))
         {
-        enI106Ch10LastMsg(iHandle);
-        return I106_TIME_NOT_FOUND;
-        };
+        iBefore = -1;
+        for (iSeg=iFirst; iSeg<iEnd; iSeg++)
+            {
+            if (bTimeSegmentHasAbs(psuModel, iSeg, iEnd, llAbsTime))
+                break;
+            if ((asuSeg[iSeg].llAbsTime <= llAbsTime) &&
+                ((iBefore == -1) || (asuSeg[iSeg].llAbsTime > asuSeg[iBefore].llAbsTime)))
+                iBefore = iSeg;
+            }
+        if (iSeg >= iEnd)
+            iSeg = (iBefore == -1) ? iFirst : iBefore;
+        }
+
+    psuModel->iCurrSegment = iSeg;
+
+    if (asuSeg[iSeg].dRate <= 0.0)
+        return asuSeg[iSeg].llRelTime;
+
+    return asuSeg[iSeg].llRelTime + 
+           (int64_t)((double)(llAbsTime - asuSeg[iSeg].llAbsTime) / asuSeg[iSeg].dRate);
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// A segment covers the absolute times from its start up to where the next 
+// segment starts in relative time.  The last segment of an epoch, the one 
+// before iEnd, goes on forever.
+
+static int bTimeSegmentHasAbs(SuTimeModel * psuModel, int iSeg, int iEnd, int64_t llAbsTime)
+    {
+    SuTimeSegment     * psuSeg = &psuModel->asuSegment[iSeg];
+    int64_t             llAbsTimeEnd;
+
+    if (llAbsTime < psuSeg->llAbsTime)
+        return bFALSE;
+
+    if (iSeg+1 >= iEnd)
+        return bTRUE;
+
+    llAbsTimeEnd = psuSeg->llAbsTime + 
+                   (int64_t)((double)(psuSeg[1].llRelTime - psuSeg->llRelTime) * psuSeg->dRate);
+
+    return llAbsTime < llAbsTimeEnd;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Get the segments of the current epoch, from iFirst up to but not including
+// iEnd
+
+static void vTimeEpochRange(SuTimeModel * psuModel, int * piFirst, int * piEnd)
+    {
+    int                 iEpoch = psuModel->iCurrEpoch;
+
+    if (psuModel->iNumEpochs <= 0)
+        {
+        *piFirst = 0;
+        *piEnd   = psuModel->iNumSegments;
+        return;
+        }
+
+    if ((iEpoch < 0) || (iEpoch >= psuModel->iNumEpochs))
+        iEpoch = 0;
+
+    *piFirst = psuModel->asuEpoch[iEpoch].iFirstSegment;
+    if (iEpoch+1 < psuModel->iNumEpochs)
+        *piEnd = psuModel->asuEpoch[iEpoch+1].iFirstSegment;
+    else
+        *piEnd = psuModel->iNumSegments;
+
+    return;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Use the time model epoch for where a handle is reading.  Any offset inside
+// the packet just read will do and the byte before the read position is 
+// always in it.
+
+static void vTimeModelSetHandleEpoch(int iI106Ch10Handle)
+    {
+    SuTimeModel       * psuModel = psuI106Handle(iI106Ch10Handle)->psuTimeModel;
+    int64_t             llPos;
+
+    if (psuModel->iNumEpochs <= 1)
+        return;
+
+    if ((enI106Ch10GetPos(iI106Ch10Handle, &llPos) == I106_OK) && (llPos > 0))
+        vI106_TimeModelSetOffset(psuModel, llPos - 1);
+
+    return;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+void I106_CALL_DECL 
+    vI106_FreeTimeModel(SuTimeModel * psuModel)
+    {
+    if (psuModel == NULL)
+        return;
+
+    free(psuModel->asuSegment);
+    free(psuModel->asuEpoch);
+    free(psuModel);
+
+    return;
+    }
+
 
-    // If we don't already have it, figure out how many search steps
-    if (psuIndex->iNumSearchSteps == 0)
+
+/* ----------------------------------------------------------------------- */
+
+EnI106Status I106_CALL_DECL 
+    enI106_LoadTimeModel(int           iI106Ch10Handle,
+                         int           bRequireSync,
+                         const char  * szModelFileName)
+    {
+    EnI106Status        enStatus;
+    char              * szDefaultName = NULL;
+    const char        * szName;
+
+    if (bI106ValidHandle(iI106Ch10Handle) == bFALSE)
+        return I106_INVALID_HANDLE;
+
+    if (szModelFileName == NULL)
+        {
+        szDefaultName = (char *)malloc(strlen(psuI106Handle(iI106Ch10Handle)->szFileName) + 5);
+        if (szDefaultName == NULL)
+            return I106_NO_MEMORY;
+        strcpy(szDefaultName, psuI106Handle(iI106Ch10Handle)->szFileName);
+        strcat(szDefaultName, ".tim");
+        szName = szDefaultName;
+        }
+    else
+        szName = szModelFileName;
+
+    // Use the time model file if it's current, otherwise make it again
+    enStatus = I106_OK;
+    if (bReadTimeModel(iI106Ch10Handle, szName) == bFALSE)
+        {
+        enStatus = enI106_MakeTimeModel(iI106Ch10Handle, bRequireSync);
+        if (enStatus == I106_OK)
+            bWriteTimeModel(iI106Ch10Handle, szName);
+        }
+
+    free(szDefaultName);
+
+    return enStatus;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+static int bReadTimeModel(int iI106Ch10Handle, const char * szModelFileName)
+    {
+    FILE                  * psuFile;
+    SuTimeModelFileHdr      suFileHdr;
+    SuTimeModel           * psuModel;
+    int64_t                 llSourceSize;
+    int64_t                 llSourceTime;
+    uint64_t                ullSourceHash;
+    uint32_t                uSegment;
+    uint32_t                uEpoch;
+    int                     bReadOK = bFALSE;
+
+    psuFile = fopen(szModelFileName, "rb");
+    if (psuFile == NULL)
+        return bFALSE;
+
+    psuModel = (SuTimeModel *)calloc(1, sizeof(SuTimeModel));
+
+    // Setup a one time loop to make it easy to break out on errors
+    do
         {
-        iUpperLimit = 1;
-        while (iUpperLimit < psuIndex->iArrayUsed)
+        if (psuModel == NULL)
+            break;
+
+        // Check the header and make sure it goes with the data file
+        if (fread(&suFileHdr, sizeof(suFileHdr), 1, psuFile) != 1)
+            break;
+        if ((memcmp(suFileHdr.achMagic, TIME_MODEL_MAGIC, sizeof(TIME_MODEL_MAGIC)) != 0) ||
+            (suFileHdr.ulVersion     != TIME_MODEL_VERSION)                               ||
+            (suFileHdr.ulHeaderSize  != sizeof(SuTimeModelFileHdr))                       ||
+            (suFileHdr.ulNumSegments == 0)                                                ||
+            (suFileHdr.ulNumSegments >  0x7fffffffUL / sizeof(SuTimeSegment))             ||
+            (suFileHdr.ulNumEpochs   == 0)                                                ||
+            (suFileHdr.ulNumEpochs   >  suFileHdr.ulNumSegments))
+            break;
+        if (bI106Ch10GetFileId(psuI106Handle(iI106Ch10Handle)->szFileName, 
+                               &llSourceSize, &llSourceTime, &ullSourceHash) == bFALSE)
+            break;
+        if ((suFileHdr.llSourceSize  != llSourceSize) ||
+            (suFileHdr.llSourceTime  != llSourceTime) ||
+            (suFileHdr.ullSourceHash != ullSourceHash))
+            break;
+
+        // Read the segments and epochs
+        psuModel->asuSegment = (SuTimeSegment *)malloc(sizeof(SuTimeSegment) * suFileHdr.ulNumSegments);
+        psuModel->asuEpoch   = (SuTimeEpoch *)malloc(sizeof(SuTimeEpoch) * suFileHdr.ulNumEpochs);
+        if ((psuModel->asuSegment == NULL) || (psuModel->asuEpoch == NULL))
+            break;
+        if (fread(psuModel->asuSegment, sizeof(SuTimeSegment), suFileHdr.ulNumSegments, psuFile) != suFileHdr.ulNumSegments)
+            break;
+        if (fread(psuModel->asuEpoch, sizeof(SuTimeEpoch), suFileHdr.ulNumEpochs, psuFile) != suFileHdr.ulNumEpochs)
+            break;
+        if (fgetc(psuFile) != EOF)
+            break;
+
+        // Epochs have to start at the beginning of the file and go forward, 
+        // each with at least one segment
+        if ((psuModel->asuEpoch[0].llOffset != 0) || (psuModel->asuEpoch[0].iFirstSegment != 0))
+            break;
+        for (uEpoch=1; uEpoch<suFileHdr.ulNumEpochs; uEpoch++)
+            if ((psuModel->asuEpoch[uEpoch].llOffset      <= psuModel->asuEpoch[uEpoch-1].llOffset)      ||
+                (psuModel->asuEpoch[uEpoch].iFirstSegment <= psuModel->asuEpoch[uEpoch-1].iFirstSegment) ||
+                ((uint32_t)psuModel->asuEpoch[uEpoch].iFirstSegment >= suFileHdr.ulNumSegments))
+                break;
+        if (uEpoch < suFileHdr.ulNumEpochs)
+            break;
+
+        // Segments have to be in relative time order within an epoch
+        uEpoch = 1;
+        for (uSegment=1; uSegment<suFileHdr.ulNumSegments; uSegment++)
             {
-            iUpperLimit *= 2;
-            psuIndex->iNumSearchSteps++;
+            if ((uEpoch < suFileHdr.ulNumEpochs) && 
+                ((uint32_t)psuModel->asuEpoch[uEpoch].iFirstSegment == uSegment))
+                {
+                uEpoch++;
+                continue;
+                }
+            if (psuModel->asuSegment[uSegment].llRelTime < psuModel->asuSegment[uSegment-1].llRelTime)
+                break;
             }
-        } // end if no search steps
-
-    // Loop prescribed number of times
-    iLowerLimit = 0;
-    iUpperLimit = psuIndex->iArrayUsed-1;
-    psuIndex->iArrayCurr = (iUpperLimit - iLowerLimit) / 2;
-    for (iSearchLoopIdx = 0; 
-         iSearchLoopIdx < psuIndex->iNumSearchSteps; 
-         iSearchLoopIdx++)
-        {
-        if      (psuIndex->asuIndex[psuIndex->iArrayCurr].llTime > llSeekTime)
-            iUpperLimit = (iUpperLimit - iLowerLimit) / 2;
-        else if (psuIndex->asuIndex[psuIndex->iArrayCurr].llTime < llSeekTime)
-            iLowerLimit = (iUpperLimit - iLowerLimit) / 2;
-        else
+        if (uSegment < suFileHdr.ulNumSegments)
             break;
+
+        psuModel->iNumSegments    = (int)suFileHdr.ulNumSegments;
+        psuModel->iArraySize      = (int)suFileHdr.ulNumSegments;
+        psuModel->iNumEpochs      = (int)suFileHdr.ulNumEpochs;
+        psuModel->iEpochArraySize = (int)suFileHdr.ulNumEpochs;
+        psuModel->uTimeChanID  = (uint16_t)suFileHdr.ulTimeChanID;
+        psuModel->enFmt        = (EnI106DateFmt)suFileHdr.ulDateFmt;
+        bReadOK = bTRUE;
+        } while (bFALSE); // end one time loop to read
+
+    fclose(psuFile);
+
+    if (bReadOK)
+        {
+        vI106_FreeTimeModel(psuI106Handle(iI106Ch10Handle)->psuTimeModel);
+        psuI106Handle(iI106Ch10Handle)->psuTimeModel = psuModel;
         }
+    else
+        vI106_FreeTimeModel(psuModel);
 
-    return I106_OK;
+    return bReadOK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Write the time model file.  It is written to a temporary file first and 
+// then renamed so a half written model is never seen.
+
+static int bWriteTimeModel(int iI106Ch10Handle, const char * szModelFileName)
+    {
+    FILE                  * psuFile;
+    SuTimeModelFileHdr      suFileHdr;
+    SuTimeModel           * psuModel = psuI106Handle(iI106Ch10Handle)->psuTimeModel;
+    SuTimeEpoch             suEpoch;
+    char                  * szTempFileName;
+    int                     bWriteOK;
+
+    if ((psuModel == NULL) || (psuModel->iNumSegments <= 0))
+        return bFALSE;
+
+    memset(&suFileHdr, 0, sizeof(suFileHdr));
+    memcpy(suFileHdr.achMagic, TIME_MODEL_MAGIC, sizeof(TIME_MODEL_MAGIC));
+    suFileHdr.ulVersion     = TIME_MODEL_VERSION;
+    suFileHdr.ulHeaderSize  = sizeof(SuTimeModelFileHdr);
+    suFileHdr.ulNumSegments = (uint32_t)psuModel->iNumSegments;
+    suFileHdr.ulDateFmt     = (uint32_t)psuModel->enFmt;
+    suFileHdr.ulTimeChanID  = psuModel->uTimeChanID;
+    suFileHdr.ulNumEpochs   = psuModel->iNumEpochs > 0 ? (uint32_t)psuModel->iNumEpochs : 1;
+    if (bI106Ch10GetFileId(psuI106Handle(iI106Ch10Handle)->szFileName, &suFileHdr.llSourceSize, 
+                           &suFileHdr.llSourceTime, &suFileHdr.ullSourceHash) == bFALSE)
+        return bFALSE;
+
+    szTempFileName = (char *)malloc(strlen(szModelFileName) + 5);
+    if (szTempFileName == NULL)
+        return bFALSE;
+    strcpy(szTempFileName, szModelFileName);
+    strcat(szTempFileName, ".tmp");
+
+    psuFile = fopen(szTempFileName, "wb");
+    if (psuFile == NULL)
+        {
+        free(szTempFileName);
+        return bFALSE;
+        }
+
+    bWriteOK = (fwrite(&suFileHdr, sizeof(suFileHdr), 1, psuFile) == 1) &&
+               (fwrite(psuModel->asuSegment, sizeof(SuTimeSegment), psuModel->iNumSegments, psuFile) == 
+                (size_t)psuModel->iNumSegments);
+
+    // A model without epochs is one epoch holding every segment
+    if (bWriteOK && (psuModel->iNumEpochs > 0))
+        bWriteOK = fwrite(psuModel->asuEpoch, sizeof(SuTimeEpoch), psuModel->iNumEpochs, psuFile) == 
+                   (size_t)psuModel->iNumEpochs;
+    else if (bWriteOK)
+        {
+        memset(&suEpoch, 0, sizeof(suEpoch));
+        bWriteOK = fwrite(&suEpoch, sizeof(SuTimeEpoch), 1, psuFile) == 1;
+        }
+
+    if (fclose(psuFile) != 0)
+        bWriteOK = bFALSE;
+
+    if (bWriteOK)
+        {
+#if defined(_WIN32)
+        remove(szModelFileName);
+#endif
+        bWriteOK = rename(szTempFileName, szModelFileName) == 0;
+        }
+    if (!bWriteOK)
+        remove(szTempFileName);
+
+    free(szTempFileName);
+
+    return bWriteOK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Get the time reference for a handle, making a new one the first time 
+// through. Returns NULL if the handle isn't open.
+
+static SuTimeRef * psuGetTimeRef(int iI106Ch10Handle)
+    {
+
+    if (bI106ValidHandle(iI106Ch10Handle) == bFALSE)
+        return NULL;
+
+    if (psuI106Handle(iI106Ch10Handle)->psuTimeRef == NULL)
+        psuI106Handle(iI106Ch10Handle)->psuTimeRef = (SuTimeRef *)calloc(1, sizeof(SuTimeRef));
+
+    return psuI106Handle(iI106Ch10Handle)->psuTimeRef;
     }
 
 
@@ -534,44 +2427,191 @@ EnI106Status I106_CALL_DECL
 
 char * IrigTime2String(SuIrig106Time * psuTime)
     {
-    static char     szTime[30];
-    struct tm     * psuTmTime;
-
-    // Convert IRIG time into it's components
-    psuTmTime = gmtime((time_t *)&(psuTime->ulSecs));
-
-    // Make the appropriate string
-    switch (psuTime->enFmt)
-        {
-        // Year / Month / Day format ("2008/02/29 12:34:56.789")
-        case I106_DATEFMT_DMY :
-            sprintf(szTime, "%4.4i/%2.2i/%2.2i %2.2i:%2.2i:%2.2i.%3.3i",
-                psuTmTime->tm_year + 1900,
-                psuTmTime->tm_mon + 1,
-                psuTmTime->tm_mday,
-                psuTmTime->tm_hour,
-                psuTmTime->tm_min,
-                psuTmTime->tm_sec,
-                psuTime->ulFrac / 10000);
-            break;
+    static char                 szTime[I106_TIME_STRING_SIZE];
+    static SuTimeStringCache    suCache;
 
-        // Day of the Year format ("001:12:34:56.789")
-        case I106_DATEFMT_DAY :
-        default :
-            sprintf(szTime, "%3.3i:%2.2i:%2.2i:%2.2i.%3.3i",
-                psuTmTime->tm_yday+1,
-                psuTmTime->tm_hour,
-                psuTmTime->tm_min,
-                psuTmTime->tm_sec,
-                psuTime->ulFrac / 10000);
-            break;
-        } // end switch on format
+    iI106_IrigTime2String(psuTime, &suCache, szTime);
 
     return szTime;
     }
 
 
 
+/* ------------------------------------------------------------------------ */
+
+// Fill in the date strings for a day number (days since 1970).  This is 
+// done with integer math so there's no gmtime() and no time zone or locale 
+// worries.
+
+static void vFillTimeStringCache(int64_t llDay, SuTimeStringCache * psuCache)
+    {
+    int64_t     llYear;
+    int         iYear;
+    int         iMonth;
+    int         iDay;
+    int         iYearDay;
+
+    vI106_Days2Date(llDay, &iYear, &iMonth, &iDay, &iYearDay);
+
+    llYear = iYear;
+    if ((llYear < 0) || (llYear > 9999))
+        llYear = 0;
+
+    psuCache->achDMY[0]  = (char)('0' + llYear / 1000);
+    psuCache->achDMY[1]  = (char)('0' + llYear / 100 % 10);
+    psuCache->achDMY[2]  = (char)('0' + llYear / 10 % 10);
+    psuCache->achDMY[3]  = (char)('0' + llYear % 10);
+    psuCache->achDMY[4]  = '/';
+    psuCache->achDMY[5]  = (char)('0' + iMonth / 10);
+    psuCache->achDMY[6]  = (char)('0' + iMonth % 10);
+    psuCache->achDMY[7]  = '/';
+    psuCache->achDMY[8]  = (char)('0' + iDay / 10);
+    psuCache->achDMY[9]  = (char)('0' + iDay % 10);
+    psuCache->achDMY[10] = ' ';
+
+    psuCache->achDay[0]  = (char)('0' + iYearDay / 100);
+    psuCache->achDay[1]  = (char)('0' + iYearDay / 10 % 10);
+    psuCache->achDay[2]  = (char)('0' + iYearDay % 10);
+    psuCache->achDay[3]  = ':';
+
+    psuCache->llDay  = llDay;
+    psuCache->bValid = bTRUE;
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Make a time string from seconds since 1970 and 100 nsec fraction.  The 
+// date part comes from the cache and only the time of day is done every time.
+
+static int iTime2String(int64_t               llSecs,
+                        uint32_t              ulFrac,
+                        EnI106DateFmt         enFmt,
+                        SuTimeStringCache   * psuCache,
+                        char                  szTime[])
+    {
+    int64_t     llDay;
+    int         iSecOfDay;
+    int         iHour;
+    int         iMin;
+    int         iSec;
+    int         iMilli;
+    char      * pchTime;
+
+    // Split into day and time of day
+    llDay     = llSecs / 86400;
+    iSecOfDay = (int)(llSecs % 86400);
+    if (iSecOfDay < 0)
+        {
+        iSecOfDay += 86400;
+        llDay     -= 1;
+        }
+
+    // Redo the date only when the day changes
+    if ((psuCache->bValid == bFALSE) || (psuCache->llDay != llDay))
+        vFillTimeStringCache(llDay, psuCache);
+
+    iHour  = iSecOfDay / 3600;
+    iMin   = iSecOfDay / 60 % 60;
+    iSec   = iSecOfDay % 60;
+    iMilli = (int)(ulFrac / 10000);
+    if (iMilli > 999)
+        iMilli = 999;
+
+    // Year / Month / Day format ("2008/02/29 12:34:56.789") or
+    // Day of the Year format ("001:12:34:56.789")
+    pchTime = szTime;
+    if (enFmt == I106_DATEFMT_DMY)
+        {
+        memcpy(pchTime, psuCache->achDMY, sizeof(psuCache->achDMY));
+        pchTime += sizeof(psuCache->achDMY);
+        }
+    else
+        {
+        memcpy(pchTime, psuCache->achDay, sizeof(psuCache->achDay));
+        pchTime += sizeof(psuCache->achDay);
+        }
+
+    pchTime[0]  = (char)('0' + iHour / 10);
+    pchTime[1]  = (char)('0' + iHour % 10);
+    pchTime[2]  = ':';
+    pchTime[3]  = (char)('0' + iMin / 10);
+    pchTime[4]  = (char)('0' + iMin % 10);
+    pchTime[5]  = ':';
+    pchTime[6]  = (char)('0' + iSec / 10);
+    pchTime[7]  = (char)('0' + iSec % 10);
+    pchTime[8]  = '.';
+    pchTime[9]  = (char)('0' + iMilli / 100);
+    pchTime[10] = (char)('0' + iMilli / 10 % 10);
+    pchTime[11] = (char)('0' + iMilli % 10);
+    pchTime[12] = '\0';
+
+    return (int)(pchTime + 12 - szTime);
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+int I106_CALL_DECL 
+    iI106_IrigTime2String(SuIrig106Time       * psuTime,
+                          SuTimeStringCache   * psuCache,
+                          char                  szTime[])
+    {
+    SuTimeStringCache   suCache;
+
+    if (psuCache == NULL)
+        {
+        suCache.bValid = bFALSE;
+        psuCache       = &suCache;
+        }
+
+    return iTime2String((int64_t)psuTime->ulSecs, psuTime->ulFrac, psuTime->enFmt, psuCache, szTime);
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+void I106_CALL_DECL 
+    vI106_AbsTime2StringArray(const int64_t         allAbsTime[],
+                              int                   iCount,
+                              EnI106DateFmt         enFmt,
+                              SuTimeStringCache   * psuCache,
+                              char                  achTime[],
+                              int                   iStride)
+    {
+    SuTimeStringCache   suCache;
+    int64_t             llSecs;
+    int64_t             llFrac;
+    int                 iIdx;
+
+    if (psuCache == NULL)
+        {
+        suCache.bValid = bFALSE;
+        psuCache       = &suCache;
+        }
+
+    for (iIdx=0; iIdx<iCount; iIdx++)
+        {
+        llSecs = allAbsTime[iIdx] / 10000000;
+        llFrac = allAbsTime[iIdx] % 10000000;
+        if (llFrac < 0)
+            {
+            llFrac += 10000000;
+            llSecs -= 1;
+            }
+        iTime2String(llSecs, (uint32_t)llFrac, enFmt, psuCache, &achTime[(size_t)iIdx * iStride]);
+        }
+
+    return;
+    }
+
+
+
 /* ------------------------------------------------------------------------ */
 
 // This function fills in the SuTimeRef structure with the "best" relative 
@@ -761,6 +2801,71 @@ uint32_t I106_CALL_DECL mkgmtime(struct tm * psuTmTime)
 
 
 
+/* ------------------------------------------------------------------------ */
+
+// Date to day number and back.  These count years from March 1 so the leap
+// day is at the end of the year, and 400 year eras so the leap year rules 
+// are all inside an era.
+
+int64_t I106_CALL_DECL 
+    llI106_Date2Days(int iYear, int iMonth, int iDay)
+    {
+    int64_t     llYear;
+    int64_t     llEra;
+    int64_t     llYearOfEra;
+    int64_t     llDayOfYear;
+    int64_t     llDayOfEra;
+
+    // Roll months outside 1 - 12 over into the year
+    llYear  = (int64_t)iYear + (iMonth > 0 ? (iMonth - 1) / 12 : (iMonth - 12) / 12);
+    iMonth  = ((iMonth - 1) % 12 + 12) % 12 + 1;
+
+    llYear     -= iMonth <= 2 ? 1 : 0;
+    llEra       = (llYear >= 0 ? llYear : llYear - 399) / 400;
+    llYearOfEra = llYear - llEra * 400;
+    llDayOfYear = (153 * (iMonth > 2 ? iMonth - 3 : iMonth + 9) + 2) / 5 + iDay - 1;
+    llDayOfEra  = llYearOfEra * 365 + llYearOfEra / 4 - llYearOfEra / 100 + llDayOfYear;
+
+    return llEra * 146097 + llDayOfEra - 719468;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+void I106_CALL_DECL 
+    vI106_Days2Date(int64_t llDays, int * piYear, int * piMonth, int * piDay, int * piYearDay)
+    {
+    int64_t     llEra;
+    int64_t     llDayOfEra;
+    int64_t     llYearOfEra;
+    int64_t     llDayOfYear;
+    int         iMonthIdx;
+    int         bLeap;
+
+    llDays     += 719468;
+    llEra       = (llDays >= 0 ? llDays : llDays - 146096) / 146097;
+    llDayOfEra  = llDays - llEra * 146097;
+    llYearOfEra = (llDayOfEra - llDayOfEra/1460 + llDayOfEra/36524 - llDayOfEra/146096) / 365;
+    llDayOfYear = llDayOfEra - (365*llYearOfEra + llYearOfEra/4 - llYearOfEra/100);
+    iMonthIdx   = (int)((5*llDayOfYear + 2) / 153);
+
+    *piDay   = (int)(llDayOfYear - (153*iMonthIdx + 2)/5 + 1);
+    *piMonth = iMonthIdx < 10 ? iMonthIdx + 3 : iMonthIdx - 9;
+    *piYear  = (int)(llYearOfEra + llEra * 400 + (*piMonth <= 2 ? 1 : 0));
+
+    // Day of the year counting from January 1
+    bLeap = ((*piYear % 4) == 0) && (((*piYear % 100) != 0) || ((*piYear % 400) == 0));
+    if (iMonthIdx >= 10)
+        *piYearDay = (int)llDayOfYear - 306 + 1;
+    else
+        *piYearDay = (int)llDayOfYear + 59 + bLeap + 1;
+
+    return;
+    }
+
+
+
 
 
 #ifdef __cplusplus
@@ -55,12 +55,24 @@ extern "C" {
 #define CH4BINARYTIME_LOW_LSB_SEC      0.01
 #define _100_NANO_SEC_IN_MICRO_SEC    10
 
+// Size of the buffer needed for an IRIG time string including the null
+#define I106_TIME_STRING_SIZE         24
+
 typedef PUBLIC enum DateFmt
     {
     I106_DATEFMT_DAY         =  0,
     I106_DATEFMT_DMY         =  1,
     } EnI106DateFmt;
 
+// What a 64 bit nanosecond time value is counting from
+typedef PUBLIC enum NanoTimeType
+    {
+    I106_NANOTIME_NONE       =  0,      // No time available
+    I106_NANOTIME_ABS        =  1,      // Nanoseconds since 1970
+    I106_NANOTIME_ERTC       =  2,      // Extended relative time counter
+    I106_NANOTIME_TOY        =  3,      // Nanoseconds since the start of the year
+    } EnI106NanoTimeType;
+
 
 /*
  * Data structures
@@ -93,6 +105,79 @@ typedef PUBLIC struct SuTimeRef_S
     } SuTimeRef;
 
 
+/// One piece of the piecewise linear relative time to clock time model.  
+/// Absolute times are 100 nsec counts (see enI106_RelInt2AbsTimeArray()).
+typedef PUBLIC struct SuTimeSegment_S
+    {
+    int64_t         llRelTime;          ///< Relative time at start of segment
+    int64_t         llAbsTime;          ///< Absolute time at start of segment
+    int64_t         llRelTimeEnd;       ///< Relative time of last time packet in segment
+    double          dRate;              ///< Absolute time per relative time tick
+    } SuTimeSegment;
+
+/// Run of time model segments between relative time clock resets.  An
+/// epoch covers the data from its file offset up to the next epoch.
+typedef PUBLIC struct SuTimeEpoch_S
+    {
+    int64_t         llOffset;           ///< File offset the epoch starts at
+    int             iFirstSegment;      ///< First segment in the epoch
+    } SuTimeEpoch;
+
+/// Relative time to clock time model made from all the time packets in a 
+/// file.  A new segment starts when clock drift makes a straight line no 
+/// longer fit, and when the time source jumps.  When relative time goes 
+/// backwards (the RTC was reset) a new epoch starts.  Segments are in 
+/// relative time order within an epoch.  Conversions use the current epoch.
+/// A model with no epochs is treated as one epoch holding every segment.
+typedef PUBLIC struct SuTimeModel_S
+    {
+    SuTimeSegment * asuSegment;
+    int             iNumSegments;
+    int             iArraySize;
+    int             iCurrSegment;       ///< Segment used last, speeds up lookups
+    uint16_t        uTimeChanID;        ///< Channel ID of time packets used
+    EnI106DateFmt   enFmt;              ///< Date format of time packets used
+    SuTimeEpoch   * asuEpoch;
+    int             iNumEpochs;
+    int             iEpochArraySize;
+    int             iCurrEpoch;         ///< Epoch used for conversions
+    } SuTimeModel;
+
+
+// Date part of the last time string made.  Time strings on the same day 
+// reuse it.  Zero it out before first use.
+typedef PUBLIC struct SuTimeStringCache_S
+    {
+    int64_t         llDay;             // Days since 1970 of the cached date
+    int             bValid;            // Cached date is valid
+    char            achDMY[11];        // "2008/02/29 "
+    char            achDay[4];         // "060:"
+    } SuTimeStringCache;
+
+
+// Time packet found by enI106_FindTimePacket()
+typedef PUBLIC struct SuTimeSync_S
+    {
+    int64_t         llOffset;          // File offset of the time packet
+    int64_t         llRelTime;         // Relative time from header
+    SuIrig106Time   suIrigTime;        // Decoded clock time
+    uint16_t        uChID;             // Time channel ID
+    uint32_t        ulChanSpec;        // Time F1 channel specific data word
+    } SuTimeSync;
+
+
+// One decoded time packet
+typedef PUBLIC struct SuTimePacket_S
+    {
+    int64_t         llRelTime;         // Relative time from header
+    int64_t         llAbsTime;         // Clock time, 100 nsec since 1970
+    uint16_t        uChID;             // Time channel ID
+    uint8_t         ubyDataType;       // Time F1 or F2
+    uint8_t         ubyTimeSrc;        // F1 time source or F2 time status
+    EnI106DateFmt   enFmt;             // Day or DMY format
+    } SuTimePacket;
+
+
 /// IRIG 106 secondary header time in Ch 4 BCD format
 typedef PUBLIC struct SuI106Ch4_BCD_Time_S
     {
@@ -211,6 +296,88 @@ EnI106Status I106_CALL_DECL
                             int64_t           llRelTime,
                             SuIrig106Time   * psuTime);
 
+// Batch conversion of relative time to absolute time.  Absolute time is 
+// returned as a 64 bit count of 100 nsec ticks of IRIG time (i.e. ulSecs
+// times 10,000,000 plus ulFrac).  The input and output arrays may be the
+// same array.
+
+EnI106Status I106_CALL_DECL 
+    enI106_RelInt2AbsTimeArray(int               iI106Ch10Handle,
+                               const int64_t     allRelTime[],
+                               int64_t           allAbsTime[],
+                               int               iCount);
+
+EnI106Status I106_CALL_DECL 
+    enI106_RelInt2AbsTimeArray2(SuTimeRef       * psuRelTimeRef,
+                                const int64_t     allRelTime[],
+                                int64_t           allAbsTime[],
+                                int               iCount);
+
+// Same as above but for 6 byte relative time values spaced iStride bytes
+// apart, such as the relative time in a run of intra-packet headers
+EnI106Status I106_CALL_DECL 
+    enI106_Rel2AbsTimeArray2(SuTimeRef       * psuRelTimeRef,
+                             const uint8_t   * pabyRelTime,
+                             int               iStride,
+                             int64_t           allAbsTime[],
+                             int               iCount);
+
+// Time model
+// ----------
+// Once a handle has a time model enI106_Rel2IrigTime(), 
+// enI106_RelInt2IrigTime(), enI106_RelInt2AbsTimeArray(), and 
+// enI106_Irig2RelTime() use it instead of the single time reference.  If
+// the model has more than one epoch they use the epoch at the current read
+// position of the handle.
+
+// Make a time model from every time packet (format 1 and 2) in the file.
+EnI106Status I106_CALL_DECL 
+    enI106_MakeTimeModel(int     iI106Ch10Handle,
+                         int     bRequireSync);     // Require external time sync
+
+// Read the time model file if it matches the data file, otherwise make a 
+// new time model and write it out.  The time model file name defaults to the
+// data file name with ".tim" added if szModelFileName is NULL.
+EnI106Status I106_CALL_DECL 
+    enI106_LoadTimeModel(int           iI106Ch10Handle,
+                         int           bRequireSync,
+                         const char  * szModelFileName);
+
+// Decode every time packet (format 1 and 2) in the file, or just the ones
+// from channel iChanID if it isn't -1.  The array is malloc()'ed and it's up
+// to the caller to free() it.
+EnI106Status I106_CALL_DECL 
+    enI106_ReadTimePackets(int              iI106Ch10Handle,
+                           int              iChanID,
+                           SuTimePacket  ** pasuTimePacket,
+                           int            * piNumPackets);
+
+// Make the epoch holding the data at file offset llOffset the current epoch
+void I106_CALL_DECL 
+    vI106_TimeModelSetOffset(SuTimeModel   * psuModel,
+                             int64_t         llOffset);
+
+// Convert relative time to 64 bit absolute time with the current epoch of a
+// time model.  Returns 0 if the model has no segments.
+int64_t I106_CALL_DECL 
+    llI106_TimeModelRel2Abs(SuTimeModel   * psuModel,
+                            int64_t         llRelTime);
+
+// Convert 64 bit absolute time back to relative time with the current epoch
+// of a time model.  Returns 0 if the model has no segments.
+int64_t I106_CALL_DECL 
+    llI106_TimeModelAbs2Rel(SuTimeModel   * psuModel,
+                            int64_t         llAbsTime);
+
+void I106_CALL_DECL 
+    vI106_FreeTimeModel(SuTimeModel * psuModel);
+
+// Turn a 64 bit absolute time back into an IRIG time
+void I106_CALL_DECL 
+    vAbsInt2IrigTime(int64_t           llAbsTime,
+                     EnI106DateFmt     enFmt,
+                     SuIrig106Time   * psuTime);
+
 EnI106Status I106_CALL_DECL 
     enI106_Irig2RelTime(int              iI106Ch10Handle,
                         SuIrig106Time  * psuTime,
@@ -229,6 +396,54 @@ EnI106Status I106_CALL_DECL
                        SuIntraPacketTS  * psuIntraPacketTS, 
                        SuTimeRef        * psuTimeRef);
 
+// Nanosecond time
+// ---------------
+// SuIrig106Time only goes down to 100 nsec.  These keep time as a 64 bit
+// count of nanoseconds instead, either nanoseconds since 1970 (good until
+// 2262), the raw ERTC count, or for Ch 4 binary time nanoseconds since the
+// start of an unknown year.  All integer math so nothing gets rounded.
+
+int64_t I106_CALL_DECL 
+    llI106_IEEE15882NanoTime(const SuIEEE1588_Time * psuIEEE1588Time);
+
+int64_t I106_CALL_DECL 
+    llI106_ERTC2NanoTime(const SuERTC_Time * psuERTCTime);
+
+// Time of year, there's no year in Ch 4 binary time
+int64_t I106_CALL_DECL 
+    llI106_Ch4Binary2NanoTime(const SuI106Ch4_Binary_Time * psuCh4BinaryTime);
+
+int64_t I106_CALL_DECL 
+    llI106_IrigTime2NanoTime(const SuIrig106Time * psuTime);
+
+// Goes down to the 100 nsec resolution of IRIG time
+void I106_CALL_DECL 
+    vI106_NanoTime2IrigTime(int64_t           llNanoTime,
+                            EnI106DateFmt     enFmt,
+                            SuIrig106Time   * psuTime);
+
+// Best time for a packet, or for a message in it if psuIntraPacketTS isn't 
+// NULL.  IEEE-1588 time in the secondary header or intra-packet header is 
+// used as is and Ch 4 binary time is returned as I106_NANOTIME_TOY.  
+// Relative time and ERTC are turned into absolute time with the handle's 
+// time reference or time model.  ERTC is returned raw as I106_NANOTIME_ERTC
+// if that can't be done.
+EnI106NanoTimeType I106_CALL_DECL 
+    enI106_PacketNanoTime(int                 iI106Ch10Handle,
+                          SuI106Ch10Header  * psuHeader,
+                          SuIntraPacketTS   * psuIntraPacketTS,
+                          int64_t           * pllNanoTime);
+
+// Same as above for a run of intra-packet time stamps spaced iStride bytes 
+// apart, such as one for every frame in an Ethernet packet
+EnI106NanoTimeType I106_CALL_DECL 
+    enI106_IntraPktNanoTimeArray(int                 iI106Ch10Handle,
+                                 SuI106Ch10Header  * psuHeader,
+                                 const uint8_t     * pabyIntPktTime,
+                                 int                 iStride,
+                                 int64_t             allNanoTime[],
+                                 int                 iCount);
+
 // Warning - array to int / int to array functions are little endian only!
 
 void I106_CALL_DECL 
@@ -240,25 +455,89 @@ void I106_CALL_DECL
     vTimeArray2LLInt(uint8_t   abyRelTime[],
                      int64_t * pllRelTime);
 
-
+// Find the first time F1 packet at or after a file offset, without changing
+// the read position.  Time packets are found from the file index (see 
+// enReadIndexes()) if there is one.  Results are remembered per file so 
+// finding the same time packet again, from this or another handle, doesn't
+// read through the file again.
+EnI106Status I106_CALL_DECL 
+    enI106_FindTimePacket(int            iI106Ch10Handle,
+                          int64_t        llStartOffset,
+                          int            bRequireSync,       // Require external time sync
+                          int            iTimeLimit,         // Max scan ahead time in seconds, 0 = no limit
+                          SuTimeSync   * psuTimeSync);
+
+// Set the time reference from the first time packet after the current 
+// read position
 EnI106Status I106_CALL_DECL 
     enI106_SyncTime(int     iI106Ch10Handle,
                     int     bRequireSync,       // Require external time sync
                     int     iTimeLimit);        // Max scan ahead time in seconds, 0 = no limit
 
+// Time seeking needs a sorted in-order index (see vMakeInOrderIndex()).  The
+// read position is moved to the first packet at or after the seek time, and 
+// if the seek time is before the start of the recording then to the start of
+// the file.  If no packet is that late I106_TIME_NOT_FOUND is returned and the
+// read position is left at the last packet.  The channel versions find the 
+// first packet from channel iChanID, or any channel if iChanID is -1.  Any
+// other channel ID outside 0 - 0xFFFF returns I106_INVALID_PARAMETER.  A 
+// channel that isn't close by is looked up in the channel time tables if 
+// they have been made with enMakeChanIndexes(), otherwise packet headers are
+// read through the index until one turns up.
+
 EnI106Status I106_CALL_DECL 
     enI106Ch10SetPosToIrigTime(int iI106Ch10Handle, SuIrig106Time * psuSeekTime);
 
+EnI106Status I106_CALL_DECL 
+    enI106Ch10SetPosToIrigTimeChan(int              iI106Ch10Handle, 
+                                   SuIrig106Time  * psuSeekTime,
+                                   int              iChanID);
+
+EnI106Status I106_CALL_DECL 
+    enI106Ch10SetPosToRelTime(int       iI106Ch10Handle, 
+                              int64_t   llSeekTime,
+                              int       iChanID);
+
 
 // General purpose time utilities
 // ------------------------------
 
-// Convert IRIG time into an appropriate string
+// Convert IRIG time into an appropriate string.  The returned string is in
+// a static buffer and gets overwritten by the next call.
 char * IrigTime2String(SuIrig106Time * psuTime);
 
+// Reentrant version of IrigTime2String().  The string goes into szTime, 
+// which needs to be at least I106_TIME_STRING_SIZE long.  psuCache may be 
+// NULL but formatting is faster with one, one per thread.  Returns the 
+// string length.
+int I106_CALL_DECL 
+    iI106_IrigTime2String(SuIrig106Time       * psuTime,
+                          SuTimeStringCache   * psuCache,
+                          char                  szTime[]);
+
+// Convert an array of 64 bit absolute times (see enI106_RelInt2AbsTimeArray())
+// into strings.  String i goes into achTime + i * iStride, and iStride needs
+// to be at least I106_TIME_STRING_SIZE.
+void I106_CALL_DECL 
+    vI106_AbsTime2StringArray(const int64_t         allAbsTime[],
+                              int                   iCount,
+                              EnI106DateFmt         enFmt,
+                              SuTimeStringCache   * psuCache,
+                              char                  achTime[],
+                              int                   iStride);
+
 // This is handy enough that we'll go ahead and export it to the world
 uint32_t I106_CALL_DECL mkgmtime(struct tm * psuTmTime);
 
+// Days since 1970 from a date, and back again.  Integer math only and none 
+// of the normalizing that mkgmtime() does, other than months outside 1 - 12
+// rolling over into the year.  Day of year is from 1.
+int64_t I106_CALL_DECL 
+    llI106_Date2Days(int iYear, int iMonth, int iDay);
+
+void I106_CALL_DECL 
+    vI106_Days2Date(int64_t llDays, int * piYear, int * piMonth, int * piDay, int * piYearDay);
+
 #ifdef __cplusplus
 } // end extern "C"
 } // end namespace i106
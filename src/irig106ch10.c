@@ -35,6 +35,10 @@
 
  ****************************************************************************/
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE                 // For fallocate()
+#endif
+
 #if defined(__GNUC__)
 #ifndef _FILE_OFFSET_BITS
 #define _FILE_OFFSET_BITS 64
@@ -51,12 +55,19 @@
 #include <sys/stat.h>
 #include <errno.h>
 #include <assert.h>
+#include <time.h>
 
 #if !defined(_WIN32)
 #include <sys/io.h>
+#include <sys/mman.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/uio.h>
 #else
 #include <io.h>
+#include <windows.h>
+#include <process.h>
 #endif
 
 #if defined(IRIG_NETWORKING) & !defined(_WIN32)
@@ -68,11 +79,16 @@
 
 #include "irig106ch10.h"
 #include "i106_time.h"
+#include "i106_index.h"
 
 #if defined(IRIG_NETWORKING)
 #include "i106_data_stream.h"
 #endif
 
+#if defined(I106_SSE2)
+#include <emmintrin.h>
+#endif
+
 #ifdef __cplusplus
 namespace Irig106 {
 #endif
@@ -84,12 +100,156 @@ namespace Irig106 {
 
 #define BACKUP_SIZE     256
 
+// Amount to read ahead right after a seek, before sequential reading resumes
+#define READ_AHEAD_SEEK_SIZE    0x1000
+
+#if !defined(INT64_MAX)
+#define INT64_MAX               ((int64_t)(~(uint64_t)0 >> 1))
+#endif
+
+// Block size to scan through when looking for the next good header
+#define SYNC_SCAN_SIZE          0x4000
+
+// Block size to scan through when looking backwards for a good header. Blocks
+// start on multiples of this size and overlap the next block by a header.
+#define REV_SCAN_SIZE           0x10000
+#define REV_BUFF_SIZE           (REV_SCAN_SIZE + HEADER_SIZE - 1)
+
+// How long the writer thread (or a blocked producer) waits on the ring. It
+// yields this many times and then sleeps.
+#define WRITE_THREAD_SPIN_COUNT 1000
+#define WRITE_THREAD_POLL_MS    1
+
+// In order index file identification.  The source file is identified by its
+// size, modify time, and a hash of the data at each end.
+#define INDEX_FILE_MAGIC        "I106IDX"
+#define INDEX_FILE_VERSION      1
+#define INDEX_HASH_SIZE         0x10000
+
+// Atomic load and store of the write ring counters
+#if defined(_WIN32)
+#define RING_LOAD(pllCount)         InterlockedCompareExchange64((volatile LONG64 *)(pllCount), 0, 0)
+#define RING_STORE(pllCount, llVal) InterlockedExchange64((volatile LONG64 *)(pllCount), (LONG64)(llVal))
+#else
+#define RING_LOAD(pllCount)         __atomic_load_n((pllCount), __ATOMIC_ACQUIRE)
+#define RING_STORE(pllCount, llVal) __atomic_store_n((pllCount), (llVal), __ATOMIC_RELEASE)
+#endif
+
+// Atomic load and store of flags shared between threads
+#if defined(_WIN32)
+#define FLAG_LOAD(pbFlag)           InterlockedCompareExchange((volatile LONG *)(pbFlag), 0, 0)
+#define FLAG_STORE(pbFlag, bVal)    InterlockedExchange((volatile LONG *)(pbFlag), (LONG)(bVal))
+#else
+#define FLAG_LOAD(pbFlag)           __atomic_load_n((pbFlag), __ATOMIC_ACQUIRE)
+#define FLAG_STORE(pbFlag, bVal)    __atomic_store_n((pbFlag), (bVal), __ATOMIC_RELEASE)
+#endif
+
 
 /*
  * Data structures
  * ---------------
  */
 
+// Work for one thread of a parallel file scan
+typedef struct
+    {
+    int                     iThread;
+    int                     iHandle;
+    int64_t                 llRangeStart;   // Start of this thread's byte range
+    int64_t                 llRangeEnd;     // Start of next thread's byte range
+    PFnI106PacketHandler    pfnHandler;
+    void                  * pvUserData;
+    int                   * pbAbort;        // Set to stop all threads, see FLAG_LOAD()
+    EnI106Ch10Mode          enMode;         // Read mode to open the file with
+    int                     bReadData;      // False to hand off headers only
+    int                     bFindStop;      // Just find where the packet chain leaves the range
+    int64_t                 llStartOffset;  // First packet to hand off
+    int64_t                 llStopOffset;   // First packet of the next range
+    EnI106Status            enStatus;
+    } SuScanWorker;
+
+// Index array and channel summary for making an in order index
+typedef struct
+    {
+    SuInOrderPacketInfo   * asuIndex;
+    int                     iArraySize;
+    int                     iArrayUsed;
+    uint32_t              * aulChanSlot;    // Channel ID to channel info index + 1
+    SuInOrderChanInfo     * asuChanInfo;
+    int                     iNumChans;
+    } SuIndexScanArray;
+
+// In order index file header.  It is followed by the channel summary and 
+// then the index entries, all in native byte order.
+typedef struct
+    {
+    char                    achMagic[8];
+    uint32_t                ulVersion;
+    uint32_t                ulHeaderSize;
+    int64_t                 llSourceSize;   // Data file size
+    int64_t                 llSourceTime;   // Data file modify time
+    uint64_t                ullSourceHash;  // Hash of data at each end of the file
+    uint32_t                ulNumEntries;
+    uint32_t                ulNumChans;
+    } SuInOrderIndexFileHdr;
+
+// One packet held in the time order window
+typedef struct
+    {
+    int64_t                 llTime;         // Header RTC
+    int64_t                 llSeq;          // Read order, keeps equal times in order
+    int64_t                 llOffset;       // File offset of the header, -1 if unknown
+    unsigned long           ulHeaderLen;
+    unsigned long           ulPacketLen;
+    unsigned char         * pchPacket;      // Header followed by data
+    } SuReorderPacket;
+
+// Time order window.  Packets are kept in a min-heap ordered by time.  The 
+// oldest one comes out once something llHorizon newer has been read.
+typedef struct SuReorder_S
+    {
+    int64_t                 llHorizon;
+    unsigned long           ulMaxBytes;
+    unsigned long           ulBytesUsed;
+    SuReorderPacket       * asuHeap;
+    int                     iHeapSize;
+    int                     iHeapUsed;
+    int64_t                 llNewestTime;   // Newest RTC read into the window
+    int64_t                 llNextSeq;
+    int                     bSourceDone;    // Hit EOF reading ahead
+    int                     bBusy;          // Reading ahead, so seeks are our own
+    int                     bCurrValid;     // suCurr holds the packet just returned
+    int                     bCurrDataRead;
+    int                     bCurrPutBack;   // Hand suCurr out again on the next read
+    SuReorderPacket         suCurr;
+    } SuReorder;
+
+// Background writer thread and its ring buffer.  There is one producer (the
+// caller of the write routines) and one consumer (the writer thread) so the
+// ring only needs atomic loads and stores of the head and tail counts.  The
+// statistics have a single writer too, but enI106Ch10GetWriteStats() can read
+// them from any thread so they are loaded and stored atomically as well.
+typedef struct SuWriteThread_S
+    {
+    int                     iHandle;
+    unsigned char         * pchRing;
+    unsigned long           ulRingSize;
+    volatile int64_t        llHead;         // Total bytes put in the ring, producer owned
+    volatile int64_t        llTail;         // Total bytes taken out of the ring, consumer owned
+    volatile int64_t        bStop;          // Set to make the writer thread finish up
+    volatile EnI106Status   enWriteStatus;  // First write error seen by the writer thread, see FLAG_LOAD()
+    int64_t                 llStartOffset;  // File offset when the writer thread started
+    EnI106WritePolicy       enPolicy;
+    volatile int64_t        llHighWater;    // Producer owned, see RING_LOAD()
+    volatile int64_t        llPacketsDropped;
+    volatile int64_t        llBytesDropped;
+#if defined(_WIN32)
+    HANDLE                  hThread;
+#else
+    pthread_t               hThread;
+#endif
+    } SuWriteThread;
+
 /*
 struct SuInOrderHdrInfo
     {
@@ -104,30 +264,91 @@ struct SuInOrderHdrInfo
  * -----------
  */
 
-SuI106Ch10Handle  g_suI106Handle[MAX_HANDLES];
-static int        m_bHandlesInited = bFALSE;
-
-// In order read linked list pointers
-/*
-struct SuInOrderHdrInfo   * m_psuFirstInOrderHdr  = NULL;
-struct SuInOrderHdrInfo   * m_psuLastInOrderHdr   = NULL;
-struct SuInOrderHdrInfo   * m_psuCurrInOrderHdr   = NULL;
+// Handle table.  Pages of handles are allocated as needed and are never 
+// freed or moved so a handle pointer stays good for as long as it is open.
+// Unused handles are chained together through iNextFree.
+static SuI106Ch10Handle * m_apsuHandlePage[I106_HANDLE_PAGES];
+static int                m_iHandlePages = 0;
+static int                m_iFreeHandle  = -1;
 
-struct SuInOrderHdrInfo   * m_psuFirstInOrderFree = NULL;
-*/
+// Lock for handle allocation and release.  A critical section has no static
+// initializer so it is set up by whichever thread gets to it first.
+#if defined(_WIN32)
+static CRITICAL_SECTION m_suHandleLock;
+static volatile LONG    m_lHandleLockInit  = 0;
+static volatile LONG    m_lHandleLockReady = 0;
+static void vLockHandles(void);
+#define LOCK_HANDLES()      vLockHandles()
+#define UNLOCK_HANDLES()    LeaveCriticalSection(&m_suHandleLock)
+#else
+static pthread_mutex_t  m_suHandleLock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK_HANDLES()      pthread_mutex_lock(&m_suHandleLock)
+#define UNLOCK_HANDLES()    pthread_mutex_unlock(&m_suHandleLock)
+#endif
 
 /*
  * Function Declaration
  * --------------------
  */
 
-void InitHandles();
 int GetNextHandle();
-
-#ifdef LOOK_AHEAD
-void vCheckFillLookAheadBuffer(int iHandle);
+void vReleaseHandle(int iHandle);
+
+static int iReadFile(int iHandle, void * pvBuff, unsigned long ulReadAmount);
+static EnI106Status enWriteFile(int iHandle, const void * apvSeg[], const unsigned long aulSegLen[], int iNumSegs);
+static EnI106Status enWriteDirect(int iHandle, const void * apvSeg[], const unsigned long aulSegLen[], int iNumSegs,
+                                  unsigned long * pulWritten);
+static EnI106Status enFlushWriteBuff(int iHandle);
+static int64_t llGetMilliSecs(void);
+static EnI106Status enWriteRing(SuWriteThread * psuWriter, const void * apvSeg[], const unsigned long aulSegLen[], int iNumSegs);
+static EnI106Status enDrainWriteRing(SuWriteThread * psuWriter);
+static void vWriteThread(SuWriteThread * psuWriter);
+static void vRingWait(int * piWaitCount);
+#if defined(_WIN32)
+static unsigned __stdcall uWriteThread(void * pvWriter);
+#else
+static void * pvWriteThread(void * pvWriter);
+#endif
+static EnI106Status enResyncFile(int iHandle, int64_t llStartOffset);
+static EnI106Status enFindPrevHeader(int iHandle, int64_t llBeforeOffset, int64_t * pllHeaderOffset);
+static int iFindSync(const uint8_t * pbyBuff, int iBuffLen);
+static int iFindSyncReverse(const uint8_t * pbyBuff, int iCandidates);
+static int bGoodHeader(const uint8_t * pbyBuff);
+static int bFilterPass(SuI106Ch10Filter * psuFilter, SuI106Ch10Header * psuHeader);
+static EnI106Status enReadPrevHeaderUnfiltered(int iHandle, SuI106Ch10Header * psuHeader);
+static SuI106Ch10Filter * psuGetFilter(int iHandle, EnI106Status * penStatus);
+static EnI106Status enFindFirstHeader(int iHandle, int64_t llOffset, int64_t * pllHeaderOffset);
+static EnI106Status enFollowChain(int iHandle, int64_t llOffset, int64_t llBoundary, int64_t * pllStopOffset);
+static EnI106Status enScanFile(const char szFileName[], int iNumThreads, 
+                               EnI106Ch10Mode enMode, int bReadData,
+                               PFnI106PacketHandler pfnHandler, void * pvUserData);
+static EnI106Status enRunScanWorkers(SuScanWorker asuWorker[], int iNumWorkers);
+static void vScanWorker(SuScanWorker * psuWorker);
+#if defined(_WIN32)
+static unsigned __stdcall uScanWorkerThread(void * pvWorker);
+#else
+static void * pvScanWorkerThread(void * pvWorker);
 #endif
 
+static EnI106Status enReadNextHeaderReorder(int iHandle, SuI106Ch10Header * psuHeader);
+static EnI106Status enReadDataReorder(int iHandle, unsigned long ulBuffSize, void * pvBuff);
+static EnI106Status enFillReorder(int iHandle);
+static void vResetReorder(SuReorder * psuReorder);
+static void vPutBackHeader(int iHandle, int64_t llOffset);
+static int  bIndexArrayAdd(SuIndexScanArray * psuArray, int64_t llOffset, SuI106Ch10Header * psuHeader);
+static void vFreeIndexArray(SuIndexScanArray * psuArray);
+static int  bMergeChanInfo(SuInOrderIndex * psuIndex, SuIndexScanArray asuArray[], int iNumArrays);
+static int  ChanInfoCompare(const void * psuChanInfo1, const void * psuChanInfo2);
+static void vFreeInOrderIndex(SuInOrderIndex * psuIndex);
+static int  bWriteAll(int iFile, const void * pvBuff, int64_t llLen);
+static EnI106Status enMakeIndexSerial(int iHandle);
+static void vSortInOrderIndex(SuInOrderPacketInfo * asuIndex, int iNumIndex);
+static void vFreeReorder(int iHandle);
+static int  bReorderBefore(SuReorderPacket * psuPacket1, SuReorderPacket * psuPacket2);
+static int  bGrowReorderHeap(SuReorder * psuReorder);
+static void vHeapPush(SuReorder * psuReorder, SuReorderPacket * psuPacket);
+static void vHeapPop(SuReorder * psuReorder, SuReorderPacket * psuPacket);
+
 /* ----------------------------------------------------------------------- */
 
 const char* szGetVersion()
@@ -147,12 +368,10 @@ EnI106Status I106_CALL_DECL
     int                 iFlags;
     int                 iFileMode;
     uint16_t            uSignature;
+    int                 bTmatsFirst;
     EnI106Status        enStatus;
     SuI106Ch10Header    suI106Hdr;
 
-    // Initialize handle data if necessary
-    InitHandles();
-
     // Get the next available handle
     *piHandle = GetNextHandle();
     if (*piHandle == -1)
@@ -161,20 +380,42 @@ EnI106Status I106_CALL_DECL
         } // end if handle not found
 
     // Initialize some data
-    g_suI106Handle[*piHandle].enFileState                 = enClosed;
-    g_suI106Handle[*piHandle].suInOrderIndex.enSortStatus = enUnsorted;
+    psuI106Handle(*piHandle)->enFileState                 = enClosed;
+    psuI106Handle(*piHandle)->suInOrderIndex.enSortStatus = enUnsorted;
 
     // Get a copy of the file name
-    strncpy (g_suI106Handle[*piHandle].szFileName, szFileName, sizeof(g_suI106Handle[*piHandle].szFileName));
-    g_suI106Handle[*piHandle].szFileName[sizeof(g_suI106Handle[*piHandle].szFileName) - 1] = '\0';
+    strncpy (psuI106Handle(*piHandle)->szFileName, szFileName, sizeof(psuI106Handle(*piHandle)->szFileName));
+    psuI106Handle(*piHandle)->szFileName[sizeof(psuI106Handle(*piHandle)->szFileName) - 1] = '\0';
 
     // Reset total bytes written
-    g_suI106Handle[*piHandle].ulTotalBytesWritten = 0L;
+    psuI106Handle(*piHandle)->ulTotalBytesWritten = 0L;
+
+    // No file mapping yet
+    psuI106Handle(*piHandle)->pchMapBase = NULL;
+    psuI106Handle(*piHandle)->llMapSize  = 0L;
+    psuI106Handle(*piHandle)->llMapPos   = 0L;
+
+    // No read ahead buffer yet.  It gets allocated on the first read.
+    psuI106Handle(*piHandle)->pchReadBuff      = NULL;
+    psuI106Handle(*piHandle)->ulReadBuffLen    = 0L;
+    psuI106Handle(*piHandle)->ulReadBuffPos    = 0L;
+    psuI106Handle(*piHandle)->llReadBuffOffset = 0L;
+    psuI106Handle(*piHandle)->bReadBuffSeek    = bFALSE;
+    psuI106Handle(*piHandle)->pchRevBuff       = NULL;
+    psuI106Handle(*piHandle)->llRevBuffOffset  = -1L;
+    psuI106Handle(*piHandle)->iRevBuffLen      = 0;
+
+    // No read filter
+    psuI106Handle(*piHandle)->psuFilter        = NULL;
+    if ((I106_READ == enMode) || (I106_READ_IN_ORDER == enMode))
+        psuI106Handle(*piHandle)->ulReadBuffSize = I106_READ_AHEAD_DEFAULT;
+    else
+        psuI106Handle(*piHandle)->ulReadBuffSize = 0L;
 
 /*** Read Mode ***/
 
     // Open for read
-    if ((I106_READ == enMode) || (I106_READ_IN_ORDER == enMode))
+    if ((I106_READ == enMode) || (I106_READ_IN_ORDER == enMode) || (I106_READ_MMAP == enMode))
         {
 
         //// Try to open file
@@ -185,24 +426,72 @@ EnI106Status I106_CALL_DECL
 #else
         iFlags = O_RDONLY;
 #endif
-        g_suI106Handle[*piHandle].iFile = open(szFileName, iFlags, 0);
-        if (g_suI106Handle[*piHandle].iFile == -1)
+        psuI106Handle(*piHandle)->iFile = open(szFileName, iFlags, 0);
+        if (psuI106Handle(*piHandle)->iFile == -1)
             {
-            g_suI106Handle[*piHandle].bInUse = bFALSE;
+            vReleaseHandle(*piHandle);
             *piHandle = -1;
             return I106_OPEN_ERROR;
             }
+
+        //// If memory mapped then map the whole file
+
+        if (I106_READ_MMAP == enMode)
+            {
+#if defined(_WIN32)
+            close(psuI106Handle(*piHandle)->iFile);
+            vReleaseHandle(*piHandle);
+            *piHandle = -1;
+            return I106_UNSUPPORTED;
+#else
+            struct stat     suStatBuff;
+            void          * pvMap;
+
+            // Get the file size. Make sure it can be mapped in one piece.
+            if ((fstat(psuI106Handle(*piHandle)->iFile, &suStatBuff) != 0) ||
+                (suStatBuff.st_size < 2)                                    ||
+                ((uint64_t)suStatBuff.st_size > (uint64_t)(size_t)-1))
+                {
+                close(psuI106Handle(*piHandle)->iFile);
+                vReleaseHandle(*piHandle);
+                *piHandle = -1;
+                return I106_OPEN_ERROR;
+                }
+
+            pvMap = mmap(NULL, (size_t)suStatBuff.st_size, PROT_READ, MAP_SHARED, 
+                         psuI106Handle(*piHandle)->iFile, 0);
+            if (pvMap == MAP_FAILED)
+                {
+                close(psuI106Handle(*piHandle)->iFile);
+                vReleaseHandle(*piHandle);
+                *piHandle = -1;
+                return I106_OPEN_ERROR;
+                }
+
+            // Data will mostly be read front to back so let the kernel read ahead
+            madvise(pvMap, (size_t)suStatBuff.st_size, MADV_SEQUENTIAL);
+
+            psuI106Handle(*piHandle)->pchMapBase = (unsigned char *)pvMap;
+            psuI106Handle(*piHandle)->llMapSize  = (int64_t)suStatBuff.st_size;
+            psuI106Handle(*piHandle)->llMapPos   = 0L;
+#endif
+            } // end if memory mapped
     
         //// Check to make sure it is a valid IRIG 106 Ch 10 data file
 
         // Check for valid signature
 
         // If we couldn't even read the first 2 bytes then return error
-        iReadCnt = read(g_suI106Handle[*piHandle].iFile, &uSignature, 2);
+        iReadCnt = read(psuI106Handle(*piHandle)->iFile, &uSignature, 2);
         if (iReadCnt != 2)
             {
-            close(g_suI106Handle[*piHandle].iFile);
-            g_suI106Handle[*piHandle].bInUse = bFALSE;
+#if !defined(_WIN32)
+            if (psuI106Handle(*piHandle)->pchMapBase != NULL)
+                munmap(psuI106Handle(*piHandle)->pchMapBase, (size_t)psuI106Handle(*piHandle)->llMapSize);
+            psuI106Handle(*piHandle)->pchMapBase = NULL;
+#endif
+            close(psuI106Handle(*piHandle)->iFile);
+            vReleaseHandle(*piHandle);
             *piHandle = -1;
             return I106_OPEN_ERROR;
             }
@@ -210,8 +499,13 @@ EnI106Status I106_CALL_DECL
         // If the first word isn't the sync value then return error
         if (uSignature != IRIG106_SYNC)
             {
-            close(g_suI106Handle[*piHandle].iFile);
-            g_suI106Handle[*piHandle].bInUse = bFALSE;
+#if !defined(_WIN32)
+            if (psuI106Handle(*piHandle)->pchMapBase != NULL)
+                munmap(psuI106Handle(*piHandle)->pchMapBase, (size_t)psuI106Handle(*piHandle)->llMapSize);
+            psuI106Handle(*piHandle)->pchMapBase = NULL;
+#endif
+            close(psuI106Handle(*piHandle)->iFile);
+            vReleaseHandle(*piHandle);
             *piHandle = -1;
             return I106_OPEN_ERROR;
             }
@@ -219,17 +513,15 @@ EnI106Status I106_CALL_DECL
         //// Reading data file looks OK so check some other stuff
 
         // Open OK and sync character OK so set read state to reflect this
-        g_suI106Handle[*piHandle].enFileMode  = enMode;
-        g_suI106Handle[*piHandle].enFileState = enReadHeader;
+        psuI106Handle(*piHandle)->enFileMode  = enMode;
+        psuI106Handle(*piHandle)->enFileState = enReadHeader;
 
-        // Make sure first packet is a config packet
-//      fseek(g_suI106Handle[*piHandle].pFile, 0L, SEEK_SET);
+        // Make sure first packet is a config packet.  If it isn't the file
+        // is still opened the same way, it just gets a warning.
+//      fseek(psuI106Handle(*piHandle)->pFile, 0L, SEEK_SET);
         enI106Ch10SetPos(*piHandle, 0L);
         enStatus = enI106Ch10ReadNextHeaderFile(*piHandle, &suI106Hdr);
-        if (enStatus != I106_OK)
-            return I106_OPEN_WARNING;
-        if (suI106Hdr.ubyDataType != I106CH10_DTYPE_COMPUTER_1)
-            return I106_OPEN_WARNING;
+        bTmatsFirst = (enStatus == I106_OK) && (suI106Hdr.ubyDataType == I106CH10_DTYPE_COMPUTER_1);
 
 //        // Make sure first dynamic data packet is a time packet
 // THERE MAY BE MULTIPLE COMPUTER GENERATED PACKETS AT THE BEGINNING
@@ -241,20 +533,27 @@ EnI106Status I106_CALL_DECL
 //            return I106_OPEN_WARNING;
 
         // Everything OK so get time and reset back to the beginning
-//      fseek(g_suI106Handle[*piHandle].pFile, 0L, SEEK_SET);
+//      fseek(psuI106Handle(*piHandle)->pFile, 0L, SEEK_SET);
         enI106Ch10SetPos(*piHandle, 0L);
-        g_suI106Handle[*piHandle].enFileState = enReadHeader;
-        g_suI106Handle[*piHandle].enFileMode  = enMode;
+        psuI106Handle(*piHandle)->enFileState = enReadHeader;
+        psuI106Handle(*piHandle)->enFileMode  = enMode;
 
         // Do any presorting or indexing
 
         if (I106_READ_IN_ORDER == enMode)
         {
-            g_suI106Handle[*piHandle].suInOrderIndex.iArrayUsed = 0;
-            //vMakeInOrderIndex(*piHandle);
-            g_suI106Handle[*piHandle].suInOrderIndex.iArrayCurr = 0;
+            psuI106Handle(*piHandle)->suInOrderIndex.iArrayUsed = 0;
+            psuI106Handle(*piHandle)->suInOrderIndex.iArrayCurr = 0;
+
+            // Read in time order through a window rather than indexing the
+            // whole file up front
+            enI106Ch10SetReorderWindow(*piHandle, I106_REORDER_HORIZON_DEFAULT, 
+                                       I106_REORDER_MAX_BYTES_DEFAULT);
         }
 
+        if (!bTmatsFirst)
+            return I106_OPEN_WARNING;
+
         } // end if read mode
 
 
@@ -275,17 +574,17 @@ EnI106Status I106_CALL_DECL
         iFlags    = O_WRONLY | O_CREAT;
         iFileMode = 0;
 #endif
-        g_suI106Handle[*piHandle].iFile = open(szFileName, iFlags, iFileMode);
-        if (g_suI106Handle[*piHandle].iFile == -1)
+        psuI106Handle(*piHandle)->iFile = open(szFileName, iFlags, iFileMode);
+        if (psuI106Handle(*piHandle)->iFile == -1)
             {
-            g_suI106Handle[*piHandle].bInUse = bFALSE;
+            vReleaseHandle(*piHandle);
             *piHandle = -1;
             return I106_OPEN_ERROR;
             }
 
         // Open OK and write state to reflect this
-        g_suI106Handle[*piHandle].enFileState = enWrite;
-        g_suI106Handle[*piHandle].enFileMode  = enMode;
+        psuI106Handle(*piHandle)->enFileState = enWrite;
+        psuI106Handle(*piHandle)->enFileMode  = enMode;
         } // end if read mode
 
 
@@ -293,9 +592,9 @@ EnI106Status I106_CALL_DECL
 
     else
         {
-        g_suI106Handle[*piHandle].enFileState = enClosed;
-        g_suI106Handle[*piHandle].enFileMode  = I106_CLOSED;
-        g_suI106Handle[*piHandle].bInUse = bFALSE;
+        psuI106Handle(*piHandle)->enFileState = enClosed;
+        psuI106Handle(*piHandle)->enFileMode  = I106_CLOSED;
+        vReleaseHandle(*piHandle);
         *piHandle = -1;
         return I106_OPEN_ERROR;
         }
@@ -318,9 +617,6 @@ EnI106Status I106_CALL_DECL
     {
     EnI106Status    enStatus;
 
-    // Initialize handle data if necessary
-    InitHandles();
-
     // Get the next available handle
     *piHandle = GetNextHandle();
     if (*piHandle == -1)
@@ -329,15 +625,20 @@ EnI106Status I106_CALL_DECL
         } // end if handle not found
 
     // Initialize some data
-    g_suI106Handle[*piHandle].enFileState                 = enClosed;
-    g_suI106Handle[*piHandle].suInOrderIndex.enSortStatus = enUnsorted;
+    psuI106Handle(*piHandle)->enFileState                 = enClosed;
+    psuI106Handle(*piHandle)->suInOrderIndex.enSortStatus = enUnsorted;
 
     // Open the network data stream
     enStatus = enI106_OpenNetStreamRead(*piHandle, uPort);
     if (enStatus == I106_OK)
         {
-        g_suI106Handle[*piHandle].enFileMode  = I106_READ_NET_STREAM;
-        g_suI106Handle[*piHandle].enFileState = enReadHeader;
+        psuI106Handle(*piHandle)->enFileMode  = I106_READ_NET_STREAM;
+        psuI106Handle(*piHandle)->enFileState = enReadHeader;
+        }
+    else
+        {
+        enI106_CloseNetStream(*piHandle);
+        vReleaseHandle(*piHandle);
         }
 
     return enStatus;
@@ -354,9 +655,6 @@ EnI106Status I106_CALL_DECL
     {
     EnI106Status    enStatus;
 
-    // Initialize handle data if necessary
-    InitHandles();
-
     // Get the next available handle
     *piHandle = GetNextHandle();
     if (*piHandle == -1)
@@ -365,15 +663,20 @@ EnI106Status I106_CALL_DECL
         } // end if handle not found
 
     // Initialize some data
-    g_suI106Handle[*piHandle].enFileState                 = enClosed;
-//    g_suI106Handle[*piHandle].suInOrderIndex.enSortStatus = enUnsorted;
+    psuI106Handle(*piHandle)->enFileState                 = enClosed;
+//    psuI106Handle(*piHandle)->suInOrderIndex.enSortStatus = enUnsorted;
 
     // Open the network data stream
     enStatus = enI106_OpenNetStreamWrite(*piHandle, uIpAddress, uPort);
     if (enStatus == I106_OK)
         {
-        g_suI106Handle[*piHandle].enFileMode  = I106_WRITE_NET_STREAM;
-//        g_suI106Handle[*piHandle].enFileState = enReadHeader;
+        psuI106Handle(*piHandle)->enFileMode  = I106_WRITE_NET_STREAM;
+//        psuI106Handle(*piHandle)->enFileState = enReadHeader;
+        }
+    else
+        {
+        enI106_CloseNetStream(*piHandle);
+        vReleaseHandle(*piHandle);
         }
 
     return enStatus;
@@ -392,9 +695,6 @@ EnI106Status I106_CALL_DECL
 
     EnI106Status    enStatus;
 
-    // Initialize handle data if necessary
-    InitHandles();
-
     // Get the next available handle
     *piHandle = GetNextHandle();
     if (*piHandle == -1)
@@ -403,15 +703,20 @@ EnI106Status I106_CALL_DECL
         } // end if handle not found
 
     // Initialize some data
-    g_suI106Handle[*piHandle].enFileState                 = enClosed;
-    g_suI106Handle[*piHandle].suInOrderIndex.enSortStatus = enUnsorted;
+    psuI106Handle(*piHandle)->enFileState                 = enClosed;
+    psuI106Handle(*piHandle)->suInOrderIndex.enSortStatus = enUnsorted;
 
     // Open the network data stream
     enStatus = enI106_OpenPcapStreamRead(*piHandle, uUdpDestPort, szPcapFile);
     if (enStatus == I106_OK)
         {
-        g_suI106Handle[*piHandle].enFileMode  = I106_READ_PCAP_STREAM;
-        g_suI106Handle[*piHandle].enFileState = enReadHeader;
+        psuI106Handle(*piHandle)->enFileMode  = I106_READ_PCAP_STREAM;
+        psuI106Handle(*piHandle)->enFileState = enReadHeader;
+        }
+    else
+        {
+        enI106_CloseNetStream(*piHandle);
+        vReleaseHandle(*piHandle);
         }
 
     return enStatus;
@@ -430,28 +735,77 @@ EnI106Status I106_CALL_DECL
 EnI106Status I106_CALL_DECL 
     enI106Ch10Close(int iHandle)
     {
+    EnI106Status    enStatus = I106_OK;
+    EnI106Status    enStepStatus;
 
-    // If handles have not been init'ed then bail
-    if (m_bHandlesInited == bFALSE)
+    // If no handles have ever been opened then bail
+    if (m_iHandlePages == 0)
         return I106_NOT_OPEN;
 
     // Check for a valid handle
-    if ((iHandle <  0)           || 
-        (iHandle >= MAX_HANDLES) || 
-        (g_suI106Handle[iHandle].bInUse == bFALSE))
+    if (bI106ValidHandle(iHandle) == bFALSE)
         {
         return I106_INVALID_HANDLE;
         }
 
     // Handle different types of close
-    switch (g_suI106Handle[iHandle].enFileMode)
+    switch (psuI106Handle(iHandle)->enFileMode)
         {
         // Close the file
         default : // Default case is file
+#if !defined(_WIN32)
+            // Unmap the file if it was memory mapped
+            if (psuI106Handle(iHandle)->pchMapBase != NULL)
+                munmap(psuI106Handle(iHandle)->pchMapBase, (size_t)psuI106Handle(iHandle)->llMapSize);
+#endif
+            psuI106Handle(iHandle)->pchMapBase = NULL;
+            psuI106Handle(iHandle)->llMapSize  = 0L;
+            psuI106Handle(iHandle)->llMapPos   = 0L;
+
+            // Free the read ahead buffer
+            free(psuI106Handle(iHandle)->pchReadBuff);
+            psuI106Handle(iHandle)->pchReadBuff   = NULL;
+            psuI106Handle(iHandle)->ulReadBuffLen = 0L;
+            psuI106Handle(iHandle)->ulReadBuffPos = 0L;
+
+            // Free the reverse scan buffer
+            free(psuI106Handle(iHandle)->pchRevBuff);
+            psuI106Handle(iHandle)->pchRevBuff      = NULL;
+            psuI106Handle(iHandle)->llRevBuffOffset = -1L;
+            psuI106Handle(iHandle)->iRevBuffLen     = 0;
+
+            // Free the read filter
+            free(psuI106Handle(iHandle)->psuFilter);
+            psuI106Handle(iHandle)->psuFilter       = NULL;
+
+            // Write the final root index packet.  Keep going on an error
+            // but report the first one.
+            enStatus = enStopIndexWrite(iHandle);
+
+            // Stop the background writer
+            if (psuI106Handle(iHandle)->psuWriteThread != NULL)
+                {
+                enStepStatus = enI106Ch10StopWriteThread(iHandle);
+                if (enStatus == I106_OK)
+                    enStatus = enStepStatus;
+                }
+
+            // Write out and free the write buffer
+            if (psuI106Handle(iHandle)->pchWriteBuff != NULL)
+                {
+                enStepStatus = enFlushWriteBuff(iHandle);
+                if (enStatus == I106_OK)
+                    enStatus = enStepStatus;
+                free(psuI106Handle(iHandle)->pchWriteBuff);
+                psuI106Handle(iHandle)->pchWriteBuff    = NULL;
+                psuI106Handle(iHandle)->ulWriteBuffSize = 0L;
+                psuI106Handle(iHandle)->ulWriteBuffLen  = 0L;
+                }
+
             // Make sure the file is really open
-            if ((g_suI106Handle[iHandle].iFile   != -1) &&
-                (g_suI106Handle[iHandle].bInUse  == bTRUE))
-                close(g_suI106Handle[iHandle].iFile);
+            if ((psuI106Handle(iHandle)->iFile   != -1) &&
+                (psuI106Handle(iHandle)->bInUse  == bTRUE))
+                close(psuI106Handle(iHandle)->iFile);
             break;
 
         // Close network data stream
@@ -465,21 +819,27 @@ EnI106Status I106_CALL_DECL
 
         } // end switch on file mode
 
+    // Free the time order window
+    vFreeReorder(iHandle);
+
     // Free index buffer and mark unsorted
-    free(g_suI106Handle[iHandle].suInOrderIndex.asuIndex);
-    g_suI106Handle[iHandle].suInOrderIndex.asuIndex        = NULL;
-    g_suI106Handle[iHandle].suInOrderIndex.iArraySize      = 0;
-    g_suI106Handle[iHandle].suInOrderIndex.iArrayUsed      = 0;
-    g_suI106Handle[iHandle].suInOrderIndex.iNumSearchSteps = 0;
-    g_suI106Handle[iHandle].suInOrderIndex.enSortStatus    = enUnsorted;
+    vFreeInOrderIndex(&psuI106Handle(iHandle)->suInOrderIndex);
+    psuI106Handle(iHandle)->suInOrderIndex.enSortStatus    = enUnsorted;
+
+    // Free the time reference and file index
+    free(psuI106Handle(iHandle)->psuTimeRef);
+    psuI106Handle(iHandle)->psuTimeRef = NULL;
+    vI106_FreeTimeModel(psuI106Handle(iHandle)->psuTimeModel);
+    psuI106Handle(iHandle)->psuTimeModel = NULL;
+    FreeIndex(iHandle);
 
     // Reset some status variables
-    g_suI106Handle[iHandle].iFile       = -1;
-    g_suI106Handle[iHandle].bInUse      = bFALSE;
-    g_suI106Handle[iHandle].enFileMode  = I106_CLOSED;
-    g_suI106Handle[iHandle].enFileState = enClosed;
+    psuI106Handle(iHandle)->iFile       = -1;
+    psuI106Handle(iHandle)->enFileMode  = I106_CLOSED;
+    psuI106Handle(iHandle)->enFileState = enClosed;
+    vReleaseHandle(iHandle);
 
-    return I106_OK;
+    return enStatus;
     }
 
 
@@ -495,25 +855,45 @@ EnI106Status I106_CALL_DECL
     {
     EnI106Status    enStatus;
 
-    switch (g_suI106Handle[iHandle].enFileMode)
+    // Check for a valid handle
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        return I106_INVALID_HANDLE;
+
+    // Keep reading headers until one makes it through the read filter.  Data
+    // for skipped packets gets skipped over by the next header read.
+    while (bTRUE)
         {
-        case I106_READ_NET_STREAM : 
-        case I106_READ_PCAP_STREAM : 
-        case I106_READ : 
-            enStatus = enI106Ch10ReadNextHeaderFile(iHandle, psuHeader);
-            break;
+        switch (psuI106Handle(iHandle)->enFileMode)
+            {
+            case I106_READ_NET_STREAM : 
+            case I106_READ_PCAP_STREAM : 
+            case I106_READ : 
+            case I106_READ_MMAP : 
+                if (psuI106Handle(iHandle)->psuReorder != NULL)
+                    enStatus = enReadNextHeaderReorder(iHandle, psuHeader);
+                else
+                    enStatus = enI106Ch10ReadNextHeaderFile(iHandle, psuHeader);
+                break;
 
-        case I106_READ_IN_ORDER : 
-            if (g_suI106Handle[iHandle].suInOrderIndex.enSortStatus == enSorted)
-                enStatus = enI106Ch10ReadNextHeaderInOrder(iHandle, psuHeader);
-            else
-                enStatus = enI106Ch10ReadNextHeaderFile(iHandle, psuHeader);
-            break;
+            case I106_READ_IN_ORDER : 
+                if (psuI106Handle(iHandle)->suInOrderIndex.enSortStatus == enSorted)
+                    enStatus = enI106Ch10ReadNextHeaderInOrder(iHandle, psuHeader);
+                else if (psuI106Handle(iHandle)->psuReorder != NULL)
+                    enStatus = enReadNextHeaderReorder(iHandle, psuHeader);
+                else
+                    enStatus = enI106Ch10ReadNextHeaderFile(iHandle, psuHeader);
+                break;
 
-        default :
-            enStatus = I106_WRONG_FILE_MODE;
+            default :
+                enStatus = I106_WRONG_FILE_MODE;
+                break;
+            } // end switch on read mode
+
+        if ((enStatus != I106_OK) || 
+            (psuI106Handle(iHandle)->psuFilter == NULL) ||
+            bFilterPass(psuI106Handle(iHandle)->psuFilter, psuHeader))
             break;
-        } // end switch on read mode
+        } // end while looking for a packet that passes the filter
     
     return enStatus;
     }
@@ -535,15 +915,13 @@ EnI106Status I106_CALL_DECL
     EnI106Status        enStatus;
 
     // Check for a valid handle
-    if ((iHandle <  0)           || 
-        (iHandle >= MAX_HANDLES) || 
-        (g_suI106Handle[iHandle].bInUse == bFALSE))
+    if (bI106ValidHandle(iHandle) == bFALSE)
         {
         return I106_INVALID_HANDLE;
         }
 
     // Check for invalid file modes
-    switch (g_suI106Handle[iHandle].enFileMode)
+    switch (psuI106Handle(iHandle)->enFileMode)
         {
         case I106_CLOSED :
             return I106_NOT_OPEN;
@@ -551,7 +929,6 @@ EnI106Status I106_CALL_DECL
 
         case I106_OVERWRITE       :
         case I106_APPEND          :
-        case I106_READ_IN_ORDER   : 
         default                   :
             return I106_WRONG_FILE_MODE;
             break;
@@ -559,11 +936,13 @@ EnI106Status I106_CALL_DECL
         case I106_READ_NET_STREAM : 
         case I106_READ_PCAP_STREAM : 
         case I106_READ :
+        case I106_READ_IN_ORDER : 
+        case I106_READ_MMAP :
             break;
         } // end switch on read mode
 
     // Check file state
-    switch (g_suI106Handle[iHandle].enFileState)
+    switch (psuI106Handle(iHandle)->enFileState)
         {
         case enClosed :
             return I106_NOT_OPEN;
@@ -577,12 +956,12 @@ EnI106Status I106_CALL_DECL
             break;
 
         case enReadData :
-            llSkipSize = g_suI106Handle[iHandle].ulCurrPacketLen - 
-                         g_suI106Handle[iHandle].ulCurrHeaderBuffLen -
-                         g_suI106Handle[iHandle].ulCurrDataBuffReadPos;
+            llSkipSize = psuI106Handle(iHandle)->ulCurrPacketLen - 
+                         psuI106Handle(iHandle)->ulCurrHeaderBuffLen -
+                         psuI106Handle(iHandle)->ulCurrDataBuffReadPos;
 
-            if ((g_suI106Handle[iHandle].enFileMode != I106_READ_NET_STREAM ) &&
-                (g_suI106Handle[iHandle].enFileMode != I106_READ_PCAP_STREAM))
+            if ((psuI106Handle(iHandle)->enFileMode != I106_READ_NET_STREAM ) &&
+                (psuI106Handle(iHandle)->enFileMode != I106_READ_PCAP_STREAM))
                 {
                 enStatus = enI106Ch10GetPos(iHandle, &llFileOffset);
                 if (enStatus != I106_OK)
@@ -631,10 +1010,12 @@ EnI106Status I106_CALL_DECL
         bReadHeaderWasOK = bTRUE;
 
         // Read the header
-        switch (g_suI106Handle[iHandle].enFileMode)
+        switch (psuI106Handle(iHandle)->enFileMode)
             {
             case I106_READ :
-                iReadCnt = read(g_suI106Handle[iHandle].iFile, psuHeader, HEADER_SIZE);
+            case I106_READ_IN_ORDER :
+            case I106_READ_MMAP :
+                iReadCnt = iReadFile(iHandle, psuHeader, HEADER_SIZE);
                 break;
 
 #if defined(IRIG_NETWORKING)
@@ -649,12 +1030,12 @@ EnI106Status I106_CALL_DECL
             } // end switch on file mode
 
         // Keep track of how much header we've read
-        g_suI106Handle[iHandle].ulCurrHeaderBuffLen = HEADER_SIZE;
+        psuI106Handle(iHandle)->ulCurrHeaderBuffLen = HEADER_SIZE;
 
         // If there was an error reading, figure out why
         if (iReadCnt != HEADER_SIZE)
             {
-            g_suI106Handle[iHandle].enFileState = enReadUnsynced;
+            psuI106Handle(iHandle)->enFileState = enReadUnsynced;
             if (iReadCnt == -1)
                 return I106_READ_ERROR;
             else
@@ -668,7 +1049,7 @@ EnI106Status I106_CALL_DECL
             // Read OK, check the sync field
             if (psuHeader->uSync != IRIG106_SYNC)
                 {
-                g_suI106Handle[iHandle].enFileState = enReadUnsynced;
+                psuI106Handle(iHandle)->enFileState = enReadUnsynced;
                 bReadHeaderWasOK = bFALSE;
                 break;
                 }
@@ -679,9 +1060,9 @@ EnI106Status I106_CALL_DECL
                 // If the header checksum was bad then set to unsynced state
                 // and return the error. Next time we're called we'll go
                 // through lots of heroics to find the next header.
-                if (g_suI106Handle[iHandle].enFileState != enReadUnsynced)
+                if (psuI106Handle(iHandle)->enFileState != enReadUnsynced)
                     {
-                    g_suI106Handle[iHandle].enFileState = enReadUnsynced;
+                    psuI106Handle(iHandle)->enFileState = enReadUnsynced;
                     return I106_HEADER_CHKSUM_BAD;
                     }
                 bReadHeaderWasOK = bFALSE;
@@ -696,10 +1077,12 @@ EnI106Status I106_CALL_DECL
             if ((psuHeader->ubyPacketFlags & I106CH10_PFLAGS_SEC_HEADER) != 0)
                 {
                 // Read the secondary header
-                switch (g_suI106Handle[iHandle].enFileMode)
+                switch (psuI106Handle(iHandle)->enFileMode)
                     {
                     case I106_READ :
-                        iReadCnt = read(g_suI106Handle[iHandle].iFile, psuHeader->abySecHdr, SEC_HEADER_SIZE);
+                    case I106_READ_IN_ORDER :
+                    case I106_READ_MMAP :
+                        iReadCnt = iReadFile(iHandle, psuHeader->abySecHdr, SEC_HEADER_SIZE);
                         break;
 
 #if defined(IRIG_NETWORKING)
@@ -714,12 +1097,12 @@ EnI106Status I106_CALL_DECL
                     } // end switch on file mode
 
                 // Keep track of how much header we've read
-                g_suI106Handle[iHandle].ulCurrHeaderBuffLen += SEC_HEADER_SIZE;
+                psuI106Handle(iHandle)->ulCurrHeaderBuffLen += SEC_HEADER_SIZE;
 
                 // If there was an error reading, figure out why
                 if (iReadCnt != SEC_HEADER_SIZE)
                     {
-                    g_suI106Handle[iHandle].enFileState = enReadUnsynced;
+                    psuI106Handle(iHandle)->enFileState = enReadUnsynced;
                     if (iReadCnt == -1)
                         return I106_READ_ERROR;
                     else
@@ -732,9 +1115,9 @@ EnI106Status I106_CALL_DECL
                     // If the header checksum was bad then set to unsynced state
                     // and return the error. Next time we're called we'll go
                     // through lots of heroics to find the next header.
-                    if (g_suI106Handle[iHandle].enFileState != enReadUnsynced)
+                    if (psuI106Handle(iHandle)->enFileState != enReadUnsynced)
                         {
-                        g_suI106Handle[iHandle].enFileState = enReadUnsynced;
+                        psuI106Handle(iHandle)->enFileState = enReadUnsynced;
                         return I106_HEADER_CHKSUM_BAD;
                         }
                     bReadHeaderWasOK = bFALSE;
@@ -750,17 +1133,18 @@ EnI106Status I106_CALL_DECL
             break;
 
         // Read header was not OK so try again beyond previous read point
-        if (g_suI106Handle[iHandle].enFileMode != I106_READ_NET_STREAM)
+        if (psuI106Handle(iHandle)->enFileMode != I106_READ_NET_STREAM)
             {
             enStatus = enI106Ch10GetPos(iHandle, &llFileOffset);
             if (enStatus != I106_OK)
                 return I106_SEEK_ERROR;
 
-            llFileOffset = llFileOffset - g_suI106Handle[iHandle].ulCurrHeaderBuffLen + 1;
+            llFileOffset = llFileOffset - psuI106Handle(iHandle)->ulCurrHeaderBuffLen + 1;
 
-            enStatus = enI106Ch10SetPos(iHandle, llFileOffset);
+            // Scan ahead in big blocks for the next likely looking header
+            enStatus = enResyncFile(iHandle, llFileOffset);
             if (enStatus != I106_OK)
-                return I106_SEEK_ERROR;
+                return enStatus;
             }
 #if defined(IRIG_NETWORKING)
         else
@@ -773,10 +1157,10 @@ EnI106Status I106_CALL_DECL
         } // end while looping forever, looking for a good header
 
     // Save some data for later use
-    g_suI106Handle[iHandle].ulCurrPacketLen       = psuHeader->ulPacketLen;
-    g_suI106Handle[iHandle].ulCurrDataBuffLen     = uGetDataLen(psuHeader);
-    g_suI106Handle[iHandle].ulCurrDataBuffReadPos = 0;
-    g_suI106Handle[iHandle].enFileState           = enReadData;
+    psuI106Handle(iHandle)->ulCurrPacketLen       = psuHeader->ulPacketLen;
+    psuI106Handle(iHandle)->ulCurrDataBuffLen     = uGetDataLen(psuHeader);
+    psuI106Handle(iHandle)->ulCurrDataBuffReadPos = 0;
+    psuI106Handle(iHandle)->enFileState           = enReadData;
 
     return I106_OK;
     } // end enI106Ch10ReadNextHeaderFile()
@@ -792,7 +1176,7 @@ EnI106Status I106_CALL_DECL
                                     SuI106Ch10Header * psuHeader)
     {
 
-    SuInOrderIndex    * psuIndex = &g_suI106Handle[iHandle].suInOrderIndex;
+    SuInOrderIndex    * psuIndex = &psuI106Handle(iHandle)->suInOrderIndex;
     EnI106Status        enStatus;
     int64_t             llOffset;
     EnFileState         enSavedFileState;
@@ -802,11 +1186,7 @@ EnI106Status I106_CALL_DECL
         return I106_EOF;
 
     // Save the read state going in
-    enSavedFileState = g_suI106Handle[iHandle].enFileState;
-
-#ifdef LOOK_AHEAD
-vCheckFillLookAheadBuffer(iHandle);
-#endif
+    enSavedFileState = psuI106Handle(iHandle)->enFileState;
 
     // Move file pointer to the proper, er, point
     llOffset = psuIndex->asuIndex[psuIndex->iArrayCurr].llOffset;
@@ -817,7 +1197,7 @@ vCheckFillLookAheadBuffer(iHandle);
 
     // If the state was unsynced before but is synced now, figure out where in the
     // index we are
-    if ((enSavedFileState == enReadUnsynced) && (g_suI106Handle[iHandle].enFileState != enReadUnsynced))
+    if ((enSavedFileState == enReadUnsynced) && (psuI106Handle(iHandle)->enFileState != enReadUnsynced))
         {
         enI106Ch10GetPos(iHandle, &llOffset);
         llOffset -= iGetHeaderLen(psuHeader);
@@ -841,31 +1221,51 @@ vCheckFillLookAheadBuffer(iHandle);
 
 /* ----------------------------------------------------------------------- */
 
+// Get the previous header.  Packets that don't pass the read filter are 
+// stepped back over the same as enI106Ch10ReadNextHeader() skips them.
+
 EnI106Status I106_CALL_DECL 
     enI106Ch10ReadPrevHeader(int                 iHandle,
                              SuI106Ch10Header  * psuHeader)
     {
-    int                 bStillReading;
-    int64_t             llCurrPos;
     EnI106Status        enStatus;
 
-    uint64_t            llInitialBackup;
-    int                 iBackupAmount;
-    uint64_t            llNextBuffReadPos;
-    uint8_t             abyScanBuff[BACKUP_SIZE+HEADER_SIZE];
-    int                 iBuffIdx;
-    uint16_t            uCheckSum;
+    while (bTRUE)
+        {
+        enStatus = enReadPrevHeaderUnfiltered(iHandle, psuHeader);
+        if ((enStatus != I106_OK) || 
+            (psuI106Handle(iHandle)->psuFilter == NULL) ||
+            bFilterPass(psuI106Handle(iHandle)->psuFilter, psuHeader))
+            break;
+        } // end while looking for a packet that passes the filter
+
+    return enStatus;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Step back to the packet before the most recently read one
+
+static EnI106Status enReadPrevHeaderUnfiltered(int                 iHandle,
+                                               SuI106Ch10Header  * psuHeader)
+    {
+    int64_t             llCurrPos;
+    int64_t             llHeaderPos;
+    int64_t             llInitialBackup;
+    EnI106Status        enStatus;
+    SuInOrderIndex    * psuIndex;
+    int                 iPrevIdx;
 
     // Check for a valid handle
-    if ((iHandle <  0)           || 
-        (iHandle >= MAX_HANDLES) || 
-        (g_suI106Handle[iHandle].bInUse == bFALSE))
+    if (bI106ValidHandle(iHandle) == bFALSE)
         {
         return I106_INVALID_HANDLE;
         }
 
     // Check for invalid file modes
-    switch (g_suI106Handle[iHandle].enFileMode)
+    switch (psuI106Handle(iHandle)->enFileMode)
         {
         case I106_CLOSED :
             return I106_NOT_OPEN;
@@ -873,18 +1273,27 @@ EnI106Status I106_CALL_DECL
 
         case I106_OVERWRITE       :
         case I106_APPEND          :
-        case I106_READ_IN_ORDER   : // HANDLE THE READ IN ORDER MODE!!!!
         case I106_READ_NET_STREAM : 
         default                   :
             return I106_WRONG_FILE_MODE;
             break;
 
+        case I106_READ_IN_ORDER   :
         case I106_READ :
+        case I106_READ_MMAP :
             break;
         } // end switch on read mode
 
+    // If reading through a time order window then go back to the packet it 
+    // last returned and step back in file order from there
+    if ((psuI106Handle(iHandle)->psuReorder                   != NULL)   &&
+        (psuI106Handle(iHandle)->suInOrderIndex.enSortStatus  != enSorted) &&
+        (psuI106Handle(iHandle)->psuReorder->bCurrValid       == bTRUE)  &&
+        (psuI106Handle(iHandle)->psuReorder->suCurr.llOffset  >= 0))
+        enI106Ch10SetPos(iHandle, psuI106Handle(iHandle)->psuReorder->suCurr.llOffset);
+
     // Check file mode
-    switch (g_suI106Handle[iHandle].enFileState)
+    switch (psuI106Handle(iHandle)->enFileState)
         {
         case enClosed :
             return I106_NOT_OPEN;
@@ -899,18 +1308,37 @@ EnI106Status I106_CALL_DECL
             // Backup to a point just before the most recently read header.
             // The amount to backup is the size of the previous header and the amount
             // of data already read.
-            llInitialBackup = g_suI106Handle[iHandle].ulCurrHeaderBuffLen +
-                              g_suI106Handle[iHandle].ulCurrDataBuffReadPos;
+            llInitialBackup = psuI106Handle(iHandle)->ulCurrHeaderBuffLen +
+                              psuI106Handle(iHandle)->ulCurrDataBuffReadPos;
             break;
 
         case enReadUnsynced :
-            llInitialBackup = 0;
-            break;
-
         default :
+            llInitialBackup = 0;
             break;
         } // end switch file state
 
+    // If reading in order with a sorted index then just step back in the index.
+    // The most recently read header is the one before the current index unless
+    // the file was just repositioned.
+    psuIndex = &psuI106Handle(iHandle)->suInOrderIndex;
+    if ((psuI106Handle(iHandle)->enFileMode == I106_READ_IN_ORDER) &&
+        (psuIndex->enSortStatus             == enSorted))
+        {
+        if (psuI106Handle(iHandle)->enFileState == enReadUnsynced)
+            iPrevIdx = psuIndex->iArrayCurr - 1;
+        else
+            iPrevIdx = psuIndex->iArrayCurr - 2;
+
+        if (iPrevIdx < 0)
+            {
+            enI106Ch10FirstMsg(iHandle);
+            return I106_BOF;
+            }
+
+        psuIndex->iArrayCurr = iPrevIdx;
+        return enI106Ch10ReadNextHeaderInOrder(iHandle, psuHeader);
+        }
 
     // This puts us at the beginning of the most recently read header (or BOF)
     enI106Ch10GetPos(iHandle, &llCurrPos);
@@ -924,68 +1352,34 @@ EnI106Status I106_CALL_DECL
         }
 
     // Loop until previous packet found
-    bStillReading = bTRUE;
-    while (bStillReading)
+    while (bTRUE)
         {
+        // Scan backwards for something that looks like a header.  If we get 
+        // to the beginning of a file and a valid header wasn't found then it 
+        // IS a seek error.
+        enStatus = enFindPrevHeader(iHandle, llCurrPos, &llCurrPos);
+        if (enStatus == I106_BOF)
+            return I106_SEEK_ERROR;
+        if (enStatus != I106_OK)
+            return enStatus;
 
-        // Figure out how much to backup
-        if (llCurrPos >= BACKUP_SIZE)
-            iBackupAmount = BACKUP_SIZE;
-        else
-            iBackupAmount = (int)llCurrPos;
-
-        // Backup that amount
-        llNextBuffReadPos = llCurrPos - iBackupAmount;
-        enI106Ch10SetPos(iHandle, llNextBuffReadPos);
-
-        // Read a buffer of data to scan backwards through
-        read(g_suI106Handle[iHandle].iFile, abyScanBuff, iBackupAmount+HEADER_SIZE);
-
-        // Go to the end of the buffer and start scanning backwards
-        for (iBuffIdx=iBackupAmount-1; iBuffIdx>=0; iBuffIdx--)
-            {
-
-            // Keep track of where we are in the file
-            llCurrPos--;
-
-            // Check for sync chars
-            if ((abyScanBuff[iBuffIdx]   != 0x25) ||
-                (abyScanBuff[iBuffIdx+1] != 0xEB))
-                continue;
-
-            // Sync chars found so check header checksum
-            uCheckSum = uCalcHeaderChecksum((SuI106Ch10Header *)(&abyScanBuff[iBuffIdx]));
-            if (uCheckSum != ((SuI106Ch10Header *)(&abyScanBuff[iBuffIdx]))->uChecksum)
-                continue;
-
-            // Header checksum found so let ReadNextHeader() have a crack
-            enStatus = enI106Ch10SetPos(iHandle, llCurrPos);
-            if (enStatus != I106_OK)
-                continue;
-            enStatus = enI106Ch10ReadNextHeaderFile(iHandle, psuHeader);
-            if (enStatus != I106_OK)
-                continue;
-
-            // Header OK so break out
-            bStillReading = bFALSE;
-            break;
-
-            // At the beginning of the buffer go back and read some more
-
-            } // end for all bytes in buffer
-
-        // Check to see if we're at the BOF.  BTW, if we're at the beginning of a file
-        // and a valid header wasn't found then it IS a seek error.
-        if (llCurrPos == 0)
+        // Header checksum found so let ReadNextHeader() have a crack.  Make 
+        // sure it didn't have to resync somewhere else to find a header.
+        enStatus = enI106Ch10SetPos(iHandle, llCurrPos);
+        if (enStatus != I106_OK)
+            return enStatus;
+        enStatus = enI106Ch10ReadNextHeaderFile(iHandle, psuHeader);
+        if (enStatus == I106_OK)
             {
-            bStillReading = bFALSE;
-            enStatus = I106_SEEK_ERROR;
+            enI106Ch10GetPos(iHandle, &llHeaderPos);
+            if (llHeaderPos - iGetHeaderLen(psuHeader) == llCurrPos)
+                break;
             }
-            
-        } // end while looping forever on buffers
 
-    return enStatus;
-    } // end enI106Ch10ReadPrevHeader()
+        } // end while looping forever on candidates
+
+    return I106_OK;
+    } // end enReadPrevHeaderUnfiltered()
 
 
 
@@ -1001,13 +1395,24 @@ EnI106Status I106_CALL_DECL
     {
     EnI106Status    enStatus;
 
-    switch (g_suI106Handle[iHandle].enFileMode)
+    // Check for a valid handle
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        {
+        return I106_INVALID_HANDLE;
+        }
+
+    switch (psuI106Handle(iHandle)->enFileMode)
         {
         case I106_READ_NET_STREAM : 
         case I106_READ_PCAP_STREAM : 
         case I106_READ : 
         case I106_READ_IN_ORDER : 
-            enStatus = enI106Ch10ReadDataFile(iHandle, ulBuffSize, pvBuff);
+        case I106_READ_MMAP : 
+            if ((psuI106Handle(iHandle)->psuReorder             != NULL) &&
+                (psuI106Handle(iHandle)->psuReorder->bCurrValid == bTRUE))
+                enStatus = enReadDataReorder(iHandle, ulBuffSize, pvBuff);
+            else
+                enStatus = enI106Ch10ReadDataFile(iHandle, ulBuffSize, pvBuff);
             break;
 
         default :
@@ -1032,15 +1437,13 @@ EnI106Status I106_CALL_DECL
     unsigned long   ulReadAmount;
 
     // Check for a valid handle
-    if ((iHandle <  0)           || 
-        (iHandle >= MAX_HANDLES) || 
-        (g_suI106Handle[iHandle].bInUse == bFALSE))
+    if (bI106ValidHandle(iHandle) == bFALSE)
         {
         return I106_INVALID_HANDLE;
         }
 
     // Check for invalid file modes
-    switch (g_suI106Handle[iHandle].enFileMode)
+    switch (psuI106Handle(iHandle)->enFileMode)
         {
         case I106_CLOSED :
             return I106_NOT_OPEN;
@@ -1055,7 +1458,7 @@ EnI106Status I106_CALL_DECL
         } // end switch on read mode
 
     // Check file state
-    switch (g_suI106Handle[iHandle].enFileState)
+    switch (psuI106Handle(iHandle)->enFileState)
         {
         case enClosed :
             return I106_NOT_OPEN;
@@ -1070,24 +1473,25 @@ EnI106Status I106_CALL_DECL
 
         default :
 // MIGHT WANT TO SUPPORT THE "MORE DATA" METHOD INSTEAD
-            g_suI106Handle[iHandle].enFileState = enReadUnsynced;
+            psuI106Handle(iHandle)->enFileState = enReadUnsynced;
             return I106_READ_ERROR;
             break;
         } // end switch file state
 
     // Make sure there is enough room in the user buffer
 // MIGHT WANT TO SUPPORT THE "MORE DATA" METHOD INSTEAD
-    ulReadAmount = g_suI106Handle[iHandle].ulCurrDataBuffLen -
-                   g_suI106Handle[iHandle].ulCurrDataBuffReadPos;
+    ulReadAmount = psuI106Handle(iHandle)->ulCurrDataBuffLen -
+                   psuI106Handle(iHandle)->ulCurrDataBuffReadPos;
     if (ulBuffSize < ulReadAmount)
         return I106_BUFFER_TOO_SMALL;
 
     // Read the data, filler, and data checksum
-    switch (g_suI106Handle[iHandle].enFileMode)
+    switch (psuI106Handle(iHandle)->enFileMode)
         {
         case I106_READ : 
         case I106_READ_IN_ORDER : 
-            iReadCnt = read(g_suI106Handle[iHandle].iFile, pvBuff, ulReadAmount);
+        case I106_READ_MMAP : 
+            iReadCnt = iReadFile(iHandle, pvBuff, ulReadAmount);
             break;
 
         case I106_READ_NET_STREAM : 
@@ -1105,7 +1509,7 @@ EnI106Status I106_CALL_DECL
     // If there was an error reading, figure out why
     if ((unsigned long)iReadCnt != ulReadAmount)
         {
-        g_suI106Handle[iHandle].enFileState = enReadUnsynced;
+        psuI106Handle(iHandle)->enFileState = enReadUnsynced;
         if (iReadCnt == -1)
             return I106_READ_ERROR;
         else
@@ -1113,12 +1517,12 @@ EnI106Status I106_CALL_DECL
         } // end if read error
 
     // Keep track of our read position in the current data buffer
-    g_suI106Handle[iHandle].ulCurrDataBuffReadPos = ulReadAmount;
+    psuI106Handle(iHandle)->ulCurrDataBuffReadPos = ulReadAmount;
 
 // MAY WANT TO DO CHECKSUM CHECKING SOMEDAY
 
     // Expect a header next read
-    g_suI106Handle[iHandle].enFileState = enReadHeader;
+    psuI106Handle(iHandle)->enFileState = enReadHeader;
 
     return I106_OK;
     } // end enI106Ch10ReadData()
@@ -1127,1184 +1531,4159 @@ EnI106Status I106_CALL_DECL
 
 /* ----------------------------------------------------------------------- */
 
+// Return a pointer to the current packet data inside the file mapping rather
+// than copying it into a user buffer.
+
 EnI106Status I106_CALL_DECL 
-    enI106Ch10WriteMsg(int                iHandle,
-                       SuI106Ch10Header * psuHeader,
-                       void             * pvBuff)
+    enI106Ch10ReadDataPtr(int                iHandle,
+                          void            ** ppvBuff,
+                          unsigned long    * pulBuffLen)
     {
-    int     iHeaderLen;
-    int     iWriteCnt;
+    unsigned long   ulReadAmount;
 
     // Check for a valid handle
-    if ((iHandle <  0)           || 
-        (iHandle >= MAX_HANDLES) || 
-        (g_suI106Handle[iHandle].bInUse == bFALSE))
+    if (bI106ValidHandle(iHandle) == bFALSE)
         {
         return I106_INVALID_HANDLE;
         }
 
-    // Check for invalid file modes
-    switch (g_suI106Handle[iHandle].enFileMode)
+    // Only memory mapped files have something to point to
+    switch (psuI106Handle(iHandle)->enFileMode)
         {
         case I106_CLOSED :
             return I106_NOT_OPEN;
             break;
 
-        case I106_READ            :
-        case I106_READ_IN_ORDER   : 
-        case I106_READ_NET_STREAM : 
-            return I106_WRONG_FILE_MODE;
+        case I106_READ_MMAP :
             break;
+
         default :
+            return I106_WRONG_FILE_MODE;
             break;
         } // end switch on read mode
 
-    // Figure out header length
-    iHeaderLen = iGetHeaderLen(psuHeader);
-
-    // Write the header
-    iWriteCnt = write(g_suI106Handle[iHandle].iFile, psuHeader, iHeaderLen);
+    // Packets from the time order window are already in memory
+    if ((psuI106Handle(iHandle)->psuReorder             != NULL) &&
+        (psuI106Handle(iHandle)->psuReorder->bCurrValid == bTRUE))
+        {
+        SuReorderPacket * psuCurr = &psuI106Handle(iHandle)->psuReorder->suCurr;
+        *ppvBuff    = psuCurr->pchPacket   + psuCurr->ulHeaderLen;
+        *pulBuffLen = psuCurr->ulPacketLen - psuCurr->ulHeaderLen;
+        psuI106Handle(iHandle)->psuReorder->bCurrDataRead = bTRUE;
+        return I106_OK;
+        }
 
-    // If there was an error reading, figure out why
-    if (iWriteCnt != iHeaderLen)
+    // Check file state
+    if (psuI106Handle(iHandle)->enFileState != enReadData)
         {
-        return I106_WRITE_ERROR;
-        } // end if write error
-    
-    // Write the data
-    iWriteCnt = write(g_suI106Handle[iHandle].iFile, pvBuff, psuHeader->ulPacketLen-iHeaderLen);
+        psuI106Handle(iHandle)->enFileState = enReadUnsynced;
+        return I106_READ_ERROR;
+        }
 
-    // If there was an error writing, figure out why
-    if ((unsigned long)iWriteCnt != (psuHeader->ulPacketLen-iHeaderLen))
+    // Make sure the whole data buffer is in the file
+    ulReadAmount = psuI106Handle(iHandle)->ulCurrDataBuffLen -
+                   psuI106Handle(iHandle)->ulCurrDataBuffReadPos;
+    if (psuI106Handle(iHandle)->llMapPos + (int64_t)ulReadAmount > psuI106Handle(iHandle)->llMapSize)
         {
-        return I106_WRITE_ERROR;
-        } // end if write error
+        psuI106Handle(iHandle)->enFileState = enReadUnsynced;
+        return I106_EOF;
+        }
 
-    // Update the number of bytes written
-    g_suI106Handle[iHandle].ulTotalBytesWritten += psuHeader->ulPacketLen;
+    *ppvBuff    = psuI106Handle(iHandle)->pchMapBase + psuI106Handle(iHandle)->llMapPos;
+    *pulBuffLen = ulReadAmount;
+
+    // Move past the data just like a normal read
+    psuI106Handle(iHandle)->llMapPos             += ulReadAmount;
+    psuI106Handle(iHandle)->ulCurrDataBuffReadPos = psuI106Handle(iHandle)->ulCurrDataBuffLen;
+    psuI106Handle(iHandle)->enFileState           = enReadHeader;
 
     return I106_OK;
-    }
+    } // end enI106Ch10ReadDataPtr()
 
 
 
 /* ----------------------------------------------------------------------- */
 
-// Write a complete Ch 10 packet.
-// This version is useful in cases where the data buffer size can't be 
-// conveniently controlled and manipulated.
+// Set the read ahead buffer size. The old buffer is tossed and the file 
+// position is left where it logically was.
 
-EnI106Status I106_CALL_DECL
-    enI106Ch10WriteMsg2(int                   iHandle,
-                        SuI106Ch10Header    * psuHeader,
-                        void                * pvCSDW,
-                        int                   iCSDWLen,
-                        void                * pvBuff,
-                        unsigned long         ulBuffDataLen,
-                        void                * pvFiller,
-                        int                   iFillerLen)
+EnI106Status I106_CALL_DECL 
+    enI106Ch10SetReadAheadSize(int              iHandle,
+                               unsigned long    ulBuffSize)
     {
-    int     iHeaderLen;
-    int     iWriteCnt;
+    SuI106Ch10Handle  * psuHandle;
+    int64_t             llOffset;
+    EnI106Status        enStatus;
+    EnFileState         enSavedFileState;
 
     // Check for a valid handle
-    if ((iHandle <  0)           || 
-        (iHandle >= MAX_HANDLES) || 
-        (g_suI106Handle[iHandle].bInUse == bFALSE))
+    if (bI106ValidHandle(iHandle) == bFALSE)
         {
         return I106_INVALID_HANDLE;
         }
 
-    // Check for invalid file modes
-    switch (g_suI106Handle[iHandle].enFileMode)
+    psuHandle = psuI106Handle(iHandle);
+
+    // Check file modes
+    switch (psuHandle->enFileMode)
         {
         case I106_CLOSED :
             return I106_NOT_OPEN;
             break;
 
-        case I106_READ            :
-        case I106_READ_IN_ORDER   : 
-        case I106_READ_NET_STREAM : 
-            return I106_WRONG_FILE_MODE;
+        case I106_READ          :
+        case I106_READ_IN_ORDER :
             break;
+
         default :
+            return I106_WRONG_FILE_MODE;
             break;
-        } // end switch on read mode
+        } // end switch on file mode
 
-    // Figure out header length
-    iHeaderLen = iGetHeaderLen(psuHeader);
+    // Put the OS file position back to where the reader thinks it is
+    if (psuHandle->pchReadBuff != NULL)
+        {
+        enI106Ch10GetPos(iHandle, &llOffset);
+        free(psuHandle->pchReadBuff);
+        psuHandle->pchReadBuff   = NULL;
+        psuHandle->ulReadBuffLen = 0L;
+        psuHandle->ulReadBuffPos = 0L;
+        enSavedFileState = psuHandle->enFileState;
+        if (psuHandle->psuReorder != NULL)
+            psuHandle->psuReorder->bBusy = bTRUE;
+        enStatus = enI106Ch10SetPos(iHandle, llOffset);
+        if (psuHandle->psuReorder != NULL)
+            psuHandle->psuReorder->bBusy = bFALSE;
+        psuHandle->enFileState = enSavedFileState;
+        if (enStatus != I106_OK)
+            return enStatus;
+        }
 
-    // Write the header
-    iWriteCnt = write(g_suI106Handle[iHandle].iFile, psuHeader, iHeaderLen);
+    // The new buffer gets allocated on the next read
+    psuHandle->ulReadBuffSize = ulBuffSize;
 
-    // If there was an error reading, figure out why
-    if (iWriteCnt != iHeaderLen)
-        {
-        return I106_WRITE_ERROR;
-        } // end if write error
-    
-    // Write the Channel Specific Data Word
-    iWriteCnt = write(g_suI106Handle[iHandle].iFile, pvCSDW, iCSDWLen);
-
-    // If there was an error reading, figure out why
-    if (iWriteCnt != iCSDWLen)
-        {
-        return I106_WRITE_ERROR;
-        } // end if write error
-    
-    // Write the data
-    iWriteCnt = write(g_suI106Handle[iHandle].iFile, pvBuff, ulBuffDataLen);
-
-    // If there was an error writing, figure out why
-    if ((unsigned long)iWriteCnt != ulBuffDataLen)
-        {
-        return I106_WRITE_ERROR;
-        } // end if write error
-
-    // Write the checksum and filler
-    if (iFillerLen > 0)
-        {
-        iWriteCnt = write(g_suI106Handle[iHandle].iFile, pvFiller, iFillerLen);
-
-        // If there was an error writing, figure out why
-        if (iWriteCnt != iFillerLen)
-            {
-            return I106_WRITE_ERROR;
-            } // end if write error
-
-        } // end if iFillerLen > 0
-
-    // Update the number of bytes written
-    g_suI106Handle[iHandle].ulTotalBytesWritten += psuHeader->ulPacketLen;
-
-    return I106_OK;
-    }
+    return I106_OK;
+    } // end enI106Ch10SetReadAheadSize()
 
 
 
-/* -----------------------------------------------------------------------
- * Move file pointer
- * ----------------------------------------------------------------------- */
+/* ----------------------------------------------------------------------- */
 
 EnI106Status I106_CALL_DECL 
-    enI106Ch10FirstMsg(int iHandle)
+    enI106Ch10SetReorderWindow(int               iHandle,
+                               int64_t           llHorizon,
+                               unsigned long     ulMaxBytes)
     {
+    SuReorder         * psuReorder;
 
     // Check for a valid handle
-    if ((iHandle <  0)           || 
-        (iHandle >= MAX_HANDLES) || 
-        (g_suI106Handle[iHandle].bInUse == bFALSE))
+    if (bI106ValidHandle(iHandle) == bFALSE)
         {
         return I106_INVALID_HANDLE;
         }
 
     // Check file modes
-    switch (g_suI106Handle[iHandle].enFileMode)
+    switch (psuI106Handle(iHandle)->enFileMode)
         {
         case I106_CLOSED :
             return I106_NOT_OPEN;
             break;
 
-        case I106_OVERWRITE       :
-        case I106_APPEND          :
-        case I106_READ_NET_STREAM : 
-        default                   :
-            return I106_WRONG_FILE_MODE;
+        case I106_READ             :
+        case I106_READ_IN_ORDER    :
+        case I106_READ_MMAP        :
+        case I106_READ_NET_STREAM  :
+        case I106_READ_PCAP_STREAM :
             break;
 
-        case I106_READ_IN_ORDER   :
-            g_suI106Handle[iHandle].suInOrderIndex.iArrayCurr = 0;
-            enI106Ch10SetPos(iHandle, 0L);
+        default :
+            return I106_WRONG_FILE_MODE;
             break;
+        } // end switch on file mode
 
-        case I106_READ :
-            enI106Ch10SetPos(iHandle, 0L);
-            break;
-        } // end switch on read mode
+    if (llHorizon < 0)
+        return I106_INVALID_PARAMETER;
+
+    // Turn it off
+    if (llHorizon == 0)
+        {
+        vFreeReorder(iHandle);
+        return I106_OK;
+        }
+
+    // Make a new window if necessary
+    psuReorder = psuI106Handle(iHandle)->psuReorder;
+    if (psuReorder == NULL)
+        {
+        psuReorder = (SuReorder *)calloc(1, sizeof(SuReorder));
+        if (psuReorder == NULL)
+            return I106_NO_MEMORY;
+        psuI106Handle(iHandle)->psuReorder = psuReorder;
+        }
+
+    psuReorder->llHorizon  = llHorizon;
+    psuReorder->ulMaxBytes = ulMaxBytes;
 
     return I106_OK;
-    }
+    } // end enI106Ch10SetReorderWindow()
 
 
 
 /* ----------------------------------------------------------------------- */
 
+// Read a batch of whole packets into a user buffer.  A header that is read 
+// but whose packet won't fit is put back so the next read gets it again.
+
 EnI106Status I106_CALL_DECL 
-    enI106Ch10LastMsg(int iHandle)
+    enI106Ch10ReadPacketBatch(int               iHandle,
+                              void            * pvBuff,
+                              unsigned long     ulBuffSize,
+                              SuPacketRef       asuPacketRef[],
+                              int               iMaxPackets,
+                              int             * piNumPackets)
     {
-    EnI106Status        enReturnStatus;
-    EnI106Status        enStatus;
-    int64_t             llPos;
     SuI106Ch10Header    suHeader;
-    int                 iReadCnt;  
-#if !defined(_WIN32)
-    struct stat         suStatBuff;
-#endif
+    SuPacketRef       * psuRef;
+    unsigned long       ulBuffUsed;
+    unsigned long       ulHeaderLen;
+    int64_t             llOffset;
+    EnI106Status        enStatus;
+
+    *piNumPackets = 0;
 
     // Check for a valid handle
-    if ((iHandle <  0)           || 
-        (iHandle >= MAX_HANDLES) || 
-        (g_suI106Handle[iHandle].bInUse == bFALSE))
+    if (bI106ValidHandle(iHandle) == bFALSE)
         {
         return I106_INVALID_HANDLE;
         }
 
-
-    // Check file modes
-    switch (g_suI106Handle[iHandle].enFileMode)
+    // Only files can back up to put a packet back
+    switch (psuI106Handle(iHandle)->enFileMode)
         {
         case I106_CLOSED :
             return I106_NOT_OPEN;
             break;
 
-        case I106_OVERWRITE       :
-        case I106_APPEND          :
-        case I106_READ_NET_STREAM : 
-        default                   :
+        case I106_READ          :
+        case I106_READ_IN_ORDER :
+        case I106_READ_MMAP     :
+            break;
+
+        default :
             return I106_WRONG_FILE_MODE;
             break;
+        } // end switch on file mode
 
-        // If its opened for reading in order then just set the index pointer
-        // to the last index.
-        case I106_READ_IN_ORDER   :
-            g_suI106Handle[iHandle].suInOrderIndex.iArrayCurr = g_suI106Handle[iHandle].suInOrderIndex.iArrayUsed-1;
-            enReturnStatus = I106_OK;
+    ulBuffUsed = 0;
+    enStatus   = I106_OK;
+    while (*piNumPackets < iMaxPackets)
+        {
+        // Get the next header, skipping over bad ones
+        enStatus = enI106Ch10ReadNextHeader(iHandle, &suHeader);
+        if (enStatus == I106_HEADER_CHKSUM_BAD)
+            continue;
+        if (enStatus != I106_OK)
             break;
 
-        // If there is no index then do it the hard way
-        case I106_READ :
+        // A packet from the time order window knows where it came from.  The
+        // read position is how far the window has read ahead.
+        ulHeaderLen = iGetHeaderLen(&suHeader);
+        if ((psuI106Handle(iHandle)->psuReorder             != NULL) &&
+            (psuI106Handle(iHandle)->psuReorder->bCurrValid == bTRUE))
+            llOffset = psuI106Handle(iHandle)->psuReorder->suCurr.llOffset;
+        else
+            {
+            enI106Ch10GetPos(iHandle, &llOffset);
+            llOffset -= ulHeaderLen;
+            }
 
-            // Figure out how big the file is and go to the end
-#if defined(_WIN32)
-            llPos = _filelengthi64(g_suI106Handle[iHandle].iFile) - HEADER_SIZE;
-#else   
-            fstat(g_suI106Handle[iHandle].iFile, &suStatBuff);
-            llPos = suStatBuff.st_size - HEADER_SIZE;
-#endif      
+        // A packet shorter than its own header is bad.  Put it back if there
+        // are packets to return so the next call reports it.  Otherwise the
+        // next read carries on from just past the header.
+        if (suHeader.ulPacketLen < ulHeaderLen)
+            {
+            enStatus = I106_INVALID_DATA;
+            if (*piNumPackets == 0)
+                break;
+            vPutBackHeader(iHandle, llOffset);
+            break;
+            }
 
-            //if ((llPos % 4) != 0)
-            //    return I106_SEEK_ERROR;
+        // If it doesn't fit then put it back for next time
+        if (suHeader.ulPacketLen > ulBuffSize - ulBuffUsed)
+            {
+            vPutBackHeader(iHandle, llOffset);
+            if (*piNumPackets == 0)
+                enStatus = I106_BUFFER_TOO_SMALL;
+            break;
+            }
 
-            // Now loop forever looking for a valid packet or die trying
-            while (1==1)
-                {
-                // Not at the beginning so go back 1 byte and try again
-                llPos -= 1;
+        // Copy the header and read the data right behind it
+        psuRef = &asuPacketRef[*piNumPackets];
+        psuRef->psuHeader    = (SuI106Ch10Header *)((uint8_t *)pvBuff + ulBuffUsed);
+        psuRef->pvData       = (uint8_t *)pvBuff + ulBuffUsed + ulHeaderLen;
+        psuRef->ulBuffOffset = ulBuffUsed;
+        psuRef->ulPacketLen  = suHeader.ulPacketLen;
+        psuRef->ulDataLen    = suHeader.ulPacketLen - ulHeaderLen;
+        psuRef->llFileOffset = llOffset;
+        memcpy(psuRef->psuHeader, &suHeader, ulHeaderLen);
+
+        enStatus = enI106Ch10ReadData(iHandle, psuRef->ulDataLen, psuRef->pvData);
+        if (enStatus != I106_OK)
+            break;
 
-                // Go to the new position and look for a legal header
-                enStatus = enI106Ch10SetPos(iHandle, llPos);
-                if (enStatus != I106_OK)
-                    return I106_SEEK_ERROR;
+        ulBuffUsed += suHeader.ulPacketLen;
+        (*piNumPackets)++;
+        } // end while reading packets
 
-                // Read and check the header
-                iReadCnt = read(g_suI106Handle[iHandle].iFile, &suHeader, HEADER_SIZE);
+    // Return whatever was read.  Any error will show up again next time.
+    if ((*piNumPackets > 0) || (enStatus == I106_OK))
+        return I106_OK;
 
-                if (iReadCnt != HEADER_SIZE)
-                    continue;
+    return enStatus;
+    } // end enI106Ch10ReadPacketBatch()
 
-                if (suHeader.uSync != IRIG106_SYNC)
-                    continue;
-            
-                // Sync pattern matched so check the header checksum
-                if (suHeader.uChecksum == uCalcHeaderChecksum(&suHeader))
-                    {
-                    enReturnStatus = I106_OK;
-                    break;
-                    }
 
-                // No match, check for begining of file
-    // ONLY NEED TO GO BACK THE MAX PACKET SIZE
-                if (llPos <= 0)
-                    {
-                    enReturnStatus = I106_SEEK_ERROR;
-                    break;
-                    }
 
-                } // end looping forever
+/* ----------------------------------------------------------------------- */
 
-            // Go back to the good position
-            enStatus = enI106Ch10SetPos(iHandle, llPos);
+// Put back the header just read so the next read gets it again.  A packet 
+// from the time order window is handed out again from the window, seeking
+// would throw the window away.
 
-            break;
-        } // end switch on read mode
+static void vPutBackHeader(int iHandle, int64_t llOffset)
+    {
 
-    return enReturnStatus;
+    if ((psuI106Handle(iHandle)->psuReorder             != NULL) &&
+        (psuI106Handle(iHandle)->psuReorder->bCurrValid == bTRUE))
+        {
+        psuI106Handle(iHandle)->psuReorder->bCurrPutBack = bTRUE;
+        return;
+        }
+
+    if ((psuI106Handle(iHandle)->enFileMode == I106_READ_IN_ORDER) &&
+        (psuI106Handle(iHandle)->suInOrderIndex.enSortStatus == enSorted))
+        psuI106Handle(iHandle)->suInOrderIndex.iArrayCurr--;
+    enI106Ch10SetPos(iHandle, llOffset);
+
+    return;
     }
 
 
 
 /* ----------------------------------------------------------------------- */
 
+// Read filters
+
 EnI106Status I106_CALL_DECL 
-    enI106Ch10SetPos(int iHandle, int64_t llOffset)
+    enI106Ch10FilterChannel(int iHandle, uint16_t uChID)
     {
+    SuI106Ch10Filter  * psuFilter;
+    EnI106Status        enStatus;
 
-    // Check for a valid handle
-    if ((iHandle <  0)           || 
-        (iHandle >= MAX_HANDLES) || 
-        (g_suI106Handle[iHandle].bInUse == bFALSE))
-        {
-        return I106_INVALID_HANDLE;
-        }
+    psuFilter = psuGetFilter(iHandle, &enStatus);
+    if (psuFilter == NULL)
+        return enStatus;
 
+    psuFilter->bChanFilter = bTRUE;
+    psuFilter->abyChanMask[uChID >> 3] |= (uint8_t)(1 << (uChID & 0x07));
 
-    // Check file modes
-    switch (g_suI106Handle[iHandle].enFileMode)
-        {
-        case I106_CLOSED :
-            return I106_NOT_OPEN;
-            break;
+    return I106_OK;
+    }
 
-        case I106_OVERWRITE       :
-        case I106_APPEND          :
-        case I106_READ_NET_STREAM : 
-        default                   :
-            return I106_WRONG_FILE_MODE;
-            break;
 
-        case I106_READ_IN_ORDER   :
-        case I106_READ :
-            // Seek
-#if defined(_WIN32)
-            {
-            __int64  llStatus;
-            llStatus = _lseeki64(g_suI106Handle[iHandle].iFile, llOffset, SEEK_SET);
-            }
-#else
+
+EnI106Status I106_CALL_DECL 
+    enI106Ch10FilterDataType(int iHandle, uint8_t ubyDataType)
     {
-    off64_t  llStatus;
-    llStatus = lseek64(g_suI106Handle[iHandle].iFile, (off64_t)llOffset, SEEK_SET);
-    assert(llStatus >= 0);
-    }
-#endif
+    SuI106Ch10Filter  * psuFilter;
+    EnI106Status        enStatus;
 
-            // Can't be sure we're on a message boundary so set unsync'ed
-            g_suI106Handle[iHandle].enFileState = enReadUnsynced;
-            break;
-        } // end switch on file mode
+    psuFilter = psuGetFilter(iHandle, &enStatus);
+    if (psuFilter == NULL)
+        return enStatus;
+
+    psuFilter->bTypeFilter = bTRUE;
+    psuFilter->abyTypeMask[ubyDataType >> 3] |= (uint8_t)(1 << (ubyDataType & 0x07));
 
     return I106_OK;
     }
 
 
 
-/* ----------------------------------------------------------------------- */
-
 EnI106Status I106_CALL_DECL 
-    enI106Ch10GetPos(int iHandle, int64_t *pllOffset)
+    enI106Ch10FilterFlags(int iHandle, uint8_t ubyFlagsMask, uint8_t ubyFlagsValue)
     {
+    SuI106Ch10Filter  * psuFilter;
+    EnI106Status        enStatus;
 
-    // Check for a valid handle
-    if ((iHandle <  0)           || 
-        (iHandle >= MAX_HANDLES) || 
-        (g_suI106Handle[iHandle].bInUse == bFALSE))
-        {
-        return I106_INVALID_HANDLE;
-        }
-
-    // Check file modes
-    switch (g_suI106Handle[iHandle].enFileMode)
-        {
-        case I106_CLOSED :
-            return I106_NOT_OPEN;
-            break;
-
-        case I106_READ_NET_STREAM : 
-        default                   :
-            return I106_WRONG_FILE_MODE;
-            break;
-
-        case I106_READ_IN_ORDER   :
-        case I106_READ            :
-        case I106_OVERWRITE       :
-        case I106_APPEND          :
-    // Get position
-#if defined(_WIN32)
-            *pllOffset = _telli64(g_suI106Handle[iHandle].iFile);
-#else
-    {
-    *pllOffset = (int64_t)lseek64(g_suI106Handle[iHandle].iFile, (off64_t)0, SEEK_CUR);
-    assert(*pllOffset >= 0);
-    }
-#endif
-            break;
-        } // end switch on file mode
+    psuFilter = psuGetFilter(iHandle, &enStatus);
+    if (psuFilter == NULL)
+        return enStatus;
 
+    psuFilter->ubyFlagsMask  = ubyFlagsMask;
+    psuFilter->ubyFlagsValue = ubyFlagsValue & ubyFlagsMask;
 
     return I106_OK;
     }
 
 
 
-/* -----------------------------------------------------------------------
- * Utilities
- * ----------------------------------------------------------------------- */
-
-/* Set packet header to some sane values. Be sure to fill in proper values for:
-        ulPacketLen
-        ulDataLen
-        ubyHdrVer
-        aubyRefTime
-        uChecksum
- */
-int I106_CALL_DECL 
-    iHeaderInit(SuI106Ch10Header * psuHeader,
-                unsigned int       uChanID,
-                unsigned int       uDataType,
-                unsigned int       uFlags,
-                unsigned int       uSeqNum)
+EnI106Status I106_CALL_DECL 
+    enI106Ch10FilterTime(int iHandle, int64_t llStartTime, int64_t llStopTime)
     {
+    SuI106Ch10Filter  * psuFilter;
+    EnI106Status        enStatus;
 
-    // Make a legal, valid header
-    psuHeader->uSync          = IRIG106_SYNC;
-    psuHeader->uChID          = uChanID;
-    psuHeader->ulPacketLen    = HEADER_SIZE;
-    psuHeader->ulDataLen      = 0;
-    psuHeader->ubyHdrVer      = 0x02;  // <-- NEED TO PASS THIS IN!!!
-    psuHeader->ubySeqNum      = uSeqNum;
-    psuHeader->ubyPacketFlags = uFlags;
-    psuHeader->ubyDataType    = uDataType;
-    memset(&(psuHeader->aubyRefTime), 0, 6);
-//  psuHeader->uChecksum      = uCalcHeaderChecksum(psuHeader);
-    psuHeader->uChecksum      = 0;
-// This could overrun if the header doesn't have a secondary header
-//    memset(&(psuHeader->aulTime), 0, 8);
-//    psuHeader->uReserved      = 0;
-//    psuHeader->uSecChecksum   = uCalcSecHeaderChecksum(psuHeader);
+    psuFilter = psuGetFilter(iHandle, &enStatus);
+    if (psuFilter == NULL)
+        return enStatus;
 
-    return 0;
+    psuFilter->bTimeFilter = bTRUE;
+    psuFilter->llStartTime = llStartTime;
+    psuFilter->llStopTime  = llStopTime;
+
+    return I106_OK;
     }
 
-/* ----------------------------------------------------------------------- */
 
-// Figure out header length (might need to check header version at
-// some point if I can ever figure out what the different header
-// version mean.
 
-int I106_CALL_DECL 
-    iGetHeaderLen(SuI106Ch10Header * psuHeader)
+EnI106Status I106_CALL_DECL 
+    enI106Ch10FilterClear(int iHandle)
     {
-    int     iHeaderLen;
 
-    if ((psuHeader->ubyPacketFlags & I106CH10_PFLAGS_SEC_HEADER) == 0)
-        iHeaderLen = HEADER_SIZE;
-    else
-        iHeaderLen = HEADER_SIZE + SEC_HEADER_SIZE;
+    // Check for a valid handle
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        {
+        return I106_INVALID_HANDLE;
+        }
 
-    return iHeaderLen;
-    }
+    free(psuI106Handle(iHandle)->psuFilter);
+    psuI106Handle(iHandle)->psuFilter = NULL;
 
+    return I106_OK;
+    }
 
 
 
 /* ----------------------------------------------------------------------- */
 
-// Figure out data length including padding and any data checksum
+// Scan a file with multiple threads.  Each thread gets its own handle and a
+// byte range of the file.  A thread owns the packets on the sequential read
+// packet chain that start in its range, so every packet a sequential read 
+// would return is handed off exactly once no matter how the threads are 
+// scheduled.
 
-uint32_t I106_CALL_DECL 
-    uGetDataLen(SuI106Ch10Header * psuHeader)
+EnI106Status I106_CALL_DECL 
+    enI106Ch10ScanParallel(const char              szFileName[],
+                           int                     iNumThreads,
+                           PFnI106PacketHandler    pfnHandler,
+                           void                  * pvUserData)
     {
-    int     iDataLen;
-
-    iDataLen = psuHeader->ulPacketLen - iGetHeaderLen(psuHeader);
-
-    return iDataLen;
-    }
+    return enScanFile(szFileName, iNumThreads, I106_READ, bTRUE, pfnHandler, pvUserData);
+    } // end enI106Ch10ScanParallel()
 
 
 
 /* ----------------------------------------------------------------------- */
 
-uint16_t I106_CALL_DECL 
-    uCalcHeaderChecksum(SuI106Ch10Header * psuHeader)
+// Memory mapping makes skipping over the data free
+
+EnI106Status I106_CALL_DECL 
+    enI106Ch10ScanHeadersParallel(const char              szFileName[],
+                                  int                     iNumThreads,
+                                  PFnI106PacketHandler    pfnHandler,
+                                  void                  * pvUserData)
     {
-    int             iHdrIdx;
-    uint16_t        uHdrSum;
-    uint16_t      * aHdr = (uint16_t *)psuHeader;
+#if defined(_WIN32)
+    return enScanFile(szFileName, iNumThreads, I106_READ, bFALSE, pfnHandler, pvUserData);
+#else
+    return enScanFile(szFileName, iNumThreads, I106_READ_MMAP, bFALSE, pfnHandler, pvUserData);
+#endif
+    } // end enI106Ch10ScanHeadersParallel()
 
-    uHdrSum = 0;
-    for (iHdrIdx=0; iHdrIdx<(HEADER_SIZE-2)/2; iHdrIdx++)
-        uHdrSum += aHdr[iHdrIdx];
 
-    return uHdrSum;
+
+/* ----------------------------------------------------------------------- */
+
+// Do the work of a parallel scan.  Header only scans skip over packet data
+// and hand the packet handler a NULL data pointer.
+//
+// The first good header at or after a range boundary may be a false sync in 
+// the middle of some packet data.  So first each thread follows the packet 
+// chain from its first header to the first packet at or after the next 
+// boundary.  Then the real boundaries are worked out in file order starting
+// from the beginning of the file, which is always a packet start.  A range 
+// whose first header isn't where the previous chain lands gets its chain 
+// followed again from the right place.  Only then are packets handed off.
+
+static EnI106Status enScanFile(const char              szFileName[],
+                               int                     iNumThreads,
+                               EnI106Ch10Mode          enMode,
+                               int                     bReadData,
+                               PFnI106PacketHandler    pfnHandler,
+                               void                  * pvUserData)
+    {
+    SuScanWorker      * asuWorker;
+    SuScanWorker      * psuWorker;
+    int                 bAbort = bFALSE;
+    int64_t             llFileSize;
+    int64_t             llStartOffset;
+    int64_t             llStopOffset;
+    int                 iThreadIdx;
+    EnI106Status        enStatus;
+#if !defined(_WIN32)
+    struct stat         suStatBuff;
+#endif
+
+    if ((iNumThreads < 1) || (pfnHandler == NULL))
+        return I106_INVALID_PARAMETER;
+
+    asuWorker = (SuScanWorker *)calloc(iNumThreads, sizeof(SuScanWorker));
+    if (asuWorker == NULL)
+        return I106_NO_MEMORY;
+
+    // Open a handle for each thread up front so an open failure can be
+    // reported before any scanning starts.
+    enStatus = I106_OK;
+    for (iThreadIdx=0; iThreadIdx<iNumThreads; iThreadIdx++)
+        asuWorker[iThreadIdx].iHandle = -1;
+    for (iThreadIdx=0; iThreadIdx<iNumThreads; iThreadIdx++)
+        {
+        enStatus = enI106Ch10Open(&asuWorker[iThreadIdx].iHandle, szFileName, enMode);
+        if (enStatus == I106_OPEN_WARNING)
+            enStatus = I106_OK;
+        if (enStatus != I106_OK)
+            break;
+        }
+
+    // Split the file into equal size ranges
+    if (enStatus == I106_OK)
+        {
+#if defined(_WIN32)
+        llFileSize = _filelengthi64(psuI106Handle(asuWorker[0].iHandle)->iFile);
+#else
+        fstat(psuI106Handle(asuWorker[0].iHandle)->iFile, &suStatBuff);
+        llFileSize = suStatBuff.st_size;
+#endif
+
+        for (iThreadIdx=0; iThreadIdx<iNumThreads; iThreadIdx++)
+            {
+            asuWorker[iThreadIdx].iThread      = iThreadIdx;
+            asuWorker[iThreadIdx].llRangeStart = llFileSize * iThreadIdx       / iNumThreads;
+            asuWorker[iThreadIdx].llRangeEnd   = llFileSize * (iThreadIdx + 1) / iNumThreads;
+            asuWorker[iThreadIdx].pfnHandler   = pfnHandler;
+            asuWorker[iThreadIdx].pvUserData   = pvUserData;
+            asuWorker[iThreadIdx].pbAbort      = &bAbort;
+            asuWorker[iThreadIdx].enMode       = enMode;
+            asuWorker[iThreadIdx].bReadData    = bReadData;
+            asuWorker[iThreadIdx].bFindStop    = bTRUE;
+            asuWorker[iThreadIdx].enStatus     = I106_OK;
+            }
+
+        // Follow each chain to the next range.  The last range goes to the
+        // end of the file so it doesn't need to.
+        enStatus = enRunScanWorkers(asuWorker, iNumThreads - 1);
+
+        // Work out the real boundaries
+        llStartOffset = 0;
+        for (iThreadIdx=0; (iThreadIdx<iNumThreads) && (enStatus == I106_OK); iThreadIdx++)
+            {
+            psuWorker = &asuWorker[iThreadIdx];
+            if (iThreadIdx == iNumThreads - 1)
+                llStopOffset = INT64_MAX;
+            else if (llStartOffset == psuWorker->llStartOffset)
+                llStopOffset = psuWorker->llStopOffset;
+            else
+                enStatus = enFollowChain(psuWorker->iHandle, llStartOffset, psuWorker->llRangeEnd, &llStopOffset);
+            psuWorker->llStartOffset = llStartOffset;
+            psuWorker->llStopOffset  = llStopOffset;
+            psuWorker->bFindStop     = bFALSE;
+            llStartOffset            = llStopOffset;
+            }
+
+        // Hand off the packets
+        if (enStatus == I106_OK)
+            enStatus = enRunScanWorkers(asuWorker, iNumThreads);
+        } // end if all handles opened
+
+    // Clean up
+    for (iThreadIdx=0; iThreadIdx<iNumThreads; iThreadIdx++)
+        {
+        if (asuWorker[iThreadIdx].iHandle >= 0)
+            enI106Ch10Close(asuWorker[iThreadIdx].iHandle);
+        }
+    free(asuWorker);
+
+    return enStatus;
     }
 
 
+
 /* ----------------------------------------------------------------------- */
 
-uint16_t I106_CALL_DECL 
-    uCalcSecHeaderChecksum(SuI106Ch10Header * psuHeader)
+// Run each worker on its own thread and wait for them all to finish.  If a 
+// thread can't be started its work is done here.  Returns the first error.
+
+static EnI106Status enRunScanWorkers(SuScanWorker asuWorker[], int iNumWorkers)
     {
+#if defined(_WIN32)
+    HANDLE            * ahThread;
+#else
+    pthread_t         * ahThread;
+#endif
+    int               * abThreadOK;
+    int                 iThreadIdx;
 
-    int             iByteIdx;
-    uint16_t        uHdrSum;
-// MAKE THIS 16 BIT UNSIGNEDS LIKE ABOVE
-    unsigned char * auchHdrByte = (unsigned char *)psuHeader;
+    if (iNumWorkers < 1)
+        return I106_OK;
 
-    uHdrSum = 0;
-    for (iByteIdx=0; iByteIdx<SEC_HEADER_SIZE-2; iByteIdx++)
-        uHdrSum += auchHdrByte[iByteIdx+HEADER_SIZE];
+    abThreadOK = (int *)calloc(iNumWorkers, sizeof(int));
+#if defined(_WIN32)
+    ahThread   = (HANDLE *)calloc(iNumWorkers, sizeof(HANDLE));
+#else
+    ahThread   = (pthread_t *)calloc(iNumWorkers, sizeof(pthread_t));
+#endif
+    if ((abThreadOK == NULL) || (ahThread == NULL))
+        {
+        free(abThreadOK);
+        free(ahThread);
+        return I106_NO_MEMORY;
+        }
 
-    return uHdrSum;
+    for (iThreadIdx=0; iThreadIdx<iNumWorkers; iThreadIdx++)
+        {
+#if defined(_WIN32)
+        ahThread[iThreadIdx] = (HANDLE)_beginthreadex(NULL, 0, uScanWorkerThread, 
+                                                      &asuWorker[iThreadIdx], 0, NULL);
+        abThreadOK[iThreadIdx] = ahThread[iThreadIdx] != 0;
+#else
+        abThreadOK[iThreadIdx] = pthread_create(&ahThread[iThreadIdx], NULL, 
+                                                pvScanWorkerThread, &asuWorker[iThreadIdx]) == 0;
+#endif
+        if (!abThreadOK[iThreadIdx])
+            vScanWorker(&asuWorker[iThreadIdx]);
+        }
+
+    for (iThreadIdx=0; iThreadIdx<iNumWorkers; iThreadIdx++)
+        {
+        if (!abThreadOK[iThreadIdx])
+            continue;
+#if defined(_WIN32)
+        WaitForSingleObject(ahThread[iThreadIdx], INFINITE);
+        CloseHandle(ahThread[iThreadIdx]);
+#else
+        pthread_join(ahThread[iThreadIdx], NULL);
+#endif
+        }
+
+    free(abThreadOK);
+    free(ahThread);
+
+    for (iThreadIdx=0; iThreadIdx<iNumWorkers; iThreadIdx++)
+        if (asuWorker[iThreadIdx].enStatus != I106_OK)
+            return asuWorker[iThreadIdx].enStatus;
+
+    return I106_OK;
     }
 
 
+
+
+
 /* ----------------------------------------------------------------------- */
 
-// Calculate and return the required size of the data buffer portion of the
-// packet including checksum and appropriate filler for 4 byte alignment.
+EnI106Status I106_CALL_DECL 
+    enI106Ch10WriteMsg(int                iHandle,
+                       SuI106Ch10Header * psuHeader,
+                       void             * pvBuff)
+    {
+    int             iHeaderLen;
+    const void    * apvSeg[2];
+    unsigned long   aulSegLen[2];
+    EnI106Status    enStatus;
 
-uint32_t I106_CALL_DECL 
-    uCalcDataBuffReqSize(uint32_t uDataLen, int iChecksumType)
+    // Check for a valid handle
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        {
+        return I106_INVALID_HANDLE;
+        }
+
+    // Check for invalid file modes
+    switch (psuI106Handle(iHandle)->enFileMode)
+        {
+        case I106_CLOSED :
+            return I106_NOT_OPEN;
+            break;
+
+        case I106_READ            :
+        case I106_READ_IN_ORDER   : 
+        case I106_READ_MMAP       : 
+        case I106_READ_NET_STREAM : 
+            return I106_WRONG_FILE_MODE;
+            break;
+        default :
+            break;
+        } // end switch on read mode
+
+    // Figure out header length
+    iHeaderLen = iGetHeaderLen(psuHeader);
+
+    // Write the header and data
+    apvSeg[0]   = psuHeader;
+    aulSegLen[0] = iHeaderLen;
+    apvSeg[1]   = pvBuff;
+    aulSegLen[1] = psuHeader->ulPacketLen - iHeaderLen;
+
+    enStatus = enWriteFile(iHandle, apvSeg, aulSegLen, 2);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    // Update the number of bytes written
+    psuI106Handle(iHandle)->ulTotalBytesWritten += psuHeader->ulPacketLen;
+
+    // Keep the index packet writer up to date
+    if (psuI106Handle(iHandle)->psuFileIndex != NULL)
+        return enIndexPacketWritten(iHandle, psuHeader);
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Write a complete Ch 10 packet.
+// This version is useful in cases where the data buffer size can't be 
+// conveniently controlled and manipulated.
+
+EnI106Status I106_CALL_DECL
+    enI106Ch10WriteMsg2(int                   iHandle,
+                        SuI106Ch10Header    * psuHeader,
+                        void                * pvCSDW,
+                        int                   iCSDWLen,
+                        void                * pvBuff,
+                        unsigned long         ulBuffDataLen,
+                        void                * pvFiller,
+                        int                   iFillerLen)
     {
-    uint32_t    uDataBuffLen;
+    int             iHeaderLen;
+    const void    * apvSeg[4];
+    unsigned long   aulSegLen[4];
+    int             iNumSegs;
+    EnI106Status    enStatus;
 
-    // Start with the length of the data
-    uDataBuffLen = uDataLen;
+    // Check for a valid handle
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        {
+        return I106_INVALID_HANDLE;
+        }
 
-    // Add in enough for the selected checksum
-    switch (iChecksumType)
+    // Check for invalid file modes
+    switch (psuI106Handle(iHandle)->enFileMode)
         {
-        case I106CH10_PFLAGS_CHKSUM_NONE :
+        case I106_CLOSED :
+            return I106_NOT_OPEN;
             break;
-        case I106CH10_PFLAGS_CHKSUM_8    :
-            uDataBuffLen += 1;
+
+        case I106_READ            :
+        case I106_READ_IN_ORDER   : 
+        case I106_READ_MMAP       : 
+        case I106_READ_NET_STREAM : 
+            return I106_WRONG_FILE_MODE;
             break;
-        case I106CH10_PFLAGS_CHKSUM_16   :
-            uDataBuffLen += 2;
+        default :
             break;
-        case I106CH10_PFLAGS_CHKSUM_32   :
-            uDataBuffLen += 4;
+        } // end switch on read mode
+
+    // Figure out header length
+    iHeaderLen = iGetHeaderLen(psuHeader);
+
+    // Write the header, Channel Specific Data Word, data, and filler
+    iNumSegs = 0;
+    apvSeg[iNumSegs]    = psuHeader;
+    aulSegLen[iNumSegs] = iHeaderLen;
+    iNumSegs++;
+    apvSeg[iNumSegs]    = pvCSDW;
+    aulSegLen[iNumSegs] = iCSDWLen;
+    iNumSegs++;
+    apvSeg[iNumSegs]    = pvBuff;
+    aulSegLen[iNumSegs] = ulBuffDataLen;
+    iNumSegs++;
+    if (iFillerLen > 0)
+        {
+        apvSeg[iNumSegs]    = pvFiller;
+        aulSegLen[iNumSegs] = iFillerLen;
+        iNumSegs++;
+        }
+
+    enStatus = enWriteFile(iHandle, apvSeg, aulSegLen, iNumSegs);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    // Update the number of bytes written
+    psuI106Handle(iHandle)->ulTotalBytesWritten += psuHeader->ulPacketLen;
+
+    // Keep the index packet writer up to date
+    if (psuI106Handle(iHandle)->psuFileIndex != NULL)
+        return enIndexPacketWritten(iHandle, psuHeader);
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+EnI106Status I106_CALL_DECL
+    enI106Ch10SetWriteBuffer(int                iHandle,
+                             unsigned long      ulBuffSize,
+                             unsigned long      ulFlushMs)
+    {
+    EnI106Status    enStatus;
+
+    // Check for a valid handle
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        {
+        return I106_INVALID_HANDLE;
+        }
+
+    // Only makes sense for files open for writing
+    switch (psuI106Handle(iHandle)->enFileMode)
+        {
+        case I106_CLOSED :
+            return I106_NOT_OPEN;
+            break;
+
+        case I106_OVERWRITE       :
+        case I106_APPEND          :
             break;
+
         default :
-            uDataBuffLen = 0;
-        } // end switch iChecksumType
+            return I106_WRONG_FILE_MODE;
+            break;
+        } // end switch on file mode
 
-    // Now add filler for 4 byte alignment
-    uDataBuffLen += 3;
-    uDataBuffLen &= 0xfffffffc;
+    // Write out anything in the current buffer
+    enStatus = enFlushWriteBuff(iHandle);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    // Resize the buffer
+    if (ulBuffSize != psuI106Handle(iHandle)->ulWriteBuffSize)
+        {
+        free(psuI106Handle(iHandle)->pchWriteBuff);
+        psuI106Handle(iHandle)->pchWriteBuff    = NULL;
+        psuI106Handle(iHandle)->ulWriteBuffSize = 0L;
+
+        if (ulBuffSize > 0)
+            {
+            psuI106Handle(iHandle)->pchWriteBuff = (unsigned char *)malloc(ulBuffSize);
+            if (psuI106Handle(iHandle)->pchWriteBuff == NULL)
+                return I106_NO_MEMORY;
+            psuI106Handle(iHandle)->ulWriteBuffSize = ulBuffSize;
+            }
+        }
+
+    psuI106Handle(iHandle)->ulWriteBuffLen = 0L;
+    psuI106Handle(iHandle)->ulWriteFlushMs = ulFlushMs;
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+EnI106Status I106_CALL_DECL
+    enI106Ch10Flush(int iHandle)
+    {
+
+    // Check for a valid handle
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        {
+        return I106_INVALID_HANDLE;
+        }
+
+    switch (psuI106Handle(iHandle)->enFileMode)
+        {
+        case I106_CLOSED :
+            return I106_NOT_OPEN;
+            break;
+
+        case I106_OVERWRITE       :
+        case I106_APPEND          :
+            break;
+
+        default :
+            return I106_WRONG_FILE_MODE;
+            break;
+        } // end switch on file mode
+
+    if (psuI106Handle(iHandle)->psuWriteThread != NULL)
+        return enDrainWriteRing(psuI106Handle(iHandle)->psuWriteThread);
+
+    return enFlushWriteBuff(iHandle);
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+EnI106Status I106_CALL_DECL
+    enI106Ch10Sync(int iHandle)
+    {
+    EnI106Status    enStatus;
+    int             iStatus;
+
+    enStatus = enI106Ch10Flush(iHandle);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+#if defined(_WIN32)
+    iStatus = _commit(psuI106Handle(iHandle)->iFile);
+#else
+    iStatus = fsync(psuI106Handle(iHandle)->iFile);
+#endif
+    if (iStatus != 0)
+        return I106_WRITE_ERROR;
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+EnI106Status I106_CALL_DECL
+    enI106Ch10Preallocate(int iHandle, int64_t llSize)
+    {
+    EnI106Status    enStatus;
+    int64_t         llOffset;
+
+    // Check for a valid handle
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        {
+        return I106_INVALID_HANDLE;
+        }
+
+    switch (psuI106Handle(iHandle)->enFileMode)
+        {
+        case I106_CLOSED :
+            return I106_NOT_OPEN;
+            break;
+
+        case I106_OVERWRITE       :
+        case I106_APPEND          :
+            break;
+
+        default :
+            return I106_WRONG_FILE_MODE;
+            break;
+        } // end switch on file mode
+
+    if (llSize <= 0)
+        return I106_INVALID_PARAMETER;
+
+    // Reserve space from the logical write position on
+    enStatus = enI106Ch10GetPos(iHandle, &llOffset);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+#if defined(__linux__)
+    // Allocate blocks but leave the file size alone so readers don't see
+    // a tail of zeros if the recording stops early
+    if (fallocate(psuI106Handle(iHandle)->iFile, FALLOC_FL_KEEP_SIZE, 
+                  (off_t)llOffset, (off_t)llSize) != 0)
+        {
+        if ((errno == EOPNOTSUPP) || (errno == ENOSYS))
+            return I106_UNSUPPORTED;
+        return I106_WRITE_ERROR;
+        }
+    return I106_OK;
+#else
+    (void)llOffset;
+    return I106_UNSUPPORTED;
+#endif
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+EnI106Status I106_CALL_DECL
+    enI106Ch10StartWriteThread(int                  iHandle,
+                               unsigned long        ulRingSize,
+                               EnI106WritePolicy    enPolicy)
+    {
+    EnI106Status        enStatus;
+    SuWriteThread     * psuWriter;
+    int                 bThreadOK;
+
+    // Check for a valid handle
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        {
+        return I106_INVALID_HANDLE;
+        }
+
+    switch (psuI106Handle(iHandle)->enFileMode)
+        {
+        case I106_CLOSED :
+            return I106_NOT_OPEN;
+            break;
+
+        case I106_OVERWRITE       :
+        case I106_APPEND          :
+            break;
+
+        default :
+            return I106_WRONG_FILE_MODE;
+            break;
+        } // end switch on file mode
+
+    if (psuI106Handle(iHandle)->psuWriteThread != NULL)
+        return I106_ALREADY_OPEN;
+
+    if (ulRingSize == 0L)
+        return I106_INVALID_PARAMETER;
+
+    // Anything already buffered goes out first to keep the packets in order
+    enStatus = enFlushWriteBuff(iHandle);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    psuWriter = (SuWriteThread *)calloc(1, sizeof(SuWriteThread));
+    if (psuWriter == NULL)
+        return I106_NO_MEMORY;
+
+    enI106Ch10GetPos(iHandle, &psuWriter->llStartOffset);
+
+    psuWriter->pchRing = (unsigned char *)malloc(ulRingSize);
+    if (psuWriter->pchRing == NULL)
+        {
+        free(psuWriter);
+        return I106_NO_MEMORY;
+        }
+
+    psuWriter->iHandle          = iHandle;
+    psuWriter->ulRingSize       = ulRingSize;
+    psuWriter->llHead           = 0;
+    psuWriter->llTail           = 0;
+    psuWriter->bStop            = bFALSE;
+    psuWriter->enWriteStatus    = I106_OK;
+    psuWriter->enPolicy         = enPolicy;
+    psuWriter->llHighWater      = 0;
+    psuWriter->llPacketsDropped = 0;
+    psuWriter->llBytesDropped   = 0;
+
+#if defined(_WIN32)
+    psuWriter->hThread = (HANDLE)_beginthreadex(NULL, 0, uWriteThread, psuWriter, 0, NULL);
+    bThreadOK = psuWriter->hThread != 0;
+#else
+    bThreadOK = pthread_create(&psuWriter->hThread, NULL, pvWriteThread, psuWriter) == 0;
+#endif
+    if (bThreadOK == bFALSE)
+        {
+        free(psuWriter->pchRing);
+        free(psuWriter);
+        return I106_OPEN_ERROR;
+        }
+
+    psuI106Handle(iHandle)->psuWriteThread = psuWriter;
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+EnI106Status I106_CALL_DECL
+    enI106Ch10StopWriteThread(int iHandle)
+    {
+    EnI106Status        enStatus;
+    SuWriteThread     * psuWriter;
+
+    // Check for a valid handle
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        {
+        return I106_INVALID_HANDLE;
+        }
+
+    psuWriter = psuI106Handle(iHandle)->psuWriteThread;
+    if (psuWriter == NULL)
+        return I106_NOT_OPEN;
+
+    // The writer thread empties the ring before it quits
+    RING_STORE(&psuWriter->bStop, bTRUE);
+#if defined(_WIN32)
+    WaitForSingleObject(psuWriter->hThread, INFINITE);
+    CloseHandle(psuWriter->hThread);
+#else
+    pthread_join(psuWriter->hThread, NULL);
+#endif
+
+    enStatus = (EnI106Status)FLAG_LOAD(&psuWriter->enWriteStatus);
+
+    psuI106Handle(iHandle)->psuWriteThread = NULL;
+    free(psuWriter->pchRing);
+    free(psuWriter);
+
+    return enStatus;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+EnI106Status I106_CALL_DECL
+    enI106Ch10GetWriteStats(int iHandle, SuI106WriteStats * psuStats)
+    {
+    SuWriteThread     * psuWriter;
+
+    // Check for a valid handle
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        {
+        return I106_INVALID_HANDLE;
+        }
+
+    psuWriter = psuI106Handle(iHandle)->psuWriteThread;
+    if (psuWriter == NULL)
+        return I106_NOT_OPEN;
+
+    psuStats->ulRingSize        = psuWriter->ulRingSize;
+    psuStats->ulRingUsed        = (unsigned long)(RING_LOAD(&psuWriter->llHead) - RING_LOAD(&psuWriter->llTail));
+    psuStats->ulHighWater       = (unsigned long)RING_LOAD(&psuWriter->llHighWater);
+    psuStats->ullPacketsDropped = (uint64_t)RING_LOAD(&psuWriter->llPacketsDropped);
+    psuStats->ullBytesDropped   = (uint64_t)RING_LOAD(&psuWriter->llBytesDropped);
+    psuStats->enWriteStatus     = (EnI106Status)FLAG_LOAD(&psuWriter->enWriteStatus);
+
+    return I106_OK;
+    }
+
+
+
+/* -----------------------------------------------------------------------
+ * Move file pointer
+ * ----------------------------------------------------------------------- */
+
+EnI106Status I106_CALL_DECL 
+    enI106Ch10FirstMsg(int iHandle)
+    {
+
+    // Check for a valid handle
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        {
+        return I106_INVALID_HANDLE;
+        }
+
+    // Check file modes
+    switch (psuI106Handle(iHandle)->enFileMode)
+        {
+        case I106_CLOSED :
+            return I106_NOT_OPEN;
+            break;
+
+        case I106_OVERWRITE       :
+        case I106_APPEND          :
+        case I106_READ_NET_STREAM : 
+        default                   :
+            return I106_WRONG_FILE_MODE;
+            break;
+
+        case I106_READ_IN_ORDER   :
+            psuI106Handle(iHandle)->suInOrderIndex.iArrayCurr = 0;
+            enI106Ch10SetPos(iHandle, 0L);
+            break;
+
+        case I106_READ :
+        case I106_READ_MMAP :
+            enI106Ch10SetPos(iHandle, 0L);
+            break;
+        } // end switch on read mode
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+EnI106Status I106_CALL_DECL 
+    enI106Ch10LastMsg(int iHandle)
+    {
+    EnI106Status        enReturnStatus;
+    EnI106Status        enStatus;
+    int64_t             llPos;
+#if !defined(_WIN32)
+    struct stat         suStatBuff;
+#endif
+
+    // Check for a valid handle
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        {
+        return I106_INVALID_HANDLE;
+        }
+
+
+    // Check file modes
+    switch (psuI106Handle(iHandle)->enFileMode)
+        {
+        case I106_CLOSED :
+            return I106_NOT_OPEN;
+            break;
+
+        case I106_OVERWRITE       :
+        case I106_APPEND          :
+        case I106_READ_NET_STREAM : 
+        default                   :
+            return I106_WRONG_FILE_MODE;
+            break;
+
+        // If its opened for reading in order then just set the index pointer
+        // to the last index.
+        case I106_READ_IN_ORDER   :
+            if (psuI106Handle(iHandle)->suInOrderIndex.enSortStatus == enSorted)
+                {
+                SuInOrderIndex * psuIndex = &psuI106Handle(iHandle)->suInOrderIndex;
+                if (psuIndex->iArrayUsed <= 0)
+                    return I106_SEEK_ERROR;
+                psuIndex->iArrayCurr = psuIndex->iArrayUsed-1;
+                enI106Ch10SetPos(iHandle, psuIndex->asuIndex[psuIndex->iArrayCurr].llOffset);
+                enReturnStatus = I106_OK;
+                break;
+                }
+            // No index so fall through and do it the hard way
+
+        // If there is no index then do it the hard way
+        case I106_READ :
+        case I106_READ_MMAP :
+
+            // Figure out how big the file is
+            if (psuI106Handle(iHandle)->pchMapBase != NULL)
+                llPos = psuI106Handle(iHandle)->llMapSize;
+            else
+                {
+#if defined(_WIN32)
+                llPos = _filelengthi64(psuI106Handle(iHandle)->iFile);
+#else   
+                fstat(psuI106Handle(iHandle)->iFile, &suStatBuff);
+                llPos = suStatBuff.st_size;
+#endif      
+                }
+
+            // Scan backwards from the last place a full header could be
+            enStatus = enFindPrevHeader(iHandle, llPos - HEADER_SIZE + 1, &llPos);
+            if (enStatus == I106_BOF)
+                return I106_SEEK_ERROR;
+            if (enStatus != I106_OK)
+                return enStatus;
+
+            // Go to the good position
+            enI106Ch10SetPos(iHandle, llPos);
+            enReturnStatus = I106_OK;
+
+            break;
+        } // end switch on read mode
+
+    return enReturnStatus;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+EnI106Status I106_CALL_DECL 
+    enI106Ch10SetPos(int iHandle, int64_t llOffset)
+    {
+
+    // Check for a valid handle
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        {
+        return I106_INVALID_HANDLE;
+        }
+
+    // Anything in the time order window is from somewhere else now
+    if ((psuI106Handle(iHandle)->psuReorder        != NULL) &&
+        (psuI106Handle(iHandle)->psuReorder->bBusy == bFALSE))
+        vResetReorder(psuI106Handle(iHandle)->psuReorder);
+
+
+    // Check file modes
+    switch (psuI106Handle(iHandle)->enFileMode)
+        {
+        case I106_CLOSED :
+            return I106_NOT_OPEN;
+            break;
+
+        case I106_OVERWRITE       :
+        case I106_APPEND          :
+        case I106_READ_NET_STREAM : 
+        default                   :
+            return I106_WRONG_FILE_MODE;
+            break;
+
+        case I106_READ_MMAP :
+            // No seeking necessary, just remember the new position
+            if (llOffset < 0)
+                return I106_SEEK_ERROR;
+            psuI106Handle(iHandle)->llMapPos    = llOffset;
+            psuI106Handle(iHandle)->enFileState = enReadUnsynced;
+            break;
+
+        case I106_READ_IN_ORDER   :
+        case I106_READ :
+            // Can't be sure we're on a message boundary so set unsync'ed
+            psuI106Handle(iHandle)->enFileState = enReadUnsynced;
+
+            // If the new position is already in the read ahead buffer then
+            // just move the buffer pointer
+            if (psuI106Handle(iHandle)->pchReadBuff != NULL)
+                {
+                if ((llOffset >= psuI106Handle(iHandle)->llReadBuffOffset) &&
+                    (llOffset <= psuI106Handle(iHandle)->llReadBuffOffset + 
+                                 (int64_t)psuI106Handle(iHandle)->ulReadBuffLen))
+                    {
+                    psuI106Handle(iHandle)->ulReadBuffPos = 
+                        (unsigned long)(llOffset - psuI106Handle(iHandle)->llReadBuffOffset);
+                    break;
+                    }
+
+                // Otherwise toss the buffer and start over at the new position
+                psuI106Handle(iHandle)->llReadBuffOffset = llOffset;
+                psuI106Handle(iHandle)->ulReadBuffLen    = 0L;
+                psuI106Handle(iHandle)->ulReadBuffPos    = 0L;
+                psuI106Handle(iHandle)->bReadBuffSeek    = bTRUE;
+                }
+
+            // Seek
+#if defined(_WIN32)
+            {
+            __int64  llStatus;
+            llStatus = _lseeki64(psuI106Handle(iHandle)->iFile, llOffset, SEEK_SET);
+            }
+#else
+    {
+    off64_t  llStatus;
+    llStatus = lseek64(psuI106Handle(iHandle)->iFile, (off64_t)llOffset, SEEK_SET);
+    assert(llStatus >= 0);
+    }
+#endif
+            break;
+        } // end switch on file mode
+
+    return I106_OK;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+EnI106Status I106_CALL_DECL 
+    enI106Ch10GetPos(int iHandle, int64_t *pllOffset)
+    {
+
+    // Check for a valid handle
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        {
+        return I106_INVALID_HANDLE;
+        }
+
+    // Check file modes
+    switch (psuI106Handle(iHandle)->enFileMode)
+        {
+        case I106_CLOSED :
+            return I106_NOT_OPEN;
+            break;
+
+        case I106_READ_NET_STREAM : 
+        default                   :
+            return I106_WRONG_FILE_MODE;
+            break;
+
+        case I106_READ_MMAP       :
+            *pllOffset = psuI106Handle(iHandle)->llMapPos;
+            break;
+
+        case I106_READ_IN_ORDER   :
+        case I106_READ            :
+            // If read ahead buffering then the position is in the buffer
+            if (psuI106Handle(iHandle)->pchReadBuff != NULL)
+                {
+                *pllOffset = psuI106Handle(iHandle)->llReadBuffOffset + 
+                             psuI106Handle(iHandle)->ulReadBuffPos;
+                break;
+                }
+            // Fall through
+
+        case I106_OVERWRITE       :
+        case I106_APPEND          :
+            // The writer thread is busy moving the OS file position so count
+            // from where it started
+            if (psuI106Handle(iHandle)->psuWriteThread != NULL)
+                {
+                *pllOffset = psuI106Handle(iHandle)->psuWriteThread->llStartOffset +
+                             psuI106Handle(iHandle)->psuWriteThread->llHead;
+                break;
+                }
+
+    // Get position
+#if defined(_WIN32)
+            *pllOffset = _telli64(psuI106Handle(iHandle)->iFile);
+#else
+    {
+    *pllOffset = (int64_t)lseek64(psuI106Handle(iHandle)->iFile, (off64_t)0, SEEK_CUR);
+    assert(*pllOffset >= 0);
+    }
+#endif
+            // Buffered writes haven't made it to the file yet
+            *pllOffset += psuI106Handle(iHandle)->ulWriteBuffLen;
+            break;
+        } // end switch on file mode
+
+
+    return I106_OK;
+    }
+
+
+
+/* -----------------------------------------------------------------------
+ * Utilities
+ * ----------------------------------------------------------------------- */
+
+/* Set packet header to some sane values. Be sure to fill in proper values for:
+        ulPacketLen
+        ulDataLen
+        ubyHdrVer
+        aubyRefTime
+        uChecksum
+ */
+int I106_CALL_DECL 
+    iHeaderInit(SuI106Ch10Header * psuHeader,
+                unsigned int       uChanID,
+                unsigned int       uDataType,
+                unsigned int       uFlags,
+                unsigned int       uSeqNum)
+    {
+
+    // Make a legal, valid header
+    psuHeader->uSync          = IRIG106_SYNC;
+    psuHeader->uChID          = uChanID;
+    psuHeader->ulPacketLen    = HEADER_SIZE;
+    psuHeader->ulDataLen      = 0;
+    psuHeader->ubyHdrVer      = 0x02;  // <-- NEED TO PASS THIS IN!!!
+    psuHeader->ubySeqNum      = uSeqNum;
+    psuHeader->ubyPacketFlags = uFlags;
+    psuHeader->ubyDataType    = uDataType;
+    memset(&(psuHeader->aubyRefTime), 0, 6);
+//  psuHeader->uChecksum      = uCalcHeaderChecksum(psuHeader);
+    psuHeader->uChecksum      = 0;
+// This could overrun if the header doesn't have a secondary header
+//    memset(&(psuHeader->aulTime), 0, 8);
+//    psuHeader->uReserved      = 0;
+//    psuHeader->uSecChecksum   = uCalcSecHeaderChecksum(psuHeader);
+
+    return 0;
+    }
+
+/* ----------------------------------------------------------------------- */
+
+// Figure out header length (might need to check header version at
+// some point if I can ever figure out what the different header
+// version mean.
+
+int I106_CALL_DECL 
+    iGetHeaderLen(SuI106Ch10Header * psuHeader)
+    {
+    int     iHeaderLen;
+
+    if ((psuHeader->ubyPacketFlags & I106CH10_PFLAGS_SEC_HEADER) == 0)
+        iHeaderLen = HEADER_SIZE;
+    else
+        iHeaderLen = HEADER_SIZE + SEC_HEADER_SIZE;
+
+    return iHeaderLen;
+    }
+
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Figure out data length including padding and any data checksum
+
+uint32_t I106_CALL_DECL 
+    uGetDataLen(SuI106Ch10Header * psuHeader)
+    {
+    int     iDataLen;
+
+    iDataLen = psuHeader->ulPacketLen - iGetHeaderLen(psuHeader);
+
+    return iDataLen;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+uint16_t I106_CALL_DECL 
+    uCalcHeaderChecksum(SuI106Ch10Header * psuHeader)
+    {
+#if defined(I106_SSE2)
+    __m128i         vLow;
+    __m128i         vHigh;
+
+    // Add words 0 - 7 to words 8 - 10, then fold the 8 partial sums down
+    vLow  = _mm_loadu_si128((const __m128i *)psuHeader);
+    vHigh = _mm_loadl_epi64((const __m128i *)((uint8_t *)psuHeader + 16));
+    vHigh = _mm_and_si128(vHigh, _mm_set_epi16(0, 0, 0, 0, 0, -1, -1, -1));
+    vLow  = _mm_add_epi16(vLow, vHigh);
+    vLow  = _mm_add_epi16(vLow, _mm_srli_si128(vLow, 8));
+    vLow  = _mm_add_epi16(vLow, _mm_srli_si128(vLow, 4));
+    vLow  = _mm_add_epi16(vLow, _mm_srli_si128(vLow, 2));
+
+    return (uint16_t)_mm_cvtsi128_si32(vLow);
+#else
+    int             iHdrIdx;
+    uint16_t        uHdrSum;
+    uint16_t      * aHdr = (uint16_t *)psuHeader;
+
+    uHdrSum = 0;
+    for (iHdrIdx=0; iHdrIdx<(HEADER_SIZE-2)/2; iHdrIdx++)
+        uHdrSum += aHdr[iHdrIdx];
+
+    return uHdrSum;
+#endif
+    }
+
+
+/* ----------------------------------------------------------------------- */
+
+uint16_t I106_CALL_DECL 
+    uCalcSecHeaderChecksum(SuI106Ch10Header * psuHeader)
+    {
+
+    int             iByteIdx;
+    uint16_t        uHdrSum;
+// MAKE THIS 16 BIT UNSIGNEDS LIKE ABOVE
+    unsigned char * auchHdrByte = (unsigned char *)psuHeader;
+
+    uHdrSum = 0;
+    for (iByteIdx=0; iByteIdx<SEC_HEADER_SIZE-2; iByteIdx++)
+        uHdrSum += auchHdrByte[iByteIdx+HEADER_SIZE];
+
+    return uHdrSum;
+    }
+
+
+/* ----------------------------------------------------------------------- */
+
+// Calculate and return the required size of the data buffer portion of the
+// packet including checksum and appropriate filler for 4 byte alignment.
+
+uint32_t I106_CALL_DECL 
+    uCalcDataBuffReqSize(uint32_t uDataLen, int iChecksumType)
+    {
+    uint32_t    uDataBuffLen;
+
+    // Start with the length of the data
+    uDataBuffLen = uDataLen;
+
+    // Add in enough for the selected checksum
+    switch (iChecksumType)
+        {
+        case I106CH10_PFLAGS_CHKSUM_NONE :
+            break;
+        case I106CH10_PFLAGS_CHKSUM_8    :
+            uDataBuffLen += 1;
+            break;
+        case I106CH10_PFLAGS_CHKSUM_16   :
+            uDataBuffLen += 2;
+            break;
+        case I106CH10_PFLAGS_CHKSUM_32   :
+            uDataBuffLen += 4;
+            break;
+        default :
+            uDataBuffLen = 0;
+        } // end switch iChecksumType
+
+    // Now add filler for 4 byte alignment
+    uDataBuffLen += 3;
+    uDataBuffLen &= 0xfffffffc;
+
+    return uDataBuffLen;
+    }
+
+
+/* ----------------------------------------------------------------------- */
+
+// Calculate and return the appropriate checksum of the data in the buffer.
+
+/* 
+Note that this checksum method is technically incorrect. Filler needs to be included in
+the checksum process. The common and ubiquitous filler is typically 0x00 and in that case
+this routine will work fine. But a filler value of 0xFF legal (but not common). In this
+case this routine will give incorrect results.
+*/
+uint32_t I106_CALL_DECL
+    uCalcDataChecksum(int iChecksumType, const void * pvBuff, uint32_t uBuffLen, uint32_t uChecksum)
+    {
+
+    // Calculate the appropriate checksum
+    switch (iChecksumType)
+        {
+        // The 8 bit case is easy. Just sum up the bytes in the buffer.
+        case I106CH10_PFLAGS_CHKSUM_8  :
+            {
+            assert(uChecksum <= 0xff);
+            uint8_t         uSum8   = (uint8_t)uChecksum;
+            uint8_t       * puData8 = (uint8_t *)pvBuff;
+            unsigned        uBytesLeftToChecksum = uBuffLen;
+            while (uBytesLeftToChecksum > 0)
+                {
+                uSum8 += *puData8;
+                puData8++;
+                uBytesLeftToChecksum -= 1;
+                }
+            uChecksum = uSum8;
+            }
+            break;
+
+        // The 16 (and 32) bit cases are more complicated. If the size of the data buffer doens't
+        // fall on a 16 (or 32) bit boundary then we shouldn't really access data past the end of
+        // the buffer. So we directly access buffer data when full words are available. But at the
+        // end of the buffer if there isn't enough data to make a full word then a full word is
+        // constructed in local storage.
+        case I106CH10_PFLAGS_CHKSUM_16   :
+            {
+            assert(uChecksum <= 0xffff);
+            uint16_t        uSum16   = (uint16_t)uChecksum;
+            uint16_t      * puData16 = (uint16_t *)pvBuff;
+            unsigned        uBytesLeftToChecksum = uBuffLen;
+            while (uBytesLeftToChecksum > 0)
+                {
+                // If we have at least a whole 32 bit word in the data buffer to checksum
+                if (uBytesLeftToChecksum >= 2)
+                    {
+                    uSum16 += *puData16;
+                    puData16++;
+                    uBytesLeftToChecksum -= 2;
+                    }
+
+                // Else less than a whole 16 bit word left in the data buffer
+                else
+                    {
+                    uint16_t    uData16 = 0;
+                    memcpy(&uData16, puData16, uBytesLeftToChecksum);
+                    uSum16 += uData16;
+                    uBytesLeftToChecksum  = 0;;
+                    }
+                } // end uBytesLeftToChecksum > 0
+            uChecksum = uSum16;
+            }
+            break;
+
+        case I106CH10_PFLAGS_CHKSUM_32   :
+            {
+            assert(uChecksum <= 0xffffffff);
+            uint32_t        uSum32   = (uint32_t)uChecksum;
+            uint32_t      * puData32 = (uint32_t *)pvBuff;
+            unsigned        uBytesLeftToChecksum = uBuffLen;
+            while (uBytesLeftToChecksum > 0)
+                {
+                // If we have at least a whole 32 bit word in the data buffer to checksum
+                if (uBytesLeftToChecksum >= 4)
+                    {
+                    uSum32 += *puData32;
+                    puData32++;
+                    uBytesLeftToChecksum -= 4;
+                    }
+
+                // Else less than a whole 32 bit word left in the data buffer
+                else
+                    {
+                    uint32_t    uData32 = 0;
+                    memcpy(&uData32, puData32, uBytesLeftToChecksum);
+                    uSum32 += uData32;
+                    uBytesLeftToChecksum  = 0;;
+                    }
+                } // end uBytesLeftToChecksum > 0
+            uChecksum = uSum32;
+            }
+            break;
+        default :
+            break;
+        } // end switch iChecksumType
+
+    return uChecksum;
+    } // end uCalcDataChecksum()
+
+
+/* ----------------------------------------------------------------------- */
+
+// Add the filler and appropriate checksum to the end of the data buffer
+// It is assumed that the buffer is big enough to hold additional filler 
+// and the checksum. Also fill in the header with the correct packet length.
+
+EnI106Status I106_CALL_DECL 
+    uAddDataFillerChecksum(SuI106Ch10Header * psuI106Hdr, unsigned char achData[])
+    {
+    unsigned char * achTrailerBuffer;
+    int             iTrailerBufferSize;
+
+    achTrailerBuffer   = &(achData[psuI106Hdr->ulDataLen]);
+    iTrailerBufferSize = 8;
+
+    // The CSDW is already part of the data buffer.
+    uAddDataFillerChecksum2(psuI106Hdr, NULL, 0, achData, psuI106Hdr->ulDataLen, achTrailerBuffer, &iTrailerBufferSize);
+
+    return I106_OK;
+    }
+
+
+/* ----------------------------------------------------------------------- */
+
+// Create approprite filler and checksum in a seperate user supplied buffer.
+
+EnI106Status I106_CALL_DECL 
+    uAddDataFillerChecksum2(
+            SuI106Ch10Header        * psuI106Hdr, 
+            const void              * pvCSDW,
+            int                       iCSDWLen,
+            const unsigned char     * achData, 
+            unsigned long             ulBuffDataLen,
+            unsigned char           * achTrailerBuffer, 
+            int                     * piTrailerBufferSize)
+    {
+    uint32_t    uDataBuffSize;
+    int         iFillSize;
+    int         iChecksumType;
+
+    // Extract the checksum type
+    iChecksumType = psuI106Hdr->ubyPacketFlags & I106CH10_PFLAGS_CHKSUM_MASK;
+
+    // Figure out how big the final packet will be
+    uDataBuffSize = uCalcDataBuffReqSize(iCSDWLen+ulBuffDataLen, iChecksumType);
+    psuI106Hdr->ulPacketLen = HEADER_SIZE + uDataBuffSize;
+    if ((psuI106Hdr->ubyPacketFlags & I106CH10_PFLAGS_SEC_HEADER) != 0)
+        psuI106Hdr->ulPacketLen += SEC_HEADER_SIZE;
+
+    // Figure out the filler/checksum size and zero fill it
+    iFillSize = uDataBuffSize - (iCSDWLen + ulBuffDataLen);
+    assert(iFillSize < 8);
+    memset(achTrailerBuffer, 0, iFillSize);
+    if (*piTrailerBufferSize < iFillSize)
+        return I106_BUFFER_TOO_SMALL;
+
+    *piTrailerBufferSize = iFillSize;
+
+    switch (iChecksumType)
+        {
+        case I106CH10_PFLAGS_CHKSUM_8    :
+            {
+            uint8_t    *puSum8;
+            puSum8  = (uint8_t *)&achTrailerBuffer[iFillSize-1];
+            *puSum8 = 0;
+            *puSum8 = uCalcDataChecksum(iChecksumType, pvCSDW,  iCSDWLen,      *puSum8);
+            *puSum8 = uCalcDataChecksum(iChecksumType, achData, ulBuffDataLen, *puSum8);
+            }
+            break;
+
+        case I106CH10_PFLAGS_CHKSUM_16   :
+            {
+            uint16_t   *puSum16;
+            puSum16  = (uint16_t *)&achTrailerBuffer[iFillSize-2];
+            *puSum16 = 0;
+            *puSum16 = uCalcDataChecksum(iChecksumType, pvCSDW,  iCSDWLen,      *puSum16);
+            *puSum16 = uCalcDataChecksum(iChecksumType, achData, ulBuffDataLen, *puSum16);
+            }
+            break;
+
+        case I106CH10_PFLAGS_CHKSUM_32   :
+            {
+            uint32_t   *puSum32;
+            puSum32  = (uint32_t *)&achTrailerBuffer[iFillSize-4];
+            *puSum32 = 0;
+            *puSum32 = uCalcDataChecksum(iChecksumType, pvCSDW,  iCSDWLen,      *puSum32);
+            *puSum32 = uCalcDataChecksum(iChecksumType, achData, ulBuffDataLen, *puSum32);
+            }
+            break;
+
+        case I106CH10_PFLAGS_CHKSUM_NONE :
+        default :
+            break;
+        } // end switch iChecksumType
+
+
+    // Calculate the checksum
+
+
+
+
+    return I106_OK;
+    }
+
+// -----------------------------------------------------------------------
+
+char * szI106ErrorStr(EnI106Status enStatus)
+    {
+    char    * szErrorMsg;
+
+    switch (enStatus)
+        {
+        case I106_OK                : szErrorMsg = "No error";              break;
+        case I106_OPEN_ERROR        : szErrorMsg = "File open failed";      break;
+        case I106_OPEN_WARNING      : szErrorMsg = "File open warning";     break;
+        case I106_EOF               : szErrorMsg = "End of file";           break;
+        case I106_BOF               : szErrorMsg = "Beginning of file";     break;
+        case I106_READ_ERROR        : szErrorMsg = "Read error";            break;
+        case I106_WRITE_ERROR       : szErrorMsg = "Write error";           break;
+        case I106_MORE_DATA         : szErrorMsg = "More data available";   break;
+        case I106_SEEK_ERROR        : szErrorMsg = "Seek error";            break;
+        case I106_WRONG_FILE_MODE   : szErrorMsg = "Wrong file mode";       break;
+        case I106_NOT_OPEN          : szErrorMsg = "File not open";         break;
+        case I106_ALREADY_OPEN      : szErrorMsg = "File already open";     break;
+        case I106_BUFFER_TOO_SMALL  : szErrorMsg = "Buffer too small";      break;
+        case I106_NO_MORE_DATA      : szErrorMsg = "No more data";          break;
+        case I106_NO_FREE_HANDLES   : szErrorMsg = "No free file handles";  break;
+        case I106_INVALID_HANDLE    : szErrorMsg = "Invalid file handle";   break;
+        case I106_TIME_NOT_FOUND    : szErrorMsg = "Time not found";        break;
+        case I106_HEADER_CHKSUM_BAD : szErrorMsg = "Bad header checksum";   break;
+        case I106_NO_INDEX          : szErrorMsg = "No index";              break;
+        case I106_UNSUPPORTED       : szErrorMsg = "Unsupported feature";   break;
+        case I106_BUFFER_OVERRUN    : szErrorMsg = "Buffer overrun";        break;
+        case I106_INDEX_NODE        : szErrorMsg = "Index node";            break;
+        case I106_INDEX_ROOT        : szErrorMsg = "Index root";            break;
+        case I106_INDEX_ROOT_LINK   : szErrorMsg = "Index root link";       break;
+        case I106_INVALID_DATA      : szErrorMsg = "Invalid data";          break;
+        case I106_INVALID_PARAMETER : szErrorMsg = "Invalid parameter";     break;
+        case I106_NO_MEMORY         : szErrorMsg = "Out of memory";         break;
+        default                     : szErrorMsg = "Unknown error";         break;
+        } // end switch on status
+
+    return szErrorMsg;
+    }
+
+
+// -----------------------------------------------------------------------
+
+// Get a pointer to the context for a handle
+
+SuI106Ch10Handle * I106_CALL_DECL
+    psuI106Handle(int iHandle)
+    {
+    return &m_apsuHandlePage[iHandle >> I106_HANDLE_PAGE_BITS]
+                            [iHandle &  (I106_HANDLE_PAGE_SIZE - 1)];
+    }
+
+
+// -----------------------------------------------------------------------
+
+// Check that a handle refers to an open context
+
+int I106_CALL_DECL
+    bI106ValidHandle(int iHandle)
+    {
+    if ((iHandle < 0) || (iHandle >= MAX_HANDLES))
+        return bFALSE;
+
+    if (m_apsuHandlePage[iHandle >> I106_HANDLE_PAGE_BITS] == NULL)
+        return bFALSE;
+
+    return psuI106Handle(iHandle)->bInUse == bTRUE;
+    }
+
+
+// -----------------------------------------------------------------------
+
+#if defined(_WIN32)
+// Take the handle lock, initializing it on first use
+
+static void vLockHandles(void)
+    {
+    if (m_lHandleLockReady == 0)
+        {
+        if (InterlockedIncrement((LONG *)&m_lHandleLockInit) == 1)
+            {
+            InitializeCriticalSection(&m_suHandleLock);
+            InterlockedExchange((LONG *)&m_lHandleLockReady, 1);
+            }
+        else
+            {
+            while (m_lHandleLockReady == 0)
+                Sleep(0);
+            }
+        }
+
+    EnterCriticalSection(&m_suHandleLock);
+    }
+#endif
+
+
+// -----------------------------------------------------------------------
+
+// Get the next available handle.  Handles are int indexes into a table of 
+// handle pages.  Free handles are kept on a list.  If the list is empty then
+// add another page of handles to it.
+
+int GetNextHandle()
+    {
+    int                 iHandle;
+    int                 iIdx;
+    int                 iPage;
+    SuI106Ch10Handle  * psuPage;
+
+    LOCK_HANDLES();
+
+    // No free handles so allocate a new page of them
+    if ((m_iFreeHandle == -1) && (m_iHandlePages < I106_HANDLE_PAGES))
+        {
+        iPage   = m_iHandlePages;
+        psuPage = (SuI106Ch10Handle *)calloc(I106_HANDLE_PAGE_SIZE, sizeof(SuI106Ch10Handle));
+        if (psuPage != NULL)
+            {
+            for (iIdx=0; iIdx<I106_HANDLE_PAGE_SIZE; iIdx++)
+                {
+                psuPage[iIdx].bInUse      = bFALSE;
+                psuPage[iIdx].iNextFree   = iIdx < I106_HANDLE_PAGE_SIZE - 1 ?
+                                            iPage * I106_HANDLE_PAGE_SIZE + iIdx + 1 : -1;
+                psuPage[iIdx].iFile       = -1;
+                psuPage[iIdx].enFileMode  = I106_CLOSED;
+                psuPage[iIdx].enFileState = enClosed;
+                }
+            m_apsuHandlePage[iPage] = psuPage;
+            m_iHandlePages++;
+            m_iFreeHandle = iPage * I106_HANDLE_PAGE_SIZE;
+            }
+        } // end if new handle page needed
+
+    // Take the first handle off the free list
+    iHandle = m_iFreeHandle;
+    if (iHandle != -1)
+        {
+        m_iFreeHandle = psuI106Handle(iHandle)->iNextFree;
+        psuI106Handle(iHandle)->iNextFree = -1;
+        psuI106Handle(iHandle)->bInUse    = bTRUE;
+        }
+
+    UNLOCK_HANDLES();
+
+    return iHandle;
+    }
+
+
+// -----------------------------------------------------------------------
+
+// Return a handle to the pool of available handles
+
+void vReleaseHandle(int iHandle)
+    {
+    LOCK_HANDLES();
+    psuI106Handle(iHandle)->bInUse    = bFALSE;
+    psuI106Handle(iHandle)->iNextFree = m_iFreeHandle;
+    m_iFreeHandle = iHandle;
+    UNLOCK_HANDLES();
+    }
+
+
+// -----------------------------------------------------------------------
+
+// Write a packet made up of one or more pieces.  If write buffering is on 
+// the pieces are copied into the write buffer, which is written out when it
+// fills up or gets too old.  Otherwise the pieces go to the OS in a single
+// gathered write.
+
+static EnI106Status enWriteFile(int iHandle, const void * apvSeg[], const unsigned long aulSegLen[], int iNumSegs)
+    {
+    EnI106Status        enStatus;
+    SuI106Ch10Handle  * psuHandle = psuI106Handle(iHandle);
+    unsigned long       ulTotalLen;
+    int                 iSegIdx;
+
+    // Background writer takes everything
+    if (psuHandle->psuWriteThread != NULL)
+        return enWriteRing(psuHandle->psuWriteThread, apvSeg, aulSegLen, iNumSegs);
+
+    // No buffering so write it now
+    if (psuHandle->pchWriteBuff == NULL)
+        return enWriteDirect(iHandle, apvSeg, aulSegLen, iNumSegs, NULL);
+
+    ulTotalLen = 0L;
+    for (iSegIdx=0; iSegIdx<iNumSegs; iSegIdx++)
+        ulTotalLen += aulSegLen[iSegIdx];
+
+    // If it won't fit then make room
+    if (psuHandle->ulWriteBuffLen + ulTotalLen > psuHandle->ulWriteBuffSize)
+        {
+        enStatus = enFlushWriteBuff(iHandle);
+        if (enStatus != I106_OK)
+            return enStatus;
+        }
+
+    // Packets bigger than the whole buffer go straight out
+    if (ulTotalLen > psuHandle->ulWriteBuffSize)
+        return enWriteDirect(iHandle, apvSeg, aulSegLen, iNumSegs, NULL);
+
+    // Copy the packet into the buffer
+    if (psuHandle->ulWriteBuffLen == 0L)
+        psuHandle->llWriteBuffTime = llGetMilliSecs();
+    for (iSegIdx=0; iSegIdx<iNumSegs; iSegIdx++)
+        {
+        memcpy(&psuHandle->pchWriteBuff[psuHandle->ulWriteBuffLen], apvSeg[iSegIdx], aulSegLen[iSegIdx]);
+        psuHandle->ulWriteBuffLen += aulSegLen[iSegIdx];
+        }
+
+    // Write the buffer if it is full or has been sitting around too long.  The
+    // packet is safely in the buffer now so a write error here is left for the
+    // next write, flush, or close to run into again and report.
+    if ((psuHandle->ulWriteBuffLen == psuHandle->ulWriteBuffSize) ||
+        ((psuHandle->ulWriteFlushMs != 0L) &&
+         (llGetMilliSecs() - psuHandle->llWriteBuffTime >= (int64_t)psuHandle->ulWriteFlushMs)))
+        enFlushWriteBuff(iHandle);
+
+    return I106_OK;
+    }
+
+
+
+// -----------------------------------------------------------------------
+
+// Write pieces of data to the file in order, with one system call where the
+// OS supports gathered writes.  Short writes are picked up where they left
+// off.  If pulWritten isn't NULL it gets the number of bytes that actually 
+// made it to the file, which is less than the total on a write error.
+
+static EnI106Status enWriteDirect(int iHandle, const void * apvSeg[], const unsigned long aulSegLen[], int iNumSegs,
+                                  unsigned long * pulWritten)
+    {
+    int                 iSegIdx;
+    unsigned long       ulWritten = 0L;
+#if defined(_WIN32)
+    int                 iWriteCnt;
+    unsigned long       ulSegPos;
+
+    for (iSegIdx=0; iSegIdx<iNumSegs; iSegIdx++)
+        {
+        ulSegPos = 0L;
+        while (ulSegPos < aulSegLen[iSegIdx])
+            {
+            iWriteCnt = write(psuI106Handle(iHandle)->iFile, (const char *)apvSeg[iSegIdx] + ulSegPos,
+                              aulSegLen[iSegIdx] - ulSegPos);
+            if (iWriteCnt <= 0)
+                {
+                if (pulWritten != NULL)
+                    *pulWritten = ulWritten;
+                return I106_WRITE_ERROR;
+                }
+            ulSegPos  += iWriteCnt;
+            ulWritten += iWriteCnt;
+            }
+        }
+#else
+    struct iovec        asuIov[4];
+    struct iovec      * psuIov;
+    int                 iIovCnt;
+    ssize_t             lWriteCnt;
+
+    assert(iNumSegs <= 4);
+
+    iIovCnt = 0;
+    for (iSegIdx=0; iSegIdx<iNumSegs; iSegIdx++)
+        {
+        if (aulSegLen[iSegIdx] == 0L)
+            continue;
+        asuIov[iIovCnt].iov_base = (void *)apvSeg[iSegIdx];
+        asuIov[iIovCnt].iov_len  = aulSegLen[iSegIdx];
+        iIovCnt++;
+        }
+
+    // Keep going until everything is written, picking up after short writes
+    psuIov = asuIov;
+    while (iIovCnt > 0)
+        {
+        lWriteCnt = writev(psuI106Handle(iHandle)->iFile, psuIov, iIovCnt);
+        if (lWriteCnt < 0)
+            {
+            if (errno == EINTR)
+                continue;
+            if (pulWritten != NULL)
+                *pulWritten = ulWritten;
+            return I106_WRITE_ERROR;
+            }
+        ulWritten += (unsigned long)lWriteCnt;
+
+        while ((iIovCnt > 0) && ((size_t)lWriteCnt >= psuIov->iov_len))
+            {
+            lWriteCnt -= psuIov->iov_len;
+            psuIov++;
+            iIovCnt--;
+            }
+        if (iIovCnt > 0)
+            {
+            psuIov->iov_base  = (char *)psuIov->iov_base + lWriteCnt;
+            psuIov->iov_len  -= lWriteCnt;
+            }
+        } // end while data left to write
+#endif
+
+    if (pulWritten != NULL)
+        *pulWritten = ulWritten;
+
+    return I106_OK;
+    }
+
+
+
+// -----------------------------------------------------------------------
+
+// Write out whatever is in the write buffer.  On a write error whatever 
+// didn't make it to the file stays in the buffer.
+
+static EnI106Status enFlushWriteBuff(int iHandle)
+    {
+    EnI106Status        enStatus;
+    SuI106Ch10Handle  * psuHandle = psuI106Handle(iHandle);
+    const void        * apvSeg[1];
+    unsigned long       aulSegLen[1];
+    unsigned long       ulWritten;
+
+    if (psuHandle->ulWriteBuffLen == 0L)
+        return I106_OK;
+
+    apvSeg[0]    = psuHandle->pchWriteBuff;
+    aulSegLen[0] = psuHandle->ulWriteBuffLen;
+    enStatus = enWriteDirect(iHandle, apvSeg, aulSegLen, 1, &ulWritten);
+
+    if (ulWritten < psuHandle->ulWriteBuffLen)
+        memmove(psuHandle->pchWriteBuff, &psuHandle->pchWriteBuff[ulWritten],
+                psuHandle->ulWriteBuffLen - ulWritten);
+    psuHandle->ulWriteBuffLen -= ulWritten;
+
+    return enStatus;
+    }
+
+
+
+// -----------------------------------------------------------------------
+
+// Millisecond clock for timing write buffer flushes
+
+static int64_t llGetMilliSecs(void)
+    {
+#if defined(_WIN32)
+    return (int64_t)GetTickCount64();
+#else
+    struct timespec     suNow;
+
+    clock_gettime(CLOCK_MONOTONIC, &suNow);
+    return (int64_t)suNow.tv_sec * 1000 + suNow.tv_nsec / 1000000;
+#endif
+    }
+
+
+
+// -----------------------------------------------------------------------
+
+// Copy a packet into the background writer ring.  Only the producer moves the
+// head, so the head is read directly and published with a release store once
+// the data is in place.  The same goes for the statistics.  Once the writer
+// thread has had a write error nothing more is taken and the error is 
+// returned.
+
+static EnI106Status enWriteRing(SuWriteThread * psuWriter, const void * apvSeg[], const unsigned long aulSegLen[], int iNumSegs)
+    {
+    EnI106Status        enStatus;
+    int64_t             llHead;
+    unsigned long       ulTotalLen;
+    unsigned long       ulFree;
+    unsigned long       ulRingPos;
+    unsigned long       ulCopyLen;
+    unsigned long       ulSegPos;
+    unsigned long       ulUsed;
+    int                 iSegIdx;
+    int                 iWaitCount = 0;
+
+    enStatus = (EnI106Status)FLAG_LOAD(&psuWriter->enWriteStatus);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    ulTotalLen = 0L;
+    for (iSegIdx=0; iSegIdx<iNumSegs; iSegIdx++)
+        ulTotalLen += aulSegLen[iSegIdx];
+
+    llHead = psuWriter->llHead;
+    ulFree = psuWriter->ulRingSize - (unsigned long)(llHead - RING_LOAD(&psuWriter->llTail));
+
+    // If dropping then the whole packet has to fit or none of it goes
+    if ((ulTotalLen > ulFree) && (psuWriter->enPolicy == I106_WRITE_DROP))
+        {
+        RING_STORE(&psuWriter->llPacketsDropped, psuWriter->llPacketsDropped + 1);
+        RING_STORE(&psuWriter->llBytesDropped,   psuWriter->llBytesDropped + ulTotalLen);
+        return I106_BUFFER_OVERRUN;
+        }
+
+    // Copy each piece in, waiting for room if necessary
+    for (iSegIdx=0; iSegIdx<iNumSegs; iSegIdx++)
+        {
+        ulSegPos = 0L;
+        while (ulSegPos < aulSegLen[iSegIdx])
+            {
+            ulFree = psuWriter->ulRingSize - (unsigned long)(llHead - RING_LOAD(&psuWriter->llTail));
+            if (ulFree == 0L)
+                {
+                vRingWait(&iWaitCount);
+                continue;
+                }
+            iWaitCount = 0;
+
+            // Copy up to the end of the ring, the rest wraps around next time
+            ulRingPos = (unsigned long)(llHead % psuWriter->ulRingSize);
+            ulCopyLen = aulSegLen[iSegIdx] - ulSegPos;
+            if (ulCopyLen > ulFree)
+                ulCopyLen = ulFree;
+            if (ulCopyLen > psuWriter->ulRingSize - ulRingPos)
+                ulCopyLen = psuWriter->ulRingSize - ulRingPos;
+
+            memcpy(&psuWriter->pchRing[ulRingPos], (const char *)apvSeg[iSegIdx] + ulSegPos, ulCopyLen);
+            ulSegPos += ulCopyLen;
+            llHead   += ulCopyLen;
+            RING_STORE(&psuWriter->llHead, llHead);
+            } // end while more of this piece to copy
+        } // end for each piece
+
+    // Keep track of the high water mark
+    ulUsed = (unsigned long)(llHead - RING_LOAD(&psuWriter->llTail));
+    if ((int64_t)ulUsed > psuWriter->llHighWater)
+        RING_STORE(&psuWriter->llHighWater, (int64_t)ulUsed);
+
+    return I106_OK;
+    }
+
+
+
+// -----------------------------------------------------------------------
+
+// Wait for the background writer to empty the ring
+
+static EnI106Status enDrainWriteRing(SuWriteThread * psuWriter)
+    {
+    int                 iWaitCount = 0;
+
+    while (RING_LOAD(&psuWriter->llTail) != psuWriter->llHead)
+        vRingWait(&iWaitCount);
+
+    return (EnI106Status)FLAG_LOAD(&psuWriter->enWriteStatus);
+    }
+
+
+
+// -----------------------------------------------------------------------
+
+// Background writer thread.  Write whatever is in the ring, as much as is 
+// contiguous at a time, until told to stop and the ring is empty.  After a 
+// write error the data is thrown away so a blocked producer doesn't hang.
+
+static void vWriteThread(SuWriteThread * psuWriter)
+    {
+    EnI106Status        enStatus;
+    int64_t             bStop;
+    int64_t             llHead;
+    int64_t             llTail;
+    unsigned long       ulRingPos;
+    unsigned long       aulSegLen[1];
+    const void        * apvSeg[1];
+    int                 iWaitCount = 0;
+
+    llTail = psuWriter->llTail;
+    while (1)
+        {
+        // Check for stop before looking at the head so nothing gets left behind
+        bStop  = RING_LOAD(&psuWriter->bStop);
+        llHead = RING_LOAD(&psuWriter->llHead);
+
+        if (llHead == llTail)
+            {
+            if (bStop)
+                break;
+            vRingWait(&iWaitCount);
+            continue;
+            }
+        iWaitCount = 0;
+
+        ulRingPos    = (unsigned long)(llTail % psuWriter->ulRingSize);
+        aulSegLen[0] = (unsigned long)(llHead - llTail);
+        if (aulSegLen[0] > psuWriter->ulRingSize - ulRingPos)
+            aulSegLen[0] = psuWriter->ulRingSize - ulRingPos;
+        apvSeg[0] = &psuWriter->pchRing[ulRingPos];
+
+        if (psuWriter->enWriteStatus == I106_OK)
+            {
+            enStatus = enWriteDirect(psuWriter->iHandle, apvSeg, aulSegLen, 1, NULL);
+            if (enStatus != I106_OK)
+                FLAG_STORE(&psuWriter->enWriteStatus, enStatus);
+            }
+
+        llTail += aulSegLen[0];
+        RING_STORE(&psuWriter->llTail, llTail);
+        } // end while writing
+
+    return;
+    }
+
+
+
+#if defined(_WIN32)
+static unsigned __stdcall uWriteThread(void * pvWriter)
+    {
+    vWriteThread((SuWriteThread *)pvWriter);
+    return 0;
+    }
+#else
+static void * pvWriteThread(void * pvWriter)
+    {
+    vWriteThread((SuWriteThread *)pvWriter);
+    return NULL;
+    }
+#endif
+
+
+
+// -----------------------------------------------------------------------
+
+// Wait a bit for the other side of the write ring.  Yield for a while so
+// short waits stay short, then back off to sleeping so long waits don't eat
+// a CPU.
+
+static void vRingWait(int * piWaitCount)
+    {
+#if defined(_WIN32)
+    if (*piWaitCount < WRITE_THREAD_SPIN_COUNT)
+        SwitchToThread();
+    else
+        Sleep(WRITE_THREAD_POLL_MS);
+#else
+    struct timespec     suSleep;
+
+    if (*piWaitCount < WRITE_THREAD_SPIN_COUNT)
+        sched_yield();
+    else
+        {
+        suSleep.tv_sec  = 0;
+        suSleep.tv_nsec = WRITE_THREAD_POLL_MS * 1000000L;
+        nanosleep(&suSleep, NULL);
+        }
+#endif
+    (*piWaitCount)++;
+    }
+
+
+
+// -----------------------------------------------------------------------
+
+// Read from the current file position.  Memory mapped files are copied out of
+// the mapping, buffered files are copied out of the read ahead buffer, and 
+// everything else goes to the OS.  Returns the number of bytes read or -1 on 
+// error, just like read().
+
+static int iReadFile(int iHandle, void * pvBuff, unsigned long ulReadAmount)
+    {
+    SuI106Ch10Handle  * psuHandle = psuI106Handle(iHandle);
+    int64_t             llAvailable;
+    unsigned long       ulCopyAmount;
+    unsigned long       ulFillAmount;
+    unsigned long       ulTotalRead;
+    int                 iReadCnt;
+
+    // Memory mapped read
+    if (psuHandle->pchMapBase != NULL)
+        {
+        llAvailable = psuHandle->llMapSize - psuHandle->llMapPos;
+        if (llAvailable <= 0)
+            return 0;
+        if ((int64_t)ulReadAmount > llAvailable)
+            ulReadAmount = (unsigned long)llAvailable;
+
+        memcpy(pvBuff, psuHandle->pchMapBase + psuHandle->llMapPos, ulReadAmount);
+        psuHandle->llMapPos += ulReadAmount;
+
+        return (int)ulReadAmount;
+        }
+
+    // Normal file read if not buffering
+    if (psuHandle->ulReadBuffSize == 0)
+        return read(psuHandle->iFile, pvBuff, ulReadAmount);
+
+    // Make the read ahead buffer the first time through. The OS file position
+    // is always at the end of the valid data in the buffer.
+    if (psuHandle->pchReadBuff == NULL)
+        {
+        enI106Ch10GetPos(iHandle, &psuHandle->llReadBuffOffset);
+        psuHandle->pchReadBuff = (unsigned char *)malloc(psuHandle->ulReadBuffSize);
+        if (psuHandle->pchReadBuff == NULL)
+            {
+            psuHandle->ulReadBuffSize = 0;
+            return read(psuHandle->iFile, pvBuff, ulReadAmount);
+            }
+        psuHandle->ulReadBuffLen = 0L;
+        psuHandle->ulReadBuffPos = 0L;
+        psuHandle->bReadBuffSeek = bTRUE;
+        }
+
+    ulTotalRead = 0L;
+    while (ulTotalRead < ulReadAmount)
+        {
+        // Copy out whatever is in the buffer
+        ulCopyAmount = psuHandle->ulReadBuffLen - psuHandle->ulReadBuffPos;
+        if (ulCopyAmount > 0)
+            {
+            if (ulCopyAmount > ulReadAmount - ulTotalRead)
+                ulCopyAmount = ulReadAmount - ulTotalRead;
+            memcpy((unsigned char *)pvBuff + ulTotalRead, 
+                   psuHandle->pchReadBuff + psuHandle->ulReadBuffPos, ulCopyAmount);
+            psuHandle->ulReadBuffPos += ulCopyAmount;
+            ulTotalRead              += ulCopyAmount;
+            continue;
+            }
+
+        // Buffer is empty so start a new one at the current position
+        psuHandle->llReadBuffOffset += psuHandle->ulReadBuffLen;
+        psuHandle->ulReadBuffLen     = 0L;
+        psuHandle->ulReadBuffPos     = 0L;
+
+        // Big reads go straight into the user buffer
+        if (ulReadAmount - ulTotalRead >= psuHandle->ulReadBuffSize)
+            {
+            iReadCnt = read(psuHandle->iFile, (unsigned char *)pvBuff + ulTotalRead, 
+                            ulReadAmount - ulTotalRead);
+            if (iReadCnt > 0)
+                {
+                psuHandle->llReadBuffOffset += iReadCnt;
+                ulTotalRead                 += iReadCnt;
+                }
+            break;
+            }
+
+        // Right after a seek we may be hopping around so don't read the whole
+        // buffer full yet. Sequential reads get the full buffer.
+        ulFillAmount = psuHandle->ulReadBuffSize;
+        if ((psuHandle->bReadBuffSeek == bTRUE) && (ulFillAmount > READ_AHEAD_SEEK_SIZE))
+            ulFillAmount = READ_AHEAD_SEEK_SIZE;
+        if (ulFillAmount < ulReadAmount - ulTotalRead)
+            ulFillAmount = ulReadAmount - ulTotalRead;
+        psuHandle->bReadBuffSeek = bFALSE;
+
+        iReadCnt = read(psuHandle->iFile, psuHandle->pchReadBuff, ulFillAmount);
+        if (iReadCnt <= 0)
+            {
+            if ((iReadCnt < 0) && (ulTotalRead == 0))
+                return -1;
+            break;
+            }
+        psuHandle->ulReadBuffLen = (unsigned long)iReadCnt;
+        } // end while reading
+
+    return (int)ulTotalRead;
+    }
+
+
+// Scan forward from a file offset for the next thing that looks like a good
+// header, a sync pattern followed by a good header checksum.  Leave the file
+// positioned there.  If nothing is found leave the file positioned near the 
+// end so that the next header read returns EOF.
+
+static EnI106Status enResyncFile(int iHandle, int64_t llStartOffset)
+    {
+    SuI106Ch10Handle  * psuHandle = psuI106Handle(iHandle);
+    uint8_t             abyScanBuff[SYNC_SCAN_SIZE];
+    const uint8_t     * pbyScan;
+    int64_t             llScanOffset;
+    int                 iScanLen;
+    int                 iSyncIdx;
+    EnI106Status        enStatus;
+
+    llScanOffset = llStartOffset;
+    while (bTRUE)
+        {
+        // Memory mapped files get scanned in place, everything else gets read
+        if (psuHandle->pchMapBase != NULL)
+            {
+            iScanLen = SYNC_SCAN_SIZE;
+            if (llScanOffset >= psuHandle->llMapSize)
+                iScanLen = 0;
+            else if (psuHandle->llMapSize - llScanOffset < SYNC_SCAN_SIZE)
+                iScanLen = (int)(psuHandle->llMapSize - llScanOffset);
+            pbyScan = psuHandle->pchMapBase + llScanOffset;
+            }
+        else
+            {
+            enStatus = enI106Ch10SetPos(iHandle, llScanOffset);
+            if (enStatus != I106_OK)
+                return I106_SEEK_ERROR;
+            iScanLen = iReadFile(iHandle, abyScanBuff, SYNC_SCAN_SIZE);
+            if (iScanLen < 0)
+                return I106_READ_ERROR;
+            pbyScan = abyScanBuff;
+            }
+
+        // Look for a good header
+        iSyncIdx = iFindSync(pbyScan, iScanLen);
+        if (iSyncIdx >= 0)
+            {
+            llScanOffset += iSyncIdx;
+            break;
+            }
+
+        // Not found so move on, backing up enough to catch a header that
+        // straddles the end of this block
+        if (iScanLen > HEADER_SIZE - 1)
+            llScanOffset += iScanLen - (HEADER_SIZE - 1);
+
+        // At the end of the file
+        if (iScanLen < SYNC_SCAN_SIZE)
+            break;
+        } // end while scanning blocks
+
+    return enI106Ch10SetPos(iHandle, llScanOffset);
+    }
+
+
+
+// -----------------------------------------------------------------------
+
+// Find the first sync pattern in a buffer that is followed by a full header
+// with a good checksum.  Returns the buffer index or -1 if not found.
+
+static int iFindSync(const uint8_t * pbyBuff, int iBuffLen)
+    {
+    int                 iBuffIdx;
+    int                 iLastIdx;
+#if defined(I106_SSE2)
+    __m128i             vSyncLow  = _mm_set1_epi8((char)(IRIG106_SYNC & 0xff));
+    __m128i             vSyncHigh = _mm_set1_epi8((char)(IRIG106_SYNC >> 8));
+    __m128i             vMatch;
+    unsigned int        uMask;
+    int                 iBitIdx;
+#endif
+
+    // Last place a full header could start
+    iLastIdx = iBuffLen - HEADER_SIZE;
+    iBuffIdx = 0;
+
+#if defined(I106_SSE2)
+    // Compare 16 possible sync positions at a time.  Each match gets checked 
+    // for a good header checksum.
+    while (iBuffIdx + 16 <= iLastIdx)
+        {
+        vMatch = _mm_and_si128(
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(pbyBuff + iBuffIdx)),     vSyncLow),
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(pbyBuff + iBuffIdx + 1)), vSyncHigh));
+        uMask = (unsigned int)_mm_movemask_epi8(vMatch);
+        while (uMask != 0)
+            {
+            iBitIdx = 0;
+            while ((uMask & (1u << iBitIdx)) == 0)
+                iBitIdx++;
+            if (bGoodHeader(pbyBuff + iBuffIdx + iBitIdx))
+                return iBuffIdx + iBitIdx;
+            uMask &= ~(1u << iBitIdx);
+            }
+        iBuffIdx += 16;
+        }
+#endif
+
+    // Check whatever is left one byte at a time
+    for ( ; iBuffIdx <= iLastIdx; iBuffIdx++)
+        {
+        if ((pbyBuff[iBuffIdx]   == (IRIG106_SYNC & 0xff)) &&
+            (pbyBuff[iBuffIdx+1] == (IRIG106_SYNC >> 8))   &&
+            bGoodHeader(pbyBuff + iBuffIdx))
+            return iBuffIdx;
+        }
+
+    return -1;
+    }
+
+
+
+// -----------------------------------------------------------------------
+
+// Scan backwards from a file offset for the closest thing before it that 
+// looks like a good header.  The file is read in aligned blocks and the most
+// recent block is kept around so stepping backwards through a file doesn't
+// need to go back to the disk every time.  Returns I106_BOF if nothing found.
+
+static EnI106Status enFindPrevHeader(int iHandle, int64_t llBeforeOffset, int64_t * pllHeaderOffset)
+    {
+    SuI106Ch10Handle  * psuHandle = psuI106Handle(iHandle);
+    const uint8_t     * pbyBlock;
+    int64_t             llBlockOffset;
+    int                 iBlockLen;
+    int                 iCandidates;
+    int                 iSyncIdx;
+    EnI106Status        enStatus;
+
+    while (llBeforeOffset > 0)
+        {
+        // Block holding the first candidate position before the offset
+        llBlockOffset = ((llBeforeOffset - 1) / REV_SCAN_SIZE) * REV_SCAN_SIZE;
+        iCandidates   = (int)(llBeforeOffset - llBlockOffset);
+
+        // Memory mapped files get scanned in place
+        if (psuHandle->pchMapBase != NULL)
+            {
+            iBlockLen = REV_BUFF_SIZE;
+            if (psuHandle->llMapSize - llBlockOffset < REV_BUFF_SIZE)
+                iBlockLen = (int)(psuHandle->llMapSize - llBlockOffset);
+            pbyBlock = psuHandle->pchMapBase + llBlockOffset;
+            }
+
+        // Everything else reads the block unless it is already cached
+        else
+            {
+            if ((psuHandle->pchRevBuff      == NULL)          ||
+                (psuHandle->llRevBuffOffset != llBlockOffset) ||
+                ((psuHandle->iRevBuffLen    != REV_BUFF_SIZE) &&
+                 (psuHandle->iRevBuffLen    <  iCandidates + HEADER_SIZE - 1)))
+                {
+                if (psuHandle->pchRevBuff == NULL)
+                    {
+                    psuHandle->pchRevBuff = (unsigned char *)malloc(REV_BUFF_SIZE);
+                    if (psuHandle->pchRevBuff == NULL)
+                        return I106_READ_ERROR;
+                    }
+
+                psuHandle->llRevBuffOffset = -1L;
+                enStatus = enI106Ch10SetPos(iHandle, llBlockOffset);
+                if (enStatus != I106_OK)
+                    return I106_SEEK_ERROR;
+                psuHandle->iRevBuffLen = iReadFile(iHandle, psuHandle->pchRevBuff, REV_BUFF_SIZE);
+                if (psuHandle->iRevBuffLen < 0)
+                    {
+                    psuHandle->iRevBuffLen = 0;
+                    return I106_READ_ERROR;
+                    }
+                psuHandle->llRevBuffOffset = llBlockOffset;
+                }
+            pbyBlock  = psuHandle->pchRevBuff;
+            iBlockLen = psuHandle->iRevBuffLen;
+            }
+
+        // Only check places where there is a whole header to check
+        if (iCandidates > iBlockLen - HEADER_SIZE + 1)
+            iCandidates = iBlockLen - HEADER_SIZE + 1;
+
+        if (iCandidates > 0)
+            {
+            iSyncIdx = iFindSyncReverse(pbyBlock, iCandidates);
+            if (iSyncIdx >= 0)
+                {
+                *pllHeaderOffset = llBlockOffset + iSyncIdx;
+                return I106_OK;
+                }
+            }
+
+        // Nothing here so try the previous block
+        llBeforeOffset = llBlockOffset;
+        } // end while not at the beginning of the file
+
+    return I106_BOF;
+    }
+
+
+
+// -----------------------------------------------------------------------
+
+// Find the last sync pattern in a buffer that is followed by a full header
+// with a good checksum.  Only the first iCandidates positions are checked
+// and the buffer must hold a full header past each of them.  Returns the 
+// buffer index or -1 if not found.
+
+static int iFindSyncReverse(const uint8_t * pbyBuff, int iCandidates)
+    {
+    int                 iBuffIdx;
+#if defined(I106_SSE2)
+    __m128i             vSyncLow  = _mm_set1_epi8((char)(IRIG106_SYNC & 0xff));
+    __m128i             vSyncHigh = _mm_set1_epi8((char)(IRIG106_SYNC >> 8));
+    __m128i             vMatch;
+    unsigned int        uMask;
+    int                 iBitIdx;
+#endif
+
+    iBuffIdx = iCandidates;
+
+#if defined(I106_SSE2)
+    // Compare 16 possible sync positions at a time, working from the end
+    while (iBuffIdx >= 16)
+        {
+        iBuffIdx -= 16;
+        vMatch = _mm_and_si128(
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(pbyBuff + iBuffIdx)),     vSyncLow),
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(pbyBuff + iBuffIdx + 1)), vSyncHigh));
+        uMask = (unsigned int)_mm_movemask_epi8(vMatch);
+        while (uMask != 0)
+            {
+            iBitIdx = 15;
+            while ((uMask & (1u << iBitIdx)) == 0)
+                iBitIdx--;
+            if (bGoodHeader(pbyBuff + iBuffIdx + iBitIdx))
+                return iBuffIdx + iBitIdx;
+            uMask &= ~(1u << iBitIdx);
+            }
+        }
+#endif
+
+    // Check whatever is left one byte at a time
+    for (iBuffIdx--; iBuffIdx >= 0; iBuffIdx--)
+        {
+        if ((pbyBuff[iBuffIdx]   == (IRIG106_SYNC & 0xff)) &&
+            (pbyBuff[iBuffIdx+1] == (IRIG106_SYNC >> 8))   &&
+            bGoodHeader(pbyBuff + iBuffIdx))
+            return iBuffIdx;
+        }
+
+    return -1;
+    }
+
+
+
+// -----------------------------------------------------------------------
+
+// Get the read filter for a handle, making an empty one if necessary.  Returns
+// NULL and sets the status on error.
+
+static SuI106Ch10Filter * psuGetFilter(int iHandle, EnI106Status * penStatus)
+    {
+
+    // Check for a valid handle
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        {
+        *penStatus = I106_INVALID_HANDLE;
+        return NULL;
+        }
+
+    // Filters only make sense for reading
+    switch (psuI106Handle(iHandle)->enFileMode)
+        {
+        case I106_READ             :
+        case I106_READ_IN_ORDER    :
+        case I106_READ_MMAP        :
+        case I106_READ_NET_STREAM  :
+        case I106_READ_PCAP_STREAM :
+            break;
+
+        default :
+            *penStatus = I106_WRONG_FILE_MODE;
+            return NULL;
+        } // end switch on file mode
+
+    // Make an empty filter that passes everything
+    if (psuI106Handle(iHandle)->psuFilter == NULL)
+        {
+        psuI106Handle(iHandle)->psuFilter = (SuI106Ch10Filter *)calloc(1, sizeof(SuI106Ch10Filter));
+        if (psuI106Handle(iHandle)->psuFilter == NULL)
+            {
+            *penStatus = I106_NO_MEMORY;
+            return NULL;
+            }
+        }
+
+    *penStatus = I106_OK;
+    return psuI106Handle(iHandle)->psuFilter;
+    }
+
+
+
+// -----------------------------------------------------------------------
+
+// Check a header against a read filter
+
+static int bFilterPass(SuI106Ch10Filter * psuFilter, SuI106Ch10Header * psuHeader)
+    {
+    int64_t     llRelTime;
+
+    if ((psuFilter->bChanFilter == bTRUE) &&
+        ((psuFilter->abyChanMask[psuHeader->uChID >> 3] & (1 << (psuHeader->uChID & 0x07))) == 0))
+        return bFALSE;
+
+    if ((psuFilter->bTypeFilter == bTRUE) &&
+        ((psuFilter->abyTypeMask[psuHeader->ubyDataType >> 3] & (1 << (psuHeader->ubyDataType & 0x07))) == 0))
+        return bFALSE;
+
+    if ((psuHeader->ubyPacketFlags & psuFilter->ubyFlagsMask) != psuFilter->ubyFlagsValue)
+        return bFALSE;
+
+    if (psuFilter->bTimeFilter == bTRUE)
+        {
+        vTimeArray2LLInt(psuHeader->aubyRefTime, &llRelTime);
+        if (llRelTime < psuFilter->llStartTime)
+            return bFALSE;
+        if ((psuFilter->llStopTime != 0) && (llRelTime >= psuFilter->llStopTime))
+            return bFALSE;
+        }
+
+    return bTRUE;
+    }
+
+
+
+// -----------------------------------------------------------------------
+
+// Find the first good header at or after a file offset, the same way a
+// sequential read would resync.  The beginning of the file is always a packet
+// boundary.  If there are no more headers return an offset past the end.
+
+static EnI106Status enFindFirstHeader(int iHandle, int64_t llOffset, int64_t * pllHeaderOffset)
+    {
+    SuI106Ch10Header    suHeader;
+    EnI106Status        enStatus;
+
+    if (llOffset <= 0)
+        {
+        *pllHeaderOffset = 0;
+        return I106_OK;
+        }
+
+    enStatus = enI106Ch10SetPos(iHandle, llOffset);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    do  {
+        enStatus = enI106Ch10ReadNextHeaderFile(iHandle, &suHeader);
+        } while (enStatus == I106_HEADER_CHKSUM_BAD);
+
+    if (enStatus == I106_EOF)
+        {
+        *pllHeaderOffset = INT64_MAX;
+        return I106_OK;
+        }
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    enI106Ch10GetPos(iHandle, pllHeaderOffset);
+    *pllHeaderOffset -= iGetHeaderLen(&suHeader);
+
+    return I106_OK;
+    }
+
+
+
+// -----------------------------------------------------------------------
+
+// Follow the packet chain from a header the same way a sequential read 
+// does, up to the first packet at or after a boundary.  If the file ends 
+// first return an offset past the end.
+
+static EnI106Status enFollowChain(int iHandle, int64_t llOffset, int64_t llBoundary, int64_t * pllStopOffset)
+    {
+    SuI106Ch10Header    suHeader;
+    EnI106Status        enStatus;
+
+    *pllStopOffset = llOffset;
+    if (llOffset >= llBoundary)
+        return I106_OK;
+
+    enStatus = enI106Ch10SetPos(iHandle, llOffset);
+    while (enStatus == I106_OK)
+        {
+        enStatus = enI106Ch10ReadNextHeaderFile(iHandle, &suHeader);
+        if (enStatus == I106_HEADER_CHKSUM_BAD)
+            {
+            enStatus = I106_OK;
+            continue;
+            }
+        if (enStatus == I106_EOF)
+            {
+            *pllStopOffset = INT64_MAX;
+            return I106_OK;
+            }
+        if (enStatus != I106_OK)
+            break;
+
+        enI106Ch10GetPos(iHandle, pllStopOffset);
+        *pllStopOffset -= iGetHeaderLen(&suHeader);
+        if (*pllStopOffset >= llBoundary)
+            break;
+        }
+
+    return enStatus;
+    }
+
+
+
+// -----------------------------------------------------------------------
+
+// Do one thread's part of a parallel file scan.  Either find where the 
+// packet chain from the first header in the range leaves the range, or read 
+// and hand off the packets from the start offset up to the stop offset.
+
+static void vScanWorker(SuScanWorker * psuWorker)
+    {
+    SuI106Ch10Header    suHeader;
+    int64_t             llPacketOffset;
+    unsigned long       ulBuffSize = 0L;
+    void              * pvBuff     = NULL;
+    EnI106Status        enStatus;
+
+    if (psuWorker->bFindStop)
+        {
+        enStatus = enFindFirstHeader(psuWorker->iHandle, psuWorker->llRangeStart, &psuWorker->llStartOffset);
+        if (enStatus == I106_OK)
+            enStatus = enFollowChain(psuWorker->iHandle, psuWorker->llStartOffset, 
+                                     psuWorker->llRangeEnd, &psuWorker->llStopOffset);
+        psuWorker->enStatus = enStatus;
+        if (enStatus != I106_OK)
+            FLAG_STORE(psuWorker->pbAbort, bTRUE);
+        return;
+        }
+
+    enStatus = I106_OK;
+    if (psuWorker->llStartOffset < psuWorker->llStopOffset)
+        enStatus = enI106Ch10SetPos(psuWorker->iHandle, psuWorker->llStartOffset);
+
+    // Read and hand off packets until the next range is reached
+    while ((enStatus == I106_OK) && (psuWorker->llStartOffset < psuWorker->llStopOffset) && 
+           !FLAG_LOAD(psuWorker->pbAbort))
+        {
+        enStatus = enI106Ch10ReadNextHeaderFile(psuWorker->iHandle, &suHeader);
+        if (enStatus == I106_HEADER_CHKSUM_BAD)
+            {
+            enStatus = I106_OK;
+            continue;
+            }
+        if (enStatus == I106_EOF)
+            {
+            enStatus = I106_OK;
+            break;
+            }
+        if (enStatus != I106_OK)
+            break;
+
+        enI106Ch10GetPos(psuWorker->iHandle, &llPacketOffset);
+        llPacketOffset -= iGetHeaderLen(&suHeader);
+        if (llPacketOffset >= psuWorker->llStopOffset)
+            break;
+
+        // Header only scans leave the data to be skipped by the next read
+        if (!psuWorker->bReadData)
+            {
+            enStatus = psuWorker->pfnHandler(psuWorker->iThread, llPacketOffset, &suHeader, NULL, psuWorker->pvUserData);
+            continue;
+            }
+
+        // Make sure the buffer is big enough and read the data
+        if (ulBuffSize < suHeader.ulPacketLen)
+            {
+            void * pvNewBuff = realloc(pvBuff, suHeader.ulPacketLen);
+            if (pvNewBuff == NULL)
+                {
+                enStatus = I106_NO_MEMORY;
+                break;
+                }
+            pvBuff     = pvNewBuff;
+            ulBuffSize = suHeader.ulPacketLen;
+            }
+        enStatus = enI106Ch10ReadData(psuWorker->iHandle, ulBuffSize, pvBuff);
+        if (enStatus == I106_EOF)
+            {
+            enStatus = I106_OK;
+            break;
+            }
+        if (enStatus != I106_OK)
+            break;
+
+        enStatus = psuWorker->pfnHandler(psuWorker->iThread, llPacketOffset, &suHeader, pvBuff, psuWorker->pvUserData);
+        } // end while reading packets
+
+    free(pvBuff);
+
+    psuWorker->enStatus = enStatus;
+    if (enStatus != I106_OK)
+        FLAG_STORE(psuWorker->pbAbort, bTRUE);
+
+    return;
+    }
+
+
+
+#if defined(_WIN32)
+static unsigned __stdcall uScanWorkerThread(void * pvWorker)
+    {
+    vScanWorker((SuScanWorker *)pvWorker);
+    return 0;
+    }
+#else
+static void * pvScanWorkerThread(void * pvWorker)
+    {
+    vScanWorker((SuScanWorker *)pvWorker);
+    return NULL;
+    }
+#endif
+
+
+
+// -----------------------------------------------------------------------
+
+// Check the header checksum of a possible header in a buffer
+
+static int bGoodHeader(const uint8_t * pbyBuff)
+    {
+    return uCalcHeaderChecksum((SuI106Ch10Header *)pbyBuff) == 
+           ((SuI106Ch10Header *)pbyBuff)->uChecksum;
+    }
+
+
+
+// TODO : Move this functionality to i106_index.*
+
+// -----------------------------------------------------------------------
+// Generate an index from the data file
+// -----------------------------------------------------------------------
+
+/*  
+Some 106-04 recorders recorded data *way* out of time order.  But most others 
+don't.  And starting with 106-05 the most out of order is 1 second.  Normally
+I106_READ_IN_ORDER reads through a time order window (see below) that handles
+this on the fly.  An index of the whole file is only needed for recordings 
+that are further out of order than the window can handle.
+*/
+
+// Read the index from a previously generated index file.  The index file
+// is mapped rather than read so even a very large index loads right away.
+// It is only used if it matches the data file as it is now.
+
+int I106_CALL_DECL 
+    bReadInOrderIndex(int iHandle, char * szIdxFileName)
+    {
+    int                     iIdxFile;
+    int                     iFlags;
+    int                     bReadOK = bFALSE;
+    int64_t                 llIdxSize;
+    int64_t                 llSourceSize;
+    int64_t                 llSourceTime;
+    uint64_t                ullSourceHash;
+    uint32_t                ulEntry;
+    unsigned char         * pchIdx = NULL;
+    SuInOrderIndexFileHdr * psuFileHdr;
+    SuInOrderChanInfo     * asuChanInfo;
+    SuInOrderPacketInfo   * asuIndex;
+    SuInOrderIndex        * psuIndex = &psuI106Handle(iHandle)->suInOrderIndex;
+#if defined(_WIN32)
+    struct _stati64         suStatBuff;
+#else
+    struct stat             suStatBuff;
+#endif
+
+    // Try opening the index file
+#if defined(_WIN32)
+    iFlags = O_RDONLY | O_BINARY;
+#else
+    iFlags = O_RDONLY;
+#endif
+    iIdxFile = open(szIdxFileName, iFlags, 0);
+    if (iIdxFile == -1)
+        return bFALSE;
+
+    // Setup a one time loop to make it easy to break out on errors
+    do
+        {
+#if defined(_WIN32)
+        if (_fstati64(iIdxFile, &suStatBuff) != 0)
+            break;
+#else
+        if (fstat(iIdxFile, &suStatBuff) != 0)
+            break;
+#endif
+        llIdxSize = suStatBuff.st_size;
+        if ((llIdxSize < (int64_t)sizeof(SuInOrderIndexFileHdr)) ||
+            ((uint64_t)llIdxSize > (uint64_t)(size_t)-1))
+            break;
+
+        // Get the index file into memory
+#if defined(_WIN32)
+        pchIdx = (unsigned char *)malloc((size_t)llIdxSize);
+        if (pchIdx == NULL)
+            break;
+        if (read(iIdxFile, pchIdx, (unsigned int)llIdxSize) != llIdxSize)
+            {
+            free(pchIdx);
+            pchIdx = NULL;
+            break;
+            }
+#else
+        pchIdx = (unsigned char *)mmap(NULL, (size_t)llIdxSize, PROT_READ, MAP_SHARED, iIdxFile, 0);
+        if ((void *)pchIdx == MAP_FAILED)
+            {
+            pchIdx = NULL;
+            break;
+            }
+#endif
+
+        // Sanity check the header and layout
+        psuFileHdr = (SuInOrderIndexFileHdr *)pchIdx;
+        if ((memcmp(psuFileHdr->achMagic, INDEX_FILE_MAGIC, sizeof(INDEX_FILE_MAGIC)) != 0) ||
+            (psuFileHdr->ulVersion    != INDEX_FILE_VERSION)                                ||
+            (psuFileHdr->ulHeaderSize != sizeof(SuInOrderIndexFileHdr))                     ||
+            (psuFileHdr->ulNumChans   >  0x10000)                                           ||
+            (psuFileHdr->ulNumEntries >  0x7fffffffUL)                                      ||
+            (llIdxSize != (int64_t)sizeof(SuInOrderIndexFileHdr) + 
+                          (int64_t)psuFileHdr->ulNumChans   * sizeof(SuInOrderChanInfo) +
+                          (int64_t)psuFileHdr->ulNumEntries * sizeof(SuInOrderPacketInfo)))
+            break;
+
+        // Make sure it goes with the data file as it is now
+        if (bI106Ch10GetFileId(psuI106Handle(iHandle)->szFileName, &llSourceSize, &llSourceTime, &ullSourceHash) == bFALSE)
+            break;
+        if ((psuFileHdr->llSourceSize  != llSourceSize) ||
+            (psuFileHdr->llSourceTime  != llSourceTime) ||
+            (psuFileHdr->ullSourceHash != ullSourceHash))
+            break;
+
+        // Every entry has to leave room for a header in the data file, and 
+        // after the TMATS and time packets at the start the entries have to
+        // be in time order.  The seek routines count on both.
+        asuChanInfo = (SuInOrderChanInfo *)(pchIdx + sizeof(SuInOrderIndexFileHdr));
+        asuIndex    = (SuInOrderPacketInfo *)(asuChanInfo + psuFileHdr->ulNumChans);
+        for (ulEntry=0; ulEntry<psuFileHdr->ulNumEntries; ulEntry++)
+            {
+            if ((asuIndex[ulEntry].llOffset < 0) ||
+                (asuIndex[ulEntry].llOffset > llSourceSize - HEADER_SIZE))
+                break;
+            if ((ulEntry > 2) && (asuIndex[ulEntry].llTime < asuIndex[ulEntry-1].llTime))
+                break;
+            }
+        if (ulEntry < psuFileHdr->ulNumEntries)
+            break;
+
+        // Looks good so use it
+        vFreeInOrderIndex(psuIndex);
+        psuIndex->pvIndexMap      = pchIdx;
+        psuIndex->llIndexMapSize  = llIdxSize;
+        psuIndex->asuChanInfo     = asuChanInfo;
+        psuIndex->iNumChans       = (int)psuFileHdr->ulNumChans;
+        psuIndex->asuIndex        = asuIndex;
+        psuIndex->iArraySize      = 0;
+        psuIndex->iArrayUsed      = (int)psuFileHdr->ulNumEntries;
+        psuIndex->iArrayCurr      = 0;
+        psuIndex->enSortStatus    = enSorted;
+        bReadOK = bTRUE;
+        } while (bFALSE); // end one time loop to read
+
+    if ((bReadOK == bFALSE) && (pchIdx != NULL))
+        {
+#if defined(_WIN32)
+        free(pchIdx);
+#else
+        munmap(pchIdx, (size_t)llIdxSize);
+#endif
+        }
+
+    close(iIdxFile);
+
+    return bReadOK;
+    }
+
+
+
+// -----------------------------------------------------------------------
+
+// Write out an index file for use next time.  It is written to a temporary
+// file first and then renamed so a half written index is never seen.
+
+int I106_CALL_DECL 
+    bWriteInOrderIndex(int iHandle, char * szIdxFileName)
+    {
+    int                     iFlags;
+    int                     iFileMode;
+    int                     iIdxFile;
+    int                     bWriteOK;
+    char                  * szTempFileName;
+    SuInOrderIndexFileHdr   suFileHdr;
+    SuInOrderIndex        * psuIndex = &psuI106Handle(iHandle)->suInOrderIndex;
+
+    if (psuIndex->enSortStatus != enSorted)
+        return bFALSE;
+
+    // Identify the data file this index goes with
+    memset(&suFileHdr, 0, sizeof(suFileHdr));
+    memcpy(suFileHdr.achMagic, INDEX_FILE_MAGIC, sizeof(INDEX_FILE_MAGIC));
+    suFileHdr.ulVersion    = INDEX_FILE_VERSION;
+    suFileHdr.ulHeaderSize = sizeof(SuInOrderIndexFileHdr);
+    suFileHdr.ulNumEntries = (uint32_t)psuIndex->iArrayUsed;
+    suFileHdr.ulNumChans   = (uint32_t)psuIndex->iNumChans;
+    if (bI106Ch10GetFileId(psuI106Handle(iHandle)->szFileName, &suFileHdr.llSourceSize, 
+                     &suFileHdr.llSourceTime, &suFileHdr.ullSourceHash) == bFALSE)
+        return bFALSE;
+
+    szTempFileName = (char *)malloc(strlen(szIdxFileName) + 5);
+    if (szTempFileName == NULL)
+        return bFALSE;
+    strcpy(szTempFileName, szIdxFileName);
+    strcat(szTempFileName, ".tmp");
+
+#if defined(_WIN32)
+    iFlags    = O_WRONLY | O_CREAT | O_TRUNC | O_BINARY;
+    iFileMode = _S_IREAD | _S_IWRITE;
+#elif defined(__GNUC__)
+    iFlags    = O_WRONLY | O_CREAT | O_TRUNC | O_LARGEFILE;
+    iFileMode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+#else
+    iFlags    = O_WRONLY | O_CREAT | O_TRUNC;
+    iFileMode = 0;
+#endif
+    iIdxFile = open(szTempFileName, iFlags, iFileMode);
+    if (iIdxFile == -1)
+        {
+        free(szTempFileName);
+        return bFALSE;
+        }
+
+    // Header, channel summary, then the index itself
+    bWriteOK = bWriteAll(iIdxFile, &suFileHdr, sizeof(suFileHdr)) &&
+               bWriteAll(iIdxFile, psuIndex->asuChanInfo, (int64_t)psuIndex->iNumChans * sizeof(SuInOrderChanInfo)) &&
+               bWriteAll(iIdxFile, psuIndex->asuIndex,    (int64_t)psuIndex->iArrayUsed * sizeof(SuInOrderPacketInfo));
+
+    if (close(iIdxFile) != 0)
+        bWriteOK = bFALSE;
+
+    if (bWriteOK)
+        {
+#if defined(_WIN32)
+        remove(szIdxFileName);
+#endif
+        bWriteOK = rename(szTempFileName, szIdxFileName) == 0;
+        }
+    if (!bWriteOK)
+        remove(szTempFileName);
+
+    free(szTempFileName);
+
+    return bWriteOK;
+    }
+
+
+
+// -----------------------------------------------------------------------
+
+EnI106Status I106_CALL_DECL
+    enI106Ch10LoadInOrderIndex(int iHandle, const char * szIdxFileName)
+    {
+    char              * szDefaultName = NULL;
+    char              * szName;
+
+    // Check for a valid handle
+    if (bI106ValidHandle(iHandle) == bFALSE)
+        {
+        return I106_INVALID_HANDLE;
+        }
+
+    // Only works on files
+    switch (psuI106Handle(iHandle)->enFileMode)
+        {
+        case I106_CLOSED :
+            return I106_NOT_OPEN;
+            break;
+
+        case I106_READ          :
+        case I106_READ_IN_ORDER :
+        case I106_READ_MMAP     :
+            break;
+
+        default :
+            return I106_WRONG_FILE_MODE;
+            break;
+        } // end switch on file mode
+
+    if (szIdxFileName == NULL)
+        {
+        szDefaultName = (char *)malloc(strlen(psuI106Handle(iHandle)->szFileName) + 5);
+        if (szDefaultName == NULL)
+            return I106_NO_MEMORY;
+        strcpy(szDefaultName, psuI106Handle(iHandle)->szFileName);
+        strcat(szDefaultName, ".idx");
+        szName = szDefaultName;
+        }
+    else
+        szName = (char *)szIdxFileName;
+
+    // Use the index file if it's current, otherwise make it again
+    if (bReadInOrderIndex(iHandle, szName) == bFALSE)
+        {
+        vMakeInOrderIndex(iHandle);
+        if (psuI106Handle(iHandle)->suInOrderIndex.enSortStatus == enSorted)
+            bWriteInOrderIndex(iHandle, szName);
+        }
+
+    free(szDefaultName);
+
+    if (psuI106Handle(iHandle)->suInOrderIndex.enSortStatus != enSorted)
+        return I106_NO_INDEX;
+
+    return I106_OK;
+    }
+
+
+
+// -----------------------------------------------------------------------
+
+// This is used in qsort in vSortInOrderIndex() below
+
+int FileTimeCompare(const void * psuIndex1, const void * psuIndex2)
+    {
+    if (((SuInOrderPacketInfo *)psuIndex1)->llTime < ((SuInOrderPacketInfo *)psuIndex2)->llTime) return -1;
+    if (((SuInOrderPacketInfo *)psuIndex1)->llTime > ((SuInOrderPacketInfo *)psuIndex2)->llTime) return  1;
+    return 0;
+    }
+
+
+// -----------------------------------------------------------------------
+
+// Read all headers and make an index based on time
+
+void I106_CALL_DECL 
+    vMakeInOrderIndex(int iHandle)
+    {
+
+    EnI106Status        enStatus;
+    int64_t             llStartPos;     // File position coming in
+    SuInOrderIndex    * psuIndex = &psuI106Handle(iHandle)->suInOrderIndex;
+
+    // Remember the current file position
+    enStatus = enI106Ch10GetPos(iHandle, &llStartPos);
+
+    // A mapped index can't be added to, and the channel summary gets made again
+    if (psuIndex->pvIndexMap != NULL)
+        vFreeInOrderIndex(psuIndex);
+    free(psuIndex->asuChanInfo);
+    psuIndex->asuChanInfo = NULL;
+    psuIndex->iNumChans   = 0;
+
+    // Read headers, put time and file offset into index array
+    psuIndex->iArrayUsed = 0;
+    enStatus = enMakeIndexSerial(iHandle);
+
+    // If an error then clean up and get out
+    if (enStatus != I106_OK)
+        {
+        vFreeInOrderIndex(psuIndex);
+        psuIndex->enSortStatus    = enSortError;
+        enI106Ch10SetPos(iHandle, llStartPos);
+        return;
+        }
+
+    // Sort the index array
+    // It is required that TMATS is the first record and IRIG time is the
+    // second record so don't include those in the sort
+    if (psuIndex->iArrayUsed > 2)
+        vSortInOrderIndex(&(psuIndex->asuIndex[2]), psuIndex->iArrayUsed-2);
+
+    // Put the file point back where we started and find the current index
+// THIS SHOULD REALLY BE DONE FOR THE FILE-READ-OK LOGIC PATH ALSO
+    enStatus = enI106Ch10SetPos(iHandle, llStartPos);
+    psuIndex->iArrayCurr = 0;
+    while (psuIndex->iArrayCurr < psuIndex->iArrayUsed)
+        {
+        if (llStartPos == psuIndex->asuIndex[psuIndex->iArrayCurr].llOffset)
+            break;
+        psuIndex->iArrayCurr++;
+        }
 
-    return uDataBuffLen;
+    // If we didn't find it then it's an error
+    if (psuIndex->iArrayCurr == psuIndex->iArrayUsed)
+        {
+        vFreeInOrderIndex(psuIndex);
+        psuIndex->enSortStatus    = enSortError;
+        }
+    else
+        psuIndex->enSortStatus = enSorted;
+
+    return;
     }
 
 
-/* ----------------------------------------------------------------------- */
 
-// Calculate and return the appropriate checksum of the data in the buffer.
+// -----------------------------------------------------------------------
 
-/* 
-Note that this checksum method is technically incorrect. Filler needs to be included in
-the checksum process. The common and ubiquitous filler is typically 0x00 and in that case
-this routine will work fine. But a filler value of 0xFF legal (but not common). In this
-case this routine will give incorrect results.
-*/
-uint32_t I106_CALL_DECL
-    uCalcDataChecksum(int iChecksumType, const void * pvBuff, uint32_t uBuffLen, uint32_t uChecksum)
+// Collect header time and offset by reading through the file with this 
+// handle
+
+static EnI106Status enMakeIndexSerial(int iHandle)
     {
+    EnI106Status        enStatus;
+    int64_t             llCurrPos;      // Current file position
+    SuI106Ch10Header    suHdr;          // Data packet header
+    SuInOrderIndex    * psuIndex = &psuI106Handle(iHandle)->suInOrderIndex;
+    SuIndexScanArray    suArray;
 
-    // Calculate the appropriate checksum
-    switch (iChecksumType)
+    memset(&suArray, 0, sizeof(suArray));
+    suArray.asuIndex   = psuIndex->asuIndex;
+    suArray.iArraySize = psuIndex->iArraySize;
+
+    enStatus = enI106Ch10SetPos(iHandle, 0L);
+
+    while (enStatus == I106_OK)
         {
-        // The 8 bit case is easy. Just sum up the bytes in the buffer.
-        case I106CH10_PFLAGS_CHKSUM_8  :
+        enStatus = enI106Ch10ReadNextHeaderFile(iHandle, &suHdr);
+
+        // If EOF break out
+        if (enStatus == I106_EOF)
             {
-            assert(uChecksum <= 0xff);
-            uint8_t         uSum8   = (uint8_t)uChecksum;
-            uint8_t       * puData8 = (uint8_t *)pvBuff;
-            unsigned        uBytesLeftToChecksum = uBuffLen;
-            while (uBytesLeftToChecksum > 0)
-                {
-                uSum8 += *puData8;
-                puData8++;
-                uBytesLeftToChecksum -= 1;
-                }
-            uChecksum = uSum8;
+            enStatus = I106_OK;
+            break;
             }
+        if (enStatus != I106_OK)
             break;
 
-        // The 16 (and 32) bit cases are more complicated. If the size of the data buffer doens't
-        // fall on a 16 (or 32) bit boundary then we shouldn't really access data past the end of
-        // the buffer. So we directly access buffer data when full words are available. But at the
-        // end of the buffer if there isn't enough data to make a full word then a full word is
-        // constructed in local storage.
-        case I106CH10_PFLAGS_CHKSUM_16   :
-            {
-            assert(uChecksum <= 0xffff);
-            uint16_t        uSum16   = (uint16_t)uChecksum;
-            uint16_t      * puData16 = (uint16_t *)pvBuff;
-            unsigned        uBytesLeftToChecksum = uBuffLen;
-            while (uBytesLeftToChecksum > 0)
-                {
-                // If we have at least a whole 32 bit word in the data buffer to checksum
-                if (uBytesLeftToChecksum >= 2)
-                    {
-                    uSum16 += *puData16;
-                    puData16++;
-                    uBytesLeftToChecksum -= 2;
-                    }
+        // Get the position
+        enStatus = enI106Ch10GetPos(iHandle, &llCurrPos);
+        llCurrPos -= iGetHeaderLen(&suHdr);
 
-                // Else less than a whole 16 bit word left in the data buffer
-                else
-                    {
-                    uint16_t    uData16 = 0;
-                    memcpy(&uData16, puData16, uBytesLeftToChecksum);
-                    uSum16 += uData16;
-                    uBytesLeftToChecksum  = 0;;
-                    }
-                } // end uBytesLeftToChecksum > 0
-            uChecksum = uSum16;
-            }
-            break;
+        if (bIndexArrayAdd(&suArray, llCurrPos, &suHdr) == bFALSE)
+            enStatus = I106_NO_MEMORY;
+        }
 
-        case I106CH10_PFLAGS_CHKSUM_32   :
-            {
-            assert(uChecksum <= 0xffffffff);
-            uint32_t        uSum32   = (uint32_t)uChecksum;
-            uint32_t      * puData32 = (uint32_t *)pvBuff;
-            unsigned        uBytesLeftToChecksum = uBuffLen;
-            while (uBytesLeftToChecksum > 0)
-                {
-                // If we have at least a whole 32 bit word in the data buffer to checksum
-                if (uBytesLeftToChecksum >= 4)
-                    {
-                    uSum32 += *puData32;
-                    puData32++;
-                    uBytesLeftToChecksum -= 4;
-                    }
+    psuIndex->asuIndex   = suArray.asuIndex;
+    psuIndex->iArraySize = suArray.iArraySize;
+    psuIndex->iArrayUsed = suArray.iArrayUsed;
 
-                // Else less than a whole 32 bit word left in the data buffer
-                else
-                    {
-                    uint32_t    uData32 = 0;
-                    memcpy(&uData32, puData32, uBytesLeftToChecksum);
-                    uSum32 += uData32;
-                    uBytesLeftToChecksum  = 0;;
-                    }
-                } // end uBytesLeftToChecksum > 0
-            uChecksum = uSum32;
-            }
-            break;
-        default :
-            break;
-        } // end switch iChecksumType
+    if ((enStatus == I106_OK) && (bMergeChanInfo(psuIndex, &suArray, 1) == bFALSE))
+        enStatus = I106_NO_MEMORY;
 
-    return uChecksum;
-    } // end uCalcDataChecksum()
+    // The index array now belongs to the handle
+    suArray.asuIndex = NULL;
+    vFreeIndexArray(&suArray);
 
+    return enStatus;
+    }
 
-/* ----------------------------------------------------------------------- */
 
-// Add the filler and appropriate checksum to the end of the data buffer
-// It is assumed that the buffer is big enough to hold additional filler 
-// and the checksum. Also fill in the header with the correct packet length.
 
-EnI106Status I106_CALL_DECL 
-    uAddDataFillerChecksum(SuI106Ch10Header * psuI106Hdr, unsigned char achData[])
+// -----------------------------------------------------------------------
+
+// Add an entry to an index array and count it in the channel summary.  The
+// array grows by half its size each time so the copying stays linear in the
+// number of packets.
+
+static int bIndexArrayAdd(SuIndexScanArray * psuArray, int64_t llOffset, SuI106Ch10Header * psuHeader)
     {
-    unsigned char * achTrailerBuffer;
-    int             iTrailerBufferSize;
+    SuInOrderPacketInfo   * asuNewIndex;
+    SuInOrderChanInfo     * asuNewChanInfo;
+    SuInOrderChanInfo     * psuChanInfo;
+    int                     iNewSize;
+    int64_t                 llTime;
 
-    achTrailerBuffer   = &(achData[psuI106Hdr->ulDataLen]);
-    iTrailerBufferSize = 8;
+    vTimeArray2LLInt(psuHeader->aubyRefTime, &llTime);
 
-    // The CSDW is already part of the data buffer.
-    uAddDataFillerChecksum2(psuI106Hdr, NULL, 0, achData, psuI106Hdr->ulDataLen, achTrailerBuffer, &iTrailerBufferSize);
+    // Find or make the channel summary
+    if (psuArray->aulChanSlot == NULL)
+        {
+        psuArray->aulChanSlot = (uint32_t *)calloc(0x10000, sizeof(uint32_t));
+        if (psuArray->aulChanSlot == NULL)
+            return bFALSE;
+        }
+    if (psuArray->aulChanSlot[psuHeader->uChID] == 0)
+        {
+        asuNewChanInfo = (SuInOrderChanInfo *)realloc(psuArray->asuChanInfo, 
+                                                      sizeof(SuInOrderChanInfo) * (psuArray->iNumChans + 1));
+        if (asuNewChanInfo == NULL)
+            return bFALSE;
+        psuArray->asuChanInfo = asuNewChanInfo;
+        psuChanInfo = &psuArray->asuChanInfo[psuArray->iNumChans++];
+        memset(psuChanInfo, 0, sizeof(SuInOrderChanInfo));
+        psuChanInfo->uChID       = psuHeader->uChID;
+        psuChanInfo->ubyDataType = psuHeader->ubyDataType;
+        psuChanInfo->llFirstTime = llTime;
+        psuChanInfo->llLastTime  = llTime;
+        psuArray->aulChanSlot[psuHeader->uChID] = psuArray->iNumChans;
+        }
+    psuChanInfo = &psuArray->asuChanInfo[psuArray->aulChanSlot[psuHeader->uChID] - 1];
+    psuChanInfo->ulPacketCount++;
+    if (llTime < psuChanInfo->llFirstTime)
+        psuChanInfo->llFirstTime = llTime;
+    if (llTime > psuChanInfo->llLastTime)
+        psuChanInfo->llLastTime  = llTime;
+
+    if (psuArray->iArrayUsed >= psuArray->iArraySize)
+        {
+        iNewSize = psuArray->iArraySize + psuArray->iArraySize / 2 + 1024;
+        asuNewIndex = (SuInOrderPacketInfo *)realloc(psuArray->asuIndex, sizeof(SuInOrderPacketInfo)*iNewSize);
+        if (asuNewIndex == NULL)
+            return bFALSE;
+        psuArray->asuIndex   = asuNewIndex;
+        psuArray->iArraySize = iNewSize;
+        }
 
-    return I106_OK;
+    psuArray->asuIndex[psuArray->iArrayUsed].llOffset = llOffset;
+    psuArray->asuIndex[psuArray->iArrayUsed].llTime   = llTime;
+    psuArray->iArrayUsed++;
+
+    return bTRUE;
     }
 
 
-/* ----------------------------------------------------------------------- */
 
-// Create approprite filler and checksum in a seperate user supplied buffer.
+// -----------------------------------------------------------------------
 
-EnI106Status I106_CALL_DECL 
-    uAddDataFillerChecksum2(
-            SuI106Ch10Header        * psuI106Hdr, 
-            const void              * pvCSDW,
-            int                       iCSDWLen,
-            const unsigned char     * achData, 
-            unsigned long             ulBuffDataLen,
-            unsigned char           * achTrailerBuffer, 
-            int                     * piTrailerBufferSize)
+static void vFreeIndexArray(SuIndexScanArray * psuArray)
     {
-    uint32_t    uDataBuffSize;
-    int         iFillSize;
-    int         iChecksumType;
+    free(psuArray->asuIndex);
+    free(psuArray->aulChanSlot);
+    free(psuArray->asuChanInfo);
+    memset(psuArray, 0, sizeof(SuIndexScanArray));
+    }
 
-    // Extract the checksum type
-    iChecksumType = psuI106Hdr->ubyPacketFlags & I106CH10_PFLAGS_CHKSUM_MASK;
 
-    // Figure out how big the final packet will be
-    uDataBuffSize = uCalcDataBuffReqSize(iCSDWLen+ulBuffDataLen, iChecksumType);
-    psuI106Hdr->ulPacketLen = HEADER_SIZE + uDataBuffSize;
-    if ((psuI106Hdr->ubyPacketFlags & I106CH10_PFLAGS_SEC_HEADER) != 0)
-        psuI106Hdr->ulPacketLen += SEC_HEADER_SIZE;
 
-    // Figure out the filler/checksum size and zero fill it
-    iFillSize = uDataBuffSize - (iCSDWLen + ulBuffDataLen);
-    assert(iFillSize < 8);
-    memset(achTrailerBuffer, 0, iFillSize);
-    if (*piTrailerBufferSize < iFillSize)
-        return I106_BUFFER_TOO_SMALL;
+// -----------------------------------------------------------------------
 
-    *piTrailerBufferSize = iFillSize;
+// Combine the channel summaries from each index array into the handle index
 
-    switch (iChecksumType)
+static int bMergeChanInfo(SuInOrderIndex * psuIndex, SuIndexScanArray asuArray[], int iNumArrays)
+    {
+    uint32_t              * aulChanSlot;
+    SuInOrderChanInfo     * psuFrom;
+    SuInOrderChanInfo     * psuTo;
+    int                     iArrayIdx;
+    int                     iChanIdx;
+    int                     iMaxChans = 0;
+
+    for (iArrayIdx=0; iArrayIdx<iNumArrays; iArrayIdx++)
+        iMaxChans += asuArray[iArrayIdx].iNumChans;
+    if (iMaxChans > 0x10000)
+        iMaxChans = 0x10000;
+
+    free(psuIndex->asuChanInfo);
+    psuIndex->iNumChans   = 0;
+    psuIndex->asuChanInfo = (SuInOrderChanInfo *)malloc(sizeof(SuInOrderChanInfo) * (iMaxChans + 1));
+    aulChanSlot           = (uint32_t *)calloc(0x10000, sizeof(uint32_t));
+    if ((psuIndex->asuChanInfo == NULL) || (aulChanSlot == NULL))
         {
-        case I106CH10_PFLAGS_CHKSUM_8    :
-            {
-            uint8_t    *puSum8;
-            puSum8  = (uint8_t *)&achTrailerBuffer[iFillSize-1];
-            *puSum8 = 0;
-            *puSum8 = uCalcDataChecksum(iChecksumType, pvCSDW,  iCSDWLen,      *puSum8);
-            *puSum8 = uCalcDataChecksum(iChecksumType, achData, ulBuffDataLen, *puSum8);
-            }
-            break;
+        free(psuIndex->asuChanInfo);
+        free(aulChanSlot);
+        psuIndex->asuChanInfo = NULL;
+        return bFALSE;
+        }
 
-        case I106CH10_PFLAGS_CHKSUM_16   :
+    // Arrays are in file order so the first data type seen stays
+    for (iArrayIdx=0; iArrayIdx<iNumArrays; iArrayIdx++)
+        {
+        for (iChanIdx=0; iChanIdx<asuArray[iArrayIdx].iNumChans; iChanIdx++)
             {
-            uint16_t   *puSum16;
-            puSum16  = (uint16_t *)&achTrailerBuffer[iFillSize-2];
-            *puSum16 = 0;
-            *puSum16 = uCalcDataChecksum(iChecksumType, pvCSDW,  iCSDWLen,      *puSum16);
-            *puSum16 = uCalcDataChecksum(iChecksumType, achData, ulBuffDataLen, *puSum16);
+            psuFrom = &asuArray[iArrayIdx].asuChanInfo[iChanIdx];
+            if (aulChanSlot[psuFrom->uChID] == 0)
+                {
+                psuIndex->asuChanInfo[psuIndex->iNumChans++] = *psuFrom;
+                aulChanSlot[psuFrom->uChID] = psuIndex->iNumChans;
+                continue;
+                }
+            psuTo = &psuIndex->asuChanInfo[aulChanSlot[psuFrom->uChID] - 1];
+            psuTo->ulPacketCount += psuFrom->ulPacketCount;
+            if (psuFrom->llFirstTime < psuTo->llFirstTime)
+                psuTo->llFirstTime = psuFrom->llFirstTime;
+            if (psuFrom->llLastTime > psuTo->llLastTime)
+                psuTo->llLastTime = psuFrom->llLastTime;
             }
-            break;
+        }
 
-        case I106CH10_PFLAGS_CHKSUM_32   :
-            {
-            uint32_t   *puSum32;
-            puSum32  = (uint32_t *)&achTrailerBuffer[iFillSize-4];
-            *puSum32 = 0;
-            *puSum32 = uCalcDataChecksum(iChecksumType, pvCSDW,  iCSDWLen,      *puSum32);
-            *puSum32 = uCalcDataChecksum(iChecksumType, achData, ulBuffDataLen, *puSum32);
-            }
-            break;
+    free(aulChanSlot);
 
-        case I106CH10_PFLAGS_CHKSUM_NONE :
-        default :
-            break;
-        } // end switch iChecksumType
+    qsort(psuIndex->asuChanInfo, psuIndex->iNumChans, sizeof(SuInOrderChanInfo), ChanInfoCompare);
 
+    return bTRUE;
+    }
 
-    // Calculate the checksum
 
 
+static int ChanInfoCompare(const void * psuChanInfo1, const void * psuChanInfo2)
+    {
+    return (int)((SuInOrderChanInfo *)psuChanInfo1)->uChID - 
+           (int)((SuInOrderChanInfo *)psuChanInfo2)->uChID;
+    }
 
 
-    return I106_OK;
-    }
 
 // -----------------------------------------------------------------------
 
-char * szI106ErrorStr(EnI106Status enStatus)
-    {
-    char    * szErrorMsg;
+// Free the in order index, whether it was made or mapped from an index file
 
-    switch (enStatus)
+static void vFreeInOrderIndex(SuInOrderIndex * psuIndex)
+    {
+    if (psuIndex->pvIndexMap != NULL)
         {
-        case I106_OK                : szErrorMsg = "No error";              break;
-        case I106_OPEN_ERROR        : szErrorMsg = "File open failed";      break;
-        case I106_OPEN_WARNING      : szErrorMsg = "File open warning";     break;
-        case I106_EOF               : szErrorMsg = "End of file";           break;
-        case I106_BOF               : szErrorMsg = "Beginning of file";     break;
-        case I106_READ_ERROR        : szErrorMsg = "Read error";            break;
-        case I106_WRITE_ERROR       : szErrorMsg = "Write error";           break;
-        case I106_MORE_DATA         : szErrorMsg = "More data available";   break;
-        case I106_SEEK_ERROR        : szErrorMsg = "Seek error";            break;
-        case I106_WRONG_FILE_MODE   : szErrorMsg = "Wrong file mode";       break;
-        case I106_NOT_OPEN          : szErrorMsg = "File not open";         break;
-        case I106_ALREADY_OPEN      : szErrorMsg = "File already open";     break;
-        case I106_BUFFER_TOO_SMALL  : szErrorMsg = "Buffer too small";      break;
-        case I106_NO_MORE_DATA      : szErrorMsg = "No more data";          break;
-        case I106_NO_FREE_HANDLES   : szErrorMsg = "No free file handles";  break;
-        case I106_INVALID_HANDLE    : szErrorMsg = "Invalid file handle";   break;
-        case I106_TIME_NOT_FOUND    : szErrorMsg = "Time not found";        break;
-        case I106_HEADER_CHKSUM_BAD : szErrorMsg = "Bad header checksum";   break;
-        case I106_NO_INDEX          : szErrorMsg = "No index";              break;
-        case I106_UNSUPPORTED       : szErrorMsg = "Unsupported feature";   break;
-        case I106_BUFFER_OVERRUN    : szErrorMsg = "Buffer overrun";        break;
-        case I106_INDEX_NODE        : szErrorMsg = "Index node";            break;
-        case I106_INDEX_ROOT        : szErrorMsg = "Index root";            break;
-        case I106_INDEX_ROOT_LINK   : szErrorMsg = "Index root link";       break;
-        case I106_INVALID_DATA      : szErrorMsg = "Invalid data";          break;
-        case I106_INVALID_PARAMETER : szErrorMsg = "Invalid parameter";     break;
-        default                     : szErrorMsg = "Unknown error";         break;
-        } // end switch on status
+#if defined(_WIN32)
+        free(psuIndex->pvIndexMap);
+#else
+        munmap(psuIndex->pvIndexMap, (size_t)psuIndex->llIndexMapSize);
+#endif
+        }
+    else
+        {
+        free(psuIndex->asuIndex);
+        free(psuIndex->asuChanInfo);
+        }
 
-    return szErrorMsg;
+    psuIndex->pvIndexMap      = NULL;
+    psuIndex->llIndexMapSize  = 0;
+    psuIndex->asuIndex        = NULL;
+    psuIndex->asuChanInfo     = NULL;
+    psuIndex->iNumChans       = 0;
+    psuIndex->iArraySize      = 0;
+    psuIndex->iArrayUsed      = 0;
+    psuIndex->iArrayCurr      = 0;
+    psuIndex->iNumSearchSteps = 0;
     }
 
 
+
 // -----------------------------------------------------------------------
 
-void InitHandles()
+// Identify a data file by size, modify time, and a hash of the data at the
+// beginning and end of the file.  Hashing the whole file would take as long
+// as making the index.
+
+int I106_CALL_DECL 
+    bI106Ch10GetFileId(const char    szFileName[], 
+                       int64_t     * pllSize, 
+                       int64_t     * pllTime, 
+                       uint64_t    * pullHash)
     {
-    int     iIdx;
+    int                 iFile;
+    int                 iFlags;
+    int                 iReadLen;
+    int                 iByteIdx;
+    int                 iBlock;
+    int64_t             llBlockOffset;
+    uint64_t            ullHash;
+    unsigned char     * pchBuff;
+#if defined(_WIN32)
+    struct _stati64     suStatBuff;
+#else
+    struct stat         suStatBuff;
+#endif
+
+#if defined(_WIN32)
+    iFlags = O_RDONLY | O_BINARY;
+#elif defined(__GNUC__)
+    iFlags = O_RDONLY | O_LARGEFILE;
+#else
+    iFlags = O_RDONLY;
+#endif
+    iFile = open(szFileName, iFlags, 0);
+    if (iFile == -1)
+        return bFALSE;
+
+#if defined(_WIN32)
+    if (_fstati64(iFile, &suStatBuff) != 0)
+#else
+    if (fstat(iFile, &suStatBuff) != 0)
+#endif
+        {
+        close(iFile);
+        return bFALSE;
+        }
+    *pllSize = suStatBuff.st_size;
+    *pllTime = (int64_t)suStatBuff.st_mtime;
+
+    pchBuff = (unsigned char *)malloc(INDEX_HASH_SIZE);
+    if (pchBuff == NULL)
+        {
+        close(iFile);
+        return bFALSE;
+        }
 
-    // Initialize handle data if necessary
-    if (m_bHandlesInited == bFALSE)
+    // FNV-1a over the first and last blocks
+    ullHash = 0xcbf29ce484222325ULL;
+    for (iBlock=0; iBlock<2; iBlock++)
         {
-        for (iIdx=0; iIdx<MAX_HANDLES; iIdx++)
+        llBlockOffset = iBlock == 0 ? 0 : *pllSize - INDEX_HASH_SIZE;
+        if (llBlockOffset < 0)
+            llBlockOffset = 0;
+#if defined(_WIN32)
+        _lseeki64(iFile, llBlockOffset, SEEK_SET);
+#else
+        lseek(iFile, llBlockOffset, SEEK_SET);
+#endif
+        iReadLen = read(iFile, pchBuff, INDEX_HASH_SIZE);
+        for (iByteIdx=0; iByteIdx<iReadLen; iByteIdx++)
             {
-            g_suI106Handle[iIdx].bInUse      = bFALSE;
-            g_suI106Handle[iIdx].enFileMode  = I106_CLOSED;
-            g_suI106Handle[iIdx].enFileState = enClosed;
+            ullHash ^= pchBuff[iByteIdx];
+            ullHash *= 0x100000001b3ULL;
             }
-        m_bHandlesInited = bTRUE;
-        } // end if file handles not inited yet
+        }
+
+    free(pchBuff);
+    close(iFile);
+
+    *pullHash = ullHash;
+
+    return bTRUE;
     }
 
 
+
 // -----------------------------------------------------------------------
 
-// Get the next available handle
+// Write a whole buffer, a piece at a time if necessary
 
-int GetNextHandle()
+static int bWriteAll(int iFile, const void * pvBuff, int64_t llLen)
     {
-    int     iHandle;
-    int     iIdx;
+    const char        * pchBuff = (const char *)pvBuff;
+    int                 iChunk;
+    int                 iWritten;
 
-    iHandle = -1;
-    for (iIdx=0; iIdx<MAX_HANDLES; iIdx++)
+    while (llLen > 0)
         {
-        if (g_suI106Handle[iIdx].bInUse == bFALSE)
-            {
-            g_suI106Handle[iIdx].bInUse = bTRUE;
-            iHandle = iIdx;
-            break;
-            } // end if unused handle found
-        } // end looking for unused handle
+        iChunk   = llLen > 0x40000000 ? 0x40000000 : (int)llLen;
+        iWritten = write(iFile, pchBuff, iChunk);
+        if (iWritten <= 0)
+            return bFALSE;
+        pchBuff += iWritten;
+        llLen   -= iWritten;
+        }
 
-    return iHandle;
+    return bTRUE;
     }
 
-// TODO : Move this functionality to i106_index.*
 
-// -----------------------------------------------------------------------
-// Generate an index from the data file
+
 // -----------------------------------------------------------------------
 
-/*  
-Support for read back in time order is experimental.  Some 106-04 recorders 
-recorder data *way* out of time order.  But most others don't.  And starting
-with 106-05 the most out of order is 1 second.
+// Sort index entries by time.  Files are nearly in order already so check
+// for that first.  Otherwise do an LSD radix sort on the 48 bit RTC, 16 bits
+// at a time, skipping passes where every entry has the same digit.  Radix
+// sort is stable so packets with the same time stay in file order.
 
-The best way to support read back in order is to do it on the fly as the file
-is being read.  But that's more than I'm willing to do right now.  This indexing
-scheme does get the job done for now.
-*/
+static void vSortInOrderIndex(SuInOrderPacketInfo * asuIndex, int iNumIndex)
+    {
+    SuInOrderPacketInfo   * asuTemp;
+    SuInOrderPacketInfo   * asuSrc;
+    SuInOrderPacketInfo   * asuDst;
+    SuInOrderPacketInfo   * asuSwap;
+    uint32_t              * aulCount;
+    uint32_t                ulSum;
+    uint32_t                ulCount;
+    int                     iIdx;
+    int                     iPass;
+    int                     iDigit;
+    int                     bSorted;
+
+    // Already in order?
+    bSorted = bTRUE;
+    for (iIdx=1; iIdx<iNumIndex; iIdx++)
+        {
+        if (asuIndex[iIdx].llTime < asuIndex[iIdx-1].llTime)
+            {
+            bSorted = bFALSE;
+            break;
+            }
+        }
+    if (bSorted)
+        return;
 
-// Read the index from a previously generated index file.
+    // Fall back to qsort if there isn't memory for the radix sort
+    asuTemp  = (SuInOrderPacketInfo *)malloc(sizeof(SuInOrderPacketInfo) * iNumIndex);
+    aulCount = (uint32_t *)calloc(3 * 0x10000, sizeof(uint32_t));
+    if ((asuTemp == NULL) || (aulCount == NULL))
+        {
+        free(asuTemp);
+        free(aulCount);
+        qsort(asuIndex, iNumIndex, sizeof(SuInOrderPacketInfo), FileTimeCompare);
+        return;
+        }
 
-int I106_CALL_DECL 
-    bReadInOrderIndex(int iHandle, char * szIdxFileName)
-    {
-    int                 iIdxFile;
-    int                 iFlags;
-    int                 iArrayReadStart;
-    int                 iReadCnt;
-    int                 bReadOK = bFALSE;
-    SuInOrderIndex    * psuIndex = &g_suI106Handle[iHandle].suInOrderIndex;
+    // Count all three digits in one pass
+    for (iIdx=0; iIdx<iNumIndex; iIdx++)
+        {
+        aulCount[0x00000 + ((asuIndex[iIdx].llTime      ) & 0xffff)]++;
+        aulCount[0x10000 + ((asuIndex[iIdx].llTime >> 16) & 0xffff)]++;
+        aulCount[0x20000 + ((asuIndex[iIdx].llTime >> 32) & 0xffff)]++;
+        }
 
-    // Setup a one time loop to make it easy to break out on errors
-    do
+    asuSrc = asuIndex;
+    asuDst = asuTemp;
+    for (iPass=0; iPass<3; iPass++)
         {
+        uint32_t  * aulPassCount = &aulCount[iPass * 0x10000];
 
-        // Try opening and reading the index file
-#if defined(_WIN32)
-        iFlags = O_RDONLY | O_BINARY;
-#else
-        iFlags = O_RDONLY;
-#endif
-        iIdxFile = open(szIdxFileName, iFlags, 0);
-        if (iIdxFile == -1)
-            break;
+        // Skip the pass if everything has the same digit
+        iDigit = (int)((asuSrc[0].llTime >> (16 * iPass)) & 0xffff);
+        if (aulPassCount[iDigit] == (uint32_t)iNumIndex)
+            continue;
 
-        // Read the index data from the file
-        while (bTRUE)
+        // Turn counts into starting positions
+        ulSum = 0;
+        for (iDigit=0; iDigit<0x10000; iDigit++)
             {
-            iArrayReadStart = psuIndex->iArraySize;
-            psuIndex->iArraySize += 100;
-            psuIndex->asuIndex = (SuInOrderPacketInfo *)realloc(psuIndex->asuIndex, sizeof(SuInOrderPacketInfo)*psuIndex->iArraySize);
-            iReadCnt = read(iIdxFile, &(psuIndex->asuIndex[iArrayReadStart]), 100*sizeof(SuInOrderPacketInfo));
-            psuIndex->iArrayUsed += iReadCnt / sizeof(SuInOrderPacketInfo);
-            if (iReadCnt != 100*sizeof(SuInOrderPacketInfo))
-                break;
-            } // end while reading data from file
+            ulCount              = aulPassCount[iDigit];
+            aulPassCount[iDigit] = ulSum;
+            ulSum               += ulCount;
+            }
 
-        close(iIdxFile);
+        for (iIdx=0; iIdx<iNumIndex; iIdx++)
+            {
+            iDigit = (int)((asuSrc[iIdx].llTime >> (16 * iPass)) & 0xffff);
+            asuDst[aulPassCount[iDigit]++] = asuSrc[iIdx];
+            }
 
-        // MIGHT WANT TO DO SOME SANITY CHECKS IN HERE
+        asuSwap = asuSrc;
+        asuSrc  = asuDst;
+        asuDst  = asuSwap;
+        } // end for each digit
 
-        psuIndex->enSortStatus = enSorted;
-        bReadOK = bTRUE;
-        } while (bFALSE); // end one time loop to read
+    // Make sure the result ends up in the callers array
+    if (asuSrc != asuIndex)
+        memcpy(asuIndex, asuSrc, sizeof(SuInOrderPacketInfo) * iNumIndex);
 
-    return bReadOK;
+    free(asuTemp);
+    free(aulCount);
+
+    return;
     }
 
 
 
 // -----------------------------------------------------------------------
 
-int I106_CALL_DECL 
-    bWriteInOrderIndex(int iHandle, char * szIdxFileName)
+int I106_CALL_DECL iI106Ch10GetNumCpus(void)
     {
-    int                 iFlags;
-    int                 iFileMode;
-    int                 iIdxFile;
-    int                 iWriteIdx;
-    SuInOrderIndex    * psuIndex = &g_suI106Handle[iHandle].suInOrderIndex;
-
-    // Write out an index file for use next time
 #if defined(_WIN32)
-    iFlags    = O_WRONLY | O_CREAT | O_BINARY;
-        iFileMode = _S_IREAD | _S_IWRITE;
-#elif defined(__GNUC__)
-        iFlags    = O_WRONLY | O_CREAT | O_LARGEFILE;
-        iFileMode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+    SYSTEM_INFO     suSysInfo;
+    GetSystemInfo(&suSysInfo);
+    return (int)suSysInfo.dwNumberOfProcessors;
 #else
-    iFlags    = O_WRONLY | O_CREAT;
-        iFileMode = 0;
+    long            lNumCpus;
+    lNumCpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return lNumCpus > 0 ? (int)lNumCpus : 1;
 #endif
-    iIdxFile = open(szIdxFileName, iFlags, iFileMode);
-    if (iIdxFile != -1)
-        {
+    }
 
-        // Read the index data from the file
-        for (iWriteIdx=0; iWriteIdx<psuIndex->iArrayUsed; iWriteIdx++)
-            {
-            write(iIdxFile, &(psuIndex->asuIndex[iWriteIdx]), sizeof(SuInOrderPacketInfo));
-            } // end for all index array elements
 
-        close(iIdxFile);
+
+/**
+ * If the reading mode is READ_IN_ORDER, ReadLookAheadRelTime() returns the lookahead Relative Time from the index array.
+ * Otherwise, nothing is returned.
+ */
+EnI106Status I106_CALL_DECL ReadLookAheadRelTime(int iHandle, int64_t *llLookaheadRelTime, EnI106Ch10Mode enMode)
+{
+    SuInOrderIndex *psuIndex = NULL;
+    SuReorder      *psuReorder = NULL;
+    if ( enMode==I106_READ_IN_ORDER )
+    {
+        psuIndex   = &psuI106Handle(iHandle)->suInOrderIndex;
+        psuReorder = psuI106Handle(iHandle)->psuReorder;
+        if (psuIndex->enSortStatus == enSorted)
+            *llLookaheadRelTime = psuIndex->asuIndex[psuIndex->iArrayCurr].llTime;
+        else if ((psuReorder != NULL) && (psuReorder->iHeapUsed > 0))
+            *llLookaheadRelTime = psuReorder->asuHeap[0].llTime;
+    }
+    return I106_OK;
+}
+
+// -----------------------------------------------------------------------
+// Time order window
+// -----------------------------------------------------------------------
+
+// Get the next header in time order from the time order window
+
+static EnI106Status enReadNextHeaderReorder(int                iHandle,
+                                            SuI106Ch10Header * psuHeader)
+    {
+    EnI106Status        enStatus;
+    SuReorder         * psuReorder = psuI106Handle(iHandle)->psuReorder;
+
+    // A packet that was put back goes out again
+    if ((psuReorder->bCurrValid == bTRUE) && (psuReorder->bCurrPutBack == bTRUE))
+        {
+        psuReorder->bCurrPutBack  = bFALSE;
+        psuReorder->bCurrDataRead = bFALSE;
+        memcpy(psuHeader, psuReorder->suCurr.pchPacket, psuReorder->suCurr.ulHeaderLen);
+        return I106_OK;
+        }
+
+    // Done with the last packet
+    if (psuReorder->bCurrValid == bTRUE)
+        {
+        psuReorder->ulBytesUsed -= psuReorder->suCurr.ulPacketLen;
+        free(psuReorder->suCurr.pchPacket);
+        psuReorder->suCurr.pchPacket = NULL;
+        psuReorder->bCurrValid       = bFALSE;
         }
 
-    return bFALSE;
+    // Read ahead until the oldest packet is safe to hand out
+    enStatus = enFillReorder(iHandle);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    if (psuReorder->iHeapUsed == 0)
+        return I106_EOF;
+
+    // Take the oldest packet
+    vHeapPop(psuReorder, &psuReorder->suCurr);
+    psuReorder->bCurrValid    = bTRUE;
+    psuReorder->bCurrDataRead = bFALSE;
+
+    memcpy(psuHeader, psuReorder->suCurr.pchPacket, psuReorder->suCurr.ulHeaderLen);
+
+    return I106_OK;
     }
 
 
 
 // -----------------------------------------------------------------------
 
-// This is used in qsort in vMakeInOrderIndex() below
+// Copy the data for the packet just returned out of the time order window
 
-int FileTimeCompare(const void * psuIndex1, const void * psuIndex2)
+static EnI106Status enReadDataReorder(int iHandle, unsigned long ulBuffSize, void * pvBuff)
     {
-    if (((SuInOrderPacketInfo *)psuIndex1)->llTime < ((SuInOrderPacketInfo *)psuIndex2)->llTime) return -1;
-    if (((SuInOrderPacketInfo *)psuIndex1)->llTime > ((SuInOrderPacketInfo *)psuIndex2)->llTime) return  1;
-    return 0;
+    SuReorder         * psuReorder = psuI106Handle(iHandle)->psuReorder;
+    unsigned long       ulDataLen;
+
+    if (psuReorder->bCurrDataRead == bTRUE)
+        return I106_READ_ERROR;
+
+    ulDataLen = psuReorder->suCurr.ulPacketLen - psuReorder->suCurr.ulHeaderLen;
+    if (ulBuffSize < ulDataLen)
+        return I106_BUFFER_TOO_SMALL;
+
+    memcpy(pvBuff, psuReorder->suCurr.pchPacket + psuReorder->suCurr.ulHeaderLen, ulDataLen);
+    psuReorder->bCurrDataRead = bTRUE;
+
+    return I106_OK;
     }
 
 
+
 // -----------------------------------------------------------------------
 
-// Read all headers and make an index based on time
+// Read packets into the time order window until the oldest one can't be 
+// passed by anything still to come.  Packets that don't pass the read filter
+// are never buffered.
 
-void I106_CALL_DECL 
-    vMakeInOrderIndex(int iHandle)
+static EnI106Status enFillReorder(int iHandle)
     {
+    EnI106Status        enStatus = I106_OK;
+    SuReorder         * psuReorder = psuI106Handle(iHandle)->psuReorder;
+    SuI106Ch10Header    suHeader;
+    SuReorderPacket     suPacket;
+    unsigned long       ulDataLen;
 
-    EnI106Status        enStatus;
-    int64_t             llStartPos;     // File position coming in
-    int64_t             llCurrPos;      // Current file position
-    SuI106Ch10Header    suHdr;          // Data packet header
-    int64_t             llCurrTime;     // Current header time
-    SuInOrderIndex    * psuIndex = &g_suI106Handle[iHandle].suInOrderIndex;
-
-    // Remember the current file position
-    enStatus = enI106Ch10GetPos(iHandle, &llStartPos);
-
-    enStatus = enI106Ch10SetPos(iHandle, 0L);
+    psuReorder->bBusy = bTRUE;
 
-    // Read headers, put time and file offset into index array
-    while (bTRUE)
+    while ((psuReorder->bSourceDone == bFALSE) &&
+           ((psuReorder->iHeapUsed   == 0) ||
+            ((psuReorder->llNewestTime - psuReorder->asuHeap[0].llTime < psuReorder->llHorizon) &&
+             (psuReorder->ulBytesUsed  < psuReorder->ulMaxBytes))))
         {
-        enStatus = enI106Ch10ReadNextHeaderFile(iHandle, &suHdr);
+        // Make room in the heap before reading a packet so one can't be read
+        // and then lost.  Running out of memory is reported right away, not 
+        // put off like a read error, and everything in the window stays.
+        if ((psuReorder->iHeapUsed >= psuReorder->iHeapSize) &&
+            (bGrowReorderHeap(psuReorder) == bFALSE))
+            {
+            psuReorder->bBusy = bFALSE;
+            return I106_NO_MEMORY;
+            }
 
-        // If EOF break out
+        enStatus = enI106Ch10ReadNextHeaderFile(iHandle, &suHeader);
         if (enStatus == I106_EOF)
+            {
+            psuReorder->bSourceDone = bTRUE;
+            enStatus = I106_OK;
             break;
-
-        // If an error then clean up and get out
+            }
         if (enStatus != I106_OK)
+            break;
+
+        if ((psuI106Handle(iHandle)->psuFilter != NULL) &&
+            (bFilterPass(psuI106Handle(iHandle)->psuFilter, &suHeader) == bFALSE))
+            continue;
+
+        // A packet shorter than its own header can't be held.  Drop it, the
+        // next read carries on from just past the header.
+        if (suHeader.ulPacketLen < (unsigned long)iGetHeaderLen(&suHeader))
+            continue;
+
+        // Read the whole packet into memory
+        suPacket.ulHeaderLen = iGetHeaderLen(&suHeader);
+        suPacket.ulPacketLen = suHeader.ulPacketLen;
+        suPacket.pchPacket   = (unsigned char *)malloc(suPacket.ulPacketLen);
+        if (suPacket.pchPacket == NULL)
             {
-            free(psuIndex->asuIndex);
-            psuIndex->asuIndex        = NULL;
-            psuIndex->iArraySize      = 0;
-            psuIndex->iArrayUsed      = 0;
-            psuIndex->iNumSearchSteps = 0;
-            psuIndex->enSortStatus    = enSortError;
+            enStatus = I106_NO_MEMORY;
             break;
             }
+        if (enI106Ch10GetPos(iHandle, &suPacket.llOffset) == I106_OK)
+            suPacket.llOffset -= suPacket.ulHeaderLen;
+        else
+            suPacket.llOffset = -1;
 
-        // Get the time and position
-        enStatus = enI106Ch10GetPos(iHandle, &llCurrPos);
-        llCurrPos -= iGetHeaderLen(&suHdr);
-        vTimeArray2LLInt(suHdr.aubyRefTime, &llCurrTime);
-
-        // Check the array size, make it bigger if necessary
-        if (psuIndex->iArrayUsed >= psuIndex->iArraySize)
+        memcpy(suPacket.pchPacket, &suHeader, suPacket.ulHeaderLen);
+        ulDataLen = suPacket.ulPacketLen - suPacket.ulHeaderLen;
+        enStatus  = enI106Ch10ReadDataFile(iHandle, ulDataLen, suPacket.pchPacket + suPacket.ulHeaderLen);
+        if (enStatus != I106_OK)
             {
-            psuIndex->iArraySize += 100;
-            psuIndex->asuIndex = 
-                (SuInOrderPacketInfo *)realloc(psuIndex->asuIndex, sizeof(SuInOrderPacketInfo)*psuIndex->iArraySize);
+            free(suPacket.pchPacket);
+            if (enStatus == I106_EOF)
+                {
+                psuReorder->bSourceDone = bTRUE;
+                enStatus = I106_OK;
+                }
+            break;
             }
 
-        // Copy the info into the next array element
-        psuIndex->asuIndex[psuIndex->iArrayUsed].llOffset = llCurrPos;
-        psuIndex->asuIndex[psuIndex->iArrayUsed].llTime   = llCurrTime;
-        psuIndex->iArrayUsed++;
-        }
+        // Put it in the heap
+        vTimeArray2LLInt(suHeader.aubyRefTime, &suPacket.llTime);
+        suPacket.llSeq = psuReorder->llNextSeq++;
+        vHeapPush(psuReorder, &suPacket);
 
-    // Sort the index array
-    // It is required that TMATS is the first record and IRIG time is the
-    // second record so don't include those in the sort
-    qsort(&(psuIndex->asuIndex[2]), psuIndex->iArrayUsed-2, sizeof(SuInOrderPacketInfo), FileTimeCompare);
+        psuReorder->ulBytesUsed += suPacket.ulPacketLen;
+        if ((psuReorder->iHeapUsed == 1) || (suPacket.llTime > psuReorder->llNewestTime))
+            psuReorder->llNewestTime = suPacket.llTime;
+        } // end while reading ahead
 
-    // Put the file point back where we started and find the current index
-// THIS SHOULD REALLY BE DONE FOR THE FILE-READ-OK LOGIC PATH ALSO
-    enStatus = enI106Ch10SetPos(iHandle, llStartPos);
-    psuIndex->iArrayCurr = 0;
-    while (psuIndex->iArrayCurr < psuIndex->iArrayUsed)
-        {
-        if (llStartPos == psuIndex->asuIndex[psuIndex->iArrayCurr].llOffset)
-            break;
-        psuIndex->iArrayCurr++;
-        }
+    psuReorder->bBusy = bFALSE;
 
-    // If we didn't find it then it's an error
-    if (psuIndex->iArrayCurr == psuIndex->iArrayUsed)
-        {
-        free(psuIndex->asuIndex);
-        psuIndex->asuIndex        = NULL;
-        psuIndex->iArraySize      = 0;
-        psuIndex->iArrayUsed      = 0;
-        psuIndex->iNumSearchSteps = 0;
-        psuIndex->enSortStatus    = enSortError;
-        }
-    else
-        psuIndex->enSortStatus = enSorted;
+    // A read error only matters once the window has nothing left to give
+    if ((enStatus != I106_OK) && (psuReorder->iHeapUsed > 0))
+        enStatus = I106_OK;
 
-    return;
+    return enStatus;
     }
 
-/**
- * If the reading mode is READ_IN_ORDER, ReadLookAheadRelTime() returns the lookahead Relative Time from the index array.
- * Otherwise, nothing is returned.
- */
-EnI106Status I106_CALL_DECL ReadLookAheadRelTime(int iHandle, int64_t *llLookaheadRelTime, EnI106Ch10Mode enMode)
-{
-    SuInOrderIndex *psuIndex = NULL;
-    if ( enMode==I106_READ_IN_ORDER )
+
+
+// -----------------------------------------------------------------------
+
+// Throw away everything in the time order window
+
+static void vResetReorder(SuReorder * psuReorder)
     {
-        psuIndex = &g_suI106Handle[iHandle].suInOrderIndex;
-        *llLookaheadRelTime = psuIndex->asuIndex[psuIndex->iArrayCurr].llTime;
+    int     iHeapIdx;
+
+    for (iHeapIdx=0; iHeapIdx<psuReorder->iHeapUsed; iHeapIdx++)
+        free(psuReorder->asuHeap[iHeapIdx].pchPacket);
+    free(psuReorder->suCurr.pchPacket);
+
+    psuReorder->suCurr.pchPacket = NULL;
+    psuReorder->iHeapUsed        = 0;
+    psuReorder->ulBytesUsed      = 0L;
+    psuReorder->llNewestTime     = 0;
+    psuReorder->bSourceDone      = bFALSE;
+    psuReorder->bCurrValid       = bFALSE;
+    psuReorder->bCurrDataRead    = bFALSE;
+    psuReorder->bCurrPutBack     = bFALSE;
     }
-    return I106_OK;
-}
+
+
 
 // -----------------------------------------------------------------------
-// Routines to support look-ahead sort and reorder
-// -----------------------------------------------------------------------
 
-// THIS CODE IS *VERY* EXPERIMENTAL AND HASN'T REALLY BEEN TRIED YET.
+static void vFreeReorder(int iHandle)
+    {
+    SuReorder     * psuReorder = psuI106Handle(iHandle)->psuReorder;
+
+    if (psuReorder == NULL)
+        return;
+
+    vResetReorder(psuReorder);
+    free(psuReorder->asuHeap);
+    free(psuReorder);
+    psuI106Handle(iHandle)->psuReorder = NULL;
+    }
+
 
-#ifdef LOOK_AHEAD
 
-#define LOOK_AHEAD_TIME     5.0
+// -----------------------------------------------------------------------
 
+// Heap ordering.  Older packets first, and packets with the same time come 
+// out in the order they were read.
 
-void vCheckFillLookAheadBuffer(int iHandle)
+static int bReorderBefore(SuReorderPacket * psuPacket1, SuReorderPacket * psuPacket2)
     {
-    SuIndex           * psuIndex = &g_suI106Handle[iHandle].suIndex;
-    EnI106Status        enStatus;
-    SuI106Ch10Header    suHdr;
-    int64_t             llLookAheadTime;
-    int64_t             llCurrPos;
-    int64_t             llCurrTime;
+    if (psuPacket1->llTime != psuPacket2->llTime)
+        return psuPacket1->llTime < psuPacket2->llTime;
+    return psuPacket1->llSeq < psuPacket2->llSeq;
+    }
 
-    // Return if look ahead index is full enough
-    // Only check if index array has been populated
-    if (psuIndex->iArrayUsed > 0)
-        {
-        if (psuIndex->asuIndex[psuIndex->iArrayCurr].llTime < 
-            psuIndex->asuIndex[psuIndex->iArrayUsed-1].llTime + (LOOK_AHEAD_TIME * 10000000))
-            return;
-        } // end if index array has been populated
 
-    // Shift the index down, discarding old indexes
-    memmove(&(psuIndex->asuIndex[0]), 
-            &(psuIndex->asuIndex[psuIndex->iArrayCurr]), 
-            (psuIndex->iArrayUsed - psuIndex->iArrayCurr) * sizeof(SuFileIndex));
 
-    // Find out the new look ahead time limit
-    llLookAheadTime = psuIndex->asuIndex[0].llTime + ((int)(LOOK_AHEAD_TIME * 2.0) * 10000000);
+// -----------------------------------------------------------------------
 
-    // Read ahead in file until look ahead time exceeded
-    enI106Ch10SetPos(iHandle, psuIndex->llNextReadOffset);
+// Make the heap bigger.  Returns bFALSE if there isn't memory for it, and
+// the heap is left as it was.
 
-    // Read headers, put time and file offset into index array
-    while (bTRUE)
-        {
-        enStatus = enI106Ch10ReadNextHeaderFile(iHandle, &suHdr);
+static int bGrowReorderHeap(SuReorder * psuReorder)
+    {
+    SuReorderPacket   * asuNewHeap;
 
-        // If EOF break out
-        if (enStatus == I106_EOF)
-            break;
+    asuNewHeap = (SuReorderPacket *)realloc(psuReorder->asuHeap, 
+        sizeof(SuReorderPacket) * (psuReorder->iHeapSize * 2 + 256));
+    if (asuNewHeap == NULL)
+        return bFALSE;
 
-/*
-        // If an error then clean up and get out
-        if (enStatus != I106_OK)
-            {
-            free(psuIndex->asuIndex);
-            psuIndex->asuIndex        = NULL;
-            psuIndex->iArraySize      = 0;
-            psuIndex->iArrayUsed      = 0;
-            psuIndex->iNumSearchSteps = 0;
-            psuIndex->enSortStatus    = enSortError;
-            break;
-            }
-*/
+    psuReorder->asuHeap    = asuNewHeap;
+    psuReorder->iHeapSize  = psuReorder->iHeapSize * 2 + 256;
 
-        // Get the time and position
-        enStatus = enI106Ch10GetPos(iHandle, &llCurrPos);
-        llCurrPos -= iGetHeaderLen(&suHdr);
-        vTimeArray2LLInt(suHdr.aubyRefTime, &llCurrTime);
+    return bTRUE;
+    }
 
-        // Check the array size, make it bigger if necessary
-        if (psuIndex->iArrayUsed >= psuIndex->iArraySize)
-            {
-            psuIndex->iArraySize += 100;
-            psuIndex->asuIndex = 
-                realloc(psuIndex->asuIndex, sizeof(SuFileIndex)*psuIndex->iArraySize);
-            }
 
-        // Copy the info into the next array element
-        psuIndex->asuIndex[psuIndex->iArrayUsed].llOffset = llCurrPos;
-        psuIndex->asuIndex[psuIndex->iArrayUsed].llTime   = llCurrTime;
-        psuIndex->iArrayUsed++;
 
-        psuIndex->llNextReadOffset = llCurrPos + suHdr.ulPacketLen;
+// -----------------------------------------------------------------------
+
+// Add a packet to the heap.  There has to be room for it already, see 
+// bGrowReorderHeap().
+
+static void vHeapPush(SuReorder * psuReorder, SuReorderPacket * psuPacket)
+    {
+    int                 iChild;
+    int                 iParent;
+
+    assert(psuReorder->iHeapUsed < psuReorder->iHeapSize);
 
-        if (llCurrTime > llLookAheadTime)
+    // Sift up
+    iChild = psuReorder->iHeapUsed++;
+    while (iChild > 0)
+        {
+        iParent = (iChild - 1) / 2;
+        if (bReorderBefore(psuPacket, &psuReorder->asuHeap[iParent]) == bFALSE)
             break;
+        psuReorder->asuHeap[iChild] = psuReorder->asuHeap[iParent];
+        iChild = iParent;
         }
+    psuReorder->asuHeap[iChild] = *psuPacket;
+    }
+
 
-    // Sort the index array
-    // It is required that TMATS is the first record and IRIG time is the
-    // second record so don't include those in the sort
-    qsort(&(psuIndex->asuIndex[2]), psuIndex->iArrayUsed-2, sizeof(SuFileIndex), FileTimeCompare);
 
+// -----------------------------------------------------------------------
 
-    // Sort the index
+// Take the oldest packet off the heap
 
-    return;
+static void vHeapPop(SuReorder * psuReorder, SuReorderPacket * psuPacket)
+    {
+    SuReorderPacket     suLast;
+    int                 iParent;
+    int                 iChild;
+
+    *psuPacket = psuReorder->asuHeap[0];
+    suLast     = psuReorder->asuHeap[--psuReorder->iHeapUsed];
+
+    // Sift the last element down from the top
+    iParent = 0;
+    while ((iChild = iParent * 2 + 1) < psuReorder->iHeapUsed)
+        {
+        if ((iChild + 1 < psuReorder->iHeapUsed) &&
+            bReorderBefore(&psuReorder->asuHeap[iChild + 1], &psuReorder->asuHeap[iChild]))
+            iChild++;
+        if (bReorderBefore(&psuReorder->asuHeap[iChild], &suLast) == bFALSE)
+            break;
+        psuReorder->asuHeap[iParent] = psuReorder->asuHeap[iChild];
+        iParent = iChild;
+        }
+    if (psuReorder->iHeapUsed > 0)
+        psuReorder->asuHeap[iParent] = suLast;
     }
 
-#endif // LOOK_AHEAD
 
 
 #ifdef __cplusplus
@@ -60,7 +60,20 @@ extern "C" {
 #define bFALSE      ((int)(1==0))
 #endif
 
-#define MAX_HANDLES         100
+// Handles are indexes into a table of handle contexts.  The table grows a
+// page at a time as files are opened, up to MAX_HANDLES open at once.
+#define I106_HANDLE_PAGE_BITS   8
+#define I106_HANDLE_PAGE_SIZE   (1 << I106_HANDLE_PAGE_BITS)
+#define I106_HANDLE_PAGES       4096
+#define MAX_HANDLES             (I106_HANDLE_PAGE_SIZE * I106_HANDLE_PAGES)
+
+// Default size of the user space read ahead buffer used for file reads
+#define I106_READ_AHEAD_DEFAULT     (4*1024*1024)
+
+// Default time ordering window for I106_READ_IN_ORDER.  Starting with 106-05
+// packets are never more than 1 second out of time order.
+#define I106_REORDER_HORIZON_DEFAULT    10000000L           // 1 second of RTC
+#define I106_REORDER_MAX_BYTES_DEFAULT  (64*1024*1024)
 
 #define IRIG106_SYNC        0xEB25
 
@@ -82,6 +95,7 @@ extern "C" {
 #define I106CH10_PFLAGS_TIMEFMT_IRIG106   (uint8_t)0x00
 #define I106CH10_PFLAGS_TIMEFMT_IEEE1588  (uint8_t)0x04
 #define I106CH10_PFLAGS_TIMEFMT_Reserved1 (uint8_t)0x08
+#define I106CH10_PFLAGS_TIMEFMT_ERTC      (uint8_t)0x08
 #define I106CH10_PFLAGS_TIMEFMT_Reserved2 (uint8_t)0x0C
 #define I106CH10_PFLAGS_TIMEFMT_MASK      (uint8_t)0x0C
 
@@ -169,7 +183,8 @@ typedef enum EnStatus
     I106_INDEX_ROOT         = 22,   ///< Returned decoded root message
     I106_INDEX_ROOT_LINK    = 23,   ///< Returned decoded link to next root (i.e. last root)
     I106_INVALID_DATA       = 24,   ///< Packet data is invalid for some reason
-    I106_INVALID_PARAMETER  = 25    ///< Passed parameter is invalid
+    I106_INVALID_PARAMETER  = 25,   ///< Passed parameter is invalid
+    I106_NO_MEMORY          = 26    ///< Memory allocation failed
     } EnI106Status;
 
 /// Data file open mode
@@ -183,8 +198,16 @@ typedef enum I106ChMode
     I106_READ_NET_STREAM    = 5,    ///< Open network data stream for reading
     I106_WRITE_NET_STREAM   = 6,    ///< Open network data stream for writing
     I106_READ_PCAP_STREAM   = 7,    ///< Open pcap file for reading
+    I106_READ_MMAP          = 8,    ///< Open an existing file for reading through a memory map
     } EnI106Ch10Mode;
 
+/// What the background writer does when its ring buffer is full
+typedef enum WritePolicy
+    {
+    I106_WRITE_BLOCK        = 0,    ///< Wait for the writer thread to make room
+    I106_WRITE_DROP         = 1,    ///< Drop the packet and count it
+    } EnI106WritePolicy;
+
 /// Read state is used to keep track of the next expected data file structure
 typedef enum FileState
     {
@@ -261,6 +284,17 @@ typedef struct
     int64_t     llTime;                 ///< Packet RTC at this offset
     } SuInOrderPacketInfo;
 
+/// Per channel summary kept with the file index
+typedef struct
+    {
+    uint16_t    uChID;                  ///< Channel ID
+    uint8_t     ubyDataType;            ///< Data type of first packet
+    uint8_t     ubyReserved;
+    uint32_t    ulPacketCount;          ///< Number of packets
+    int64_t     llFirstTime;            ///< Earliest packet RTC
+    int64_t     llLastTime;             ///< Latest packet RTC
+    } SuInOrderChanInfo;
+
 
 // Various file index array indexes
 typedef struct
@@ -272,12 +306,32 @@ typedef struct
     int                     iArrayCurr;  // Current position in index array
     int64_t                 llNextReadOffset;
     int                     iNumSearchSteps;
+    SuInOrderChanInfo     * asuChanInfo; ///< Channel summary, sorted by channel ID
+    int                     iNumChans;
+    void                  * pvIndexMap;  ///< Index file mapping when loaded from a file
+    int64_t                 llIndexMapSize;
     } SuInOrderIndex;
 
+/// Header level read filter. Packets that don't pass are skipped over by
+/// enI106Ch10ReadNextHeader() and enI106Ch10ReadPrevHeader().
+typedef struct
+    {
+    int                 bChanFilter;    ///< Only pass channels in channel mask
+    int                 bTypeFilter;    ///< Only pass data types in type mask
+    int                 bTimeFilter;    ///< Only pass packets in time window
+    uint8_t             abyChanMask[0x10000/8]; ///< Bit mask of channels to pass
+    uint8_t             abyTypeMask[0x100/8];   ///< Bit mask of data types to pass
+    uint8_t             ubyFlagsMask;   ///< Packet flag bits to check
+    uint8_t             ubyFlagsValue;  ///< Required value of checked packet flag bits
+    int64_t             llStartTime;    ///< Start of time window, relative time
+    int64_t             llStopTime;     ///< End of time window, relative time, 0 = no end
+    } SuI106Ch10Filter;
+
 /// Data structure for IRIG 106 read/write handle
 typedef struct
     {
     int                 bInUse;
+    int                 iNextFree;      ///< Next handle on the free list
     int                 iFile;
     char                szFileName[MAX_PATH];
     EnI106Ch10Mode      enFileMode;
@@ -288,22 +342,69 @@ typedef struct
     unsigned long       ulCurrDataBuffLen;
     unsigned long       ulCurrDataBuffReadPos;
     unsigned long       ulTotalBytesWritten;
+    unsigned char     * pchMapBase;     ///< Start of file mapping (I106_READ_MMAP)
+    int64_t             llMapSize;      ///< Size of file mapping
+    int64_t             llMapPos;       ///< Current read position in file mapping
+    unsigned char     * pchReadBuff;    ///< Read ahead buffer
+    unsigned long       ulReadBuffSize; ///< Size of read ahead buffer, 0 = no buffering
+    unsigned long       ulReadBuffLen;  ///< Amount of valid data in read ahead buffer
+    unsigned long       ulReadBuffPos;  ///< Current read position in read ahead buffer
+    int64_t             llReadBuffOffset; ///< File offset of start of read ahead buffer
+    int                 bReadBuffSeek;  ///< Next buffer refill follows a seek
+    unsigned char     * pchRevBuff;     ///< Cached block for scanning backwards
+    int64_t             llRevBuffOffset; ///< File offset of cached reverse scan block
+    int                 iRevBuffLen;    ///< Amount of valid data in reverse scan block
+    SuI106Ch10Filter  * psuFilter;      ///< Read filter, NULL = no filtering
+    unsigned char     * pchWriteBuff;   ///< Write buffer, NULL = no buffering
+    unsigned long       ulWriteBuffSize; ///< Size of write buffer
+    unsigned long       ulWriteBuffLen; ///< Amount of data waiting in write buffer
+    unsigned long       ulWriteFlushMs; ///< Flush buffer when data is this old, 0 = never
+    int64_t             llWriteBuffTime; ///< Time (ms) first data went into write buffer
+    struct SuWriteThread_S       * psuWriteThread; ///< Background writer, NULL = none
+    struct SuReorder_S           * psuReorder;     ///< Time order window, NULL = none
+    struct SuTimeRef_S           * psuTimeRef;   ///< Time reference (i106_time.c)
+    struct SuTimeModel_S         * psuTimeModel; ///< Time model, NULL = none (i106_time.c)
+    struct SuFileIndex_S         * psuFileIndex; ///< File index (i106_index.c)
+    struct SuI106Ch10NetHandle_S * psuNetHandle; ///< Network stream (i106_data_stream.c)
     char                achReserve[128];
     } SuI106Ch10Handle;
 
+/// Reference to one packet read into a batch read buffer
+typedef struct
+    {
+    SuI106Ch10Header  * psuHeader;      ///< Packet header in batch buffer
+    void              * pvData;         ///< Packet data in batch buffer
+    unsigned long       ulBuffOffset;   ///< Offset of packet in batch buffer
+    unsigned long       ulPacketLen;    ///< Packet length, header and data
+    unsigned long       ulDataLen;      ///< Packet data length, including filler and checksum
+    int64_t             llFileOffset;   ///< File offset of packet
+    } SuPacketRef;
+
+/// Background writer thread statistics
+typedef struct
+    {
+    unsigned long       ulRingSize;     ///< Size of the ring buffer
+    unsigned long       ulRingUsed;     ///< Amount of data waiting to be written
+    unsigned long       ulHighWater;    ///< Most data ever waiting to be written
+    uint64_t            ullPacketsDropped; ///< Packets dropped because the ring was full
+    uint64_t            ullBytesDropped;   ///< Bytes dropped because the ring was full
+    EnI106Status        enWriteStatus;  ///< First write error, I106_OK if none
+    } SuI106WriteStats;
+
+/// Packet handler called by enI106Ch10ScanParallel() for each packet. Return
+/// anything other than I106_OK to stop the scan.
+typedef EnI106Status (I106_CALL_DECL * PFnI106PacketHandler)(
+            int                 iThread,        ///< Worker thread number
+            int64_t             llFileOffset,   ///< File offset of packet
+            SuI106Ch10Header  * psuHeader,      ///< Packet header
+            void              * pvData,         ///< Packet data
+            void              * pvUserData);    ///< User data passed to scan
+
 #if defined(_MSC_VER)
 #pragma pack(pop)
 #endif
 
 
-/*
- * Global data
- * -----------
- */
-
-extern SuI106Ch10Handle  g_suI106Handle[MAX_HANDLES];
-
-
 /*
  * Function Declaration
  * --------------------
@@ -312,6 +413,17 @@ extern SuI106Ch10Handle  g_suI106Handle[MAX_HANDLES];
 /// Get version of the lib
 const char* szGetVersion();
 
+// Handles
+
+/// Get a pointer to the context for a handle.  The handle must be one that
+/// has been returned by an open call.
+SuI106Ch10Handle * I106_CALL_DECL
+    psuI106Handle(int iHandle);
+
+/// Check that a handle refers to an open context
+int I106_CALL_DECL
+    bI106ValidHandle(int iHandle);
+
 // Open / Close
 
 /// Open a Chapter 10 file for reading or writing
@@ -375,6 +487,91 @@ EnI106Status I106_CALL_DECL
                            unsigned long      ulBuffSize,
                            void             * pvBuff);
 
+/// Get a pointer to the current packet data without copying it.  Only
+/// supported for files opened with I106_READ_MMAP.  The pointer is valid
+/// until the file is closed.
+EnI106Status I106_CALL_DECL 
+    enI106Ch10ReadDataPtr(int                iHandle,
+                          void            ** ppvBuff,
+                          unsigned long    * pulBuffLen);
+
+/// Read packets in time order through a sliding window.  Packets are read 
+/// ahead and held until a packet at least llHorizon RTC counts newer has been
+/// read (or the window holds ulMaxBytes of packets), then the oldest one is
+/// returned by enI106Ch10ReadNextHeader().  Works on files and network 
+/// streams.  I106_READ_IN_ORDER files get a default window when opened.  A
+/// horizon of 0 turns the window off and throws away any packets in it.
+/// Seeking throws away the window and starts over from the new position.
+/// enI106Ch10GetPos() returns the position the window has read up to, and
+/// enI106Ch10ReadPrevHeader() steps back in file order.
+EnI106Status I106_CALL_DECL 
+    enI106Ch10SetReorderWindow(int               iHandle,
+                               int64_t           llHorizon,
+                               unsigned long     ulMaxBytes);
+
+/// Set the size of the read ahead buffer used for I106_READ and 
+/// I106_READ_IN_ORDER files.  A size of 0 turns read ahead buffering off.
+EnI106Status I106_CALL_DECL 
+    enI106Ch10SetReadAheadSize(int               iHandle,
+                               unsigned long     ulBuffSize);
+
+/// Read filters.  Once set, enI106Ch10ReadNextHeader() and 
+/// enI106Ch10ReadPrevHeader() only return packets that pass all the filters.
+/// The filters are cleared when the file is closed.
+
+/// Only pass packets from this channel ID (and any other channels added)
+EnI106Status I106_CALL_DECL 
+    enI106Ch10FilterChannel(int iHandle, uint16_t uChID);
+
+/// Only pass packets of this data type (and any other data types added)
+EnI106Status I106_CALL_DECL 
+    enI106Ch10FilterDataType(int iHandle, uint8_t ubyDataType);
+
+/// Only pass packets with (packet flags & ubyFlagsMask) == ubyFlagsValue
+EnI106Status I106_CALL_DECL 
+    enI106Ch10FilterFlags(int iHandle, uint8_t ubyFlagsMask, uint8_t ubyFlagsValue);
+
+/// Only pass packets with a header relative time (RTC) in the window 
+/// llStartTime <= RTC < llStopTime.  A stop time of 0 means no end.
+EnI106Status I106_CALL_DECL 
+    enI106Ch10FilterTime(int iHandle, int64_t llStartTime, int64_t llStopTime);
+
+/// Remove all read filters
+EnI106Status I106_CALL_DECL 
+    enI106Ch10FilterClear(int iHandle);
+
+/// Read as many whole packets as will fit into a buffer.  Packets are stored
+/// back to back, header followed by data, and each one gets an entry in the
+/// reference array.  Returns I106_BUFFER_TOO_SMALL if not even one packet
+/// fits, and I106_EOF at the end of the file if no packets were read.  A 
+/// packet whose length is shorter than its header returns I106_INVALID_DATA
+/// once the packets ahead of it have been returned, and is then skipped.
+EnI106Status I106_CALL_DECL 
+    enI106Ch10ReadPacketBatch(int               iHandle,
+                              void            * pvBuff,
+                              unsigned long     ulBuffSize,
+                              SuPacketRef       asuPacketRef[],
+                              int               iMaxPackets,
+                              int             * piNumPackets);
+
+/// Read every packet in a file using several threads at once.  The file is 
+/// split into equal byte ranges and each thread hands the packets that start 
+/// in its range to the packet handler.  Packets from different threads come
+/// in no particular order, so the handler must be thread safe.
+EnI106Status I106_CALL_DECL 
+    enI106Ch10ScanParallel(const char              szFileName[],
+                           int                     iNumThreads,
+                           PFnI106PacketHandler    pfnHandler,
+                           void                  * pvUserData);
+
+/// Same as enI106Ch10ScanParallel() but only packet headers are read and the
+/// packet handler gets a NULL data pointer.
+EnI106Status I106_CALL_DECL 
+    enI106Ch10ScanHeadersParallel(const char              szFileName[],
+                                  int                     iNumThreads,
+                                  PFnI106PacketHandler    pfnHandler,
+                                  void                  * pvUserData);
+
 EnI106Status I106_CALL_DECL
     enI106Ch10WriteMsg(int                   iI106Ch10Handle,
                        SuI106Ch10Header    * psuI106Hdr,
@@ -390,6 +587,52 @@ EnI106Status I106_CALL_DECL
                         void                * pvFiller,
                         int                   iFillerLen);
 
+/// Buffer packet writes for files opened with I106_OVERWRITE or I106_APPEND.
+/// Packets are gathered in a buffer of ulBuffSize bytes and written when the
+/// buffer fills, when the oldest buffered data is older than ulFlushMs 
+/// (checked on each write, 0 = no time limit), on enI106Ch10Flush(), and on 
+/// close.  A size of 0 flushes the buffer and turns buffering off.
+EnI106Status I106_CALL_DECL
+    enI106Ch10SetWriteBuffer(int                iI106Ch10Handle,
+                             unsigned long      ulBuffSize,
+                             unsigned long      ulFlushMs);
+
+/// Write any buffered packets to the operating system
+EnI106Status I106_CALL_DECL
+    enI106Ch10Flush(int iI106Ch10Handle);
+
+/// Write any buffered packets and wait until they are on the disk
+EnI106Status I106_CALL_DECL
+    enI106Ch10Sync(int iI106Ch10Handle);
+
+/// Reserve disk space for llSize more bytes past the current write position
+/// so long recordings aren't fragmented.  The file size doesn't change.  
+/// Returns I106_UNSUPPORTED where the OS or file system can't do this.
+EnI106Status I106_CALL_DECL
+    enI106Ch10Preallocate(int iI106Ch10Handle, int64_t llSize);
+
+/// Start a background thread to do the actual writing.  After this the write
+/// routines just copy packets into a ring buffer of ulRingSize bytes, without
+/// taking any locks, and the writer thread empties the ring to disk in large
+/// writes.  Only one thread at a time should write to the handle.  When the 
+/// ring is full enPolicy says whether the write routines wait for room or 
+/// drop the packet and return I106_BUFFER_OVERRUN.  enI106Ch10Flush() waits 
+/// for the ring to empty.  After the writer thread has a disk write error the
+/// write routines return that error and don't take any more packets.
+EnI106Status I106_CALL_DECL
+    enI106Ch10StartWriteThread(int                  iI106Ch10Handle,
+                               unsigned long        ulRingSize,
+                               EnI106WritePolicy    enPolicy);
+
+/// Write everything in the ring and stop the background writer thread. This
+/// is done automatically on close.
+EnI106Status I106_CALL_DECL
+    enI106Ch10StopWriteThread(int iI106Ch10Handle);
+
+/// Get background writer ring fill level, high water mark, and drop counts
+EnI106Status I106_CALL_DECL
+    enI106Ch10GetWriteStats(int iI106Ch10Handle, SuI106WriteStats * psuStats);
+
 // Move file pointer
 // -----------------
 
@@ -459,6 +702,24 @@ int I106_CALL_DECL
 
 int I106_CALL_DECL
     bWriteInOrderIndex(int iHandle, char * szIdxFileName);
+
+/// Identify a data file by size, modify time, and a hash of the data at each
+/// end.  Used to tell whether index and time model files are out of date.
+int I106_CALL_DECL
+    bI106Ch10GetFileId(const char    szFileName[], 
+                       int64_t     * pllSize, 
+                       int64_t     * pllTime, 
+                       uint64_t    * pullHash);
+
+/// Number of processors available, used to pick how many worker threads to run
+int I106_CALL_DECL
+    iI106Ch10GetNumCpus(void);
+
+/// Use the in-order index file if it matches the data file, otherwise make a
+/// new index and write it out.  The index file name defaults to the data file
+/// name with ".idx" added if szIdxFileName is NULL.
+EnI106Status I106_CALL_DECL
+    enI106Ch10LoadInOrderIndex(int iHandle, const char * szIdxFileName);
 EnI106Status I106_CALL_DECL ReadLookAheadRelTime(int iHandle, int64_t *llLookaheadRelTime, EnI106Ch10Mode enMode);
 
 #ifdef __cplusplus
@@ -0,0 +1,393 @@
+/****************************************************************************
+
+ scan_parallel_test.c - Check parallel file scans against a serial read
+
+ Copyright (c) 2006 Irig106.org
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+
+   * Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+   * Neither the name Irig106.org nor the names of its contributors may
+     be used to endorse or promote products derived from this software
+     without specific prior written permission.
+
+ This software is provided by the copyright holders and contributors
+ "as is" and any express or implied warranties, including, but not
+ limited to, the implied warranties of merchantability and fitness for
+ a particular purpose are disclaimed. In no event shall the copyright
+ owner or contributors be liable for any direct, indirect, incidental,
+ special, exemplary, or consequential damages (including, but not
+ limited to, procurement of substitute goods or services; loss of use,
+ data, or profits; or business interruption) however caused and on any
+ theory of liability, whether in contract, strict liability, or tort
+ (including negligence or otherwise) arising in any way out of the use
+ of this software, even if advised of the possibility of such damage.
+
+ ****************************************************************************/
+
+/*
+A test file is made where every packet payload is full of fake headers.  The
+fake headers have good sync patterns and checksums, and packet lengths that
+jump over real packets, so a thread that starts scanning in the middle of
+the file has to tell them from real ones.  The file is read serially with
+enI106Ch10ReadNextHeader() and then scanned with enI106Ch10ScanParallel() and
+enI106Ch10ScanHeadersParallel() with several thread counts.  Every scan has
+to find each real packet exactly once and nothing else.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "i106_stdint.h"
+
+#include "irig106ch10.h"
+#include "i106_time.h"
+
+/*
+ * Macros and definitions
+ * ----------------------
+ */
+
+#define TEST_FILE_NAME      "scan_parallel_test.ch10"
+#define TEST_PACKETS        3000
+#define TEST_MAX_DATA       6000
+#define TEST_FAKE_SPACING   96
+#define TEST_MAX_THREADS    8
+
+/*
+ * Data structures
+ * ---------------
+ */
+
+// What a scan saw, one set of counts per thread so the packet handler
+// doesn't need a lock
+typedef struct
+    {
+    int64_t           * allOffset;      // Real packet offsets, in file order
+    unsigned long     * aulDataSum;     // Byte sum of each packet's data
+    int                 iNumPackets;
+    int               * aaiSeen[TEST_MAX_THREADS];
+    int                 aiUnknown[TEST_MAX_THREADS];
+    int                 aiBadData[TEST_MAX_THREADS];
+    } SuScanResult;
+
+/*
+ * Module data
+ * -----------
+ */
+
+static uint32_t     m_ulRandom = 12345;
+
+/*
+ * Function Declaration
+ * --------------------
+ */
+
+static uint32_t ulNextRandom(void);
+static void vMakeHeader(SuI106Ch10Header * psuHeader, uint16_t uChID, int64_t llRelTime, uint32_t ulDataLen);
+static int  bMakeTestFile(void);
+static int  bReadSerial(SuScanResult * psuResult);
+static int  bCheckScan(SuScanResult * psuResult, int bHeadersOnly, int iNumThreads);
+static EnI106Status I106_CALL_DECL
+    enScanHandler(int iThread, int64_t llFileOffset, SuI106Ch10Header * psuHeader,
+                  void * pvData, void * pvUserData);
+
+
+/* ======================================================================== */
+
+int main(int argc, char ** argv)
+    {
+    SuScanResult        suResult;
+    int                 iNumThreads;
+    int                 iThread;
+    int                 bPass = bTRUE;
+
+    (void)argc;
+    (void)argv;
+
+    memset(&suResult, 0, sizeof(suResult));
+
+    if (bMakeTestFile() == bFALSE)
+        {
+        printf("FAIL - can't make test file %s\n", TEST_FILE_NAME);
+        return 1;
+        }
+
+    // The serial read is the reference
+    if (bReadSerial(&suResult) == bFALSE)
+        {
+        printf("FAIL - serial read\n");
+        remove(TEST_FILE_NAME);
+        return 1;
+        }
+
+    for (iThread=0; iThread<TEST_MAX_THREADS; iThread++)
+        suResult.aaiSeen[iThread] = (int *)malloc(suResult.iNumPackets * sizeof(int));
+
+    // Different thread counts put the range boundaries in different places
+    for (iNumThreads=1; iNumThreads<=TEST_MAX_THREADS; iNumThreads++)
+        {
+        if (bCheckScan(&suResult, bFALSE, iNumThreads) == bFALSE)
+            bPass = bFALSE;
+        if (bCheckScan(&suResult, bTRUE,  iNumThreads) == bFALSE)
+            bPass = bFALSE;
+        }
+
+    for (iThread=0; iThread<TEST_MAX_THREADS; iThread++)
+        free(suResult.aaiSeen[iThread]);
+    free(suResult.allOffset);
+    free(suResult.aulDataSum);
+    remove(TEST_FILE_NAME);
+
+    printf("%s - %d packets\n", bPass ? "PASS" : "FAIL", suResult.iNumPackets);
+
+    return bPass ? 0 : 1;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Simple LCG so the test file is the same on every platform
+
+static uint32_t ulNextRandom(void)
+    {
+    m_ulRandom = m_ulRandom * 1103515245UL + 12345UL;
+    return (m_ulRandom >> 8) & 0x00ffffff;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+static void vMakeHeader(SuI106Ch10Header * psuHeader, uint16_t uChID, int64_t llRelTime, uint32_t ulDataLen)
+    {
+
+    memset(psuHeader, 0, sizeof(SuI106Ch10Header));
+    psuHeader->uSync          = IRIG106_SYNC;
+    psuHeader->uChID          = uChID;
+    psuHeader->ulPacketLen    = HEADER_SIZE + ulDataLen;
+    psuHeader->ulDataLen      = ulDataLen;
+    psuHeader->ubyHdrVer      = 0x06;
+    psuHeader->ubyDataType    = I106CH10_DTYPE_1553_FMT_1;
+    vLLInt2TimeArray(&llRelTime, psuHeader->aubyRefTime);
+    psuHeader->uChecksum      = uCalcHeaderChecksum(psuHeader);
+
+    return;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Make the test file.  Fake headers are planted all through every payload.
+
+static int bMakeTestFile(void)
+    {
+    FILE              * psuFile;
+    SuI106Ch10Header    suHeader;
+    static uint8_t      abyData[TEST_MAX_DATA];
+    uint32_t            ulDataLen;
+    uint32_t            ulFakeLen;
+    uint32_t            ulIdx;
+    int64_t             llRelTime;
+    int                 iPacket;
+
+    psuFile = fopen(TEST_FILE_NAME, "wb");
+    if (psuFile == NULL)
+        return bFALSE;
+
+    llRelTime = 1000000;
+    for (iPacket=0; iPacket<TEST_PACKETS; iPacket++)
+        {
+        ulDataLen = (200 + ulNextRandom() % (TEST_MAX_DATA - 200)) & ~3UL;
+        for (ulIdx=0; ulIdx<ulDataLen; ulIdx++)
+            abyData[ulIdx] = (uint8_t)ulNextRandom();
+
+        for (ulIdx=8; ulIdx+HEADER_SIZE<=ulDataLen; ulIdx+=TEST_FAKE_SPACING)
+            {
+            ulFakeLen = 4 * (ulNextRandom() % 8000);
+            vMakeHeader(&suHeader, 0x77, llRelTime + ulNextRandom(), ulFakeLen);
+            memcpy(&abyData[ulIdx], &suHeader, HEADER_SIZE);
+            }
+
+        vMakeHeader(&suHeader, (uint16_t)(1 + iPacket % 5), llRelTime, ulDataLen);
+        fwrite(&suHeader, HEADER_SIZE, 1, psuFile);
+        fwrite(abyData, ulDataLen, 1, psuFile);
+        llRelTime += 1000;
+        }
+
+    return fclose(psuFile) == 0;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Read the file in order to get the real packets
+
+static int bReadSerial(SuScanResult * psuResult)
+    {
+    int                 iHandle;
+    EnI106Status        enStatus;
+    SuI106Ch10Header    suHeader;
+    static uint8_t      abyData[TEST_MAX_DATA];
+    int64_t             llOffset;
+    uint32_t            ulIdx;
+    unsigned long       ulSum;
+
+    enStatus = enI106Ch10Open(&iHandle, TEST_FILE_NAME, I106_READ);
+    if ((enStatus != I106_OK) && (enStatus != I106_OPEN_WARNING))
+        return bFALSE;
+    enI106Ch10SetPos(iHandle, 0L);
+
+    psuResult->allOffset  = (int64_t *)malloc(TEST_PACKETS * sizeof(int64_t));
+    psuResult->aulDataSum = (unsigned long *)malloc(TEST_PACKETS * sizeof(unsigned long));
+
+    while (psuResult->iNumPackets < TEST_PACKETS)
+        {
+        enStatus = enI106Ch10ReadNextHeader(iHandle, &suHeader);
+        if (enStatus != I106_OK)
+            break;
+        enI106Ch10GetPos(iHandle, &llOffset);
+        llOffset -= iGetHeaderLen(&suHeader);
+
+        enStatus = enI106Ch10ReadData(iHandle, sizeof(abyData), abyData);
+        if (enStatus != I106_OK)
+            break;
+
+        ulSum = 0;
+        for (ulIdx=0; ulIdx<suHeader.ulDataLen; ulIdx++)
+            ulSum += abyData[ulIdx];
+
+        psuResult->allOffset[psuResult->iNumPackets]  = llOffset;
+        psuResult->aulDataSum[psuResult->iNumPackets] = ulSum;
+        psuResult->iNumPackets++;
+        }
+
+    enI106Ch10Close(iHandle);
+
+    return psuResult->iNumPackets == TEST_PACKETS;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Run a parallel scan and compare what it found with the serial read
+
+static int bCheckScan(SuScanResult * psuResult, int bHeadersOnly, int iNumThreads)
+    {
+    EnI106Status        enStatus;
+    int                 iThread;
+    int                 iPacket;
+    int                 iSeen;
+    int                 iMissing   = 0;
+    int                 iDuplicate = 0;
+    int                 iUnknown   = 0;
+    int                 iBadData   = 0;
+
+    for (iThread=0; iThread<TEST_MAX_THREADS; iThread++)
+        {
+        memset(psuResult->aaiSeen[iThread], 0, psuResult->iNumPackets * sizeof(int));
+        psuResult->aiUnknown[iThread] = 0;
+        psuResult->aiBadData[iThread] = 0;
+        }
+
+    if (bHeadersOnly)
+        enStatus = enI106Ch10ScanHeadersParallel(TEST_FILE_NAME, iNumThreads, enScanHandler, psuResult);
+    else
+        enStatus = enI106Ch10ScanParallel(TEST_FILE_NAME, iNumThreads, enScanHandler, psuResult);
+
+    for (iPacket=0; iPacket<psuResult->iNumPackets; iPacket++)
+        {
+        iSeen = 0;
+        for (iThread=0; iThread<TEST_MAX_THREADS; iThread++)
+            iSeen += psuResult->aaiSeen[iThread][iPacket];
+        if (iSeen == 0)
+            iMissing++;
+        else if (iSeen > 1)
+            iDuplicate++;
+        }
+
+    for (iThread=0; iThread<TEST_MAX_THREADS; iThread++)
+        {
+        iUnknown += psuResult->aiUnknown[iThread];
+        iBadData += psuResult->aiBadData[iThread];
+        }
+
+    if ((enStatus != I106_OK) || (iMissing != 0) || (iDuplicate != 0) ||
+        (iUnknown != 0)       || (iBadData != 0))
+        {
+        printf("FAIL - %s %d threads : status %d, missing %d, duplicate %d, false sync %d, bad data %d\n",
+               bHeadersOnly ? "ScanHeadersParallel" : "ScanParallel", iNumThreads,
+               enStatus, iMissing, iDuplicate, iUnknown, iBadData);
+        return bFALSE;
+        }
+
+    return bTRUE;
+    }
+
+
+
+/* ----------------------------------------------------------------------- */
+
+// Mark the packet found as seen by this thread.  Anything that isn't a real
+// packet offset means a fake header was taken for a real one.
+
+static EnI106Status I106_CALL_DECL
+    enScanHandler(int iThread, int64_t llFileOffset, SuI106Ch10Header * psuHeader,
+                  void * pvData, void * pvUserData)
+    {
+    SuScanResult      * psuResult = (SuScanResult *)pvUserData;
+    int                 iLower;
+    int                 iUpper;
+    int                 iProbe;
+    uint32_t            ulIdx;
+    unsigned long       ulSum;
+
+    if ((iThread < 0) || (iThread >= TEST_MAX_THREADS))
+        return I106_INVALID_PARAMETER;
+
+    iLower = 0;
+    iUpper = psuResult->iNumPackets;
+    while (iLower < iUpper)
+        {
+        iProbe = iLower + (iUpper - iLower) / 2;
+        if (psuResult->allOffset[iProbe] < llFileOffset)
+            iLower = iProbe + 1;
+        else
+            iUpper = iProbe;
+        }
+
+    if ((iLower >= psuResult->iNumPackets) || (psuResult->allOffset[iLower] != llFileOffset))
+        {
+        psuResult->aiUnknown[iThread]++;
+        return I106_OK;
+        }
+
+    psuResult->aaiSeen[iThread][iLower]++;
+
+    if (pvData != NULL)
+        {
+        ulSum = 0;
+        for (ulIdx=0; ulIdx<psuHeader->ulDataLen; ulIdx++)
+            ulSum += ((uint8_t *)pvData)[ulIdx];
+        if (ulSum != psuResult->aulDataSum[iLower])
+            psuResult->aiBadData[iThread]++;
+        }
+
+    return I106_OK;
+    }